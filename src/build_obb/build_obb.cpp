@@ -1,10 +1,154 @@
 #include <DagMC.hpp>
 #include "moab/ProgOptions.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// tags used by GeomTopoTool to associate OBB roots with geometry sets
+#define OBB_ROOT_TAG_NAME "OBB_ROOT"
+#define OBB_GSET_TAG_NAME "OBB_GSET"
+
+// read the per-volume telemetry written by DagMC::write_ray_telemetry
+static bool read_ray_stats(const std::string& filename,
+                           std::map<int, moab::DagMC::RayTelemetry>& stats) {
+  std::ifstream in(filename.c_str());
+  if (!in)
+    return false;
+
+  std::string line;
+  std::getline(in, line); // header
+  while (std::getline(in, line)) {
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+    int id;
+    moab::DagMC::RayTelemetry rec;
+    if (fields >> id >> rec.rays >> rec.ray_tri_tests
+        >> rec.nodes_visited >> rec.leaves_visited)
+      stats[id] = rec;
+  }
+  return true;
+}
+
+// choose the leaf size for each volume's surfaces from its share of the
+// recorded rays: volumes hit more often than average, where triangle tests
+// outweigh node visits, get proportionally smaller leaves; volumes no ray
+// entered get larger ones
+static int weighted_leaf_size(const moab::DagMC::RayTelemetry* rec,
+                              unsigned long total_rays, int num_vols,
+                              int default_leaf) {
+  if (!rec || 0 == rec->rays)
+    return 2 * default_leaf;
+
+  double density = (double)rec->rays * num_vols / total_rays;
+  if (density <= 1.0 || rec->ray_tri_tests <= rec->nodes_visited)
+    return default_leaf;
+
+  return std::max(2, default_leaf / (int)std::ceil(density));
+}
+
+// build the OBB trees with per-surface leaf sizes taken from ray telemetry
+static moab::ErrorCode build_weighted_obbs(moab::DagMC* DAG,
+                                           const std::map<int, moab::DagMC::RayTelemetry>& stats,
+                                           bool verbose) {
+  moab::Interface* MBI = DAG->moab_instance();
+  moab::GeomTopoTool* GTT = DAG->geom_tool().get();
+  moab::OrientedBoxTreeTool* obbs = GTT->obb_tree();
+  moab::ErrorCode rval;
+
+  moab::Tag root_tag, gset_tag;
+  rval = MBI->tag_get_handle(OBB_ROOT_TAG_NAME, 1, moab::MB_TYPE_HANDLE, root_tag,
+                             moab::MB_TAG_CREAT | moab::MB_TAG_SPARSE);
+  MB_CHK_SET_ERR(rval, "Failed to get the OBB root tag");
+  rval = MBI->tag_get_handle(OBB_GSET_TAG_NAME, 1, moab::MB_TYPE_HANDLE, gset_tag,
+                             moab::MB_TAG_CREAT | moab::MB_TAG_SPARSE);
+  MB_CHK_SET_ERR(rval, "Failed to get the OBB geometry set tag");
+
+  moab::Range surfs, vols;
+  rval = DAG->setup_geometry(surfs, vols);
+  MB_CHK_SET_ERR(rval, "Failed to get the geometry sets");
+
+  unsigned long total_rays = 0;
+  std::map<int, moab::DagMC::RayTelemetry>::const_iterator sit;
+  for (sit = stats.begin(); sit != stats.end(); ++sit)
+    total_rays += sit->second.rays;
+
+  moab::OrientedBoxTreeTool::Settings settings;
+  const int default_leaf = settings.max_leaf_entities;
+
+  // a surface shared by several volumes takes the finest leaf size
+  std::map<moab::EntityHandle, int> surf_leaf;
+  for (moab::Range::iterator vit = vols.begin(); vit != vols.end(); ++vit) {
+    sit = stats.find(DAG->get_entity_id(*vit));
+    int leaf = weighted_leaf_size(sit == stats.end() ? NULL : &sit->second,
+                                  total_rays, vols.size(), default_leaf);
+    if (verbose)
+      std::cout << "Volume " << DAG->get_entity_id(*vit)
+                << " leaf size " << leaf << std::endl;
+
+    std::vector<moab::EntityHandle> children;
+    rval = MBI->get_child_meshsets(*vit, children);
+    MB_CHK_SET_ERR(rval, "Failed to get volume surfaces");
+    for (unsigned i = 0; i < children.size(); ++i) {
+      std::map<moab::EntityHandle, int>::iterator it = surf_leaf.find(children[i]);
+      if (it == surf_leaf.end())
+        surf_leaf[children[i]] = leaf;
+      else
+        it->second = std::min(it->second, leaf);
+    }
+  }
+
+  for (moab::Range::iterator it = surfs.begin(); it != surfs.end(); ++it) {
+    moab::EntityHandle surf = *it;
+    moab::Range tris;
+    rval = MBI->get_entities_by_dimension(surf, 2, tris);
+    MB_CHK_SET_ERR(rval, "Failed to get surface triangles");
+
+    settings.max_leaf_entities = surf_leaf.count(surf) ? surf_leaf[surf] : default_leaf;
+    moab::EntityHandle root;
+    rval = obbs->build(tris, root, &settings);
+    MB_CHK_SET_ERR(rval, "Failed to build surface OBB tree");
+    rval = MBI->tag_set_data(root_tag, &surf, 1, &root);
+    MB_CHK_SET_ERR(rval, "Failed to tag surface OBB root");
+    rval = MBI->tag_set_data(gset_tag, &root, 1, &surf);
+    MB_CHK_SET_ERR(rval, "Failed to tag OBB root with surface");
+  }
+
+  settings.max_leaf_entities = default_leaf;
+  for (moab::Range::iterator it = vols.begin(); it != vols.end(); ++it) {
+    moab::EntityHandle vol = *it;
+    std::vector<moab::EntityHandle> children;
+    rval = MBI->get_child_meshsets(vol, children);
+    MB_CHK_SET_ERR(rval, "Failed to get volume surfaces");
+
+    moab::Range trees;
+    for (unsigned i = 0; i < children.size(); ++i) {
+      moab::EntityHandle surf_root;
+      rval = MBI->tag_get_data(root_tag, &children[i], 1, &surf_root);
+      MB_CHK_SET_ERR(rval, "Failed to get surface OBB root");
+      trees.insert(surf_root);
+    }
+
+    moab::EntityHandle root;
+    rval = obbs->join_trees(trees, root, &settings);
+    MB_CHK_SET_ERR(rval, "Failed to build volume OBB tree");
+    rval = MBI->tag_set_data(root_tag, &vol, 1, &root);
+    MB_CHK_SET_ERR(rval, "Failed to tag volume OBB root");
+    rval = MBI->tag_set_data(gset_tag, &root, 1, &vol);
+    MB_CHK_SET_ERR(rval, "Failed to tag OBB root with volume");
+  }
+
+  return moab::MB_SUCCESS;
+}
+
 int main(int argc, char* argv[]) {
 
   std::string dag_file;
   std::string out_file;
+  std::string ray_stats_file;
   bool verbose = false;
 
   ProgOptions po("build_obb: A tool to prebuild your DAGMC OBB Tree");
@@ -12,6 +156,8 @@ int main(int argc, char* argv[]) {
   po.addOpt<void>("verbose,v", "Verbose output", &verbose);
   po.addRequiredArg<std::string>("dag_file", "Path to DAGMC file to proccess", &dag_file);
   po.addOpt<std::string>("output,o", "Specify the output filename (default "")", &out_file);
+  po.addOpt<std::string>("ray-stats,r", "Ray telemetry CSV from a previous run; "
+                         "tree leaf sizes follow the recorded ray distribution", &ray_stats_file);
 
   po.addOptionHelpHeading("Options for loading files");
 
@@ -41,11 +187,27 @@ int main(int argc, char* argv[]) {
     exit(EXIT_FAILURE);
   }
 
-  // initialize geometry
-  rval = DAG->init_OBBTree();
-  if (moab::MB_SUCCESS != rval) {
-    std::cerr << "DAGMC failed to initialize geometry and create OBB tree" <<  std::endl;
-    exit(EXIT_FAILURE);
+  if (ray_stats_file == "") {
+    // initialize geometry
+    rval = DAG->init_OBBTree();
+    if (moab::MB_SUCCESS != rval) {
+      std::cerr << "DAGMC failed to initialize geometry and create OBB tree" <<  std::endl;
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    std::map<int, moab::DagMC::RayTelemetry> stats;
+    if (!read_ray_stats(ray_stats_file, stats)) {
+      std::cerr << "DAGMC failed to read ray telemetry file: " << ray_stats_file << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    rval = DAG->setup_impl_compl();
+    if (moab::MB_SUCCESS == rval)
+      rval = build_weighted_obbs(DAG, stats, verbose);
+    if (moab::MB_SUCCESS != rval) {
+      std::cerr << "DAGMC failed to create ray weighted OBB tree" <<  std::endl;
+      exit(EXIT_FAILURE);
+    }
   }
 
   // write the new file
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <limits>
 #include <algorithm>
+#include <numeric>
 #include <set>
 #include <climits>
 
@@ -99,6 +100,10 @@ DagMC::~DagMC() {
   // clear it
   if (moab_instance_created) {
     MBI->delete_mesh();
+  } else {
+    // leave nothing of ours behind in an externally owned instance
+    for (unsigned i = 0; i < implComplRegions.size(); ++i)
+      GTT->obb_tree()->delete_tree(implComplRegions[i].root);
   }
 }
 
@@ -201,6 +206,97 @@ ErrorCode DagMC::setup_obbs() {
   return MB_SUCCESS;
 }
 
+// divides the implicit complement surfaces into spatial groups, each with
+// its own OBB tree, for use in impl_compl_ray_fire
+ErrorCode DagMC::setup_impl_compl_regions() {
+#ifndef DOUBLE_DOWN
+  if (implComplSplitDepth <= 0 || !implComplRegions.empty())
+    return MB_SUCCESS;
+
+  ErrorCode rval = GTT->get_implicit_complement(implComplVol);
+  MB_CHK_SET_ERR(rval, "Failed to get the implicit complement");
+
+  std::vector<EntityHandle> surfs;
+  rval = MBI->get_child_meshsets(implComplVol, surfs);
+  MB_CHK_SET_ERR(rval, "Failed to get the implicit complement surfaces");
+
+  // bounding boxes of the surfaces, as min and max corners
+  std::vector<double> boxes(6 * surfs.size());
+  for (unsigned i = 0; i < surfs.size(); ++i) {
+    rval = GTT->get_bounding_coords(surfs[i], &boxes[6 * i], &boxes[6 * i + 3]);
+    MB_CHK_SET_ERR(rval, "Failed to get surface bounding box");
+  }
+
+  // median splits on the longest extent of the box centers
+  std::vector<int> order(surfs.size());
+  for (unsigned i = 0; i < order.size(); ++i)
+    order[i] = i;
+
+  struct Split { int begin, end, depth; };
+  std::vector<Split> stack(1, Split{0, (int)order.size(), implComplSplitDepth});
+  while (!stack.empty()) {
+    Split sp = stack.back();
+    stack.pop_back();
+
+    if (sp.depth > 0 && sp.end - sp.begin > 1) {
+      double lo[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL};
+      double hi[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+      for (int i = sp.begin; i < sp.end; ++i) {
+        for (int j = 0; j < 3; ++j) {
+          double c = boxes[6 * order[i] + j] + boxes[6 * order[i] + 3 + j];
+          lo[j] = std::min(lo[j], c);
+          hi[j] = std::max(hi[j], c);
+        }
+      }
+      int axis = 0;
+      for (int j = 1; j < 3; ++j)
+        if (hi[j] - lo[j] > hi[axis] - lo[axis])
+          axis = j;
+
+      int mid = (sp.begin + sp.end) / 2;
+      std::nth_element(order.begin() + sp.begin, order.begin() + mid,
+                       order.begin() + sp.end, [&](int a, int b) {
+        return boxes[6 * a + axis] + boxes[6 * a + 3 + axis] <
+               boxes[6 * b + axis] + boxes[6 * b + 3 + axis];
+      });
+      stack.push_back(Split{sp.begin, mid, sp.depth - 1});
+      stack.push_back(Split{mid, sp.end, sp.depth - 1});
+      continue;
+    }
+
+    // the region tree joins the existing surface trees, as a volume tree does
+    ImplComplRegion region;
+    Range roots;
+    for (int j = 0; j < 3; ++j) {
+      region.box_min[j] = HUGE_VAL;
+      region.box_max[j] = -HUGE_VAL;
+    }
+    for (int i = sp.begin; i < sp.end; ++i) {
+      EntityHandle root;
+      rval = GTT->get_root(surfs[order[i]], root);
+      MB_CHK_SET_ERR(rval, "Failed to get the obb tree root of a surface");
+      roots.insert(root);
+      for (int j = 0; j < 3; ++j) {
+        region.box_min[j] = std::min(region.box_min[j],
+                                     boxes[6 * order[i] + j] - numerical_precision());
+        region.box_max[j] = std::max(region.box_max[j],
+                                     boxes[6 * order[i] + 3 + j] + numerical_precision());
+      }
+    }
+    if (roots.empty())
+      continue;
+
+    rval = GTT->obb_tree()->join_trees(roots, region.root);
+    MB_CHK_SET_ERR(rval, "Failed to build implicit complement region tree");
+    implComplRegions.push_back(region);
+  }
+
+  std::cout << "Split the implicit complement into " << implComplRegions.size()
+            << " regions" << std::endl;
+#endif
+  return MB_SUCCESS;
+}
+
 // setups of the indices for the problem, builds a list of surface and volumes
 // indices
 ErrorCode DagMC::setup_indices() {
@@ -229,6 +325,10 @@ ErrorCode DagMC::init_OBBTree() {
   rval = setup_obbs();
   MB_CHK_SET_ERR(rval, "Failed to setup the OBBs");
 
+  // split the implicit complement, if requested
+  rval = setup_impl_compl_regions();
+  MB_CHK_SET_ERR(rval, "Failed to split the implicit complement");
+
   // setup indices
   rval = setup_indices();
   MB_CHK_SET_ERR(rval, "Failed to setup problem indices");
@@ -286,25 +386,304 @@ ErrorCode DagMC::finish_loading() {
 
 /* SECTION II: Fundamental Geometry Operations/Queries */
 
+#ifndef DOUBLE_DOWN
+// intersection callback that applies the acceptance rules of
+// GeomQueryTool::ray_fire: facets in the history are skipped, facets are
+// only hit from the side given by the ray orientation and the surface sense,
+// and the hit nearest the ray origin is kept, including hits behind it
+// within the negative search window
+class FireRayRegCtxt : public IntRegCtxt {
+ public:
+  FireRayRegCtxt(GeomTopoTool* gtt, EntityHandle volume, const int* orientation,
+                 const DagMC::RayHistory* history, bool first_hit = false)
+    : GTT(gtt), vol(volume), orient(orientation), prevFacets(history),
+      firstHit(first_hit), closed(0.0), posDist(0.0), posSurf(0), posFacet(0),
+      negDist(0.0), negSurf(0), negFacet(0) {}
+
+  ErrorCode register_intersection(EntityHandle set, EntityHandle tri, double dist,
+                                  OrientedBoxTreeTool::IntersectSearchWindow& search_win,
+                                  GeomUtil::intersection_type) {
+    if ((firstHit && found()) || (prevFacets && prevFacets->in_history(tri)))
+      return MB_SUCCESS;
+
+    if (dist < 0.0) {
+      negDist = dist;
+      negSurf = set;
+      negFacet = tri;
+    } else {
+      posDist = dist;
+      posSurf = set;
+      posFacet = tri;
+      // a hit behind the origin must now be nearer than this one
+      if (dist < -*search_win.second) {
+        negDist = -dist;
+        negSurf = negFacet = 0;
+      }
+    }
+    narrow(search_win);
+    return MB_SUCCESS;
+  }
+
+  ErrorCode update_orient(EntityHandle set, int* surfTriOrient) {
+    int sense;
+    ErrorCode rval = GTT->get_sense(set, vol, sense);
+    MB_CHK_SET_ERR(rval, "Failed to get surface sense");
+    *surfTriOrient = *orient * sense;
+    return MB_SUCCESS;
+  }
+
+  const int* getDesiredOrient() { return orient; }
+
+  bool found() const { return posFacet || negFacet; }
+
+  // limits the search window to hits nearer than those already found, or
+  // closes it once any hit is found if only the first one is wanted
+  void narrow(OrientedBoxTreeTool::IntersectSearchWindow& search_win) const {
+    if (firstHit && found()) {
+      search_win.first = search_win.second = &closed;
+      return;
+    }
+    if (posFacet)
+      search_win.first = &posDist;
+    if (negFacet || negDist != 0.0)
+      search_win.second = &negDist;
+  }
+
+  // the accepted hit nearest the ray origin, if any
+  bool nearest(double& dist, EntityHandle& surf, EntityHandle& facet) const {
+    if (!found())
+      return false;
+    bool use_neg = negFacet && (!posFacet || -negDist < posDist);
+    dist = use_neg ? negDist : posDist;
+    surf = use_neg ? negSurf : posSurf;
+    facet = use_neg ? negFacet : posFacet;
+    return true;
+  }
+
+ private:
+  GeomTopoTool* GTT;
+  EntityHandle vol;
+  const int* orient;
+  const DagMC::RayHistory* prevFacets;
+  bool firstHit;
+  const double closed;
+  double posDist;
+  EntityHandle posSurf, posFacet;
+  double negDist;
+  EntityHandle negSurf, negFacet;
+};
+#endif
+
 ErrorCode DagMC::ray_fire(const EntityHandle volume, const double point[3],
                           const double dir[3], EntityHandle& next_surf,
                           double& next_surf_dist,
                           RayHistory* history,
                           double user_dist_limit, int ray_orientation,
                           OrientedBoxTreeTool::TrvStats* stats) {
-  ErrorCode rval = ray_tracer->ray_fire(volume, point, dir, next_surf, next_surf_dist,
-                                        history, user_dist_limit, ray_orientation,
-                                        stats);
+  if (!recordTelemetry) {
+    ErrorCode rval = trace_ray(volume, point, dir, next_surf, next_surf_dist,
+                               history, user_dist_limit, ray_orientation,
+                               stats);
+    return rval;
+  }
+
+  // the caller's stats may already hold counts, so record the difference
+  OrientedBoxTreeTool::TrvStats local_stats;
+  OrientedBoxTreeTool::TrvStats* trv = stats ? stats : &local_stats;
+  unsigned long tri_before = trv->ray_tri_tests();
+  unsigned long nodes_before = std::accumulate(trv->nodes_visited().begin(),
+                                               trv->nodes_visited().end(), 0ul);
+  unsigned long leaves_before = std::accumulate(trv->leaves_visited().begin(),
+                                                trv->leaves_visited().end(), 0ul);
+
+  ErrorCode rval = trace_ray(volume, point, dir, next_surf, next_surf_dist,
+                             history, user_dist_limit, ray_orientation,
+                             trv);
+
+  RayTelemetry& rec = rayTelemetry[volume];
+  rec.rays++;
+  rec.ray_tri_tests += trv->ray_tri_tests() - tri_before;
+  rec.nodes_visited += std::accumulate(trv->nodes_visited().begin(),
+                                       trv->nodes_visited().end(), 0ul) - nodes_before;
+  rec.leaves_visited += std::accumulate(trv->leaves_visited().begin(),
+                                        trv->leaves_visited().end(), 0ul) - leaves_before;
   return rval;
 }
 
+ErrorCode DagMC::trace_ray(const EntityHandle volume, const double point[3],
+                           const double dir[3], EntityHandle& next_surf,
+                           double& next_surf_dist,
+                           RayHistory* history,
+                           double user_dist_limit, int ray_orientation,
+                           OrientedBoxTreeTool::TrvStats* stats) {
+  if (!implComplRegions.empty() && volume == implComplVol)
+    return impl_compl_ray_fire(point, dir, next_surf, next_surf_dist, history,
+                               user_dist_limit, ray_orientation, stats);
+
+  return ray_tracer->ray_fire(volume, point, dir, next_surf, next_surf_dist,
+                              history, user_dist_limit, ray_orientation, stats);
+}
+
+ErrorCode DagMC::impl_compl_ray_fire(const double point[3], const double dir[3],
+                                     EntityHandle& next_surf,
+                                     double& next_surf_dist,
+                                     RayHistory* history,
+                                     double user_dist_limit, int ray_orientation,
+                                     OrientedBoxTreeTool::TrvStats* stats) {
+  next_surf = 0;
+#ifndef DOUBLE_DOWN
+  // the same search window as GeomQueryTool::ray_fire
+  double neg_ray_len = overlap_thickness() > 0.0 ? -overlap_thickness()
+                       : -numerical_precision();
+  double nonneg_ray_len = user_dist_limit > 0.0 ? user_dist_limit
+                          : std::numeric_limits<double>::max();
+  nonneg_ray_len = std::max(nonneg_ray_len, -neg_ray_len);
+
+  // slab test each region box, keeping those the ray passes through
+  regionOrder.clear();
+  for (unsigned i = 0; i < implComplRegions.size(); ++i) {
+    const ImplComplRegion& region = implComplRegions[i];
+    double t0 = neg_ray_len, t1 = nonneg_ray_len;
+    for (int j = 0; j < 3 && t0 <= t1; ++j) {
+      if (dir[j] == 0.0) {
+        if (point[j] < region.box_min[j] || point[j] > region.box_max[j])
+          t0 = HUGE_VAL;
+        continue;
+      }
+      double ta = (region.box_min[j] - point[j]) / dir[j];
+      double tb = (region.box_max[j] - point[j]) / dir[j];
+      t0 = std::max(t0, std::min(ta, tb));
+      t1 = std::min(t1, std::max(ta, tb));
+    }
+    if (t0 <= t1)
+      regionOrder.push_back(std::make_pair(t0, i));
+  }
+  std::sort(regionOrder.begin(), regionOrder.end());
+
+  // search the region trees nearest first; every surface belongs to exactly
+  // one region, so regions entered beyond the nearest hit can be skipped
+  FireRayRegCtxt ctxt(GTT.get(), implComplVol, &ray_orientation, history);
+  OrientedBoxTreeTool::IntersectSearchWindow search_win(&nonneg_ray_len, &neg_ray_len);
+  std::vector<double> dists;
+  std::vector<EntityHandle> surfs, facets;
+  for (unsigned i = 0; i < regionOrder.size(); ++i) {
+    if (regionOrder[i].first > *search_win.first)
+      break;
+
+    ErrorCode rval = GTT->obb_tree()->ray_intersect_sets(
+                       dists, surfs, facets,
+                       implComplRegions[regionOrder[i].second].root,
+                       numerical_precision(), point, dir, search_win, ctxt,
+                       stats);
+    MB_CHK_SET_ERR(rval, "Failed to intersect ray with implicit complement region");
+    ctxt.narrow(search_win);
+  }
+
+  EntityHandle facet;
+  if (ctxt.nearest(next_surf_dist, next_surf, facet)) {
+    next_surf_dist = std::max(0.0, next_surf_dist);
+    if (history)
+      history->add_entity(facet);
+  }
+#endif
+  return MB_SUCCESS;
+}
+
+ErrorCode DagMC::any_hit_within(const EntityHandle volume, const double point[3],
+                                const double dir[3], double dist, bool& hit,
+                                const RayHistory* history) {
+#ifdef DOUBLE_DOWN
+  // no early exit available, fall back to a limited ray_fire on a copy of
+  // the history so the caller's is left untouched
+  RayHistory scratch;
+  if (history)
+    scratch = *history;
+  EntityHandle next_surf = 0;
+  double next_surf_dist;
+  ErrorCode rval = ray_tracer->ray_fire(volume, point, dir, next_surf, next_surf_dist,
+                                        &scratch, dist);
+  MB_CHK_SET_ERR(rval, "Failed to fire ray");
+  hit = (0 != next_surf);
+  return MB_SUCCESS;
+#else
+  EntityHandle root;
+  ErrorCode rval = GTT->get_root(volume, root);
+  MB_CHK_SET_ERR(rval, "Failed to get the obb tree root of the volume");
+
+  // the same search window as GeomQueryTool::ray_fire, including hits
+  // behind the origin within the overlap thickness
+  double neg_ray_len = overlap_thickness() > 0.0 ? -overlap_thickness()
+                       : -numerical_precision();
+  double nonneg_ray_len = std::max(dist, -neg_ray_len);
+  int orientation = 1;
+
+  FireRayRegCtxt ctxt(GTT.get(), volume, &orientation, history, true);
+  OrientedBoxTreeTool::IntersectSearchWindow search_win(&nonneg_ray_len, &neg_ray_len);
+  std::vector<double> dists;
+  std::vector<EntityHandle> sets, facets;
+  rval = GTT->obb_tree()->ray_intersect_sets(dists, sets, facets, root,
+                                             numerical_precision(), point, dir,
+                                             search_win, ctxt);
+  MB_CHK_SET_ERR(rval, "Failed to intersect ray with volume");
+
+  hit = ctxt.found();
+  return MB_SUCCESS;
+#endif
+}
+
 ErrorCode DagMC::point_in_volume(const EntityHandle volume, const double xyz[3],
                                  int& result, const double* uvw,
                                  const RayHistory* history) {
+  ++pivCasts;
   ErrorCode rval = ray_tracer->point_in_volume(volume, xyz, result, uvw, history);
   return rval;
 }
 
+ErrorCode DagMC::point_in_volume(const EntityHandle volume, const double xyz[3],
+                                 int& result, const double* uvw,
+                                 const RayHistory* history,
+                                 EntityHandle last_surface) {
+  // the history only locates the crossed facet; the full test fires its ray
+  // without it, as a plain point_in_volume call does
+  EntityHandle facet = 0;
+  if (!last_surface || !uvw || !history ||
+      MB_SUCCESS != history->get_last_intersection(facet))
+    return point_in_volume(volume, xyz, result, uvw);
+
+  // only a volume bounded by the crossed surface can use it, and a two-sided
+  // surface tells us nothing
+  int sense;
+  if (MB_SUCCESS != GTT->get_sense(last_surface, volume, sense) || 0 == sense)
+    return point_in_volume(volume, xyz, result, uvw);
+
+  const EntityHandle* conn;
+  int len;
+  ErrorCode rval = MBI->get_connectivity(facet, conn, len);
+  MB_CHK_SET_ERR(rval, "Failed to get facet connectivity");
+  CartVect coords[3];
+  rval = MBI->get_coords(conn, 3, coords[0].array());
+  MB_CHK_SET_ERR(rval, "Failed to get facet coordinates");
+
+  // the point must sit on the facet itself, not just on its plane
+  CartVect pt(xyz), closest;
+  GeomUtil::closest_location_on_tri(pt, coords, closest);
+  if ((pt - closest).length() > numerical_precision())
+    return point_in_volume(volume, xyz, result, uvw);
+
+  // directions that graze the facet are left to the full test
+  CartVect normal = (coords[1] - coords[0]) * (coords[2] - coords[0]);
+  if (fabs(normal % CartVect(uvw)) <= numerical_precision() * normal.length())
+    return point_in_volume(volume, xyz, result, uvw);
+
+  // the direction against the facet normal decides, as for a boundary test
+  rval = test_volume_boundary(volume, last_surface, xyz, uvw, result, history);
+  if (MB_SUCCESS != rval)
+    return point_in_volume(volume, xyz, result, uvw);
+
+  ++pivCastsAvoided;
+  return MB_SUCCESS;
+}
+
 ErrorCode DagMC::test_volume_boundary(const EntityHandle volume,
                                       const EntityHandle surface,
                                       const double xyz[3], const double uvw[3],
@@ -370,6 +749,109 @@ ErrorCode DagMC::next_vol(EntityHandle surface, EntityHandle old_volume,
   return rval;
 }
 
+ErrorCode DagMC::trace_segments(EntityHandle start_volume,
+                                const double origin[3], const double dir[3],
+                                double max_dist,
+                                std::vector<TrackSegment>& segments) {
+  segments.clear();
+  return append_segments(start_volume, origin, dir, max_dist, segments);
+}
+
+ErrorCode DagMC::trace_segments_batch(int num_paths,
+                                      const EntityHandle* start_volumes,
+                                      const double* origins,
+                                      const double* dirs,
+                                      const double* max_dists,
+                                      std::vector<TrackSegment>& segments,
+                                      std::vector<int>& offsets) {
+  segments.clear();
+  offsets.clear();
+  offsets.reserve(num_paths + 1);
+  offsets.push_back(0);
+
+  for (int i = 0; i < num_paths; ++i) {
+    ErrorCode rval = append_segments(start_volumes[i], origins + 3 * i,
+                                     dirs + 3 * i, max_dists[i], segments);
+    MB_CHK_SET_ERR(rval, "Failed to trace path " << i);
+    offsets.push_back(segments.size());
+  }
+
+  return MB_SUCCESS;
+}
+
+ErrorCode DagMC::append_segments(EntityHandle start_volume,
+                                 const double origin[3], const double dir[3],
+                                 double max_dist,
+                                 std::vector<TrackSegment>& segments) {
+  if (max_dist <= 0.0) {
+    MB_SET_ERR(MB_FAILURE, "Path length must be positive");
+  }
+
+  traceHistory.reset();
+
+  EntityHandle vol = start_volume;
+  double dist = 0.0;
+  double pos[3] = {origin[0], origin[1], origin[2]};
+
+  while (vol) {
+    TrackSegment seg;
+    seg.volume = vol;
+    seg.entry_dist = dist;
+    seg.exit_dist = max_dist;
+    seg.exit_surface = 0;
+
+    EntityHandle next_surf = 0;
+    double next_surf_dist = 0.0;
+    ErrorCode rval = ray_fire(vol, pos, dir, next_surf, next_surf_dist,
+                              &traceHistory, max_dist - dist);
+    MB_CHK_SET_ERR(rval, "Failed to fire ray while tracing segments");
+
+    // no crossing before the end of the path
+    if (!next_surf || dist + next_surf_dist >= max_dist) {
+      segments.push_back(seg);
+      break;
+    }
+
+    dist += next_surf_dist;
+    seg.exit_dist = dist;
+    seg.exit_surface = next_surf;
+    segments.push_back(seg);
+
+    // measure positions from the origin so round-off does not accumulate
+    for (int j = 0; j < 3; ++j)
+      pos[j] = origin[j] + dist * dir[j];
+
+    EntityHandle new_vol = 0;
+    rval = next_vol(next_surf, vol, new_vol);
+    MB_CHK_SET_ERR(rval, "Failed to find volume across surface");
+    vol = new_vol;
+  }
+
+  return MB_SUCCESS;
+}
+
+void DagMC::set_ray_telemetry(bool enable) {
+  recordTelemetry = enable;
+  rayTelemetry.clear();
+}
+
+ErrorCode DagMC::write_ray_telemetry(const char* filename) {
+  std::ofstream out(filename);
+  if (!out) {
+    MB_SET_ERR(MB_FILE_WRITE_ERROR, "Could not open ray telemetry file " << filename);
+  }
+
+  out << "volume_id,rays,ray_tri_tests,nodes_visited,leaves_visited" << std::endl;
+  std::map<EntityHandle, RayTelemetry>::const_iterator it;
+  for (it = rayTelemetry.begin(); it != rayTelemetry.end(); ++it) {
+    out << get_entity_id(it->first) << "," << it->second.rays << ","
+        << it->second.ray_tri_tests << "," << it->second.nodes_visited << ","
+        << it->second.leaves_visited << std::endl;
+  }
+
+  return MB_SUCCESS;
+}
+
 /* SECTION III */
 
 EntityHandle DagMC::entity_by_id(int dimension, int id) {
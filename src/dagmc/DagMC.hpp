@@ -155,6 +155,24 @@ class DagMC {
    */
   ErrorCode setup_indices();
 
+  /**\brief split the implicit complement into spatial regions
+   *
+   * Set before init_OBBTree. The surfaces of the implicit complement are
+   * divided into 2^depth groups by recursive median splits of their
+   * bounding box centers, and each group gets an OBB tree joining its
+   * surface trees. Rays fired in the implicit complement search only the
+   * trees of the groups whose bounding boxes they pass through, nearest
+   * first, and never the full implicit complement tree. The implicit
+   * complement is still a single volume. A depth of 0 (the default)
+   * disables the split.
+   */
+  void set_implicit_complement_split(int depth) { implComplSplitDepth = depth; }
+
+  /**\brief builds the implicit complement regions requested by
+   * set_implicit_complement_split, called by init_OBBTree
+   */
+  ErrorCode setup_impl_compl_regions();
+
 
  private:
   /** loading code shared by load_file and load_existing_contents */
@@ -176,13 +194,48 @@ class DagMC {
                      double dist_limit = 0, int ray_orientation = 1,
                      OrientedBoxTreeTool::TrvStats* stats = NULL);
 
+  /**\brief is there any surface of volume closer than dist along the ray?
+   *
+   * An occlusion query for distance-limited tracking: hit is true exactly
+   * when ray_fire with a dist_limit of dist would find a surface. Facets are
+   * accepted by the same rules, including hits behind the start point within
+   * overlap_thickness, but the traversal stops at the first one. The nearest
+   * hit is not found and history is not changed, so a ray_fire is still
+   * needed when hit is true.
+   *\param hit set to true if such a facet exists
+   */
+  ErrorCode any_hit_within(const EntityHandle volume, const double ray_start[3],
+                           const double ray_dir[3], double dist, bool& hit,
+                           const RayHistory* history = NULL);
+
   ErrorCode point_in_volume(const EntityHandle volume, const double xyz[3],
                             int& result, const double* uvw = NULL,
                             const RayHistory* history = NULL);
 
+  /**\brief point_in_volume for a point that has just crossed a surface
+   *
+   * The last facet in history is taken to lie on last_surface. If volume is
+   * bounded by last_surface and xyz lies within numerical_precision of that
+   * facet, the answer comes from test_volume_boundary and no ray is fired.
+   * Otherwise, or when uvw is NULL or tangent to the facet, this falls back
+   * to the full point_in_volume without the history.
+   *\param last_surface the surface most recently crossed, 0 if unknown
+   */
+  ErrorCode point_in_volume(const EntityHandle volume, const double xyz[3],
+                            int& result, const double* uvw,
+                            const RayHistory* history,
+                            EntityHandle last_surface);
+
   ErrorCode point_in_volume_slow(const EntityHandle volume, const double xyz[3],
                                  int& result);
 
+  /** number of point_in_volume calls answered without firing a ray */
+  unsigned long point_in_volume_casts_avoided() const { return pivCastsAvoided; }
+  /** number of point_in_volume calls that fired a ray */
+  unsigned long point_in_volume_casts() const { return pivCasts; }
+  /** zero both point_in_volume counters */
+  void reset_point_in_volume_counters() { pivCastsAvoided = pivCasts = 0; }
+
   ErrorCode test_volume_boundary(const EntityHandle volume,
                                  const EntityHandle surface,
                                  const double xyz[3], const double uvw[3],
@@ -208,6 +261,72 @@ class DagMC {
   ErrorCode next_vol(EntityHandle surface, EntityHandle old_volume,
                      EntityHandle& new_volume);
 
+  /** One piece of a straight path through the geometry: the volume it lies
+   *  in, the distances along the path at which it enters and leaves that
+   *  volume, and the surface it leaves through (0 if the path ended inside
+   *  the volume).
+   */
+  struct TrackSegment {
+    EntityHandle volume;
+    double entry_dist;
+    double exit_dist;
+    EntityHandle exit_surface;
+  };
+
+  /**\brief walk a straight path and return every volume segment along it
+   *
+   * Starting in start_volume at origin, follow direction dir for at most
+   * max_dist, crossing surfaces with ray_fire and next_vol. A single ray
+   * history is carried across all crossings so that facets are not hit
+   * twice. The walk stops at max_dist, when the path leaves the geometry or
+   * when there is no volume on the far side of a surface.
+   *\param start_volume the volume containing origin
+   *\param origin start point of the path
+   *\param dir unit direction of the path
+   *\param max_dist length of the path, must be positive
+   *\param segments cleared and filled with the segments in path order; its
+   *       capacity is reused so repeated calls do not allocate
+   */
+  ErrorCode trace_segments(EntityHandle start_volume, const double origin[3],
+                           const double dir[3], double max_dist,
+                           std::vector<TrackSegment>& segments);
+
+  /**\brief trace_segments for many paths at once
+   *
+   * Path i is described by start_volumes[i], origins[3*i], dirs[3*i] and
+   * max_dists[i]. The segments of all paths are stored back to back in
+   * segments; those of path i are in [offsets[i], offsets[i+1]). Both
+   * output vectors are cleared first and their capacity reused.
+   */
+  ErrorCode trace_segments_batch(int num_paths,
+                                 const EntityHandle* start_volumes,
+                                 const double* origins, const double* dirs,
+                                 const double* max_dists,
+                                 std::vector<TrackSegment>& segments,
+                                 std::vector<int>& offsets);
+
+ private:
+  /** ray_fire without telemetry, using the implicit complement regions
+   *  when volume is the split implicit complement */
+  ErrorCode trace_ray(const EntityHandle volume, const double ray_start[3],
+                      const double ray_dir[3], EntityHandle& next_surf,
+                      double& next_surf_dist, RayHistory* history,
+                      double dist_limit, int ray_orientation,
+                      OrientedBoxTreeTool::TrvStats* stats);
+
+  /** ray_fire in the implicit complement that searches only the trees of
+   *  the regions the ray passes through, nearest first */
+  ErrorCode impl_compl_ray_fire(const double ray_start[3], const double ray_dir[3],
+                                EntityHandle& next_surf, double& next_surf_dist,
+                                RayHistory* history, double dist_limit,
+                                int ray_orientation,
+                                OrientedBoxTreeTool::TrvStats* stats);
+
+  /** append the segments of one path to segments, used by trace_segments */
+  ErrorCode append_segments(EntityHandle start_volume, const double origin[3],
+                            const double dir[3], double max_dist,
+                            std::vector<TrackSegment>& segments);
+
   /* SECTION III: Indexing & Cross-referencing */
  public:
   /** Most calling apps refer to geometric entities with a combination of
@@ -405,6 +524,30 @@ class DagMC {
   /** get the root of the obbtree for a given entity */
   ErrorCode get_root(EntityHandle vol_or_surf, EntityHandle& root);
 
+  /** Per-volume totals of the OBB traversal work done by ray_fire */
+  struct RayTelemetry {
+    unsigned long rays;
+    unsigned long ray_tri_tests;
+    unsigned long nodes_visited;
+    unsigned long leaves_visited;
+  };
+
+  /** Turn recording of per-volume ray telemetry on or off. Recording is off
+   *  by default; turning it on clears anything already recorded.
+   */
+  void set_ray_telemetry(bool enable);
+
+  /** The telemetry recorded so far, keyed by volume handle */
+  const std::map<EntityHandle, RayTelemetry>& ray_telemetry() const {
+    return rayTelemetry;
+  }
+
+  /** Write the recorded telemetry as CSV with one line per volume:
+   *  volume global ID, rays, ray/triangle tests, nodes and leaves visited.
+   *  build_obb reads this file to rebuild the trees for the recorded rays.
+   */
+  ErrorCode write_ray_telemetry(const char* filename);
+
   /** Get the instance of MOAB used by functions in this file. */
   Interface* moab_instance() {return MBI;}
   std::shared_ptr<Interface> moab_instance_sptr() {
@@ -456,6 +599,30 @@ class DagMC {
 
   double facetingTolerance;
 
+  /** per-volume ray telemetry, only filled while recordTelemetry is set */
+  bool recordTelemetry = false;
+  std::map<EntityHandle, RayTelemetry> rayTelemetry;
+
+  /** point_in_volume counters */
+  unsigned long pivCastsAvoided = 0;
+  unsigned long pivCasts = 0;
+
+  /** a group of implicit complement surfaces with its own OBB tree */
+  struct ImplComplRegion {
+    EntityHandle root;
+    double box_min[3];
+    double box_max[3];
+  };
+
+  int implComplSplitDepth = 0;
+  EntityHandle implComplVol = 0;
+  std::vector<ImplComplRegion> implComplRegions;
+  /** scratch space for impl_compl_ray_fire */
+  std::vector<std::pair<double, int> > regionOrder;
+
+  /** ray history reused by trace_segments */
+  RayHistory traceHistory;
+
   /** vectors for point_in_volume: */
   std::vector<double> disList;
   std::vector<int>    dirList;
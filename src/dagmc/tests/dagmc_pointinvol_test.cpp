@@ -230,3 +230,86 @@ TEST_F(DagmcPointInVolTest, dagmc_point_on_corner_8) {
 
   EXPECT_EQ(expected_result, result);
 }
+
+TEST_F(DagmcPointInVolTest, dagmc_point_in_vol_crossed_surface) {
+  int vol_idx = 1;
+  EntityHandle vol_h = DAG->entity_by_index(3, vol_idx);
+  DagMC::RayHistory history;
+  double origin[3] = {0.0, 1.0, 2.0};
+  double dir[3] = {1.0, 0.0, 0.0};
+  double next_surf_dist;
+  EntityHandle next_surf;
+  ErrorCode rval = DAG->ray_fire(vol_h, origin, dir, next_surf, next_surf_dist,
+                                 &history);
+  EXPECT_EQ(MB_SUCCESS, rval);
+
+  // on the x = 5 face, answered from the crossed facet without a ray cast
+  double xyz[3] = {origin[0] + next_surf_dist, origin[1], origin[2]};
+  DAG->reset_point_in_volume_counters();
+  int result = -1;
+  rval = DAG->point_in_volume(vol_h, xyz, result, dir, &history, next_surf);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_EQ(0, result);
+  double back[3] = {-1.0, 0.0, 0.0};
+  rval = DAG->point_in_volume(vol_h, xyz, result, back, &history, next_surf);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_EQ(1, result);
+  EXPECT_EQ(2u, DAG->point_in_volume_casts_avoided());
+  EXPECT_EQ(0u, DAG->point_in_volume_casts());
+
+  // away from the facet the full test is used
+  rval = DAG->point_in_volume(vol_h, origin, result, dir, &history, next_surf);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_EQ(1, result);
+  EXPECT_EQ(1u, DAG->point_in_volume_casts());
+}
+
+// returns the volume of a geometry that contains xyz
+EntityHandle dagmc_find_volume(std::shared_ptr<DagMC> dagmc, double xyz[3]) {
+  for (int i = 1; i <= dagmc->num_entities(3); i++) {
+    EntityHandle vol_h = dagmc->entity_by_index(3, i);
+    int result = 0;
+    if (dagmc->is_implicit_complement(vol_h))
+      continue;
+    ErrorCode rval = dagmc->point_in_volume(vol_h, xyz, result);
+    EXPECT_EQ(MB_SUCCESS, rval);
+    if (1 == result)
+      return vol_h;
+  }
+  return 0;
+}
+
+TEST_F(DagmcPointInVolTest, dagmc_point_in_vol_crossed_surface_not_adjacent) {
+  // three cubes side by side along x, from x = -5 to x = 25
+  std::shared_ptr<DagMC> dagmc = std::make_shared<DagMC>();
+  ErrorCode rval = dagmc->load_file("test_dagmc.h5m");
+  EXPECT_EQ(MB_SUCCESS, rval);
+  rval = dagmc->init_OBBTree();
+  EXPECT_EQ(MB_SUCCESS, rval);
+
+  double origin[3] = {20.0, 1.0, 2.0};
+  double center[3] = {0.0, 0.0, 0.0};
+  EntityHandle vol_h = dagmc_find_volume(dagmc, origin);
+  EntityHandle other_h = dagmc_find_volume(dagmc, center);
+  ASSERT_NE(0u, vol_h);
+  ASSERT_NE(0u, other_h);
+
+  DagMC::RayHistory history;
+  double dir[3] = {1.0, 0.0, 0.0};
+  double next_surf_dist;
+  EntityHandle next_surf;
+  rval = dagmc->ray_fire(vol_h, origin, dir, next_surf, next_surf_dist,
+                         &history);
+  EXPECT_EQ(MB_SUCCESS, rval);
+
+  // the x = 25 face does not bound the cube at the origin, so the full test
+  // is used instead of failing
+  double xyz[3] = {origin[0] + next_surf_dist, origin[1], origin[2]};
+  dagmc->reset_point_in_volume_counters();
+  int result = -1;
+  rval = dagmc->point_in_volume(other_h, xyz, result, dir, &history, next_surf);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_EQ(0, result);
+  EXPECT_EQ(0u, dagmc->point_in_volume_casts_avoided());
+  EXPECT_EQ(1u, dagmc->point_in_volume_casts());
+}
@@ -151,3 +151,204 @@ TEST_F(DagmcRayFireTest, dagmc_outside_face_rayfire_history) {
   EntityHandle ZERO = 0;
   EXPECT_EQ(ZERO, next_surf);
 }
+
+TEST_F(DagmcRayFireTest, dagmc_trace_segments_inside) {
+  int vol_idx = 1;
+  EntityHandle vol_h = DAG->entity_by_index(3, vol_idx);
+  double dir[3] = {1.0, 0.0, 0.0};
+  double origin[3] = {0.0, 1.0, 2.0};
+  std::vector<DagMC::TrackSegment> segments;
+  ErrorCode rval = DAG->trace_segments(vol_h, origin, dir, 3.0, segments);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  // path ends before reaching the cube face
+  ASSERT_EQ(1u, segments.size());
+  EXPECT_EQ(vol_h, segments[0].volume);
+  EXPECT_NEAR(0.0, segments[0].entry_dist, eps);
+  EXPECT_NEAR(3.0, segments[0].exit_dist, eps);
+  EntityHandle ZERO = 0;
+  EXPECT_EQ(ZERO, segments[0].exit_surface);
+}
+
+TEST_F(DagmcRayFireTest, dagmc_trace_segments_crossing) {
+  int vol_idx = 1;
+  EntityHandle vol_h = DAG->entity_by_index(3, vol_idx);
+  double dir[3] = {1.0, 0.0, 0.0};
+  double origin[3] = {0.0, 1.0, 2.0};
+  std::vector<DagMC::TrackSegment> segments;
+  ErrorCode rval = DAG->trace_segments(vol_h, origin, dir, 20.0, segments);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  ASSERT_LE(2u, segments.size());
+  // leaves the cube through the x = 5 face
+  EXPECT_EQ(vol_h, segments[0].volume);
+  EXPECT_NEAR(5.0, segments[0].exit_dist, eps);
+  EXPECT_NE(0u, segments[0].exit_surface);
+  EXPECT_NE(vol_h, segments[1].volume);
+  EXPECT_NEAR(5.0, segments[1].entry_dist, eps);
+  // segments are contiguous
+  for (unsigned i = 1; i < segments.size(); ++i)
+    EXPECT_NEAR(segments[i - 1].exit_dist, segments[i].entry_dist, eps);
+}
+
+TEST_F(DagmcRayFireTest, dagmc_trace_segments_batch) {
+  int vol_idx = 1;
+  EntityHandle vol_h = DAG->entity_by_index(3, vol_idx);
+  EntityHandle vols[2] = {vol_h, vol_h};
+  double origins[6] = {0.0, 1.0, 2.0, 0.0, 1.0, 2.0};
+  double dirs[6] = {1.0, 0.0, 0.0, -1.0, 0.0, 0.0};
+  double max_dists[2] = {3.0, 4.0};
+  std::vector<DagMC::TrackSegment> segments;
+  std::vector<int> offsets;
+  ErrorCode rval = DAG->trace_segments_batch(2, vols, origins, dirs, max_dists,
+                                             segments, offsets);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  ASSERT_EQ(3u, offsets.size());
+  EXPECT_EQ(0, offsets[0]);
+  EXPECT_EQ(1, offsets[1]);
+  EXPECT_EQ(2, offsets[2]);
+  EXPECT_NEAR(3.0, segments[0].exit_dist, eps);
+  EXPECT_NEAR(4.0, segments[1].exit_dist, eps);
+}
+
+TEST_F(DagmcRayFireTest, dagmc_ray_telemetry) {
+  int vol_idx = 1;
+  EntityHandle vol_h = DAG->entity_by_index(3, vol_idx);
+  double dir[3] = {1.0, 0.0, 0.0};
+  double origin[3] = {0.0, 1.0, 2.0};
+  double next_surf_dist;
+  EntityHandle next_surf;
+
+  // nothing is recorded until telemetry is turned on
+  DAG->ray_fire(vol_h, origin, dir, next_surf, next_surf_dist);
+  EXPECT_TRUE(DAG->ray_telemetry().empty());
+
+  DAG->set_ray_telemetry(true);
+  DAG->ray_fire(vol_h, origin, dir, next_surf, next_surf_dist);
+  DAG->ray_fire(vol_h, origin, dir, next_surf, next_surf_dist);
+  EXPECT_NEAR(5.0, next_surf_dist, eps);
+  ASSERT_EQ(1u, DAG->ray_telemetry().size());
+  const DagMC::RayTelemetry& rec = DAG->ray_telemetry().at(vol_h);
+  EXPECT_EQ(2u, rec.rays);
+  EXPECT_LT(0u, rec.ray_tri_tests);
+  EXPECT_LT(0u, rec.nodes_visited);
+
+  DAG->set_ray_telemetry(false);
+  EXPECT_TRUE(DAG->ray_telemetry().empty());
+}
+
+TEST_F(DagmcRayFireTest, dagmc_impl_compl_split_rayfire) {
+  // a fresh instance, as the split must be requested before init_OBBTree
+  std::shared_ptr<moab::DagMC> split_dag = std::make_shared<moab::DagMC>();
+  split_dag->set_implicit_complement_split(2);
+  ErrorCode rval = split_dag->load_file(input_file);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  rval = split_dag->init_OBBTree();
+  EXPECT_EQ(MB_SUCCESS, rval);
+
+  EntityHandle ic;
+  rval = split_dag->geom_tool()->get_implicit_complement(ic);
+  EXPECT_EQ(MB_SUCCESS, rval);
+
+  // toward the cube, leaving the implicit complement at x = -5
+  double dir[3] = {1.0, 0.0, 0.0};
+  double origin[3] = {-10.0, 1.0, 2.0};
+  double next_surf_dist;
+  EntityHandle next_surf;
+  rval = split_dag->ray_fire(ic, origin, dir, next_surf, next_surf_dist);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_NEAR(5.0, next_surf_dist, eps);
+  EXPECT_NE(0u, next_surf);
+
+  // away from the cube there is nothing to hit
+  double away[3] = {-1.0, 0.0, 0.0};
+  rval = split_dag->ray_fire(ic, origin, away, next_surf, next_surf_dist);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_EQ(0u, next_surf);
+
+  // rays from around the cube hit the same surfaces as the unsplit geometry
+  EntityHandle unsplit_ic;
+  rval = DAG->geom_tool()->get_implicit_complement(unsplit_ic);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  for (int i = 0; i < 27; ++i) {
+    // the 26 neighbours of the cube center
+    if (i == 13)
+      continue;
+    double start[3] = {8.0 * (i % 3 - 1), 8.0 * (i / 3 % 3 - 1), 8.0 * (i / 9 - 1)};
+    double to_cube[3] = {0.3 - start[0], 0.2 - start[1], 0.1 - start[2]};
+    double norm = sqrt(to_cube[0] * to_cube[0] + to_cube[1] * to_cube[1] +
+                       to_cube[2] * to_cube[2]);
+    for (int j = 0; j < 3; ++j)
+      to_cube[j] /= norm;
+
+    DagMC::RayHistory history, unsplit_history;
+    EntityHandle unsplit_surf;
+    double unsplit_dist;
+    rval = split_dag->ray_fire(ic, start, to_cube, next_surf, next_surf_dist,
+                               &history);
+    EXPECT_EQ(MB_SUCCESS, rval);
+    rval = DAG->ray_fire(unsplit_ic, start, to_cube, unsplit_surf, unsplit_dist,
+                         &unsplit_history);
+    EXPECT_EQ(MB_SUCCESS, rval);
+    EXPECT_EQ(DAG->get_entity_id(unsplit_surf), split_dag->get_entity_id(next_surf));
+    EXPECT_NEAR(unsplit_dist, next_surf_dist, eps);
+
+    // a distance limit short of the cube finds nothing
+    rval = split_dag->ray_fire(ic, start, to_cube, next_surf, next_surf_dist,
+                               NULL, 0.5 * unsplit_dist);
+    EXPECT_EQ(MB_SUCCESS, rval);
+    EXPECT_EQ(0u, next_surf);
+  }
+}
+
+TEST_F(DagmcRayFireTest, dagmc_any_hit_within) {
+  int vol_idx = 1;
+  EntityHandle vol_h = DAG->entity_by_index(3, vol_idx);
+  double dir[3] = {1.0, 0.0, 0.0};
+  double origin[3] = {0.0, 1.0, 2.0};
+  bool hit = true;
+
+  // the x = 5 face is 5 away
+  ErrorCode rval = DAG->any_hit_within(vol_h, origin, dir, 4.0, hit);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_FALSE(hit);
+  rval = DAG->any_hit_within(vol_h, origin, dir, 6.0, hit);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_TRUE(hit);
+
+  // a facet already in the history does not count
+  DagMC::RayHistory history;
+  double next_surf_dist;
+  EntityHandle next_surf;
+  DAG->ray_fire(vol_h, origin, dir, next_surf, next_surf_dist, &history);
+  double xyz[3] = {origin[0] + next_surf_dist, origin[1], origin[2]};
+  double back[3] = {-1.0, 0.0, 0.0};
+  rval = DAG->any_hit_within(vol_h, xyz, back, 1.0, hit, &history);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_FALSE(hit);
+}
+
+TEST_F(DagmcRayFireTest, dagmc_any_hit_within_overlap) {
+  int vol_idx = 1;
+  EntityHandle vol_h = DAG->entity_by_index(3, vol_idx);
+  // just past the x = 5 face, as a particle crossing an overlap would be
+  double xyz[3] = {5.05, 1.0, 2.0};
+  double dir[3] = {1.0, 0.0, 0.0};
+  bool hit = true;
+
+  ErrorCode rval = DAG->any_hit_within(vol_h, xyz, dir, 1.0, hit);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_FALSE(hit);
+
+  // within the overlap thickness the face behind the start point is hit,
+  // and ray_fire finds it too
+  DAG->set_overlap_thickness(0.1);
+  rval = DAG->any_hit_within(vol_h, xyz, dir, 1.0, hit);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_TRUE(hit);
+
+  double next_surf_dist;
+  EntityHandle next_surf;
+  rval = DAG->ray_fire(vol_h, xyz, dir, next_surf, next_surf_dist, NULL, 1.0);
+  EXPECT_EQ(MB_SUCCESS, rval);
+  EXPECT_NE(0u, next_surf);
+  EXPECT_NEAR(0.0, next_surf_dist, eps);
+}
@@ -42,6 +42,8 @@ static double last_uvw[3] = {0, 0, 0};
 static std::vector< DagMC::RayHistory > history_bank;
 static std::vector< DagMC::RayHistory > pblcm_history_stack;
 static bool visited_surface = false;
+// surface crossed by the last newcel, 0 once the particle has moved on
+static moab::EntityHandle crossed_surface = 0;
 
 static bool use_dist_limit = false;
 static double dist_limit; // needs to be thread-local
@@ -65,6 +67,8 @@ void dagmcinit_(char* cfile, int* clen,  // geom
 #ifdef ENABLE_RAYSTAT_DUMPS
   // the file to which ray statistics dumps will be written
   raystat_dump = new std::ofstream("dagmc_raystat_dump.csv");
+  // per-volume totals, the input to build_obb --ray-stats
+  DAG->set_ray_telemetry(true);
 #endif
 
   *dagmc_version = DAG->version();
@@ -425,7 +429,14 @@ void dagmcchkcel_(double* uuu, double* vvv, double* www, double* xxx,
   moab::EntityHandle vol = DAG->entity_by_index(3, *i1);
   double xyz[3] = {*xxx, *yyy, *zzz};
   double uvw[3] = {*uuu, *vvv, *www};
-  moab::ErrorCode rval = DAG->point_in_volume(vol, xyz, inside, uvw);
+  moab::ErrorCode rval;
+  if (crossed_surface) {
+    // right after a crossing the history already holds the crossed facet
+    rval = DAG->point_in_volume(vol, xyz, inside, uvw, &history,
+                                crossed_surface);
+  } else {
+    rval = DAG->point_in_volume(vol, xyz, inside, uvw);
+  }
 
   if (moab::MB_SUCCESS != rval) {
     std::cerr << "DAGMC: failed in point_in_volume" <<  std::endl;
@@ -493,6 +504,7 @@ void dagmcnewcel_(int* jsu, int* icl, int* iap) {
   *iap = DAG->index_by_handle(newvol);
 
   visited_surface = true;
+  crossed_surface = surf;
 
 #ifdef TRACE_DAGMC_CALLS
   std::cout << "newcel: prev_vol=" << DAG->id_by_index(3, *icl) << " surf= "
@@ -541,6 +553,7 @@ void dagmc_surf_reflection_(double* uuu, double* vvv, double* www, int* verify_d
 
 void dagmc_particle_terminate_() {
   history.reset();
+  crossed_surface = 0;
 
 #ifdef TRACE_DAGMC_CALLS
   std::cout << "particle_terminate:" << std::endl;
@@ -600,13 +613,27 @@ void dagmctrack_(int* ih, double* uuu, double* vvv, double* www, double* xxx,
 
   }
 
-  moab::ErrorCode result = DAG->ray_fire(vol, point, dir,
-                                         next_surf, next_surf_dist, &history,
-                                         (use_dist_limit ? dist_limit : 0)
+  // with a distance limit, most flights end in a collision: only find the
+  // nearest surface if there is one before the limit
+  bool surf_within_limit = true;
+  if (use_dist_limit) {
+    moab::ErrorCode rval = DAG->any_hit_within(vol, point, dir, dist_limit,
+                                               surf_within_limit, &history);
+    if (moab::MB_SUCCESS != rval) {
+      std::cerr << "DAGMC: failed in any_hit_within" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  moab::ErrorCode result = moab::MB_SUCCESS;
+  if (surf_within_limit)
+    result = DAG->ray_fire(vol, point, dir,
+                           next_surf, next_surf_dist, &history,
+                           (use_dist_limit ? dist_limit : 0)
 #ifdef ENABLE_RAYSTAT_DUMPS
-                                         , raystat_dump ? &trv : NULL
+                           , raystat_dump ? &trv : NULL
 #endif
-                                        );
+                          );
 
 
   if (moab::MB_SUCCESS != result) {
@@ -637,6 +664,7 @@ void dagmctrack_(int* ih, double* uuu, double* vvv, double* www, double* xxx,
   }
 
   visited_surface = false;
+  crossed_surface = 0;
 
 #ifdef ENABLE_RAYSTAT_DUMPS
   if (raystat_dump) {
@@ -679,6 +707,7 @@ void dagmc_bank_usetop_() {
   std::cout << "bank_usetop" << std::endl;
 #endif
 
+  crossed_surface = 0;
   if (history_bank.size()) {
     history = history_bank.back();
   } else {
@@ -721,6 +750,7 @@ void dagmc_getpar_(int* n) {
   std::cout << "getpar: " << *n << " (" << pblcm_history_stack[*n].size() << ")" << std::endl;
 #endif
   history = pblcm_history_stack[*n];
+  crossed_surface = 0;
 }
 
 
@@ -788,6 +818,14 @@ void dagmc_init_settings_(int* fort_use_dist_limit, int* use_cad,
 
 // delete the stored data
 void dagmc_teardown_() {
+#ifdef ENABLE_RAYSTAT_DUMPS
+  DAG->write_ray_telemetry("dagmc_ray_telemetry.csv");
+#endif
+#ifdef TRACE_DAGMC_CALLS
+  std::cout << "DAGMC: " << DAG->point_in_volume_casts_avoided()
+            << " point_in_volume ray casts avoided, "
+            << DAG->point_in_volume_casts() << " performed" << std::endl;
+#endif
   delete DMD;
   delete DAG;
 }
@@ -186,6 +186,47 @@ void dagmc_fmesh_setup_mesh_(int* fm_ipt, int* id, int* fmesh_idx,
   }
 }
 //---------------------------------------------------------------------------//
+/**
+ * \brief Queue tally events so that they are scored on worker threads
+ * \param[in] capacity the number of events and history ends in each queue
+ * \param[in] num_threads the number of worker threads used for scoring
+ *
+ * Transport then continues while the tallies for the queued events are
+ * scored.  A capacity of zero scores every event as it occurs.
+ */
+void dagmc_fmesh_queue_events_(int* capacity, int* num_threads) {
+  if (*capacity > 0 && *num_threads >= 0) {
+    tallyManager.enableEventQueue(*capacity, *num_threads);
+  } else {
+    tallyManager.disableEventQueue();
+  }
+}
+//---------------------------------------------------------------------------//
+/**
+ * \brief Monitor the convergence of the mesh tallies
+ * \param[in] batch_size the number of histories between statistics updates
+ * \param[in] target_rel_error the relative error needed to converge
+ *
+ * A batch size of zero stops monitoring.
+ */
+void dagmc_fmesh_monitor_statistics_(int* batch_size, double* target_rel_error) {
+  if (*batch_size > 0) {
+    tallyManager.enableStatistics(*batch_size, *target_rel_error);
+  } else {
+    tallyManager.disableStatistics();
+  }
+}
+//---------------------------------------------------------------------------//
+/**
+ * \brief Check if all monitored mesh tallies have converged
+ * \param[out] converged 1 if all tallies have converged; 0 otherwise
+ *
+ * Allows the run to be stopped before the requested number of histories.
+ */
+void dagmc_fmesh_converged_(int* converged) {
+  *converged = tallyManager.isConverged() ? 1 : 0;
+}
+//---------------------------------------------------------------------------//
 // RUNTAPE AND MPI METHODS
 //---------------------------------------------------------------------------//
 /**
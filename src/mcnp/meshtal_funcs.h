@@ -30,6 +30,12 @@ void dagmc_fmesh_setup_mesh_(int* fm_ipt, int* id, int* fmesh_idx,
                              double* energy_mesh, int* n_energy_mesh, int* tot_energy_bin,
                              char* comment, int* n_comment_lines, int* is_collision_tally);
 
+void dagmc_fmesh_queue_events_(int* capacity, int* num_threads);
+
+void dagmc_fmesh_monitor_statistics_(int* batch_size, double* target_rel_error);
+
+void dagmc_fmesh_converged_(int* converged);
+
 void dagmc_fmesh_end_history_();
 
 void dagmc_fmesh_score_(int* ipt,
@@ -6,6 +6,7 @@
 #include <utility>
 
 #include "CellTally.hpp"
+#include "TallyContext.hpp"
 
 //---------------------------------------------------------------------------//
 // CONSTRUCTOR
@@ -25,27 +26,15 @@ CellTally::CellTally(const TallyInput& input, TallyEvent::EventType eventType)
 // DERIVED PUBLIC INTERFACE from Tally.hpp
 //---------------------------------------------------------------------------//
 void CellTally::compute_score(const TallyEvent& event) {
-  // Return if current cell or particle energy is incompatible with CellTally
-  unsigned int ebin = 0;
-
-  if (event.current_cell != cell_id ||
-      !get_energy_bin(event.particle_energy, ebin)) {
-    return;
-  }
-
-  // Compute score based on event type and add it to this CellTally
-  double event_score = event.get_score_multiplier(input_data.multiplier_id);
-
-  if (event.type == TallyEvent::TRACK && event.type == expected_type) {
-    event_score *= event.track_length;
-  } else if (event.type == TallyEvent::COLLISION && event.type == expected_type) {
-    event_score /= event.total_cross_section;
-  } else { // NONE, return from this method
-    return;
-  }
-
-  int tally_index = 0;
-  data->add_score_to_tally(tally_index, event_score, ebin);
+  score_event(event, *data);
+}
+//---------------------------------------------------------------------------//
+void CellTally::compute_score(const TallyEvent& event, TallyContext& context) {
+  score_event(event, context.get_scratch_data(input_data.tally_id));
+}
+//---------------------------------------------------------------------------//
+bool CellTally::scores_event_type(TallyEvent::EventType type) const {
+  return type == expected_type;
 }
 //---------------------------------------------------------------------------//
 void CellTally::write_data(double num_histories) {
@@ -136,5 +125,29 @@ void CellTally::parse_tally_options() {
   }
 }
 //---------------------------------------------------------------------------//
+void CellTally::score_event(const TallyEvent& event, TallyData& scores) {
+  // Return if current cell or particle energy is incompatible with CellTally
+  unsigned int ebin = 0;
+
+  if (event.current_cell != cell_id ||
+      !get_energy_bin(event.particle_energy, ebin)) {
+    return;
+  }
+
+  // Compute score based on event type and add it to this CellTally
+  double event_score = event.get_score_multiplier(input_data.multiplier_id);
+
+  if (event.type == TallyEvent::TRACK && event.type == expected_type) {
+    event_score *= event.track_length;
+  } else if (event.type == TallyEvent::COLLISION && event.type == expected_type) {
+    event_score /= event.total_cross_section;
+  } else { // NONE, return from this method
+    return;
+  }
+
+  int tally_index = 0;
+  scores.add_score_to_tally(tally_index, event_score, ebin);
+}
+//---------------------------------------------------------------------------//
 
 // end of MCNP5/dagmc/CellTally.cpp
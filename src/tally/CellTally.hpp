@@ -34,7 +34,7 @@
  * -----------------
  * Sets the cell ID to the given value, which should represent the index of an
  * actual geometric cell.  Currently only one cell can be tallied per CellTally,
- * and the default value is 1.
+ * and the default value is 1.  Use a MultiCellTally to tally all cells.
  *
  * 2) "volume"="value"
  * -------------------
@@ -65,6 +65,20 @@ class CellTally : public Tally {
    */
   virtual void compute_score(const TallyEvent& event);
 
+  /**
+   * \brief Computes scores for this CellTally into a TallyContext
+   * \param[in] event the parameters needed to compute the scores
+   * \param[in, out] context the scoring context of the calling thread
+   */
+  virtual void compute_score(const TallyEvent& event, TallyContext& context);
+
+  /**
+   * \brief Checks if this CellTally scores events of the given type
+   * \param[in] type the type of tally event
+   * \return true if compute_score() may score events of this type
+   */
+  virtual bool scores_event_type(TallyEvent::EventType type) const;
+
   /**
    * \brief Write results for this CellTally
    * \param[in] num_histories the number of particle histories tracked
@@ -96,6 +110,13 @@ class CellTally : public Tally {
    * \brief Parse the TallyInput options for this CellTally
    */
   void parse_tally_options();
+
+  /**
+   * \brief Computes scores for this CellTally based on the given TallyEvent
+   * \param[in] event the parameters needed to compute the scores
+   * \param[in, out] scores the TallyData to which the scores are added
+   */
+  void score_event(const TallyEvent& event, TallyData& scores);
 };
 
 #endif // DAGMC_CELL_TALLY_HPP
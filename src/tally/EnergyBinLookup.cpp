@@ -0,0 +1,95 @@
+// MCNP5/dagmc/EnergyBinLookup.cpp
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#include "EnergyBinLookup.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+namespace {
+// minimum number of energy bins for which the direct-index table is used
+const unsigned int MIN_TABLE_BINS = 32;
+
+// number of cells in the uniform lethargy grid for each energy bin
+const unsigned int CELLS_PER_BIN = 4;
+} // namespace
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+EnergyBinLookup::EnergyBinLookup(const std::vector<double>& bounds)
+  : bounds(bounds), num_bins(bounds.size() - 1),
+    min_log_energy(0.0), inv_cell_width(0.0) {
+  if (num_bins < MIN_TABLE_BINS ||
+      !(bounds.front() > 0.0) || !(bounds.back() > bounds.front())) {
+    return;
+  }
+
+  // build the table on a grid that is uniform in lethargy
+  unsigned int num_cells = CELLS_PER_BIN * num_bins;
+  min_log_energy = log(bounds.front());
+  double cell_width = (log(bounds.back()) - min_log_energy) / num_cells;
+  inv_cell_width = 1.0 / cell_width;
+
+  table.resize(num_cells);
+
+  for (unsigned int i = 0; i < num_cells; ++i) {
+    double energy = exp(min_log_energy + i * cell_width);
+    table[i] = std::min(search_bins(energy), num_bins - 1);
+  }
+}
+//---------------------------------------------------------------------------//
+std::shared_ptr<const EnergyBinLookup>
+EnergyBinLookup::get_lookup(const std::vector<double>& bounds) {
+  typedef std::map<std::vector<double>,
+          std::weak_ptr<const EnergyBinLookup> > LookupCache;
+
+  static std::mutex cache_mutex;
+  static LookupCache cache;
+
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  std::weak_ptr<const EnergyBinLookup>& cached = cache[bounds];
+  std::shared_ptr<const EnergyBinLookup> lookup = cached.lock();
+
+  if (!lookup) {
+    lookup = std::make_shared<const EnergyBinLookup>(bounds);
+    cached = lookup;
+  }
+
+  return lookup;
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+unsigned int EnergyBinLookup::search_bins(double energy) const {
+  // the bin starts at the last bound that is not greater than the energy
+  std::vector<double>::const_iterator it;
+  it = std::upper_bound(bounds.begin(), bounds.end(), energy);
+
+  return (it - bounds.begin()) - 1;
+}
+//---------------------------------------------------------------------------//
+unsigned int EnergyBinLookup::lookup_bins(double energy) const {
+  double cell = (log(energy) - min_log_energy) * inv_cell_width;
+  unsigned int bin = table.back();
+
+  if (cell < table.size())
+    bin = table[cell > 0.0 ? static_cast<unsigned int>(cell) : 0];
+
+  // correct for rounding in the cell and any bins within the same cell
+  while (bin > 0 && energy < bounds[bin]) {
+    --bin;
+  }
+
+  while (bin < num_bins && energy >= bounds[bin + 1]) {
+    ++bin;
+  }
+
+  return bin;
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/EnergyBinLookup.cpp
@@ -0,0 +1,116 @@
+// MCNP5/dagmc/EnergyBinLookup.hpp
+
+#ifndef DAGMC_ENERGY_BIN_LOOKUP_HPP
+#define DAGMC_ENERGY_BIN_LOOKUP_HPP
+
+#include <memory>
+#include <vector>
+
+//===========================================================================//
+/**
+ * \class EnergyBinLookup
+ * \brief Finds the energy bin of a particle energy for a set of bin bounds
+ *
+ * EnergyBinLookup is created once for each set of energy bin boundaries and
+ * then used by every Tally with those boundaries to find the energy bin of
+ * each event.  Energy bin i contains the energies in [bounds[i], bounds[i+1])
+ * and the last bin also contains the maximum energy.
+ *
+ * For group structures with many bins, such as the 175 or 709 group
+ * structures, a direct-index table is built on a grid that is uniform in
+ * lethargy between the minimum and maximum energy.  Each cell of the grid
+ * stores the first energy bin that it overlaps, so the bin for an energy is
+ * found from its grid cell and a comparison with the neighbouring bounds.
+ * This only needs a small number of comparisons for structures that are
+ * close to uniform in lethargy.  Binary search is used when the structure
+ * has few bins or a minimum energy of zero.
+ *
+ * Tallies with the same energy bin boundaries share a single EnergyBinLookup
+ * through the get_lookup() method.
+ */
+//===========================================================================//
+class EnergyBinLookup {
+ public:
+  /**
+   * \brief Constructor
+   * \param[in] bounds the energy bin boundaries, sorted from min to max energy
+   */
+  explicit EnergyBinLookup(const std::vector<double>& bounds);
+
+  /**
+   * \brief Gets the EnergyBinLookup for a set of energy bin boundaries
+   * \param[in] bounds the energy bin boundaries, sorted from min to max energy
+   * \return an EnergyBinLookup shared by all callers with the same bounds
+   *
+   * The EnergyBinLookup is kept while any caller still holds a pointer to it.
+   */
+  static std::shared_ptr<const EnergyBinLookup>
+  get_lookup(const std::vector<double>& bounds);
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief Finds the energy bin that contains the given energy
+   * \param[in] energy the particle energy
+   * \param[out] ebin the index of the energy bin
+   * \return true if the energy is within the bin boundaries; false otherwise
+   */
+  bool find_bin(double energy, unsigned int& ebin) const {
+    if (energy < bounds.front() || energy > bounds.back())
+      return false;
+
+    unsigned int bin = (table.empty() ? search_bins(energy) :
+                        lookup_bins(energy));
+
+    // the maximum energy is in the last bin
+    ebin = (bin < num_bins) ? bin : num_bins - 1;
+    return true;
+  }
+
+  /**
+   * \brief in_bounds()
+   * \param[in] energy the particle energy
+   * \return true if the energy is within the bin boundaries; false otherwise
+   */
+  bool in_bounds(double energy) const {
+    return !(energy < bounds.front() || energy > bounds.back());
+  }
+
+  /**
+   * \brief uses_table()
+   * \return true if the direct-index table is used to find energy bins
+   */
+  bool uses_table() const {
+    return !table.empty();
+  }
+
+ private:
+  // Energy bin boundaries and the number of energy bins
+  std::vector<double> bounds;
+  unsigned int num_bins;
+
+  // First energy bin overlapping each cell of the uniform lethargy grid
+  std::vector<unsigned int> table;
+  double min_log_energy;
+  double inv_cell_width;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Finds the energy bin using binary search of the bounds
+   * \param[in] energy a particle energy within the bounds
+   * \return the energy bin, or num_bins if energy is the maximum energy
+   */
+  unsigned int search_bins(double energy) const;
+
+  /**
+   * \brief Finds the energy bin using the direct-index table
+   * \param[in] energy a particle energy within the bounds
+   * \return the energy bin, or num_bins if energy is the maximum energy
+   */
+  unsigned int lookup_bins(double energy) const;
+};
+
+#endif // DAGMC_ENERGY_BIN_LOOKUP_HPP
+
+// end of MCNP5/dagmc/EnergyBinLookup.hpp
@@ -0,0 +1,249 @@
+// MCNP5/dagmc/FixedPolynomialKernel.hpp
+
+#ifndef DAGMC_FIXED_POLYNOMIAL_KERNEL_HPP
+#define DAGMC_FIXED_POLYNOMIAL_KERNEL_HPP
+
+#include <cmath>
+
+#include "PolynomialKernel.hpp"
+
+//===========================================================================//
+/**
+ * \struct FixedPolynomialKernelTable
+ * \brief Compile-time coefficients of the polynomial kernel K_2R,S
+ *
+ * Defined for 1 <= S <= 3 and 1 <= R <= 3.  MULTIPLIER and COEFFICIENTS are
+ * the values computed by PolynomialKernel(S, R), with COEFFICIENTS[0] = 1.0
+ * for the 2nd-order kernels.  TERMS[k] is the coefficient of u^2k of K_2R,S
+ * as a polynomial in u, i.e. the even terms of get_polynomial().
+ */
+//===========================================================================//
+template <unsigned int S, unsigned int R>
+struct FixedPolynomialKernelTable;
+
+template <>
+struct FixedPolynomialKernelTable<1, 1> {
+  static constexpr double MULTIPLIER = 0.75;
+  static constexpr double COEFFICIENTS[1] = {1.0};
+  static constexpr double TERMS[2] = {0.75, -0.75};
+};
+
+template <>
+struct FixedPolynomialKernelTable<1, 2> {
+  static constexpr double MULTIPLIER = 1.40625;
+  static constexpr double COEFFICIENTS[2] = {1.0, -2.3333333333333335};
+  static constexpr double TERMS[3] = {1.40625, -4.6875, 3.28125};
+};
+
+template <>
+struct FixedPolynomialKernelTable<1, 3> {
+  static constexpr double MULTIPLIER = 4.1015625;
+  static constexpr double COEFFICIENTS[3] = {0.5, -3.0, 3.2999999999999998};
+  static constexpr double TERMS[4] = {2.05078125, -14.35546875, 25.83984375,
+                                      -13.53515625};
+};
+
+template <>
+struct FixedPolynomialKernelTable<2, 1> {
+  static constexpr double MULTIPLIER = 0.9375;
+  static constexpr double COEFFICIENTS[1] = {1.0};
+  static constexpr double TERMS[3] = {0.9375, -1.875, 0.9375};
+};
+
+template <>
+struct FixedPolynomialKernelTable<2, 2> {
+  static constexpr double MULTIPLIER = 1.640625;
+  static constexpr double COEFFICIENTS[2] = {1.0, -3.0};
+  static constexpr double TERMS[4] = {1.640625, -8.203125, 11.484375,
+                                      -4.921875};
+};
+
+template <>
+struct FixedPolynomialKernelTable<2, 3> {
+  static constexpr double MULTIPLIER = 4.6142578125;
+  static constexpr double COEFFICIENTS[3] = {0.5, -3.6666666666666665,
+                                             4.7666666666666666};
+  static constexpr double TERMS[5] = {2.30712890625, -21.533203125,
+                                      58.1396484375, -60.908203125,
+                                      21.99462890625};
+};
+
+template <>
+struct FixedPolynomialKernelTable<3, 1> {
+  static constexpr double MULTIPLIER = 1.09375;
+  static constexpr double COEFFICIENTS[1] = {1.0};
+  static constexpr double TERMS[4] = {1.09375, -3.28125, 3.28125, -1.09375};
+};
+
+template <>
+struct FixedPolynomialKernelTable<3, 2> {
+  static constexpr double MULTIPLIER = 1.845703125;
+  static constexpr double COEFFICIENTS[2] = {1.0, -3.6666666666666665};
+  static constexpr double TERMS[5] = {1.845703125, -12.3046875, 25.83984375,
+                                      -22.1484375, 6.767578125};
+};
+
+template <>
+struct FixedPolynomialKernelTable<3, 3> {
+  static constexpr double MULTIPLIER = 5.07568359375;
+  static constexpr double COEFFICIENTS[3] = {0.5, -4.333333333333333, 6.5};
+  static constexpr double TERMS[6] = {2.537841796875, -29.608154296875,
+                                      106.58935546875, -167.49755859375,
+                                      120.970458984375, -32.991943359375};
+};
+
+//===========================================================================//
+/**
+ * \class FixedPolynomialKernel
+ * \brief Defines a polynomial kernel function with s and r fixed at compile time
+ *
+ * FixedPolynomialKernel is a Derived class of PolynomialKernel for the
+ * kernels that are used most often.  The smoothness factor S and the order
+ * 2R are template parameters, and the multiplier and coefficients of the
+ * kernel are read from FixedPolynomialKernelTable<S, R> at compile time, so
+ * the loops over them in evaluate() and evaluate_batch() are unrolled by the
+ * compiler.  The moment functions are integrated exactly from the TERMS of
+ * the kernel as a polynomial in u.
+ *
+ * The static evaluate_fixed() and evaluate_batch_fixed() methods do not need
+ * a kernel object, which allows KDEMeshTally to call them directly instead
+ * of through the KDEKernel interface.
+ *
+ * Results are the same as a PolynomialKernel(S, R) to within round-off; the
+ * kernel values are computed with the same operations in the same order.
+ * KDEKernel::createKernel() selects a FixedPolynomialKernel for the
+ * epanechnikov, biweight and triweight kernels of order 2, 4 and 6.
+ */
+//===========================================================================//
+template <unsigned int S, unsigned int R>
+class FixedPolynomialKernel : public PolynomialKernel {
+ public:
+  /// Compile-time coefficients of this polynomial kernel
+  typedef FixedPolynomialKernelTable<S, R> Table;
+
+  /**
+   * \brief Constructor
+   */
+  FixedPolynomialKernel() : PolynomialKernel(S, R) {}
+
+  // >>> DERIVED PUBLIC INTERFACE from KDEKernel.hpp
+
+  /**
+   * \brief Evaluate this polynomial kernel function K_2R,S
+   * \param[in] u the value at which K_2R,S will be evaluated
+   * \return K_2R,S(u)
+   */
+  virtual double evaluate(double u) const {
+    return evaluate_fixed(u);
+  }
+
+  /**
+   * \brief Evaluate this polynomial kernel function K_2R,S for a block of values
+   * \param[in] u the n values at which K_2R,S will be evaluated
+   * \param[in] n the number of values
+   * \param[out] values stores K_2R,S(u[i]) for each of the n values
+   */
+  virtual void evaluate_batch(const double* u, unsigned int n,
+                              double* values) const {
+    evaluate_batch_fixed(u, n, values);
+  }
+
+  /**
+   * \brief Integrates the ith moment function for this polynomial kernel
+   * \param[in] a, b the lower and upper integration limits
+   * \param[in] i the index representing the ith moment function
+   * \return definite integral of the ith moment function for [a, b]
+   */
+  virtual double integrate_moment(double a, double b, unsigned int i) const {
+    double value = 0.0;
+
+    // check if integral limits are within the domain u = [-1, 1]
+    if (a < 1.0 && b > -1.0) {
+      // modify integration limits if needed
+      if (a < -1.0)
+        a = -1.0;
+      if (b > 1.0)
+        b = 1.0;
+
+      // a^(i+1) and b^(i+1)
+      double power_a = a;
+      double power_b = b;
+
+      for (unsigned int j = 0; j < i; ++j) {
+        power_a *= a;
+        power_b *= b;
+      }
+
+      // integrate u^i * K_2R,S(u) term by term, odd terms of K are zero
+      for (unsigned int k = 0; k < S + R; ++k) {
+        value += Table::TERMS[k] * (power_b - power_a) / (2 * k + i + 1);
+        power_a *= a * a;
+        power_b *= b * b;
+      }
+    }
+
+    return value;
+  }
+
+  // >>> STATIC KERNEL FUNCTIONS
+
+  /**
+   * \brief Evaluate K_2R,S without a kernel object
+   * \param[in] u the value at which K_2R,S will be evaluated
+   * \return K_2R,S(u)
+   */
+  static double evaluate_fixed(double u) {
+    // test if outside kernel function domain [-1.0, 1.0]
+    if (u < -1.0 || u > 1.0)
+      return 0.0;
+
+    return evaluate_inside(u);
+  }
+
+  /**
+   * \brief Evaluate K_2R,S for a block of values without a kernel object
+   * \param[in] u the n values at which K_2R,S will be evaluated
+   * \param[in] n the number of values
+   * \param[out] values stores K_2R,S(u[i]) for each of the n values
+   */
+  static void evaluate_batch_fixed(const double* u, unsigned int n,
+                                   double* values) {
+    for (unsigned int i = 0; i < n; ++i) {
+      double value = evaluate_inside(u[i]);
+      values[i] = (fabs(u[i]) > 1.0) ? 0.0 : value;
+    }
+  }
+
+ private:
+  /**
+   * \brief Evaluates K_2R,S(u) without checking the domain
+   */
+  static double evaluate_inside(double u) {
+    // evaluate a 2nd-order kernel function
+    double value = Table::MULTIPLIER;
+    double temp = 1 - u * u;
+
+    for (unsigned int i = 0; i < S; ++i) {
+      value *= temp;
+    }
+
+    // multiply value by second polynomial for kernels of higher order
+    if (R > 1) {
+      double sum = Table::COEFFICIENTS[0];
+      temp = 1.0;
+
+      for (unsigned int k = 1; k < R; ++k) {
+        temp *= u * u;
+        sum += Table::COEFFICIENTS[k] * temp;
+      }
+
+      value *= sum;
+    }
+
+    return value;
+  }
+};
+
+#endif // DAGMC_FIXED_POLYNOMIAL_KERNEL_HPP
+
+// end of MCNP5/dagmc/FixedPolynomialKernel.hpp
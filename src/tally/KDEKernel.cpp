@@ -3,9 +3,54 @@
 #include <cassert>
 #include <iostream>
 
+#include "FixedPolynomialKernel.hpp"
 #include "KDEKernel.hpp"
 #include "PolynomialKernel.hpp"
 
+//---------------------------------------------------------------------------//
+// FIXED POLYNOMIAL KERNEL TABLES
+//---------------------------------------------------------------------------//
+// definitions of the arrays, needed as they are indexed at run time
+constexpr double FixedPolynomialKernelTable<1, 1>::COEFFICIENTS[];
+constexpr double FixedPolynomialKernelTable<1, 1>::TERMS[];
+constexpr double FixedPolynomialKernelTable<1, 2>::COEFFICIENTS[];
+constexpr double FixedPolynomialKernelTable<1, 2>::TERMS[];
+constexpr double FixedPolynomialKernelTable<1, 3>::COEFFICIENTS[];
+constexpr double FixedPolynomialKernelTable<1, 3>::TERMS[];
+constexpr double FixedPolynomialKernelTable<2, 1>::COEFFICIENTS[];
+constexpr double FixedPolynomialKernelTable<2, 1>::TERMS[];
+constexpr double FixedPolynomialKernelTable<2, 2>::COEFFICIENTS[];
+constexpr double FixedPolynomialKernelTable<2, 2>::TERMS[];
+constexpr double FixedPolynomialKernelTable<2, 3>::COEFFICIENTS[];
+constexpr double FixedPolynomialKernelTable<2, 3>::TERMS[];
+constexpr double FixedPolynomialKernelTable<3, 1>::COEFFICIENTS[];
+constexpr double FixedPolynomialKernelTable<3, 1>::TERMS[];
+constexpr double FixedPolynomialKernelTable<3, 2>::COEFFICIENTS[];
+constexpr double FixedPolynomialKernelTable<3, 2>::TERMS[];
+constexpr double FixedPolynomialKernelTable<3, 3>::COEFFICIENTS[];
+constexpr double FixedPolynomialKernelTable<3, 3>::TERMS[];
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+namespace {
+// creates a polynomial kernel, using FixedPolynomialKernel for orders 2 to 6
+template <unsigned int S>
+KDEKernel* create_polynomial_kernel(unsigned int r) {
+  switch (r) {
+    case 1:
+      return new FixedPolynomialKernel<S, 1>();
+
+    case 2:
+      return new FixedPolynomialKernel<S, 2>();
+
+    case 3:
+      return new FixedPolynomialKernel<S, 3>();
+
+    default:
+      return new PolynomialKernel(S, r);
+  }
+}
+} // namespace
 //---------------------------------------------------------------------------//
 // FACTORY METHOD
 //---------------------------------------------------------------------------//
@@ -19,11 +64,11 @@ KDEKernel* KDEKernel::createKernel(const std::string& type, unsigned int order)
     if (type == "uniform") {
       kernel = new PolynomialKernel(0, r);
     } else if (type == "epanechnikov") {
-      kernel = new PolynomialKernel(1, r);
+      kernel = create_polynomial_kernel<1>(r);
     } else if (type == "biweight") {
-      kernel = new PolynomialKernel(2, r);
+      kernel = create_polynomial_kernel<2>(r);
     } else if (type == "triweight") {
-      kernel = new PolynomialKernel(3, r);
+      kernel = create_polynomial_kernel<3>(r);
     }
   }
 
@@ -32,35 +77,56 @@ KDEKernel* KDEKernel::createKernel(const std::string& type, unsigned int order)
 //---------------------------------------------------------------------------//
 // PUBLIC INTERFACE
 //---------------------------------------------------------------------------//
+void KDEKernel::evaluate_batch(const double* u, unsigned int n,
+                               double* values) const {
+  for (unsigned int i = 0; i < n; ++i) {
+    values[i] = evaluate(u[i]);
+  }
+}
+//---------------------------------------------------------------------------//
+bool KDEKernel::get_polynomial(std::vector<double>& coefficients) const {
+  coefficients.clear();
+  return false;
+}
+//---------------------------------------------------------------------------//
 double KDEKernel::boundary_correction(const double* u,
                                       const double* p,
                                       const unsigned int* side,
                                       unsigned int num_corrections) const {
+  BoundaryCorrection correction;
+  get_boundary_correction(p, side, num_corrections, correction);
+  return correction.evaluate(u);
+}
+//---------------------------------------------------------------------------//
+bool KDEKernel::get_boundary_correction(const double* p,
+                                        const unsigned int* side,
+                                        unsigned int num_corrections,
+                                        BoundaryCorrection& correction) const {
   assert(num_corrections <= 3);
   assert(num_corrections > 0);
 
-  // compute partial moments ai(p) for first dimension
-  std::vector <double> ai_u;
-  bool valid_moments = compute_moments(u[0], p[0], side[0], ai_u);
+  correction.num_corrections = num_corrections;
+  correction.valid = false;
 
-  // check within boundary kernel domain
-  if (!valid_moments)
-    return 0.0;
+  // compute partial moments ai(p) for each dimension
+  std::vector<double> ai[3];
 
-  // solve for the boundary correction factor
-  if (num_corrections == 1) {
-    double correction_factor = (ai_u[2] - ai_u[1] * u[0]);
-    correction_factor /= ai_u[0] * ai_u[2] - ai_u[1] * ai_u[1];
-    return correction_factor;
-  } else { // correction needed in more than one dimension
-    // compute partial moments ai(p) for second dimension
-    std::vector<double> ai_v;
-    valid_moments = compute_moments(u[1], p[1], side[1], ai_v);
+  for (unsigned int i = 0; i < num_corrections; ++i) {
+    bool valid_moments = compute_moments(p[i], side[i],
+                                         correction.u_min[i],
+                                         correction.u_max[i], ai[i]);
 
-    // check still within boundary kernel domain
+    // check within boundary kernel domain
     if (!valid_moments)
-      return 0.0;
+      return false;
+  }
 
+  // solve for the boundary correction factor
+  if (num_corrections == 1) {
+    double denominator = ai[0][0] * ai[0][2] - ai[0][1] * ai[0][1];
+    correction.coefficients[0] = ai[0][2] / denominator;
+    correction.coefficients[1] = -1.0 * ai[0][1] / denominator;
+  } else { // correction needed in more than one dimension
     // solve for the coefficients of the boundary correction factor
     bool solved = false;
     double precision = 1e-10;
@@ -75,23 +141,15 @@ double KDEKernel::boundary_correction(const double* u,
       rhs << 1.0, 0.0, 0.0;
 
       // get 3x3 matrix for 2-D correction
-      get_correction_matrix2D(ai_u, ai_v, correction_matrix);
+      get_correction_matrix2D(ai[0], ai[1], correction_matrix);
 
     } else { // correction needed in all three dimensions
 
-      // compute partial moments ai(p) for third dimension
-      std::vector<double> ai_w;
-      valid_moments = compute_moments(u[2], p[2], side[2], ai_w);
-
-      // check still within boundary kernel domain
-      if (!valid_moments)
-        return 0.0;
-
       // initialize 4x1 right-hand side
       rhs << 1.0, 0.0, 0.0, 0.0;
 
       // get 4x4 matrix for 3-D correction
-      get_correction_matrix3D(ai_u, ai_v, ai_w, correction_matrix);
+      get_correction_matrix3D(ai[0], ai[1], ai[2], correction_matrix);
     }
 
     // solve 3x3 or 4x4 system
@@ -100,26 +158,24 @@ double KDEKernel::boundary_correction(const double* u,
     // test for valid solution
     solved = (correction_matrix * coefficients).isApprox(rhs, precision);
 
-    if (!solved) {
-      return 0.0;
-    }
-
-    // compute the boundary correction factor from coefficients
-    double correction_factor = coefficients(0);
+    if (!solved)
+      return false;
 
-    for (unsigned int i = 1; i <= num_corrections; ++i) {
-      correction_factor += u[i - 1] * coefficients(i);
+    for (unsigned int i = 0; i <= num_corrections; ++i) {
+      correction.coefficients[i] = coefficients(i);
     }
-
-    return correction_factor;
   }
+
+  correction.valid = true;
+  return true;
 }
 //---------------------------------------------------------------------------//
 // PROTECTED METHODS
 //---------------------------------------------------------------------------//
-bool KDEKernel::compute_moments(double u,
-                                double p,
+bool KDEKernel::compute_moments(double p,
                                 unsigned int side,
+                                double& u_min,
+                                double& u_max,
                                 std::vector<double>& moments) const {
   assert(side <= 1);
   assert(moments.empty());
@@ -129,8 +185,8 @@ bool KDEKernel::compute_moments(double u,
     return false;
 
   // determine the integration limits
-  double u_min = -1.0;
-  double u_max = 1.0;
+  u_min = -1.0;
+  u_max = 1.0;
 
   if (p < 1.0) {
     if (side == 0) { // side == LOWER
@@ -140,10 +196,6 @@ bool KDEKernel::compute_moments(double u,
     }
   }
 
-  // test if outside domain u = [u_min, u_max]
-  if (u < u_min || u > u_max)
-    return false;
-
   // evaluate the partial moment functions ai(p) and add to moments vector
   moments.push_back(this->integrate_moment(u_min, u_max, 0));
   moments.push_back(this->integrate_moment(u_min, u_max, 1));
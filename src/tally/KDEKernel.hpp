@@ -26,7 +26,8 @@
  * prevent memory leaks.
  *
  * Once a kernel K(u) has been created, it can then be evaluated using the
- * evaluate(double u) method.
+ * evaluate(double u) method, or for many values at once using the
+ * evaluate_batch() method.
  *
  * If a calculation point lies within one bandwidth of an external boundary,
  * then K(u) should be multiplied by the boundary correction factor computed
@@ -82,6 +83,9 @@ class KDEKernel {
    * Only symmetric kernel functions of these types are supported, which
    * means that the order must be a multiple of 2.
    *
+   * Kernels of order 2, 4 and 6 other than "uniform" are created as a
+   * FixedPolynomialKernel; all others are created as a PolynomialKernel.
+   *
    * NOTE: if an invalid kernel is requested, a NULL pointer is returned.
    */
   static KDEKernel* createKernel(const std::string& type,
@@ -96,6 +100,18 @@ class KDEKernel {
    */
   virtual double evaluate(double u) const = 0;
 
+  /**
+   * \brief Evaluate this kernel function K for a block of values
+   * \param[in] u the n values at which K will be evaluated
+   * \param[in] n the number of values
+   * \param[out] values stores K(u[i]) for each of the n values
+   *
+   * The default implementation calls evaluate() once per value.  Derived
+   * classes should override it with a loop the compiler can vectorize.
+   */
+  virtual void evaluate_batch(const double* u, unsigned int n,
+                              double* values) const;
+
   /**
    * \brief get_kernel_name()
    * \return string representing kernel name
@@ -123,6 +139,17 @@ class KDEKernel {
    */
   virtual double integrate_moment(double a, double b, unsigned int i) const = 0;
 
+  /**
+   * \brief Gets the coefficients of this kernel as a polynomial in u
+   * \param[out] coefficients stores c[k] such that K(u) = sum of c[k] * u^k
+   * \return true if K(u) is a polynomial on [-1, 1]; false otherwise
+   *
+   * If true is returned, the polynomial is only valid for u in [-1, 1].  The
+   * default implementation returns false for kernels that are not
+   * polynomials.
+   */
+  virtual bool get_polynomial(std::vector<double>& coefficients) const;
+
   /**
    * \brief Evaluate the boundary correction factor for this kernel function K
    * \param[in] u value(s) at which the kernel is to be evaluated
@@ -159,12 +186,74 @@ class KDEKernel {
                                      const unsigned int* side,
                                      unsigned int num_corrections) const;
 
+  /**
+   * \struct BoundaryCorrection
+   * \brief Stores the boundary correction factor for one calculation point
+   *
+   * The correction factor only depends on u through its domain and the
+   * linear form a0 + a1*u + a2*v + a3*w, so it can be computed once for a
+   * calculation point and then evaluated for any u.
+   */
+  struct BoundaryCorrection {
+    /// Number of dimensions requiring correction
+    unsigned int num_corrections;
+
+    /// Domain [u_min, u_max] of the boundary kernel in each dimension
+    double u_min[3];
+    double u_max[3];
+
+    /// Coefficients a0, a1, a2, a3 of the correction factor
+    double coefficients[4];
+
+    /// False if there is no valid boundary kernel for any u
+    bool valid;
+
+    /**
+     * \brief Evaluate this boundary correction factor
+     * \param[in] u value(s) at which the kernel is to be evaluated
+     * \return the boundary correction factor, or 0.0 if u is not valid
+     */
+    double evaluate(const double* u) const {
+      if (!valid)
+        return 0.0;
+
+      double correction_factor = coefficients[0];
+
+      for (unsigned int i = 0; i < num_corrections; ++i) {
+        if (u[i] < u_min[i] || u[i] > u_max[i])
+          return 0.0;
+
+        correction_factor += u[i] * coefficients[i + 1];
+      }
+
+      return correction_factor;
+    }
+  };
+
+  /**
+   * \brief Compute the boundary correction factor for a calculation point
+   * \param[in] p ratio(s) of distance from the boundary divided by bandwidth
+   * \param[in] side the location(s) of the boundary (0 = LOWER, 1 = UPPER)
+   * \param[in] num_corrections number of dimensions requiring correction
+   * \param[out] correction the boundary correction factor
+   * \return true if the correction factor is valid; false otherwise
+   *
+   * Does the work of boundary_correction() that does not depend on u, i.e.
+   * computing the partial moments and solving the correction system.  Then
+   * boundary_correction(u, p, side, num_corrections) is the same as
+   * correction.evaluate(u).
+   */
+  bool get_boundary_correction(const double* p,
+                               const unsigned int* side,
+                               unsigned int num_corrections,
+                               BoundaryCorrection& correction) const;
+
  protected:
   /**
    * \brief Computes partial moments ai(p) for this kernel up to i = 2
-   * \param[in] u the value at which the kernel is to be evaluated
    * \param[in] p ratio of the distance from the boundary divided by bandwidth
    * \param[in] side the location of the boundary (0 = LOWER, 1 = UPPER)
+   * \param[out] u_min, u_max the domain of the boundary kernel
    * \param[out] moments an empty vector that will store the new ai(p) values
    * \return true if moments are defined for boundary kernel; false otherwise
    *
@@ -178,9 +267,10 @@ class KDEKernel {
    * [-1, p].  If UPPER, then the integration is performed on [-p, 1]. If
    * p >= 1 moments will be always be defined on the domain [-1, 1].
    */
-  bool compute_moments(double u,
-                       double p,
+  bool compute_moments(double p,
                        unsigned int side,
+                       double& u_min,
+                       double& u_max,
                        std::vector<double>& moments) const;
 
   /**
@@ -4,14 +4,15 @@
 #include <climits>
 #include <cmath>
 #include <iostream>
-#include <set>
 #include <sstream>
 #include <string>
 
 #include "moab/Core.hpp"
 #include "moab/Range.hpp"
 
+#include "FixedPolynomialKernel.hpp"
 #include "KDEMeshTally.hpp"
+#include "TallyContext.hpp"
 
 // initialize static variables
 bool KDEMeshTally::seed_is_set = false;
@@ -20,6 +21,35 @@ const char* const KDEMeshTally::kde_estimator_names[] = {"collision",
                                                          "sub-track"
                                                         };
 
+//---------------------------------------------------------------------------//
+// KERNEL FUNCTIONS
+//---------------------------------------------------------------------------//
+namespace {
+// evaluates any kernel through the KDEKernel interface
+struct GenericKernel {
+  static double evaluate(const KDEKernel* kernel, double u) {
+    return kernel->evaluate(u);
+  }
+
+  static void evaluate_batch(const KDEKernel* kernel, const double* u,
+                             unsigned int n, double* values) {
+    kernel->evaluate_batch(u, n, values);
+  }
+};
+
+// evaluates a FixedPolynomialKernel<S, R> directly, so it can be inlined
+template <unsigned int S, unsigned int R>
+struct FixedKernel {
+  static double evaluate(const KDEKernel*, double u) {
+    return FixedPolynomialKernel<S, R>::evaluate_fixed(u);
+  }
+
+  static void evaluate_batch(const KDEKernel*, const double* u,
+                             unsigned int n, double* values) {
+    FixedPolynomialKernel<S, R>::evaluate_batch_fixed(u, n, values);
+  }
+};
+} // namespace
 //---------------------------------------------------------------------------//
 // CONSTRUCTOR
 //---------------------------------------------------------------------------//
@@ -61,6 +91,14 @@ KDEMeshTally::KDEMeshTally(const TallyInput& input,
     int num_points = 3 * kernel->get_min_quadrature(0) - 2;
     std::cout << "    using " << num_points << "-pt quadrature scheme\n";
     quadrature = new Quadrature(num_points);
+
+    // integrate polynomial kernels exactly if their degree is supported
+    if (kernel->get_polynomial(kernel_polynomial) &&
+        kernel_polynomial.size() <= MAX_KERNEL_DEGREE + 1) {
+      std::cout << "    using exact integral for polynomial kernel\n";
+    } else {
+      kernel_polynomial.clear();
+    }
   } else if (estimator == SUB_TRACK) {
     std::cout << "    splitting full tracks into "
               << num_subtracks << " sub-tracks" << std::endl;
@@ -101,6 +139,17 @@ KDEMeshTally::~KDEMeshTally() {
 // DERIVED PUBLIC INTERFACE from Tally.hpp
 //---------------------------------------------------------------------------//
 void KDEMeshTally::compute_score(const TallyEvent& event) {
+  score_event(event, *data, NULL);
+}
+//---------------------------------------------------------------------------//
+void KDEMeshTally::compute_score(const TallyEvent& event,
+                                 TallyContext& context) {
+  score_event(event, context.get_scratch_data(input_data.tally_id), &context);
+}
+//---------------------------------------------------------------------------//
+void KDEMeshTally::score_event(const TallyEvent& event,
+                               TallyData& scores,
+                               TallyContext* context) {
   double weight = event.get_score_multiplier(input_data.multiplier_id);
 
   // set up tally event based on KDE mesh tally type
@@ -110,12 +159,15 @@ void KDEMeshTally::compute_score(const TallyEvent& event) {
     if (estimator == SUB_TRACK) {
       // multiply weight by track length and set up sub-track points
       weight *= event.track_length;
-      subtrack_points = choose_points(num_subtracks, event);
+      subtrack_points = choose_points(num_subtracks, event, context);
     }
   } else if (event.type == TallyEvent::COLLISION && estimator == COLLISION) {
-    // divide weight by cross section and update optimal bandwidth
+    // divide weight by cross section and update optimal bandwidth, which
+    // is only done when scoring serially
     weight /= event.total_cross_section;
-    update_variance(event.position);
+
+    if (context == NULL)
+      update_variance(event.position);
   } else { // NONE, return from this method
     return;
   }
@@ -125,28 +177,65 @@ void KDEMeshTally::compute_score(const TallyEvent& event) {
     return;
   }
 
-  // update the neighborhood region and find all of the calculations points
-  region->update_neighborhood(event, bandwidth);
-  const std::set<moab::EntityHandle>& calculation_points = region->get_points();
+  // find all of the calculation points, without updating the neighborhood
+  // region if scoring for a TallyContext
+  const std::vector<unsigned int>* points = NULL;
+
+  if (context == NULL) {
+    region->update_neighborhood(event, bandwidth);
+    points = &region->get_points();
+  } else {
+    region->get_points(event, bandwidth, context->get_point_buffer());
+    points = &context->get_point_buffer();
+  }
+
+  const std::vector<unsigned int>& calculation_points = *points;
+
+  // compute collision scores for blocks of calculation points at once
+  if (estimator == COLLISION) {
+    unsigned int num_points = calculation_points.size();
+    double block_scores[KERNEL_BLOCK_SIZE];
+
+    for (unsigned int first = 0; first < num_points; first += KERNEL_BLOCK_SIZE) {
+      unsigned int n = num_points - first;
+
+      if (n > KERNEL_BLOCK_SIZE)
+        n = KERNEL_BLOCK_SIZE;
+
+      evaluate_kernel_block(&calculation_points[first], n,
+                            event.position, block_scores);
+
+      for (unsigned int j = 0; j < n; ++j) {
+        scores.add_score_to_tally(calculation_points[first + j],
+                                  weight * block_scores[j], ebin);
+      }
+    }
+
+    return;
+  }
 
   // iterate through calculation points and compute their final scores
-  std::set<moab::EntityHandle>::iterator i;
+  std::vector<unsigned int>::const_iterator i;
   CalculationPoint X;
 
   for (i = calculation_points.begin(); i != calculation_points.end(); ++i) {
     // get coordinates of this point
-    moab::EntityHandle point = *i;
-    moab::ErrorCode rval = mbi->get_coords(&point, 1, X.coords);
+    unsigned int point = *i;
+    const double* coords = region->get_coords(point);
 
-    assert(rval == moab::MB_SUCCESS);
+    for (int j = 0; j < 3; ++j) {
+      X.coords[j] = coords[j];
+    }
 
     // get tag data for this point if user requested boundary correction
     if (use_boundary_correction) {
-      rval = mbi->tag_get_data(boundary_tag, &point, 1, X.boundary_data);
-      assert(rval == moab::MB_SUCCESS);
+      for (int j = 0; j < 3; ++j) {
+        X.boundary_data[j] = boundary_data[3 * point + j];
+        X.distance_data[j] = distance_data[3 * point + j];
+      }
 
-      rval = mbi->tag_get_data(distance_tag, &point, 1, X.distance_data);
-      assert(rval == moab::MB_SUCCESS);
+      int index = correction_index[point];
+      X.correction = (index == -1) ? NULL : &boundary_corrections[index];
     }
 
     // compute the final contribution to the tally for this point
@@ -160,61 +249,80 @@ void KDEMeshTally::compute_score(const TallyEvent& event) {
       score = evaluate_kernel(X, event.position);
     }
 
-    add_score_to_mesh_tally(point, weight, score,  ebin);
+    // calculation point indices match the tally point indices
+    scores.add_score_to_tally(point, weight * score, ebin);
   }  // end calculation_points iteration
 }
 //---------------------------------------------------------------------------//
-void KDEMeshTally::write_data(double num_histories) {
-  // display the optimal bandwidth if it was computed
-  if (estimator == COLLISION) {
-    std::cout << std::endl << "optimal bandwidth for " << num_collisions
-              << " collisions is: " << get_optimal_bandwidth() << std::endl;
-  }
+bool KDEMeshTally::scores_event_type(TallyEvent::EventType type) const {
+  if (estimator == COLLISION)
+    return type == TallyEvent::COLLISION;
 
-  // tag tally and relative error results to the mesh for each tally point
-  moab::ErrorCode rval = moab::MB_SUCCESS;
-  if (rval != moab::MB_SUCCESS) {
-    std::cout << "This can't fail" << std::endl;
-    exit(1);
+  return type == TallyEvent::TRACK;
+}
+//---------------------------------------------------------------------------//
+bool KDEMeshTally::uses_rand() const {
+  return estimator == SUB_TRACK;
+}
+//---------------------------------------------------------------------------//
+void KDEMeshTally::get_checkpoint_state(std::vector<double>& state) const {
+  state.clear();
+  state.push_back(num_collisions);
+  state.push_back(max_collisions ? 1.0 : 0.0);
+
+  for (int i = 0; i < 3; ++i) {
+    state.push_back(mean[i]);
   }
-  moab::Range::iterator i;
 
-  for (i = tally_points.begin(); i != tally_points.end(); ++i) {
-    moab::EntityHandle point = *i;
-    unsigned int point_index = get_entity_index(point);
+  for (int i = 0; i < 3; ++i) {
+    state.push_back(variance[i]);
+  }
+}
+//---------------------------------------------------------------------------//
+bool KDEMeshTally::set_checkpoint_state(const std::vector<double>& state) {
+  if (state.size() != 8)
+    return false;
 
-    unsigned int num_ebins = data->get_num_energy_bins();
-    // if there is a total, dont do anything with it
-    if (data->has_total_energy_bin())
-      num_ebins--;
+  // the count stops at LLONG_MAX, which is not exact as a double
+  if (state[0] < LLONG_MAX)
+    num_collisions = static_cast<long long int>(state[0]);
+  else
+    num_collisions = LLONG_MAX;
 
-    std::vector<double> tally_vect(num_ebins);
-    std::vector<double> error_vect(num_ebins);
+  max_collisions = (state[1] != 0.0);
 
-    for (unsigned int j = 0; j < num_ebins; ++ j) {
-      std::pair <double, double> tally_data = data->get_data(point_index, j);
-      double tally = tally_data.first;
-      double error = tally_data.second;
+  for (int i = 0; i < 3; ++i) {
+    mean[i] = state[2 + i];
+    variance[i] = state[5 + i];
+  }
 
-      // compute relative error for the tally result
-      double rel_error = 0.0;
+  return true;
+}
+//---------------------------------------------------------------------------//
+void KDEMeshTally::write_data(double num_histories) {
+  // display the optimal bandwidth if it was computed
+  if (estimator == COLLISION) {
+    std::cout << std::endl << "optimal bandwidth for " << num_collisions
+              << " collisions is: " << get_optimal_bandwidth() << std::endl;
+  }
 
-      if (error != 0.0) {
-        rel_error = sqrt(error / (tally * tally) - 1.0 / num_histories);
-      }
+  // compute results for all tally points in one pass over the tally data,
+  // ignoring the total energy bin
+  std::vector<double> tally_vect, error_vect, total_tally, total_error;
+  data->get_results(num_histories, NULL,
+                    tally_vect, error_vect, total_tally, total_error);
 
-      // normalize mesh tally result by the number of source particles
-      tally /= num_histories;
+  // set tally and error tag values for all tally points at once
+  moab::ErrorCode rval;
+  rval = mbi->tag_set_data(tally_tag, tally_points, tally_vect.data());
+  MB_CHK_SET_ERR_RET(rval, "Failed to set the tally_tag data");
+  rval = mbi->tag_set_data(error_tag, tally_points, error_vect.data());
+  MB_CHK_SET_ERR_RET(rval, "Failed to set the error_tag data");
 
-      tally_vect[j] = tally;
-      error_vect[j] = rel_error;
-    }
-    // set tally and error tag values for this entity
-    rval = mbi->tag_set_data(tally_tag, &point, 1, tally_vect.data());
-    MB_CHK_SET_ERR_RET(rval, "Failed to set the tally_tag data");
-    rval = mbi->tag_set_data(error_tag, &point, 1, error_vect.data());
-    MB_CHK_SET_ERR_RET(rval, "Failed to set the error_tag data");
-  }
+  // set the weight-window map from the results, if requested
+  std::vector<double> ww_lower;
+  rval = set_weight_windows(mbi, tally_vect, error_vect, ww_lower);
+  MB_CHK_SET_ERR_RET(rval, "Failed to set the weight windows");
 
   // create a global tag to store the bandwidth value
   moab::Tag bandwidth_tag;
@@ -237,6 +345,9 @@ void KDEMeshTally::write_data(double num_histories) {
   output_tags.push_back(error_tag);
   output_tags.push_back(bandwidth_tag);
 
+  if (!ww_lower.empty())
+    output_tags.push_back(ww_tag);
+
   rval = mbi->write_file(output_filename.c_str(),
                          NULL, NULL,
                          &tally_mesh_set, 1,
@@ -333,6 +444,29 @@ void KDEMeshTally::parse_tally_options() {
     std::cerr << "Warning: invalid kernel type '" << kernel_type << "'\n";
     kernel = KDEKernel::createKernel("epanechnikov", kernel_order);
   }
+
+  // call the kernel directly from the KDE estimators if it is fixed
+  kernel_function = &KDEMeshTally::evaluate_kernel_as<GenericKernel>;
+  kernel_block_function =
+    &KDEMeshTally::evaluate_kernel_block_as<GenericKernel>;
+
+  use_fixed_kernel<1, 1>() || use_fixed_kernel<1, 2>() ||
+  use_fixed_kernel<1, 3>() || use_fixed_kernel<2, 1>() ||
+  use_fixed_kernel<2, 2>() || use_fixed_kernel<2, 3>() ||
+  use_fixed_kernel<3, 1>() || use_fixed_kernel<3, 2>() ||
+  use_fixed_kernel<3, 3>();
+}
+//---------------------------------------------------------------------------//
+template <unsigned int S, unsigned int R>
+bool KDEMeshTally::use_fixed_kernel() {
+  if (dynamic_cast<const FixedPolynomialKernel<S, R>*>(kernel) == NULL)
+    return false;
+
+  kernel_function = &KDEMeshTally::evaluate_kernel_as<FixedKernel<S, R> >;
+  kernel_block_function =
+    &KDEMeshTally::evaluate_kernel_block_as<FixedKernel<S, R> >;
+
+  return true;
 }
 //---------------------------------------------------------------------------//
 moab::ErrorCode KDEMeshTally::initialize_mesh_data() {
@@ -389,6 +523,46 @@ moab::ErrorCode KDEMeshTally::initialize_mesh_data() {
     }
   }
 
+  // copy the boundary data for all mesh nodes out of MOAB
+  if (use_boundary_correction && !mesh_nodes.empty()) {
+    boundary_data.resize(3 * mesh_nodes.size());
+    distance_data.resize(3 * mesh_nodes.size());
+
+    rval = mbi->tag_get_data(boundary_tag, mesh_nodes, &boundary_data[0]);
+
+    if (rval != moab::MB_SUCCESS)
+      return rval;
+
+    rval = mbi->tag_get_data(distance_tag, mesh_nodes, &distance_data[0]);
+
+    if (rval != moab::MB_SUCCESS)
+      return rval;
+
+    // compute the boundary correction factor once for each boundary point
+    correction_index.assign(mesh_nodes.size(), -1);
+
+    for (unsigned int point = 0; point < mesh_nodes.size(); ++point) {
+      double pi[3];
+      unsigned int si[3];
+      unsigned int num_corrections = 0;
+
+      for (int i = 0; i < 3; ++i) {
+        if (boundary_data[3 * point + i] != -1) {
+          pi[num_corrections] = distance_data[3 * point + i] / bandwidth[i];
+          si[num_corrections] = boundary_data[3 * point + i];
+          ++num_corrections;
+        }
+      }
+
+      if (num_corrections > 0) {
+        KDEKernel::BoundaryCorrection correction;
+        kernel->get_boundary_correction(pi, si, num_corrections, correction);
+        correction_index[point] = boundary_corrections.size();
+        boundary_corrections.push_back(correction);
+      }
+    }
+  }
+
   return moab::MB_SUCCESS;
 }
 //---------------------------------------------------------------------------//
@@ -439,11 +613,24 @@ double KDEMeshTally::PathKernel::evaluate(double s) const {
 //---------------------------------------------------------------------------//
 double KDEMeshTally::evaluate_kernel(const CalculationPoint& X,
                                      const moab::CartVect& observation) const {
+  return (this->*kernel_function)(X, observation);
+}
+//---------------------------------------------------------------------------//
+void KDEMeshTally::evaluate_kernel_block(const unsigned int* points,
+                                         unsigned int n,
+                                         const moab::CartVect& observation,
+                                         double* values) const {
+  (this->*kernel_block_function)(points, n, observation, values);
+}
+//---------------------------------------------------------------------------//
+template <typename Kernel>
+double KDEMeshTally::evaluate_kernel_as(
+  const CalculationPoint& X, const moab::CartVect& observation) const {
   // define variables needed for boundary correction
-  bool is_boundary_point = false;
-  std::vector<double> ui;
-  std::vector<double> pi;
-  std::vector<unsigned int> si;
+  double ui[3];
+  double pi[3];
+  unsigned int si[3];
+  unsigned int num_corrections = 0;
 
   // evaluate the 3D kernel function
   double kernel_value = 1.0;
@@ -451,26 +638,80 @@ double KDEMeshTally::evaluate_kernel(const CalculationPoint& X,
   for (int i = 0; i < 3; ++i) {
     // always compute standard kernel value for this dimension
     double u = (X.coords[i] - observation[i]) / bandwidth[i];
-    kernel_value *= kernel->evaluate(u) / bandwidth[i];
+    kernel_value *= Kernel::evaluate(kernel, u) / bandwidth[i];
 
     // update boundary correction data if needed for this dimension
     if (use_boundary_correction && X.boundary_data[i] != -1) {
-      is_boundary_point = true;
-      ui.push_back(u);
-      pi.push_back(X.distance_data[i] / bandwidth[i]);
-      si.push_back(X.boundary_data[i]);
+      ui[num_corrections] = u;
+      pi[num_corrections] = X.distance_data[i] / bandwidth[i];
+      si[num_corrections] = X.boundary_data[i];
+      ++num_corrections;
     }
   }
 
   // multiply by boundary correction factor only if X is a boundary point
-  if (is_boundary_point) {
-    unsigned int n = ui.size();
-    kernel_value *= kernel->boundary_correction(&ui[0], &pi[0], &si[0], n);
+  if (num_corrections > 0 && X.correction != NULL) {
+    kernel_value *= X.correction->evaluate(ui);
+  } else if (num_corrections > 0) {
+    kernel_value *= kernel->boundary_correction(ui, pi, si, num_corrections);
   }
 
   return kernel_value;
 }
 //---------------------------------------------------------------------------//
+template <typename Kernel>
+void KDEMeshTally::evaluate_kernel_block_as(const unsigned int* points,
+                                            unsigned int n,
+                                            const moab::CartVect& observation,
+                                            double* values) const {
+  assert(n <= KERNEL_BLOCK_SIZE);
+
+  double u[KERNEL_BLOCK_SIZE];
+  double kernel_values[KERNEL_BLOCK_SIZE];
+
+  for (unsigned int j = 0; j < n; ++j) {
+    values[j] = 1.0;
+  }
+
+  // evaluate the 3D kernel function one dimension at a time
+  for (int i = 0; i < 3; ++i) {
+    for (unsigned int j = 0; j < n; ++j) {
+      u[j] = (region->get_coords(points[j])[i] - observation[i]) / bandwidth[i];
+    }
+
+    Kernel::evaluate_batch(kernel, u, n, kernel_values);
+
+    for (unsigned int j = 0; j < n; ++j) {
+      values[j] *= kernel_values[j] / bandwidth[i];
+    }
+  }
+
+  if (!use_boundary_correction)
+    return;
+
+  // multiply by the precomputed correction factor for the boundary points
+  for (unsigned int j = 0; j < n; ++j) {
+    unsigned int point = points[j];
+    int index = correction_index[point];
+
+    if (index == -1)
+      continue;
+
+    const double* coords = region->get_coords(point);
+    double ui[3];
+    unsigned int num_corrections = 0;
+
+    for (int i = 0; i < 3; ++i) {
+      if (boundary_data[3 * point + i] != -1) {
+        ui[num_corrections] = (coords[i] - observation[i]) / bandwidth[i];
+        ++num_corrections;
+      }
+    }
+
+    values[j] *= boundary_corrections[index].evaluate(ui);
+  }
+}
+//---------------------------------------------------------------------------//
 double KDEMeshTally::integral_track_score(const CalculationPoint& X,
                                           const TallyEvent& event) const {
   // determine the limits of integration
@@ -481,7 +722,22 @@ double KDEMeshTally::integral_track_score(const CalculationPoint& X,
 
   // compute value of the integral only if valid limits exist
   if (valid_limits) {
-    // construct a PathKernel and return value of its integral
+    // boundary points need the boundary correction at every path length
+    bool is_boundary_point = false;
+
+    if (use_boundary_correction) {
+      for (int i = 0; i < 3; ++i) {
+        if (X.boundary_data[i] != -1)
+          is_boundary_point = true;
+      }
+    }
+
+    // integrate polynomial kernels exactly
+    if (!kernel_polynomial.empty() && !is_boundary_point) {
+      return polynomial_track_score(X, event, limits);
+    }
+
+    // otherwise construct a PathKernel and return value of its integral
     PathKernel path_kernel(*this, event, X);
     return quadrature->integrate(limits.first, limits.second, path_kernel);
   } else { // integration limits are not valid so no score is computed
@@ -536,6 +792,80 @@ bool KDEMeshTally::set_integral_limits(const TallyEvent& event,
   return valid_limits;
 }
 //---------------------------------------------------------------------------//
+double KDEMeshTally::polynomial_track_score(const CalculationPoint& X,
+                                            const TallyEvent& event,
+                                            const std::pair<double, double>& limits) const {
+  assert(!kernel_polynomial.empty());
+
+  unsigned int degree = kernel_polynomial.size() - 1;
+  assert(degree <= MAX_KERNEL_DEGREE);
+
+  // path length is s = midpoint + t * path_length for t in [-1/2, 1/2],
+  // which keeps the expansion well conditioned for high order kernels
+  double path_length = limits.second - limits.first;
+  double midpoint = 0.5 * (limits.first + limits.second);
+
+  // coefficients of the 3D kernel function as a polynomial in t
+  double product[3 * MAX_KERNEL_DEGREE + 1];
+  unsigned int product_degree = 0;
+  product[0] = 1.0;
+
+  for (int i = 0; i < 3; ++i) {
+    // u = u0 + du * t is the scaled distance along this dimension
+    double u0 = X.coords[i] - event.position[i];
+    u0 -= midpoint * event.direction[i];
+    u0 /= bandwidth[i];
+    double du = -1.0 * path_length * event.direction[i] / bandwidth[i];
+
+    // set_integral_limits() does not check dimensions the track is
+    // parallel to, where u is constant and may be outside [-1, 1]
+    if (event.direction[i] == 0.0 && (u0 < -1.0 || u0 > 1.0))
+      return 0.0;
+
+    // expand K(u0 + du * t) as a polynomial in t using Horner's method
+    double factor[MAX_KERNEL_DEGREE + 1];
+    factor[0] = kernel_polynomial[degree];
+
+    for (unsigned int k = 1; k <= degree; ++k) {
+      factor[k] = factor[k - 1] * du;
+
+      for (unsigned int j = k - 1; j > 0; --j) {
+        factor[j] = factor[j] * u0 + factor[j - 1] * du;
+      }
+
+      factor[0] = factor[0] * u0 + kernel_polynomial[degree - k];
+    }
+
+    // multiply the product by this factor, highest terms first
+    for (unsigned int j = product_degree + degree; j > product_degree; --j) {
+      product[j] = 0.0;
+    }
+
+    for (int j = product_degree; j >= 0; --j) {
+      double value = product[j];
+      product[j] = 0.0;
+
+      for (unsigned int k = 0; k <= degree; ++k) {
+        product[j + k] += value * factor[k];
+      }
+    }
+
+    product_degree += degree;
+  }
+
+  // integrate the product term by term over t in [-1/2, 1/2], where
+  // only the even terms contribute
+  double integral = 0.0;
+  double scale = 1.0;
+
+  for (unsigned int k = 0; k <= product_degree; k += 2) {
+    integral += product[k] * scale / (k + 1);
+    scale *= 0.25;
+  }
+
+  return integral * path_length / (bandwidth[0] * bandwidth[1] * bandwidth[2]);
+}
+//---------------------------------------------------------------------------//
 double KDEMeshTally::subtrack_score(const CalculationPoint& X,
                                     const std::vector<moab::CartVect>& points) const {
   // iterate through the sub-track points
@@ -556,7 +886,8 @@ double KDEMeshTally::subtrack_score(const CalculationPoint& X,
 }
 //---------------------------------------------------------------------------//
 std::vector<moab::CartVect> KDEMeshTally::choose_points(unsigned int p,
-                                                        const TallyEvent& event) const {
+                                                        const TallyEvent& event,
+                                                        TallyContext* context) const {
   // make sure the number of sub-tracks is valid
   assert(p > 0);
 
@@ -570,7 +901,12 @@ std::vector<moab::CartVect> KDEMeshTally::choose_points(unsigned int p,
   std::vector<moab::CartVect> random_points;
 
   for (unsigned int i = 0; i < p; ++i) {
-    double path_length = rand() * sub_track_length / RAND_MAX;
+    double path_length = 0.0;
+
+    if (context == NULL)
+      path_length = rand() * sub_track_length / RAND_MAX;
+    else
+      path_length = context->random_number() * sub_track_length;
 
     // add the coordinates of the corresponding point
     random_points.push_back(start_point + path_length * event.direction);
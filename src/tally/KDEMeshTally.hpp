@@ -89,7 +89,9 @@ class Interface;
  * Indicates that boundary correction is needed for tally points within one
  * bandwidth of an external boundary.  The "default" method uses the boundary
  * kernel approach, and is currently the only option available.  Note that
- * this feature will only work properly for 2nd-order kernels.
+ * this feature will only work properly for 2nd-order kernels.  The boundary
+ * kernel moments and coefficients are computed once for each boundary point
+ * when the mesh is loaded.
  *
  * 6) "seed"="value", "subtracks"="value"
  * --------------------------------------
@@ -97,6 +99,12 @@ class Interface;
  * "seed" option overrides the random number seed value that is used for
  * determining sub-track points.  The "subtracks" option sets the number
  * of sub-tracks to use for computing scores.
+ *
+ * 7) "ww"="method", "ww_norm"="value", "ww_max_error"="value"
+ * -----------------------------------------------------------
+ * Writes a weight-window map with one lower bound for each calculation point
+ * and energy group.  These options are processed through the MeshTally
+ * constructor.  See MeshTally.hpp for more information.
  */
 //===========================================================================//
 class KDEMeshTally : public MeshTally {
@@ -131,6 +139,43 @@ class KDEMeshTally : public MeshTally {
    */
   virtual void compute_score(const TallyEvent& event);
 
+  /**
+   * \brief Computes scores for this KDEMeshTally into a TallyContext
+   * \param[in] event the parameters needed to compute the scores
+   * \param[in, out] context the scoring context of the calling thread
+   *
+   * Sub-track points are chosen with the random number stream of the
+   * context, and the optimal bandwidth is not updated for collisions.
+   */
+  virtual void compute_score(const TallyEvent& event, TallyContext& context);
+
+  /**
+   * \brief Checks if this KDEMeshTally scores events of the given type
+   * \param[in] type the type of tally event
+   * \return true if compute_score() may score events of this type
+   */
+  virtual bool scores_event_type(TallyEvent::EventType type) const;
+
+  /**
+   * \brief Checks if this KDEMeshTally draws random numbers from rand()
+   * \return true for the sub-track estimator
+   */
+  virtual bool uses_rand() const;
+
+  /**
+   * \brief Gets the collision data used for the optimal bandwidth
+   * \param[out] state the number of collisions, the maximum collisions flag,
+   *             and the mean and variance of the collision points
+   */
+  virtual void get_checkpoint_state(std::vector<double>& state) const;
+
+  /**
+   * \brief Restores the collision data used for the optimal bandwidth
+   * \param[in] state the values from get_checkpoint_state()
+   * \return true if the state has the expected number of values
+   */
+  virtual bool set_checkpoint_state(const std::vector<double>& state);
+
   /**
    * \brief Write results to the output file for this KDEMeshTally
    * \param[in] num_histories the number of particle histories tracked
@@ -166,12 +211,26 @@ class KDEMeshTally : public MeshTally {
   moab::Tag boundary_tag;
   moab::Tag distance_tag;
 
+  // Boundary tag data for all mesh nodes, stored as three values per node
+  // in the same order as the tally points
+  std::vector<int> boundary_data;
+  std::vector<double> distance_data;
+
+  // Boundary correction factors precomputed for the boundary points, where
+  // correction_index gives the factor used by each tally point or -1
+  std::vector<KDEKernel::BoundaryCorrection> boundary_corrections;
+  std::vector<int> correction_index;
+
   // Number of sub-tracks used to compute KDE sub-track mesh tally scores
   unsigned int num_subtracks;
 
   // Quadrature used to compute KDE integral-track mesh tally scores
   Quadrature* quadrature;
 
+  // Coefficients of the kernel as a polynomial in u, used to compute KDE
+  // integral-track mesh tally scores exactly; empty if not available
+  std::vector<double> kernel_polynomial;
+
   // MOAB instance that stores all of the mesh data
   moab::Interface* mbi;
 
@@ -249,9 +308,15 @@ class KDEMeshTally : public MeshTally {
 
   // Defines common data needed for computing score for a calculation point
   struct CalculationPoint {
+    CalculationPoint() : correction(NULL) {}
+
     double coords[3];
     int boundary_data[3];
     double distance_data[3];
+
+    // precomputed boundary correction factor, if NULL it is computed from
+    // the boundary and distance data when needed
+    const KDEKernel::BoundaryCorrection* correction;
   };
 
   /**
@@ -297,6 +362,60 @@ class KDEMeshTally : public MeshTally {
   double evaluate_kernel(const CalculationPoint& X,
                          const moab::CartVect& observation) const;
 
+  // Number of calculation points in a block for evaluate_kernel_block()
+  static const unsigned int KERNEL_BLOCK_SIZE = 64;
+
+  /**
+   * \brief Computes value of the 3D kernel function for a block of points
+   * \param[in] points indices of at most KERNEL_BLOCK_SIZE calculation points
+   * \param[in] n the number of calculation points
+   * \param[in] observation the random observation point (Xi, Yi, Zi)
+   * \param[out] values stores K(x, y, z) for each calculation point
+   *
+   * Gives the same results as evaluate_kernel(), but gathers each coordinate
+   * of the block into a contiguous array and evaluates the 1D kernel for all
+   * points with one call to KDEKernel::evaluate_batch().  The precomputed
+   * boundary correction factors are then applied to the boundary points.
+   */
+  void evaluate_kernel_block(const unsigned int* points,
+                             unsigned int n,
+                             const moab::CartVect& observation,
+                             double* values) const;
+
+  /**
+   * \brief Versions of evaluate_kernel() and evaluate_kernel_block()
+   *
+   * Kernel is a class with static evaluate(kernel, u) and evaluate_batch(
+   * kernel, u, n, values) methods for the 1D kernel function.  Instantiated
+   * for the KDEKernel interface and for each FixedPolynomialKernel, which is
+   * then evaluated without virtual calls in the loops over calculation points.
+   */
+  template <typename Kernel>
+  double evaluate_kernel_as(const CalculationPoint& X,
+                            const moab::CartVect& observation) const;
+
+  template <typename Kernel>
+  void evaluate_kernel_block_as(const unsigned int* points,
+                                unsigned int n,
+                                const moab::CartVect& observation,
+                                double* values) const;
+
+  /**
+   * \brief Selects the kernel functions for a FixedPolynomialKernel<S, R>
+   * \return true if the kernel of this tally is a FixedPolynomialKernel<S, R>
+   */
+  template <unsigned int S, unsigned int R>
+  bool use_fixed_kernel();
+
+  // Versions of evaluate_kernel() and evaluate_kernel_block() chosen for
+  // the kernel when it is created, see use_fixed_kernel()
+  double (KDEMeshTally::*kernel_function)(const CalculationPoint&,
+                                          const moab::CartVect&) const;
+  void (KDEMeshTally::*kernel_block_function)(const unsigned int*,
+                                              unsigned int,
+                                              const moab::CartVect&,
+                                              double*) const;
+
   /**
    * \brief Computes tally score based on the integral-track estimator
    * \param[in] X the calculation point
@@ -306,7 +425,9 @@ class KDEMeshTally : public MeshTally {
    * The integral_track_score() method computes the integral of the 3D
    * path-length dependent kernel function K(X, s) with respect to path-
    * length s for the given calculation point X, using the limits of
-   * integration as determined by the set_integral_limits() method.
+   * integration as determined by the set_integral_limits() method.  The
+   * integral is computed exactly by polynomial_track_score() for polynomial
+   * kernels, or by quadrature for other kernels and for boundary points.
    */
   double integral_track_score(const CalculationPoint& X,
                               const TallyEvent& event) const;
@@ -331,6 +452,28 @@ class KDEMeshTally : public MeshTally {
                            const moab::CartVect& coords,
                            std::pair<double, double>& limits) const;
 
+  // Maximum degree of a kernel polynomial used by polynomial_track_score()
+  static const unsigned int MAX_KERNEL_DEGREE = 16;
+
+  /**
+   * \brief Computes the integral-track score exactly for a polynomial kernel
+   * \param[in] X the calculation point
+   * \param[in] event the tally event containing the track segment data
+   * \param[in] limits the valid integration limits from set_integral_limits()
+   * \return the tally score for the calculation point
+   *
+   * Between the integration limits each u = (x - xo - s * uo) / hx is linear
+   * in s and lies in [-1, 1], so K(X, s) is the product of three polynomials
+   * in s.  This method expands that product about the midpoint of the
+   * limits, which keeps high order terms well conditioned, and integrates
+   * it term by term over [-1/2, 1/2] of the scaled path length.  This gives
+   * the same result as quadrature without evaluating the kernel.  It is not
+   * valid for boundary points.
+   */
+  double polynomial_track_score(const CalculationPoint& X,
+                                const TallyEvent& event,
+                                const std::pair<double, double>& limits) const;
+
   /**
    * \brief Computes tally score based on the sub-track estimator
    * \param[in] X the calculation point
@@ -349,14 +492,27 @@ class KDEMeshTally : public MeshTally {
    * \brief Chooses p random points along a track segment
    * \param[in] p the number of random points requested
    * \param[in] event the tally event containing the track segment data
+   * \param[in, out] context if not NULL, provides the random numbers
    * \return the vector of p random points
    *
    * The choose_points() method sub-divides the track segment into p
    * sub-tracks of equal length and randomly chooses the coordinates of
-   * one point from each sub-track.
+   * one point from each sub-track.  Random numbers are taken from rand()
+   * unless a TallyContext is given.
    */
   std::vector<moab::CartVect> choose_points(unsigned int p,
-                                            const TallyEvent& event) const;
+                                            const TallyEvent& event,
+                                            TallyContext* context = NULL) const;
+
+  /**
+   * \brief Computes scores for this KDEMeshTally based on the given TallyEvent
+   * \param[in] event the parameters needed to compute the scores
+   * \param[in, out] scores the TallyData to which the scores are added
+   * \param[in, out] context the scoring context of the calling thread, or
+   *                 NULL if scoring serially
+   */
+  void score_event(const TallyEvent& event, TallyData& scores,
+                   TallyContext* context);
 };
 
 #endif // DAGMC_KDE_MESH_TALLY_HPP
@@ -1,239 +1,299 @@
 // MCNP5/dagmc/KDENeighborhood.cpp
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
-#include <set>
 #include <vector>
 
-#include "moab/AdaptiveKDTree.hpp"
 #include "moab/CartVect.hpp"
 #include "moab/Range.hpp"
-#include "moab/MOABConfig.h"
 
 #include "KDENeighborhood.hpp"
 
+//---------------------------------------------------------------------------//
+// HELPER CLASSES
+//---------------------------------------------------------------------------//
+namespace {
+// orders point indices by one coordinate, used to split kd-tree nodes
+class CompareCoords {
+ public:
+  CompareCoords(const std::vector<double>& coords, int axis)
+    : coords(coords), axis(axis) {}
+
+  bool operator()(unsigned int a, unsigned int b) const {
+    return coords[3 * a + axis] < coords[3 * b + axis];
+  }
+
+ private:
+  const std::vector<double>& coords;
+  int axis;
+};
+} // namespace
 //---------------------------------------------------------------------------//
 // CONSTRUCTOR
 //---------------------------------------------------------------------------//
 KDENeighborhood::KDENeighborhood(moab::Interface* mbi,
                                  const moab::Range& mesh_nodes,
                                  bool build_kd_tree)
-  : kd_tree(NULL), kd_tree_root(0), radius(0.0) {
-  if (build_kd_tree) {
+  : use_kd_tree(build_kd_tree) {
+  region.length = 0.0;
+
+  if (build_kd_tree && mbi == NULL) {
+    std::cerr << "\nError: invalid moab::Interface for building KD-tree";
+    std::cerr << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int num_nodes = mesh_nodes.size();
+
+  // copy the coordinates of all mesh nodes out of MOAB
+  if (num_nodes > 0) {
     if (mbi == NULL) {
-      std::cerr << "\nError: invalid moab::Interface for building KD-tree";
+      std::cerr << "\nError: invalid moab::Interface for loading mesh nodes";
       std::cerr << std::endl;
       exit(EXIT_FAILURE);
     }
 
+    coords.resize(3 * num_nodes);
+    moab::ErrorCode rval = mbi->get_coords(mesh_nodes, &coords[0]);
+    assert(rval == moab::MB_SUCCESS);
+  }
+
+  // reserve space so that updating the neighborhood never allocates
+  points.reserve(num_nodes);
+
+  if (build_kd_tree) {
     std::cout << "Using KD-tree to construct neighborhood" << std::endl;
 
     // build the kd-tree from the mesh nodes
-    kd_tree = new moab::AdaptiveKDTree(mbi);
+    tree_points.resize(num_nodes);
 
-    moab::ErrorCode rval = moab::MB_SUCCESS;
+    for (unsigned int i = 0; i < num_nodes; ++i) {
+      tree_points[i] = i;
+    }
 
-#if MB_VERSION_MAJOR == 4 && MB_VERSION_MINOR < 7
-    rval = kd_tree->build_tree(mesh_nodes, kd_tree_root);
-#else
-    const char settings[] = "MESHSET_FLAGS=0x1;TAG_NAME=0";
-    moab::FileOptions fileopts(settings);
-    rval = kd_tree->build_tree(mesh_nodes, &kd_tree_root, &fileopts);
-#endif
-    assert(rval == moab::MB_SUCCESS);
+    if (num_nodes > 0)
+      build_tree_node(0, num_nodes);
   } else {
     std::cout << "Using all nodes to construct neighborhood" << std::endl;
 
-    // convert range into a default set of calculation points
-    points = std::set<moab::EntityHandle>(mesh_nodes.begin(),
-                                          mesh_nodes.end());
+    // default set of calculation points is all mesh nodes
+    for (unsigned int i = 0; i < num_nodes; ++i) {
+      points.push_back(i);
+    }
   }
 }
 //---------------------------------------------------------------------------//
 // DESTRUCTOR
 //---------------------------------------------------------------------------//
-KDENeighborhood::~KDENeighborhood() {
-  delete kd_tree;
-}
+KDENeighborhood::~KDENeighborhood() {}
 //---------------------------------------------------------------------------//
 // PUBLIC INTERFACE
 //---------------------------------------------------------------------------//
-const std::set<moab::EntityHandle>& KDENeighborhood::get_points() const {
-  return points;
-}
-//---------------------------------------------------------------------------//
 void KDENeighborhood::update_neighborhood(const TallyEvent& event,
                                           const moab::CartVect& bandwidth) {
   // do nothing if there is no kd-tree defined
-  if (kd_tree == NULL)
+  if (!use_kd_tree)
     return;
 
   // otherwise redefine the neighborhood region based on this tally event
-  if (event.type == TallyEvent::COLLISION) {
-    set_neighborhood(event.position, bandwidth);
-  } else if (event.type == TallyEvent::TRACK) {
-    set_neighborhood(event.track_length,
-                     event.position,
-                     event.direction,
-                     bandwidth);
-  } else {
-    // neighborhood region does not exist
-    std::cerr << "\nError: Could not define neighborhood for tally event";
-    std::cerr << std::endl;
-    exit(EXIT_FAILURE);
-  }
+  set_region(event, bandwidth, region);
 
   // update the set of calculation points for this neighborhood
-  points_in_box();
+  points_in_region(region, points);
 }
 //---------------------------------------------------------------------------//
-bool KDENeighborhood::is_calculation_point(const moab::EntityHandle& point) const {
-  std::set<moab::EntityHandle>::iterator it = points.find(point);
-
-  if (it == points.end()) {
-    return false;
+void KDENeighborhood::get_points(const TallyEvent& event,
+                                 const moab::CartVect& bandwidth,
+                                 std::vector<unsigned int>& region_points) const {
+  // use all calculation points if there is no kd-tree defined
+  if (!use_kd_tree) {
+    region_points.assign(points.begin(), points.end());
+    return;
   }
 
-  return true;
+  // otherwise find the neighborhood region without storing it
+  Region event_region;
+  set_region(event, bandwidth, event_region);
+  points_in_region(event_region, region_points);
+}
+//---------------------------------------------------------------------------//
+bool KDENeighborhood::is_calculation_point(unsigned int point) const {
+  return std::find(points.begin(), points.end(), point) != points.end();
 }
 //---------------------------------------------------------------------------//
 // PRIVATE METHODS
 //---------------------------------------------------------------------------//
 void KDENeighborhood::set_neighborhood(const moab::CartVect& collision_point,
-                                       const moab::CartVect& bandwidth) {
+                                       const moab::CartVect& bandwidth,
+                                       Region& region) {
   for (int i = 0; i < 3; ++i) {
-    min_corner[i] = collision_point[i] - bandwidth[i];
-    max_corner[i] = collision_point[i] + bandwidth[i];
+    region.start[i] = collision_point[i];
+    region.direction[i] = 0.0;
+    region.half_width[i] = bandwidth[i];
   }
 
-  // maximum radius is not used for collision events so reset it to 0.0
-  radius = 0.0;
+  // a collision event is a box centered on the collision point
+  region.length = 0.0;
 }
 //---------------------------------------------------------------------------//
 void KDENeighborhood::set_neighborhood(double track_length,
                                        const moab::CartVect& start_point,
                                        const moab::CartVect& direction,
-                                       const moab::CartVect& bandwidth) {
+                                       const moab::CartVect& bandwidth,
+                                       Region& region) {
   for (int i = 0; i < 3; ++i) {
-    // default case where coordinate of direction vector is zero
-    min_corner[i] = start_point[i] - bandwidth[i];
-    max_corner[i] = start_point[i] + bandwidth[i];
-
-    // adjust for direction being positive or negative
-    if (direction[i] > 0) {
-      max_corner[i] += track_length * direction[i];
-    } else if (direction[i] < 0) {
-      min_corner[i] += track_length * direction[i];
-    }
+    region.start[i] = start_point[i];
+    region.direction[i] = direction[i];
+    region.half_width[i] = bandwidth[i];
   }
 
-  // set maximum radius around the track to sqrt(hx^2 + hy^2 + hz^2)
-  radius = bandwidth.length();
+  region.length = track_length;
 }
 //---------------------------------------------------------------------------//
-bool KDENeighborhood::point_within_max_radius(const TallyEvent& event,
-                                              const moab::CartVect& coords) const {
-  // process track-based tally event only
-  if (event.type == TallyEvent::TRACK) {
-    // create a vector from starting position to point being tested
-    moab::CartVect temp;
-
-    for (int i = 0; i < 3; ++i) {
-      temp[i] = coords[i] - event.position[i];
-    }
-
-    // compute perpendicular distance from point being tested to line
-    // defined by track segment using the cross-product method
-    double distance_to_track = (event.direction * temp).length();
-
-    // return true if distance is less than radius of cylindrical region
-    if (distance_to_track < radius)
-      return true;
+void KDENeighborhood::set_region(const TallyEvent& event,
+                                 const moab::CartVect& bandwidth,
+                                 Region& region) {
+  if (event.type == TallyEvent::COLLISION) {
+    set_neighborhood(event.position, bandwidth, region);
+  } else if (event.type == TallyEvent::TRACK) {
+    set_neighborhood(event.track_length,
+                     event.position,
+                     event.direction,
+                     bandwidth,
+                     region);
+  } else {
+    // neighborhood region does not exist
+    std::cerr << "\nError: Could not define neighborhood for tally event";
+    std::cerr << std::endl;
+    exit(EXIT_FAILURE);
   }
-
-  // otherwise return false
-  return false;
 }
 //---------------------------------------------------------------------------//
-bool KDENeighborhood::point_inside_box(const moab::CartVect& coords) const {
-  // check point is in the rectangular neighborhood region
+bool KDENeighborhood::region_overlaps_box(const Region& region,
+                                          const double* lower,
+                                          const double* upper) {
+  const double* start = region.start;
+  const double* direction = region.direction;
+  const double* half_width = region.half_width;
+
+  // interval of path lengths along the track for which the box is within
+  // the bandwidth of the track, clipped to the track segment
+  double path_min = 0.0;
+  double path_max = region.length;
+
   for (int i = 0; i < 3; ++i) {
-    // account for boundary cases first
-    double min_diff = fabs(coords[i] - min_corner[i]);
-    double max_diff = fabs(coords[i] - max_corner[i]);
-
-    if (min_diff < 1e-12 || max_diff < 1e-12 ||
-        (coords[i] > min_corner[i] && coords[i] < max_corner[i])) {
-      // point may still be in the box, so do nothing
-    } else { // point is not in the box
-      return false;
+    double min_diff = lower[i] - start[i] - half_width[i] - 1e-12;
+    double max_diff = upper[i] - start[i] + half_width[i] + 1e-12;
+
+    if (direction[i] == 0.0) {
+      // track is parallel to this axis, so the box must span its position
+      if (min_diff > 0.0 || max_diff < 0.0)
+        return false;
+    } else {
+      double s1 = min_diff / direction[i];
+      double s2 = max_diff / direction[i];
+
+      path_min = std::max(path_min, std::min(s1, s2));
+      path_max = std::min(path_max, std::max(s1, s2));
+
+      if (path_min > path_max)
+        return false;
     }
   }
 
   return true;
 }
 //---------------------------------------------------------------------------//
-void KDENeighborhood::points_in_box() {
-  assert(kd_tree != NULL);
+void KDENeighborhood::build_tree_node(unsigned int begin, unsigned int end) {
+  KDTreeNode node = {-1, 0, begin, end};
 
-  // reset the set of calculation points
-  points.clear();
+  // compute the bounding box of the points in this node
+  for (int i = 0; i < 3; ++i) {
+    node.lower[i] = node.upper[i] = coords[3 * tree_points[begin] + i];
+  }
 
-  // determine the center point of the box
-  double box_center[3];
+  for (unsigned int j = begin + 1; j < end; ++j) {
+    const double* point = &coords[3 * tree_points[j]];
 
-  for (int i = 0; i < 3; ++i) {
-    box_center[i] = 0.5 * (max_corner[i] + min_corner[i]);
+    for (int i = 0; i < 3; ++i) {
+      node.lower[i] = std::min(node.lower[i], point[i]);
+      node.upper[i] = std::max(node.upper[i], point[i]);
+    }
   }
 
-  // set radius equal to distance from center to max corner of the box
-  moab::CartVect center_to_max_corner(max_corner);
-  moab::CartVect center(box_center);
-  center_to_max_corner -= center;
-  double radius = center_to_max_corner.length();
-
-  // find all leaves of the kd-tree within the given radius
-  std::vector<moab::EntityHandle> leaves;
-  moab::ErrorCode rval = moab::MB_SUCCESS;
-  if (rval != moab::MB_SUCCESS) {
-    std::cout << "this can't fail" << std::endl;
-    exit(1);
+  unsigned int index = kd_tree.size();
+  kd_tree.push_back(node);
+
+  if (end - begin <= MAX_LEAF_POINTS)
+    return;
+
+  // find the axis along which the points have the largest extent
+  int axis = 0;
+
+  for (int i = 1; i < 3; ++i) {
+    if (node.upper[i] - node.lower[i] > node.upper[axis] - node.lower[axis])
+      axis = i;
   }
 
-#if MB_VERSION_MAJOR == 4 && MB_VERSION_MINOR < 7
-  rval = kd_tree->leaves_within_distance(kd_tree_root, box_center, radius, leaves);
-#else
-  // moab::AdaptiveKDTree now checks if box_center is in tree's bounding box,
-  // which does not always work for neighborhood region that overlaps mesh
-  // TODO: using radius as tolerance for temporary fix
-  rval = kd_tree->distance_search(box_center, radius, leaves, radius);
-#endif
-  assert(rval == moab::MB_SUCCESS);
-
-  // obtain the set of unique points in the box
-  std::vector<moab::EntityHandle>::iterator i;
-  moab::Interface* mb = kd_tree->moab();
-  moab::CartVect coords(0.0, 0.0, 0.0);
-  moab::Range::iterator j;
-
-  for (i = leaves.begin(); i != leaves.end(); ++i) {
-    moab::Range leaf_points;
-    rval = mb->get_entities_by_type(*i, moab::MBVERTEX, leaf_points);
-    assert(rval == moab::MB_SUCCESS);
+  // all points are coincident, so keep them in one leaf
+  if (node.upper[axis] == node.lower[axis])
+    return;
+
+  // split the points in half at the median along that axis
+  unsigned int middle = begin + (end - begin) / 2;
+  std::nth_element(tree_points.begin() + begin,
+                   tree_points.begin() + middle,
+                   tree_points.begin() + end,
+                   CompareCoords(coords, axis));
 
-    // iterate through the points in each leaf
-    for (j = leaf_points.begin(); j != leaf_points.end(); ++j) {
-      // get coordinates of the point
-      moab::EntityHandle point = *j;
-      rval = mb->get_coords(&point, 1, coords.array());
-      assert(rval == moab::MB_SUCCESS);
+  kd_tree[index].axis = axis;
+
+  build_tree_node(begin, middle);
+  kd_tree[index].right = kd_tree.size();
+  build_tree_node(middle, end);
+}
+//---------------------------------------------------------------------------//
+void KDENeighborhood::points_in_region(const Region& region,
+                                       std::vector<unsigned int>& region_points) const {
+  assert(use_kd_tree);
+
+  // reset the calculation points, keeping the memory allocated
+  region_points.clear();
+
+  if (kd_tree.empty())
+    return;
 
-      // add the point to the set if it is in the box
-      if (point_inside_box(coords)) {
-        points.insert(point);
+  // the tree is balanced, so its depth is at most log2 of the number of
+  // points and the stack of nodes still to visit never exceeds 64
+  unsigned int stack[64];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    unsigned int index = stack[--top];
+    const KDTreeNode& node = kd_tree[index];
+
+    // skip nodes whose points are all outside the region
+    if (!region_overlaps_box(region, node.lower, node.upper))
+      continue;
+
+    if (node.axis < 0) {
+      // add the points in this leaf that are in the region
+      for (unsigned int j = node.begin; j < node.end; ++j) {
+        unsigned int point = tree_points[j];
+        const double* point_coords = &coords[3 * point];
+
+        if (region_overlaps_box(region, point_coords, point_coords)) {
+          region_points.push_back(point);
+        }
       }
+    } else {
+      assert(top < 63);
+      stack[top++] = node.right;
+      stack[top++] = index + 1;
     }
   }
 }
@@ -3,7 +3,7 @@
 #ifndef DAGMC_KDE_NEIGHBORHOOD_HPP
 #define DAGMC_KDE_NEIGHBORHOOD_HPP
 
-#include <set>
+#include <vector>
 
 #include "moab/Interface.hpp"
 
@@ -11,7 +11,6 @@
 
 // forward declarations
 namespace moab {
-class AdaptiveKDTree;
 class CartVect;
 }
 
@@ -30,8 +29,21 @@ class CartVect;
  * In general, it is not always easy to define the exact neighborhood region.
  * Therefore, the default behavior of KDENeighborhood is to use a kd-tree
  * search method to locate all possible calculation points for each TallyEvent.
- * This kd-tree approach produces an exact neighborhood region for collision
- * events, but only an approximation for track-based events.
+ * For a collision event the neighborhood region is the box of half-widths
+ * (hx, hy, hz) centered on the collision point.  For a track-based event it
+ * is that box swept along the track segment, i.e. the set of points within
+ * the bandwidth of some point on the track.  The swept box is searched
+ * directly, so the number of candidate points scales with the track length
+ * times the bandwidth cross-section rather than with the volume of the box
+ * that bounds the whole track.
+ *
+ * The coordinates of all mesh nodes are copied out of MOAB when the
+ * KDENeighborhood is created, and the kd-tree is a flat array of nodes built
+ * over those coordinates.  Calculation points are identified by their index
+ * in the moab::Range of mesh nodes passed to the constructor, which is the
+ * same index that MeshTally::get_entity_index() returns for the tally point.
+ * Updating the neighborhood only refills a reusable vector of indices, so no
+ * memory is allocated and no MOAB calls are made for each TallyEvent.
  *
  * =============================
  * KDENeighborhood Functionality
@@ -41,8 +53,14 @@ class CartVect;
  * needed to get its calculation points.  Since the dimensions of the exact
  * neighborhood region usually changes with each TallyEvent, it is first
  * necessary to call update_neighborhood().  Once the neighborhood has been
- * updated, then the set of calculation points associated with that event can
- * be obtained by get_points().
+ * updated, then the indices of the calculation points associated with that
+ * event can be obtained by get_points(), and their coordinates by
+ * get_coords().
+ *
+ * Alternatively, get_points(event, bandwidth, points) finds the calculation
+ * points for a TallyEvent without updating the neighborhood.  It does not
+ * modify the KDENeighborhood, so several threads can use it at once as long
+ * as each one provides its own vector for the points.
  */
 //===========================================================================//
 class KDENeighborhood {
@@ -55,6 +73,7 @@ class KDENeighborhood {
    *
    * Note that setting build_kd_tree to false forces the KDENeighborhood to
    * always use all calculation points with every TallyEvent that occurs.
+   * The MOAB instance is only used during construction.
    */
   KDENeighborhood(moab::Interface* mbi,
                   const moab::Range& mesh_nodes,
@@ -69,11 +88,23 @@ class KDENeighborhood {
 
   /**
    * \brief Gets the calculation points for this neighborhood region
-   * \return set of calculation points currently in the neighborhood region
+   * \return indices of the calculation points currently in the region
    *
-   * Provides read-only access to the current set of calculation points.
+   * Provides read-only access to the current calculation points.  The
+   * indices are not sorted.
+   */
+  const std::vector<unsigned int>& get_points() const {
+    return points;
+  }
+
+  /**
+   * \brief Gets the coordinates of a calculation point
+   * \param[in] point the index of the calculation point
+   * \return pointer to the (x, y, z) coordinates of the point
    */
-  const std::set<moab::EntityHandle>& get_points() const;
+  const double* get_coords(unsigned int point) const {
+    return &coords[3 * point];
+  }
 
   /**
    * \brief Updates the neighborhood region based on the given tally event
@@ -87,30 +118,74 @@ class KDENeighborhood {
   void update_neighborhood(const TallyEvent& event,
                            const moab::CartVect& bandwidth);
 
+  /**
+   * \brief Gets the calculation points for the given tally event
+   * \param[in] event the tally event for which the neighborhood is desired
+   * \param[in] bandwidth the bandwidth vector (hx, hy, hz)
+   * \param[out] region_points stores the indices of the calculation points
+   *
+   * Gives the same points as update_neighborhood() followed by get_points(),
+   * but leaves the current neighborhood region unchanged.  The indices are
+   * not sorted.
+   */
+  void get_points(const TallyEvent& event,
+                  const moab::CartVect& bandwidth,
+                  std::vector<unsigned int>& region_points) const;
+
   /**
    * \brief Checks if point belongs to the set of calculation points
-   * \param[in] point the moab::EntityHandle of the point to check
+   * \param[in] point the index of the point to check
    * \return true if point is a calculation point; false otherwise
    *
-   * Searches the set of calculation points currently stored in this
-   * neighborhood region.
+   * Searches the calculation points currently stored in this neighborhood
+   * region.  This is a linear search, intended for testing only.
    */
-  bool is_calculation_point(const moab::EntityHandle& point) const;
+  bool is_calculation_point(unsigned int point) const;
 
  private:
-  // Set of calculation points currently in this neighborhood region
-  std::set<moab::EntityHandle> points;
+  /// Copy constructor and operator= methods are not implemented
+  KDENeighborhood(const KDENeighborhood& obj);
+  KDENeighborhood& operator=(const KDENeighborhood& obj);
+
+  // Node of the kd-tree with the bounding box of its points; leaves have
+  // axis -1 and refer to the point indices tree_points[begin] to
+  // tree_points[end - 1]
+  struct KDTreeNode {
+    int axis;
+    unsigned int right;
+    unsigned int begin;
+    unsigned int end;
+    double lower[3];
+    double upper[3];
+  };
+
+  // Maximum number of points stored in a kd-tree leaf
+  static const unsigned int MAX_LEAF_POINTS = 16;
+
+  // Coordinates of all mesh nodes, stored as (x, y, z) for each index
+  std::vector<double> coords;
+
+  // Indices of the calculation points currently in this neighborhood region
+  std::vector<unsigned int> points;
 
-  // KD-Tree containing all mesh nodes in the input mesh
-  moab::AdaptiveKDTree* kd_tree;
-  moab::EntityHandle kd_tree_root;
+  // KD-Tree containing all mesh nodes in the input mesh, stored depth-first
+  // so that the left child of node i is node i + 1
+  bool use_kd_tree;
+  std::vector<KDTreeNode> kd_tree;
+  std::vector<unsigned int> tree_points;
 
-  // Minimum and maximum corner of a rectangular neighborhood region
-  double min_corner[3];
-  double max_corner[3];
+  // Neighborhood region as the box of half-widths half_width swept along a
+  // track segment; a collision event is stored as a segment of zero length
+  // with no direction
+  struct Region {
+    double start[3];
+    double direction[3];
+    double length;
+    double half_width[3];
+  };
 
-  // Radius of a cylindrical neighborhood region
-  double radius;
+  // Current neighborhood region
+  Region region;
 
   // >>> PRIVATE METHODS
 
@@ -118,9 +193,11 @@ class KDENeighborhood {
    * \brief Sets the neighborhood region for a collision event
    * \param[in] collision_point the location of the collision (x, y, z)
    * \param[in] bandwidth the bandwidth vector (hx, hy, hz)
+   * \param[out] region the neighborhood region
    */
-  void set_neighborhood(const moab::CartVect& collision_point,
-                        const moab::CartVect& bandwidth);
+  static void set_neighborhood(const moab::CartVect& collision_point,
+                               const moab::CartVect& bandwidth,
+                               Region& region);
 
   /**
    * \brief Sets the neighborhood region for a track-based event
@@ -128,41 +205,58 @@ class KDENeighborhood {
    * \param[in] start_point the starting location of the particle (xo, yo, zo)
    * \param[in] direction the direction the particle is traveling (uo, vo, wo)
    * \param[in] bandwidth the bandwidth vector (hx, hy, hz)
+   * \param[out] region the neighborhood region
    */
-  void set_neighborhood(double track_length,
-                        const moab::CartVect& start_point,
-                        const moab::CartVect& direction,
-                        const moab::CartVect& bandwidth);
+  static void set_neighborhood(double track_length,
+                               const moab::CartVect& start_point,
+                               const moab::CartVect& direction,
+                               const moab::CartVect& bandwidth,
+                               Region& region);
 
   /**
-   * \brief Determines if point lies within radius of cylindrical region
-   * \param[in] coords the coordinates of the point to check
-   * \return true if point is inside the region; false otherwise
+   * \brief Determines if a box overlaps the neighborhood region
+   * \param[in] region the neighborhood region
+   * \param[in] lower the minimum corner of the box
+   * \param[in] upper the maximum corner of the box
+   * \return true if the box overlaps the region; false otherwise
    *
-   * TODO currently unused, may integrate into update_neighborhood to
-   * refine neighborhood region for a track-based event.
+   * Tests whether the track segment passes through the box expanded by the
+   * half-widths of the region, including boundaries to within +/- 1e-12.
+   * A point is tested by passing its coordinates as both corners.
    */
-  bool point_within_max_radius(const TallyEvent& event,
-                               const moab::CartVect& coords) const;
+  static bool region_overlaps_box(const Region& region,
+                                  const double* lower, const double* upper);
 
   /**
-   * \brief Determines if point lies within min/max corners of box
-   * \param[in] coords the coordinates of the point to check
-   * \return true if point is inside box; false otherwise
+   * \brief Builds the kd-tree node for a range of tree_points
+   * \param[in] begin the first entry in tree_points for this node
+   * \param[in] end one past the last entry in tree_points for this node
    *
-   * This is a helper method used by points_in_box to determine if a point
-   * should be added to the set of calculation points.
+   * Splits the points at the median of the axis with the largest extent
+   * and recurses until each leaf has at most MAX_LEAF_POINTS points.
+   */
+  void build_tree_node(unsigned int begin, unsigned int end);
+
+  /**
+   * \brief Finds the neighborhood region for a tally event
+   * \param[in] event the tally event for which the neighborhood is desired
+   * \param[in] bandwidth the bandwidth vector (hx, hy, hz)
+   * \param[out] region the neighborhood region
    */
-  bool point_inside_box(const moab::CartVect& coords) const;
+  static void set_region(const TallyEvent& event,
+                         const moab::CartVect& bandwidth,
+                         Region& region);
 
   /**
-   * \brief Finds the vertices that exist inside a rectangular region
+   * \brief Finds the vertices that exist inside a neighborhood region
+   * \param[in] region the neighborhood region
+   * \param[out] region_points stores the indices of the vertices found
    *
-   * Includes vertices that are within +/- 1e-12 of a box boundary.  This
-   * method updates the set of calculation points with all vertices that
-   * were located within the current neighborhood region.
+   * Includes vertices that are within +/- 1e-12 of the region boundary.
+   * Requires the kd-tree; region_points is cleared before it is filled.
    */
-  void points_in_box();
+  void points_in_region(const Region& region,
+                        std::vector<unsigned int>& region_points) const;
 };
 
 #endif // DAGMC_KDE_NEIGHBORHOOD_HPP
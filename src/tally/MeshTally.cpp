@@ -12,8 +12,8 @@
 //---------------------------------------------------------------------------//
 // CONSTRUCTOR
 //---------------------------------------------------------------------------//
-MeshTally::MeshTally(const TallyInput& input)
-  : Tally(input) {
+MeshTally::MeshTally(const TallyInput& input, bool input_file_required)
+  : Tally(input), previous_ww_read(false) {
   // Determine name of the output file
   TallyInput::TallyOptions::iterator it = input_data.options.find("out");
 
@@ -33,14 +33,21 @@ MeshTally::MeshTally(const TallyInput& input)
   if (it != input_data.options.end()) {
     input_filename = it->second;
     input_data.options.erase(it);
-  } else {
+  } else if (input_file_required) {
     std::cerr << "Exit: No input mesh file was given." << std::endl;
     exit(EXIT_FAILURE);
   }
+
+  parse_weight_window_options();
 }
 //---------------------------------------------------------------------------//
 // PROTECTED METHODS
 //---------------------------------------------------------------------------//
+bool MeshTally::is_vtk_output() const {
+  std::string::size_type dot = output_filename.rfind('.');
+  return dot != std::string::npos && output_filename.substr(dot) == ".vtk";
+}
+//---------------------------------------------------------------------------//
 unsigned int MeshTally::get_entity_index(moab::EntityHandle tally_point) {
   unsigned int ret = tally_points.index(tally_point);
   assert(ret < tally_points.size());
@@ -165,5 +172,129 @@ void MeshTally::add_score_to_mesh_tally(const moab::EntityHandle& tally_point,
   data->add_score_to_tally(point_index, weighted_score, ebin);
 }
 //---------------------------------------------------------------------------//
+moab::ErrorCode
+MeshTally::set_weight_windows(moab::Interface* mbi,
+                              const std::vector<double>& results,
+                              const std::vector<double>& rel_errors,
+                              std::vector<double>& lower_bounds) {
+  lower_bounds.clear();
+
+  if (!ww_generator || tally_points.empty())
+    return moab::MB_SUCCESS;
+
+  int num_groups = results.size() / tally_points.size();
+
+  // read the lower bounds of the previous weight-window map from the input
+  // mesh the first time, as the tag is overwritten with the new lower bounds
+  moab::ErrorCode rval;
+
+  if (!previous_ww_read) {
+    previous_ww_read = true;
+    rval = mbi->tag_get_handle("WW_LOWER", num_groups,
+                               moab::MB_TYPE_DOUBLE, ww_tag);
+
+    if (rval == moab::MB_SUCCESS) {
+      previous_ww.resize(results.size());
+      rval = mbi->tag_get_data(ww_tag, tally_points, previous_ww.data());
+
+      if (rval != moab::MB_SUCCESS)
+        previous_ww.clear();
+    } else if (rval == moab::MB_INVALID_SIZE) {
+      std::cerr << "Warning: previous weight windows for mesh tally "
+                << input_data.tally_id << " have a different number of "
+                << "energy groups and will be replaced." << std::endl;
+
+      rval = mbi->tag_get_handle("WW_LOWER", ww_tag);
+      MB_CHK_SET_ERR(rval, "Failed to get the previous weight window tag");
+      rval = mbi->tag_delete(ww_tag);
+      MB_CHK_SET_ERR(rval, "Failed to delete the previous weight window tag");
+    }
+  }
+
+  unsigned long num_generated = ww_generator->generate(num_groups, results,
+                                                       rel_errors, previous_ww,
+                                                       lower_bounds);
+
+  std::cout << "Weight windows for mesh tally " << input_data.tally_id
+            << ": " << num_generated << " of " << lower_bounds.size()
+            << " lower bounds found from the tally results" << std::endl;
+
+  rval = mbi->tag_get_handle("WW_LOWER", num_groups, moab::MB_TYPE_DOUBLE,
+                             ww_tag, moab::MB_TAG_DENSE | moab::MB_TAG_CREAT);
+  MB_CHK_SET_ERR(rval, "Failed to get the weight window tag");
+
+  rval = mbi->tag_set_data(ww_tag, tally_points, lower_bounds.data());
+  MB_CHK_SET_ERR(rval, "Failed to set the weight window tag");
+
+  return moab::MB_SUCCESS;
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+void MeshTally::parse_weight_window_options() {
+  TallyInput::TallyOptions& options = input_data.options;
+  TallyInput::TallyOptions::iterator it = options.find("ww");
+
+  WeightWindowGenerator::Method method = WeightWindowGenerator::MAGIC;
+  bool enabled = false;
+
+  if (it != options.end()) {
+    enabled = WeightWindowGenerator::parse_method(it->second, method);
+
+    if (!enabled) {
+      std::cerr << "Warning: '" << it->second << "' is an invalid weight "
+                << "window method for mesh tally " << input_data.tally_id
+                << std::endl;
+      std::cerr << "    weight windows will not be written" << std::endl;
+    }
+
+    options.erase(it);
+  }
+
+  double normalization = WeightWindowGenerator::default_normalization(method);
+  double max_rel_error = 0.5;
+
+  it = options.find("ww_norm");
+
+  if (it != options.end()) {
+    char* end;
+    double value = strtod(it->second.c_str(), &end);
+
+    if (it->second.c_str() != end && value > 0.0) {
+      normalization = value;
+    } else {
+      std::cerr << "Warning: invalid weight window normalization ww_norm = "
+                << it->second << std::endl;
+      std::cerr << "    using default value ww_norm = "
+                << normalization << std::endl;
+    }
+
+    options.erase(it);
+  }
+
+  it = options.find("ww_max_error");
+
+  if (it != options.end()) {
+    char* end;
+    double value = strtod(it->second.c_str(), &end);
+
+    if (it->second.c_str() != end && value > 0.0) {
+      max_rel_error = value;
+    } else {
+      std::cerr << "Warning: invalid maximum relative error ww_max_error = "
+                << it->second << std::endl;
+      std::cerr << "    using default value ww_max_error = "
+                << max_rel_error << std::endl;
+    }
+
+    options.erase(it);
+  }
+
+  if (enabled) {
+    ww_generator.reset(new WeightWindowGenerator(method, normalization,
+                                                 max_rel_error));
+  }
+}
+//---------------------------------------------------------------------------//
 
 // end of MCNP5/dagmc/MeshTally.cpp
@@ -3,12 +3,14 @@
 #ifndef DAGMC_MESH_TALLY_HPP
 #define DAGMC_MESH_TALLY_HPP
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "moab/Range.hpp"
 
 #include "Tally.hpp"
+#include "WeightWindowGenerator.hpp"
 
 // forward declaration
 namespace moab {
@@ -37,12 +39,14 @@ class Interface;
  * Input/Output Files
  * ==================
  *
- * All MeshTally objects are REQUIRED to include "inp"="input_filename" as
- * a TallyOption in the TallyInput struct defined in Tally.hpp and set through
- * the TallyManager.  This input file contains all of the mesh data that is
- * needed to compute the mesh tally scores.  It must be created in a file format
- * that is supported by the Mesh-Oriented Database (MOAB), which includes both
- * H5M and VTK options.  Source code and more information on MOAB can be found
+ * All MeshTally objects that score on an existing mesh are REQUIRED to
+ * include "inp"="input_filename" as a TallyOption in the TallyInput struct
+ * defined in Tally.hpp and set through the TallyManager.  This input file
+ * contains all of the mesh data that is needed to compute the mesh tally
+ * scores.  It must be created in a file format that is supported by the
+ * Mesh-Oriented Database (MOAB), which includes both H5M and VTK options.
+ * Mesh tallies that build their own mesh, such as StructuredMeshTally, do
+ * not need an input file.  Source code and more information on MOAB can be found
  * at http://sigma.mcs.anl.gov/moab-library/
  *
  * In addition to the "inp" key, all MeshTally objects can also include an
@@ -51,6 +55,29 @@ class Interface;
  * meshtal<tally_id>.h5m.  To write to a different file format that is
  * supported by MOAB, simply add the desired extension to the output filename
  * (i.e. "out"="filename.vtk" will write results to the VTK format).
+ * Mesh tallies that keep their own copy of the mesh, such as
+ * TrackLengthMeshTally, write VTK files directly without going through MOAB.
+ *
+ * ==============
+ * Weight Windows
+ * ==============
+ *
+ * Mesh tallies that support it can also write a weight-window map on their
+ * mesh, which is enabled with the optional "ww"="magic" or "ww"="adjoint"
+ * key-value pair.  The lower weight bound of each tally point and energy
+ * group is then found from the tally results by a WeightWindowGenerator and
+ * written to the output file as the WW_LOWER tag.  Two other options can be
+ * included with the "ww" key
+ *
+ *     1) "ww_norm"="value": the normalization constant of the method, which
+ *        defaults to 0.5 for "magic" and 1.0 for "adjoint"
+ *     2) "ww_max_error"="value": the largest relative error of a result that
+ *        is used to find a lower bound, which defaults to 0.5
+ *
+ * If the input mesh already has a WW_LOWER tag, for example because it is
+ * the output file of the previous run, then tally points with unreliable
+ * results keep their previous lower bounds.  This allows the weight windows
+ * to be iterated over a series of runs.
  */
 //===========================================================================//
 class MeshTally : public Tally {
@@ -58,8 +85,9 @@ class MeshTally : public Tally {
   /**
    * \brief Constructor
    * \param[in] input user-defined input parameters for this mesh tally
+   * \param[in] input_file_required false if the mesh is built by the tally
    */
-  explicit MeshTally(const TallyInput& input);
+  explicit MeshTally(const TallyInput& input, bool input_file_required = true);
 
  public:
   /**
@@ -85,8 +113,25 @@ class MeshTally : public Tally {
   moab::Tag tally_tag, error_tag;
   moab::Tag total_tally_tag, total_error_tag;
 
+  /// Generator for the weight-window map, or NULL if it is not written
+  std::unique_ptr<WeightWindowGenerator> ww_generator;
+
+  /// Tag for storing the lower weight bounds of the weight-window map
+  moab::Tag ww_tag;
+
+  /// Lower weight bounds of the previous weight-window map, if any, and
+  /// whether they have been read from ww_tag on the input mesh
+  std::vector<double> previous_ww;
+  bool previous_ww_read;
+
   // >>> PROTECTED METHODS
 
+  /**
+   * \brief Checks if the results are written to a VTK output file
+   * \return true if output_filename has a ".vtk" extension
+   */
+  bool is_vtk_output() const;
+
   /**
    * \brief Determines entity index corresponding to tally point
    * \param[in] tally_point entity handle representing tally point
@@ -148,6 +193,33 @@ class MeshTally : public Tally {
    */
   void add_score_to_mesh_tally(const moab::EntityHandle& tally_point,
                                double weight, double score, unsigned int ebin);
+
+  /**
+   * \brief Sets the weight-window map for all tally points from the results
+   * \param[in] mbi the MOAB interface for this mesh tally
+   * \param[in] results the tally results for each energy group
+   * \param[in] rel_errors the relative errors for each energy group
+   * \param[out] lower_bounds the lower weight bounds for each energy group
+   * \return the MOAB ErrorCode value
+   *
+   * The results and relative errors are those returned by get_results()
+   * for the tally points.  Any previous lower bounds are read from the
+   * WW_LOWER tag of the input mesh on the first call.  Does nothing and leaves
+   * lower_bounds empty if weight windows were not requested.
+   */
+  moab::ErrorCode set_weight_windows(moab::Interface* mbi,
+                                     const std::vector<double>& results,
+                                     const std::vector<double>& rel_errors,
+                                     std::vector<double>& lower_bounds);
+
+ private:
+  /**
+   * \brief Parses the weight window options from the tally input
+   *
+   * Weight window options are removed from input_data.options so that they
+   * are not parsed by the Derived class.
+   */
+  void parse_weight_window_options();
 };
 
 #endif // DAGMC_MESHTALLY_HPP
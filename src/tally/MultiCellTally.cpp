@@ -0,0 +1,196 @@
+// MCNP5/dagmc/MultiCellTally.cpp
+
+#include <cstdlib>
+#include <iostream>
+#include <cmath>
+#include <utility>
+
+#include "DagMC.hpp"
+
+#include "MultiCellTally.hpp"
+#include "TallyContext.hpp"
+
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+MultiCellTally::MultiCellTally(const TallyInput& input,
+                               TallyEvent::EventType eventType)
+  : Tally(input), expected_type(eventType) {
+  // Set up MultiCellTally member variables from TallyInput
+  parse_tally_options();
+
+  if (cell_volumes.empty()) {
+    std::cerr << "\nError: no cells were defined for MultiCellTally "
+              << input_data.tally_id << "; set the 'num_cells' or 'geometry'"
+              << " option" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // Initialize the data arrays to store one tally point per cell
+  data->resize_data_arrays(cell_volumes.size());
+}
+//---------------------------------------------------------------------------//
+// DERIVED PUBLIC INTERFACE from Tally.hpp
+//---------------------------------------------------------------------------//
+void MultiCellTally::compute_score(const TallyEvent& event) {
+  score_event(event, *data);
+}
+//---------------------------------------------------------------------------//
+void MultiCellTally::compute_score(const TallyEvent& event,
+                                   TallyContext& context) {
+  score_event(event, context.get_scratch_data(input_data.tally_id));
+}
+//---------------------------------------------------------------------------//
+bool MultiCellTally::scores_event_type(TallyEvent::EventType type) const {
+  return type == expected_type;
+}
+//---------------------------------------------------------------------------//
+void MultiCellTally::write_data(double num_histories) {
+  std::cout << "Writing data for MultiCellTally " << input_data.tally_id
+            << ": " << std::endl;
+
+  std::cout << "number of cells = " << cell_volumes.size() << std::endl;
+  std::cout << "type = " <<
+            (expected_type == TallyEvent::COLLISION ? "collision " :
+             expected_type == TallyEvent::TRACK     ? "track "     : "none");
+  std::cout << std::endl << std::endl;
+
+  unsigned int num_bins = data->get_num_energy_bins();
+
+  for (unsigned int i = 0; i < num_bins; ++i) {
+    if (data->has_total_energy_bin() && (i == num_bins - 1)) {
+      std::cout << "Total Energy Bin: " << std::endl;
+    } else {
+      std::cout << "Energy bin (" << input_data.energy_bin_bounds.at(i)
+                << ", " << input_data.energy_bin_bounds.at(i + 1) << "):\n";
+    }
+
+    std::cout << "    cell    volume    tally    error" << std::endl;
+
+    for (unsigned int j = 0; j < cell_volumes.size(); ++j) {
+      std::pair <double, double> tally_data = data->get_data(j, i);
+      double tally = tally_data.first;
+      double error = tally_data.second;
+
+      // compute relative error for the tally result
+      double rel_error = 0.0;
+
+      if (error != 0.0) {
+        rel_error = sqrt(error / (tally * tally) - 1.0 / num_histories);
+      }
+
+      // normalize cell tally result by the number of source particles, and
+      // by the volume of the cell if it has one
+      tally /= num_histories;
+
+      if (cell_volumes[j] != 0.0)
+        tally /= cell_volumes[j];
+
+      std::cout << "    " << j + 1 << "    " << cell_volumes[j]
+                << "    " << tally << "    " << rel_error << std::endl;
+    }
+
+    std::cout << std::endl;
+  }
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+void MultiCellTally::parse_tally_options() {
+  const TallyInput::TallyOptions& options = input_data.options;
+  TallyInput::TallyOptions::const_iterator it;
+
+  std::string geometry_filename;
+  long num_cells = 0;
+
+  for (it = options.begin(); it != options.end(); ++it) {
+    std::string key = it->first;
+    std::string value = it->second;
+
+    // process tally option according to key
+    if (key == "num_cells") {
+      char* end; // pointer to first non-numeric char
+      num_cells = strtol(value.c_str(), &end, 10);
+
+      if (value.c_str() == end || num_cells < 1) {
+        std::cerr << "Warning: '" << value << "' is an invalid value"
+                  << " for the number of cells" << std::endl;
+        num_cells = 0;
+      }
+    } else if (key == "geometry") {
+      geometry_filename = value;
+    } else { // invalid tally option
+      std::cerr << "Warning: input data for multi-cell tally "
+                << input_data.tally_id
+                << " has unknown key '" << key << "'" << std::endl;
+    }
+  }
+
+  if (!geometry_filename.empty()) {
+    measure_cell_volumes(geometry_filename);
+  } else {
+    cell_volumes.assign(num_cells, 1.0);
+  }
+}
+//---------------------------------------------------------------------------//
+void MultiCellTally::measure_cell_volumes(const std::string& filename) {
+  moab::DagMC dagmc;
+  moab::ErrorCode rval = dagmc.load_file(filename.c_str());
+
+  if (rval == moab::MB_SUCCESS)
+    rval = dagmc.setup_indices();
+
+  if (rval != moab::MB_SUCCESS) {
+    std::cerr << "\nError: failed to load the geometry " << filename
+              << " for MultiCellTally " << input_data.tally_id << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int num_cells = dagmc.num_entities(3);
+  cell_volumes.resize(num_cells);
+
+  for (unsigned int i = 0; i < num_cells; ++i) {
+    moab::EntityHandle volume = dagmc.entity_by_index(3, i + 1);
+
+    // the implicit complement has no finite volume to normalize by
+    if (dagmc.is_implicit_complement(volume)) {
+      cell_volumes[i] = 1.0;
+      continue;
+    }
+
+    rval = dagmc.measure_volume(volume, cell_volumes[i]);
+
+    if (rval != moab::MB_SUCCESS) {
+      std::cerr << "\nError: could not measure the volume of cell " << i + 1
+                << " for MultiCellTally " << input_data.tally_id << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+void MultiCellTally::score_event(const TallyEvent& event, TallyData& scores) {
+  // Return if current cell or particle energy is outside this MultiCellTally
+  unsigned int ebin = 0;
+  unsigned int cell_index = event.current_cell;
+
+  if (cell_index < 1 || cell_index > cell_volumes.size() ||
+      !get_energy_bin(event.particle_energy, ebin)) {
+    return;
+  }
+
+  // Compute score based on event type and add it to the point for the cell
+  double event_score = event.get_score_multiplier(input_data.multiplier_id);
+
+  if (event.type == TallyEvent::TRACK && event.type == expected_type) {
+    event_score *= event.track_length;
+  } else if (event.type == TallyEvent::COLLISION && event.type == expected_type) {
+    event_score /= event.total_cross_section;
+  } else { // NONE, return from this method
+    return;
+  }
+
+  scores.add_score_to_tally(cell_index - 1, event_score, ebin);
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/MultiCellTally.cpp
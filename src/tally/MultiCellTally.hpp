@@ -0,0 +1,148 @@
+// MCNP5/dagmc/MultiCellTally.hpp
+
+#ifndef DAGMC_MULTI_CELL_TALLY_HPP
+#define DAGMC_MULTI_CELL_TALLY_HPP
+
+#include <string>
+#include <vector>
+
+#include "Tally.hpp"
+#include "TallyEvent.hpp"
+
+//===========================================================================//
+/**
+ * \class MultiCellTally
+ * \brief Defines a cell tally for every geometric cell in the problem
+ *
+ * MultiCellTally is a concrete class derived from Tally that scores all of
+ * the geometric cells in a single tally.  The scores for each cell are stored
+ * as one tally point in the TallyData, with the tally point for a cell given
+ * directly by its cell index.  Each event therefore only updates one entry in
+ * the data arrays, instead of being passed to a separate CellTally for every
+ * cell.  Two types of multi-cell tallies can be created
+ *
+ *     1) TallyEvent::COLLISION cell tally, based on particle collisions
+ *     2) TallyEvent::TRACK cell tally, based on full particle tracks
+ *
+ * The scores computed for each cell are the same as for a CellTally.  Events
+ * in cells with an index that is outside the range of the tally are ignored.
+ *
+ * ==========
+ * TallyInput
+ * ==========
+ *
+ * The TallyInput struct needed to construct a MultiCellTally object is
+ * defined in Tally.hpp and is set through the TallyManager when a Tally is
+ * created.  Options that are currently available for MultiCellTally objects
+ * include
+ *
+ * 1) "num_cells"="value"
+ * ----------------------
+ * Sets the number of cells to the given value, so that cells with indices
+ * from 1 to num_cells are tallied.  The volume of each cell is set to 1.0.
+ *
+ * 2) "geometry"="input_filename"
+ * ------------------------------
+ * Loads the DAGMC geometry from the given file.  All volumes in the geometry
+ * are tallied, with cell index i referring to the volume that has index i in
+ * DagMC.  The volume of each cell is computed with DagMC::measure_volume()
+ * and used to normalize the final tally results.  The implicit complement is
+ * tallied with a volume of 1.0, and cells with a volume of 0.0 are only
+ * normalized by the number of histories.  This option overrides the
+ * "num_cells" option.
+ *
+ * One of these options must be given.
+ */
+//===========================================================================//
+class MultiCellTally : public Tally {
+ public:
+  /**
+   * \brief Constructor
+   * \param[in] input user-defined input parameters for this MultiCellTally
+   * \param[in] eventType the type of event that is to be tallied
+   */
+  MultiCellTally(const TallyInput& input, TallyEvent::EventType eventType);
+
+  /**
+   * \brief Destructor
+   */
+  virtual ~MultiCellTally() {}
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief Computes scores for this MultiCellTally based on the given TallyEvent
+   * \param[in] event the parameters needed to compute the scores
+   */
+  virtual void compute_score(const TallyEvent& event);
+
+  /**
+   * \brief Computes scores for this MultiCellTally into a TallyContext
+   * \param[in] event the parameters needed to compute the scores
+   * \param[in, out] context the scoring context of the calling thread
+   */
+  virtual void compute_score(const TallyEvent& event, TallyContext& context);
+
+  /**
+   * \brief Checks if this MultiCellTally scores events of the given type
+   * \param[in] type the type of tally event
+   * \return true if compute_score() may score events of this type
+   */
+  virtual bool scores_event_type(TallyEvent::EventType type) const;
+
+  /**
+   * \brief Write results for this MultiCellTally
+   * \param[in] num_histories the number of particle histories tracked
+   *
+   * The write_data() method writes the current tally and relative standard
+   * error results for each cell to std::out, normalized by both the number
+   * of particle histories that were tracked and the volume of the cell.
+   */
+  virtual void write_data(double num_histories);
+
+  /**
+   * \brief get_num_cells()
+   * \return number of cells tallied by this MultiCellTally
+   */
+  unsigned int get_num_cells() const {
+    return cell_volumes.size();
+  }
+
+  /**
+   * \brief get_cell_volume()
+   * \param[in] cell_index the index of the cell, from 1 to get_num_cells()
+   * \return volume used to normalize the results for that cell
+   */
+  double get_cell_volume(unsigned int cell_index) const {
+    return cell_volumes.at(cell_index - 1);
+  }
+
+ private:
+  // Volume for each geometric cell, where cell index i is stored at i - 1
+  std::vector<double> cell_volumes;
+
+  // Event type used by this MultiCellTally (COLLISION or TRACK, not both)
+  TallyEvent::EventType expected_type;
+
+  /**
+   * \brief Parse the TallyInput options for this MultiCellTally
+   */
+  void parse_tally_options();
+
+  /**
+   * \brief Sets the cells and their volumes from a DAGMC geometry file
+   * \param[in] filename the name of the geometry file
+   */
+  void measure_cell_volumes(const std::string& filename);
+
+  /**
+   * \brief Computes scores for this MultiCellTally based on the given TallyEvent
+   * \param[in] event the parameters needed to compute the scores
+   * \param[in, out] scores the TallyData to which the scores are added
+   */
+  void score_event(const TallyEvent& event, TallyData& scores);
+};
+
+#endif // DAGMC_MULTI_CELL_TALLY_HPP
+
+// end of MCNP5/dagmc/MultiCellTally.hpp
@@ -1,6 +1,7 @@
 // MCNP5/dagmc/PolynomialKernel.cpp
 
 #include <cassert>
+#include <cmath>
 #include <sstream>
 
 #include "PolynomialKernel.hpp"
@@ -74,6 +75,38 @@ double PolynomialKernel::evaluate(double u) const {
   return value;
 }
 //---------------------------------------------------------------------------//
+void PolynomialKernel::evaluate_batch(const double* u, unsigned int n,
+                                      double* values) const {
+  // set values outside kernel function domain [-1.0, 1.0] to zero
+  const double value = multiplier;
+
+  for (unsigned int i = 0; i < n; ++i) {
+    values[i] = (fabs(u[i]) > 1.0) ? 0.0 : value;
+  }
+
+  // evaluate a 2nd-order kernel function
+  for (unsigned int j = 0; j < s; ++j) {
+    for (unsigned int i = 0; i < n; ++i) {
+      values[i] *= 1 - u[i] * u[i];
+    }
+  }
+
+  // multiply values by second polynomial for kernels of higher order
+  if (r > 1) {
+    for (unsigned int i = 0; i < n; ++i) {
+      double sum = coefficients[0];
+      double temp = 1.0;
+
+      for (unsigned int k = 1; k < r; ++k) {
+        temp *= u[i] * u[i];
+        sum += coefficients[k] * temp;
+      }
+
+      values[i] *= sum;
+    }
+  }
+}
+//---------------------------------------------------------------------------//
 std::string PolynomialKernel::get_kernel_name() const {
   // determine the order of this kernel and add to kernel name
   std::stringstream kernel_name;
@@ -149,6 +182,34 @@ double PolynomialKernel::integrate_moment(double a,
   return value;
 }
 //---------------------------------------------------------------------------//
+bool PolynomialKernel::get_polynomial(std::vector<double>& polynomial) const {
+  polynomial.assign(1, multiplier);
+
+  // multiply by (1 - u^2) for each level of smoothness
+  for (unsigned int j = 0; j < s; ++j) {
+    polynomial.resize(polynomial.size() + 2, 0.0);
+
+    for (unsigned int k = polynomial.size() - 1; k >= 2; --k) {
+      polynomial[k] -= polynomial[k - 2];
+    }
+  }
+
+  // multiply by second polynomial in u^2 for kernels of higher order
+  if (r > 1) {
+    std::vector<double> product(polynomial.size() + 2 * (r - 1), 0.0);
+
+    for (unsigned int i = 0; i < polynomial.size(); ++i) {
+      for (unsigned int k = 0; k < r; ++k) {
+        product[i + 2 * k] += polynomial[i] * coefficients[k];
+      }
+    }
+
+    polynomial.swap(product);
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------//
 // PRIVATE METHODS
 //---------------------------------------------------------------------------//
 double PolynomialKernel::compute_multiplier() {
@@ -65,6 +65,18 @@ class PolynomialKernel : public KDEKernel {
    */
   virtual double evaluate(double u) const;
 
+  /**
+   * \brief Evaluate this polynomial kernel function K_2r,s for a block of values
+   * \param[in] u the n values at which K_2r,s will be evaluated
+   * \param[in] n the number of values
+   * \param[out] values stores K_2r,s(u[i]) for each of the n values
+   *
+   * Gives the same results as evaluate(), but each step is applied to all
+   * of the values in turn so that the loops can be vectorized.
+   */
+  virtual void evaluate_batch(const double* u, unsigned int n,
+                              double* values) const;
+
   /**
    * \brief get_kernel_name()
    * \return string representing polynomial kernel name
@@ -92,7 +104,14 @@ class PolynomialKernel : public KDEKernel {
    */
   virtual double integrate_moment(double a, double b, unsigned int i) const;
 
- private:
+  /**
+   * \brief Gets the coefficients of this polynomial kernel as a polynomial in u
+   * \param[out] polynomial stores c[k] such that K_2r,s(u) = sum of c[k] * u^k
+   * \return true, as K_2r,s(u) is always a polynomial on [-1, 1]
+   */
+  virtual bool get_polynomial(std::vector<double>& polynomial) const;
+
+ protected:
   /// Smoothness factor for this polynomial kernel
   unsigned int s;
 
@@ -105,6 +124,7 @@ class PolynomialKernel : public KDEKernel {
   /// Coefficients of the polynomial generated for kernels of order > 2
   std::vector<double> coefficients;
 
+ private:
   /// Quadrature set for integrating moment functions
   Quadrature* quadrature;
 
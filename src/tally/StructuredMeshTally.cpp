@@ -0,0 +1,776 @@
+// MCNP5/dagmc/StructuredMeshTally.cpp
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "moab/Core.hpp"
+
+#include "StructuredMeshTally.hpp"
+#include "TallyContext.hpp"
+
+#ifndef M_PI  /* windows */
+# define M_PI 3.14159265358979323846
+#endif
+
+// points closer than this fraction of the grid extent to a bin edge are
+// treated as lying on it
+#define BIN_TOLERANCE 1e-10
+
+// number of sectors per revolution used to draw cylindrical cells
+#define SECTORS_PER_REVOLUTION 16
+
+//---------------------------------------------------------------------------//
+// MISCELLANEOUS FILE SCOPE METHODS
+//---------------------------------------------------------------------------//
+// Parse a comma-separated list of doubles, e.g. "-1.0,0,2.5e1"
+static bool parse_double_list(const std::string& value,
+                              std::vector<double>& values) {
+  values.clear();
+  const char* ptr = value.c_str();
+
+  while (*ptr) {
+    char* end;
+    double val = strtod(ptr, &end);
+    if (end == ptr)
+      return false;
+
+    values.push_back(val);
+    ptr = end;
+
+    if (*ptr == ',')
+      ++ptr;
+    else if (*ptr)
+      return false;
+  }
+
+  return !values.empty();
+}
+//---------------------------------------------------------------------------//
+// Returns the bin containing x, or the bin a track moving at the given rate
+// enters when x is on an edge.  Values below the first edge return -1 and
+// values above the last edge return the number of bins.
+static int find_bin(const std::vector<double>& edges, double x, double rate) {
+  double tol = BIN_TOLERANCE * (edges.back() - edges.front());
+  int n = edges.size();
+
+  // first edge that is not below x
+  int k = std::lower_bound(edges.begin(), edges.end(), x - tol) - edges.begin();
+
+  if (k < n && edges[k] <= x + tol) {
+    if (rate > 0.0)
+      return k;
+    else if (rate < 0.0)
+      return k - 1;
+    else
+      return (k == n - 1) ? k - 1 : k;
+  }
+
+  return k - 1;
+}
+//---------------------------------------------------------------------------//
+// Converts an angle in radians to revolutions in [theta0, theta0 + 1)
+static double to_revolutions(double angle, double theta0) {
+  double rev = angle / (2.0 * M_PI);
+  double shift = theta0 - BIN_TOLERANCE;
+  return rev - floor(rev - shift);
+}
+//---------------------------------------------------------------------------//
+// Track in the frame of a cylindrical grid, where the squared distance from
+// the axis is r^2(t) = a t^2 + 2 b t + c at distance t along the track
+struct CylinderTrack {
+  moab::CartVect q;
+  moab::CartVect u;
+  double a, b, c;
+
+  // z component of q x u, which is constant along the track; theta
+  // increases along the track if it is positive and decreases if negative
+  double spin;
+
+  CylinderTrack(const moab::CartVect& origin, const TallyEvent& event)
+    : q(event.position - origin), u(event.direction) {
+    a = u[0] * u[0] + u[1] * u[1];
+    b = q[0] * u[0] + q[1] * u[1];
+    c = q[0] * q[0] + q[1] * q[1];
+    spin = q[0] * u[1] - q[1] * u[0];
+  }
+
+  // distances at which the track crosses the cylinder of the given radius,
+  // false if the track misses or only touches it
+  bool cylinder_roots(double radius, double& t1, double& t2) const {
+    if (a <= 0.0)
+      return false;
+
+    double disc = b * b - a * (c - radius * radius);
+    if (disc <= 0.0)
+      return false;
+
+    double s = sqrt(disc);
+    t1 = (-b - s) / a;
+    t2 = (-b + s) / a;
+    return true;
+  }
+
+  // distance at which the track crosses the half-plane bounded by the axis
+  // at the given angle in revolutions, HUGE_VAL if it never does
+  double half_plane_crossing(double theta) const {
+    double phi = 2.0 * M_PI * theta;
+    double cs = cos(phi);
+    double sn = sin(phi);
+
+    double denom = cs * u[1] - sn * u[0];
+    if (denom == 0.0)
+      return HUGE_VAL;
+
+    double t = (sn * q[0] - cs * q[1]) / denom;
+
+    // the track may cross the plane on the other side of the axis
+    if ((q[0] + u[0] * t) * cs + (q[1] + u[1] * t) * sn <= 0.0)
+      return HUGE_VAL;
+
+    return t;
+  }
+
+  // distance at which the track is closest to the axis
+  double axis_crossing() const {
+    return (a > 0.0) ? -b / a : HUGE_VAL;
+  }
+};
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+StructuredMeshTally::StructuredMeshTally(const TallyInput& input,
+                                         StructuredMeshTally::Geometry type)
+  : MeshTally(input, false),
+    geometry(type),
+    origin(0.0, 0.0, 0.0),
+    full_circle(false),
+    mbi(new moab::Core()) {
+  std::cout << "Creating " << (geometry == CARTESIAN ? "Cartesian" : "cylindrical")
+            << " structured mesh tally " << input.tally_id
+            << ", output: " << output_filename << std::endl;
+
+  // set up StructuredMeshTally member variables from TallyInput
+  parse_tally_options();
+
+  // the grid is built by the tally, so there are no previous weight windows
+  if (ww_generator) {
+    std::cerr << "Warning: weight windows are not supported for structured "
+              << "mesh tally " << input.tally_id << std::endl;
+    ww_generator.reset();
+  }
+
+  unsigned int num_cells = num_bins(0) * num_bins(1) * num_bins(2);
+  std::cout << "    grid has " << num_bins(0) << " x " << num_bins(1)
+            << " x " << num_bins(2) << " = " << num_cells << " cells" << std::endl;
+
+  // initialize the data arrays to store one tally point per grid cell
+  data->resize_data_arrays(num_cells);
+
+  moab::ErrorCode rval = build_output_mesh();
+  if (rval != moab::MB_SUCCESS) {
+    std::cerr << "Error: failed to build the output mesh for tally "
+              << input.tally_id << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  rval = setup_tags(mbi);
+  assert(rval == moab::MB_SUCCESS);
+}
+//---------------------------------------------------------------------------//
+// DESTRUCTOR
+//---------------------------------------------------------------------------//
+StructuredMeshTally::~StructuredMeshTally() {
+  delete mbi;
+}
+//---------------------------------------------------------------------------//
+// DERIVED PUBLIC INTERFACE from Tally.hpp
+//---------------------------------------------------------------------------//
+void StructuredMeshTally::compute_score(const TallyEvent& event) {
+  score_event(event, *data);
+}
+//---------------------------------------------------------------------------//
+void StructuredMeshTally::compute_score(const TallyEvent& event,
+                                        TallyContext& context) {
+  score_event(event, context.get_scratch_data(input_data.tally_id));
+}
+//---------------------------------------------------------------------------//
+bool StructuredMeshTally::scores_event_type(TallyEvent::EventType type) const {
+  return type == TallyEvent::TRACK;
+}
+//---------------------------------------------------------------------------//
+void StructuredMeshTally::write_data(double num_histories) {
+  moab::ErrorCode rval;
+
+  // compute results for all grid cells in one pass over the tally data
+  std::vector<double> tally_vect, error_vect, total_tally, total_error;
+  data->get_results(num_histories, cell_volumes.data(),
+                    tally_vect, error_vect, total_tally, total_error);
+
+  // cylindrical grid cells can have more than one output element
+  if (cell_elements.size() != cell_volumes.size()) {
+    expand_to_elements(tally_vect);
+    expand_to_elements(error_vect);
+    expand_to_elements(total_tally);
+    expand_to_elements(total_error);
+  }
+
+  // set tag values for all output elements at once
+  unsigned int num_elements = cell_elements.size();
+
+  rval = mbi->tag_set_data(tally_tag, &cell_elements[0], num_elements, tally_vect.data());
+  MB_CHK_SET_ERR_RET(rval, "Failed to set the tally_tag data");
+  rval = mbi->tag_set_data(error_tag, &cell_elements[0], num_elements, error_vect.data());
+  MB_CHK_SET_ERR_RET(rval, "Failed to set the error_tag data");
+
+  if (data->has_total_energy_bin()) {
+    rval = mbi->tag_set_data(total_tally_tag, &cell_elements[0], num_elements, total_tally.data());
+    MB_CHK_SET_ERR_RET(rval, "Failed to set the total_tally_tag data");
+    rval = mbi->tag_set_data(total_error_tag, &cell_elements[0], num_elements, total_error.data());
+    MB_CHK_SET_ERR_RET(rval, "Failed to set the total_error_tag data");
+  }
+
+  std::vector<moab::Tag> output_tags;
+  output_tags.push_back(tally_tag);
+  output_tags.push_back(error_tag);
+  if (data->has_total_energy_bin()) {
+    output_tags.push_back(total_tally_tag);
+    output_tags.push_back(total_error_tag);
+  }
+
+  rval = mbi->write_file(output_filename.c_str(), NULL, NULL, &tally_mesh_set, 1,
+                         &(output_tags[0]), output_tags.size());
+  if (rval != moab::MB_SUCCESS) {
+    std::cerr << "Error: failed to write structured mesh tally "
+              << input_data.tally_id << " to " << output_filename << std::endl;
+  }
+}
+//---------------------------------------------------------------------------//
+int StructuredMeshTally::get_cell_index(const moab::CartVect& point) const {
+  int ijk[3];
+  if (!locate(point, moab::CartVect(0.0, 0.0, 0.0), ijk))
+    return -1;
+
+  return cell_index(ijk);
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+void StructuredMeshTally::parse_tally_options() {
+  const TallyInput::TallyOptions& options = input_data.options;
+  TallyInput::TallyOptions::const_iterator it;
+
+  for (it = options.begin(); it != options.end(); ++it) {
+    std::string key = it->first;
+    std::string value = it->second;
+
+    // process tally option according to key
+    if (key == "x" && geometry == CARTESIAN)
+      parse_bin_edges(key, value, edges[0]);
+    else if (key == "y" && geometry == CARTESIAN)
+      parse_bin_edges(key, value, edges[1]);
+    else if (key == "r" && geometry == CYLINDRICAL)
+      parse_bin_edges(key, value, edges[0]);
+    else if (key == "theta" && geometry == CYLINDRICAL)
+      parse_bin_edges(key, value, edges[1]);
+    else if (key == "z")
+      parse_bin_edges(key, value, edges[2]);
+    else if (key == "origin" && geometry == CYLINDRICAL) {
+      std::vector<double> values;
+      if (!parse_double_list(value, values) || values.size() != 3) {
+        std::cerr << "Error: Tally " << input_data.tally_id
+                  << " input has bad origin '" << value << "'" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      origin = moab::CartVect(values[0], values[1], values[2]);
+    } else { // invalid tally option
+      std::cerr << "Warning: Tally " << input_data.tally_id
+                << " input has unknown key '" << key << "'" << std::endl;
+    }
+  }
+
+  // default to a single bin covering a full revolution
+  if (geometry == CYLINDRICAL && edges[1].empty()) {
+    edges[1].push_back(0.0);
+    edges[1].push_back(1.0);
+  }
+
+  const char* names[2][3] = {{"x", "y", "z"}, {"r", "theta", "z"}};
+  for (int axis = 0; axis < 3; ++axis) {
+    if (edges[axis].empty()) {
+      std::cerr << "Error: Tally " << input_data.tally_id << " input is missing the '"
+                << names[geometry][axis] << "' bin edges" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (geometry == CYLINDRICAL) {
+    double span = edges[1].back() - edges[1].front();
+
+    if (edges[0].front() < 0.0 || span > 1.0 + BIN_TOLERANCE) {
+      std::cerr << "Error: Tally " << input_data.tally_id
+                << " input needs r >= 0 and at most one revolution of theta" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    full_circle = (span >= 1.0 - BIN_TOLERANCE);
+  }
+}
+//---------------------------------------------------------------------------//
+void StructuredMeshTally::parse_bin_edges(const std::string& key,
+                                          const std::string& value,
+                                          std::vector<double>& bins) {
+  bool okay = parse_double_list(value, bins) && bins.size() > 1;
+
+  for (unsigned int i = 1; okay && i < bins.size(); ++i) {
+    if (bins[i] <= bins[i - 1])
+      okay = false;
+  }
+
+  if (!okay) {
+    std::cerr << "Error: Tally " << input_data.tally_id << " input has bad '"
+              << key << "' bin edges '" << value << "'" << std::endl;
+    std::cerr << "       expected at least two increasing, comma-separated values" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+//---------------------------------------------------------------------------//
+void StructuredMeshTally::expand_to_elements(std::vector<double>& values) const {
+  unsigned int num_cells = cell_volumes.size();
+  if (values.empty())
+    return;
+
+  unsigned int num_values = values.size() / num_cells;
+  std::vector<double> element_values(cell_elements.size() * num_values);
+
+  for (unsigned int i = 0; i < num_cells; ++i) {
+    for (unsigned int e = element_offsets[i]; e < element_offsets[i + 1]; ++e) {
+      std::copy(&values[i * num_values], &values[i * num_values] + num_values,
+                &element_values[e * num_values]);
+    }
+  }
+
+  values.swap(element_values);
+}
+//---------------------------------------------------------------------------//
+double StructuredMeshTally::cell_volume(const int ijk[3]) const {
+  double width[3];
+  for (int axis = 0; axis < 3; ++axis)
+    width[axis] = edges[axis][ijk[axis] + 1] - edges[axis][ijk[axis]];
+
+  if (geometry == CARTESIAN)
+    return width[0] * width[1] * width[2];
+
+  double r0 = edges[0][ijk[0]];
+  double r1 = edges[0][ijk[0] + 1];
+  return M_PI * (r1 * r1 - r0 * r0) * width[1] * width[2];
+}
+//---------------------------------------------------------------------------//
+bool StructuredMeshTally::locate(const moab::CartVect& point,
+                                 const moab::CartVect& direction,
+                                 int ijk[3]) const {
+  double coords[3];
+  double rates[3];
+
+  if (geometry == CARTESIAN) {
+    for (int axis = 0; axis < 3; ++axis) {
+      coords[axis] = point[axis];
+      rates[axis] = direction[axis];
+    }
+  } else {
+    moab::CartVect q = point - origin;
+    double r = sqrt(q[0] * q[0] + q[1] * q[1]);
+    double x = q[0], y = q[1];
+
+    coords[0] = r;
+    rates[1] = q[0] * direction[1] - q[1] * direction[0];
+
+    if (r > BIN_TOLERANCE * edges[0].back()) {
+      rates[0] = (q[0] * direction[0] + q[1] * direction[1]) / r;
+    } else {
+      // on the axis theta is that of the direction the track leaves in
+      rates[0] = 1.0;
+      rates[1] = 0.0;
+      x = direction[0];
+      y = direction[1];
+    }
+
+    coords[1] = to_revolutions(atan2(y, x), edges[1].front());
+    coords[2] = q[2];
+    rates[2] = direction[2];
+  }
+
+  for (int axis = 0; axis < 3; ++axis)
+    ijk[axis] = find_bin(edges[axis], coords[axis], rates[axis]);
+
+  // theta bins wrap around a full revolution
+  if (geometry == CYLINDRICAL && full_circle) {
+    int nt = num_bins(1);
+    ijk[1] = (ijk[1] % nt + nt) % nt;
+  }
+
+  for (int axis = 0; axis < 3; ++axis) {
+    if (ijk[axis] < 0 || ijk[axis] >= num_bins(axis))
+      return false;
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------//
+void StructuredMeshTally::score_event(const TallyEvent& event,
+                                      TallyData& scores) {
+  // If it's not the type we want leave immediately
+  if (event.type != TallyEvent::TRACK)
+    return;
+
+  unsigned int ebin;
+  if (!get_energy_bin(event.particle_energy, ebin))
+    return;
+
+  double weight = event.get_score_multiplier(input_data.multiplier_id);
+
+  if (geometry == CARTESIAN)
+    score_cartesian(event, scores, ebin, weight);
+  else
+    score_cylindrical(event, scores, ebin, weight);
+}
+//---------------------------------------------------------------------------//
+void StructuredMeshTally::score_cartesian(const TallyEvent& event,
+                                          TallyData& scores,
+                                          unsigned int ebin, double weight) {
+  const moab::CartVect& p = event.position;
+  const moab::CartVect& u = event.direction;
+
+  // clip the track to the bounding box of the grid
+  double t_in = 0.0;
+  double t_out = event.track_length;
+
+  for (int axis = 0; axis < 3; ++axis) {
+    double lo = edges[axis].front();
+    double hi = edges[axis].back();
+
+    if (u[axis] == 0.0) {
+      if (p[axis] < lo || p[axis] > hi)
+        return;
+    } else {
+      double t0 = (lo - p[axis]) / u[axis];
+      double t1 = (hi - p[axis]) / u[axis];
+      if (t0 > t1)
+        std::swap(t0, t1);
+      t_in = std::max(t_in, t0);
+      t_out = std::min(t_out, t1);
+    }
+  }
+
+  if (t_in >= t_out)
+    return;
+
+  int ijk[3];
+  if (!locate(p + u * t_in, u, ijk))
+    return;
+
+  // distance along the track to the next bin edge on each axis
+  double t_next[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    if (u[axis] > 0.0)
+      t_next[axis] = (edges[axis][ijk[axis] + 1] - p[axis]) / u[axis];
+    else if (u[axis] < 0.0)
+      t_next[axis] = (edges[axis][ijk[axis]] - p[axis]) / u[axis];
+    else
+      t_next[axis] = HUGE_VAL;
+  }
+
+  // step through the grid one bin edge at a time, always crossing the
+  // nearest edge next
+  double t = t_in;
+  while (t < t_out) {
+    int axis = 0;
+    if (t_next[1] < t_next[axis])
+      axis = 1;
+    if (t_next[2] < t_next[axis])
+      axis = 2;
+
+    double t_end = std::min(t_next[axis], t_out);
+    if (t_end > t)
+      scores.add_score_to_tally(cell_index(ijk), weight * (t_end - t), ebin);
+
+    t = t_end;
+    if (t >= t_out)
+      break;
+
+    if (u[axis] > 0.0) {
+      if (++ijk[axis] >= num_bins(axis))
+        break;
+      t_next[axis] = (edges[axis][ijk[axis] + 1] - p[axis]) / u[axis];
+    } else {
+      if (--ijk[axis] < 0)
+        break;
+      t_next[axis] = (edges[axis][ijk[axis]] - p[axis]) / u[axis];
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+void StructuredMeshTally::score_cylindrical(const TallyEvent& event,
+                                            TallyData& scores,
+                                            unsigned int ebin, double weight) {
+  // a track can cross each of the grid boundaries only a few times, so
+  // this bounds the number of times it can enter the grid
+  const int max_entries = 10;
+
+  double t = 0.0;
+  double entry;
+  int ijk[3];
+
+  for (int i = 0; i < max_entries && t < event.track_length; ++i) {
+    if (!find_cylinder_entry(event, t, entry, ijk))
+      return;
+
+    t = std::max(walk_cylinder(event, scores, entry, ijk, ebin, weight), t);
+  }
+}
+//---------------------------------------------------------------------------//
+bool StructuredMeshTally::find_cylinder_entry(const TallyEvent& event,
+                                              double start, double& entry,
+                                              int ijk[3]) const {
+  CylinderTrack track(origin, event);
+  double length = event.track_length;
+
+  // every distance at which the track may enter or leave the grid: the
+  // start, two roots for each radius, two planes and three azimuthal crossings
+  double times[10] = {start};
+  int num_times = 1;
+  double t1, t2;
+
+  const double radii[2] = {edges[0].front(), edges[0].back()};
+  for (int i = 0; i < 2; ++i) {
+    if (radii[i] > 0.0 && track.cylinder_roots(radii[i], t1, t2)) {
+      times[num_times++] = t1;
+      times[num_times++] = t2;
+    }
+  }
+
+  if (track.u[2] != 0.0) {
+    times[num_times++] = (edges[2].front() - track.q[2]) / track.u[2];
+    times[num_times++] = (edges[2].back() - track.q[2]) / track.u[2];
+  }
+
+  if (!full_circle) {
+    times[num_times++] = track.half_plane_crossing(edges[1].front());
+    times[num_times++] = track.half_plane_crossing(edges[1].back());
+    times[num_times++] = track.axis_crossing();
+  }
+
+  std::sort(times, times + num_times);
+
+  // the track is either inside or outside the grid between two of these
+  for (int k = 0; k < num_times; ++k) {
+    double t_c = times[k];
+    if (t_c < start)
+      continue;
+    if (t_c >= length)
+      break;
+
+    double t_n = (k + 1 < num_times) ? std::min(times[k + 1], length) : length;
+    if (t_n <= t_c)
+      continue;
+
+    // start in the cell at t_c if it can be found there, otherwise
+    // slightly further on
+    const double fractions[3] = {0.0, 1e-6, 0.5};
+    for (int f = 0; f < 3; ++f) {
+      double t = t_c + fractions[f] * (t_n - t_c);
+      if (locate(event.position + event.direction * t, event.direction, ijk)) {
+        entry = t;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+//---------------------------------------------------------------------------//
+double StructuredMeshTally::walk_cylinder(const TallyEvent& event,
+                                          TallyData& scores, double start, int ijk[3],
+                                          unsigned int ebin, double weight) {
+  CylinderTrack track(origin, event);
+  const double length = event.track_length;
+  const int nt = num_bins(1);
+  const bool use_theta = !(full_circle && nt == 1);
+  const double axis_tol = BIN_TOLERANCE * edges[0].back();
+
+  // each cylinder is crossed at most twice and each plane at most once
+  const int max_steps = 2 * (num_bins(0) + num_bins(1) + num_bins(2)) + 8;
+
+  double t = start;
+  for (int steps = 0; steps < max_steps; ++steps) {
+    // find the nearest surface of the current cell ahead of the track;
+    // the surface just crossed is behind it, so ties with t are allowed
+    // and a track through an edge or corner crosses one surface at a time
+    double t_exit = HUGE_VAL;
+    int axis = -1;
+    int step = 0;
+    double t1, t2;
+
+    double r_lo = edges[0][ijk[0]];
+    double r_hi = edges[0][ijk[0] + 1];
+
+    if (track.cylinder_roots(r_hi, t1, t2) && t2 >= t && t2 < t_exit) {
+      t_exit = t2;
+      axis = 0;
+      step = 1;
+    }
+
+    if (r_lo > 0.0 && track.cylinder_roots(r_lo, t1, t2) && t1 >= t && t1 < t_exit) {
+      t_exit = t1;
+      axis = 0;
+      step = -1;
+    }
+
+    if (track.u[2] != 0.0) {
+      int k = (track.u[2] > 0.0) ? ijk[2] + 1 : ijk[2];
+      double tz = (edges[2][k] - track.q[2]) / track.u[2];
+      if (tz >= t && tz < t_exit) {
+        t_exit = tz;
+        axis = 2;
+        step = (track.u[2] > 0.0) ? 1 : -1;
+      }
+    }
+
+    bool through_axis = false;
+    if (use_theta) {
+      if (track.spin > axis_tol || track.spin < -axis_tol) {
+        int j = (track.spin > 0.0) ? ijk[1] + 1 : ijk[1];
+        double tt = track.half_plane_crossing(edges[1][j]);
+        if (tt >= t && tt < t_exit) {
+          t_exit = tt;
+          axis = 1;
+          step = (track.spin > 0.0) ? 1 : -1;
+        }
+      } else if (r_lo == 0.0) {
+        // a track through the axis jumps half a revolution in theta
+        double ta = track.axis_crossing();
+        if (ta > t && ta < t_exit) {
+          t_exit = ta;
+          axis = 1;
+          through_axis = true;
+        }
+      }
+    }
+
+    double t_end = std::min(t_exit, length);
+    if (t_end > t)
+      scores.add_score_to_tally(cell_index(ijk), weight * (t_end - t), ebin);
+
+    if (t_exit >= length || axis < 0)
+      return length;
+
+    t = t_exit;
+
+    if (through_axis) {
+      double theta = to_revolutions(atan2(track.u[1], track.u[0]), edges[1].front());
+      ijk[1] = find_bin(edges[1], theta, 0.0);
+    } else {
+      ijk[axis] += step;
+    }
+
+    if (full_circle)
+      ijk[1] = (ijk[1] % nt + nt) % nt;
+
+    if (ijk[axis] < 0 || ijk[axis] >= num_bins(axis))
+      return t;
+  }
+
+  return length;
+}
+//---------------------------------------------------------------------------//
+moab::ErrorCode StructuredMeshTally::build_output_mesh() {
+  moab::ErrorCode rval = mbi->create_meshset(moab::MESHSET_SET, tally_mesh_set);
+  MB_CHK_SET_ERR(rval, "Failed to create the output mesh set");
+
+  int n[3] = {num_bins(0), num_bins(1), num_bins(2)};
+
+  // Cartesian cells share the vertices of the grid
+  std::vector<moab::EntityHandle> grid_verts;
+  if (geometry == CARTESIAN) {
+    grid_verts.resize((n[0] + 1) * (n[1] + 1) * (n[2] + 1));
+    for (int k = 0; k <= n[2]; ++k) {
+      for (int j = 0; j <= n[1]; ++j) {
+        for (int i = 0; i <= n[0]; ++i) {
+          double xyz[3] = {edges[0][i], edges[1][j], edges[2][k]};
+          rval = mbi->create_vertex(xyz, grid_verts[i + (n[0] + 1) * (j + (n[1] + 1) * k)]);
+          MB_CHK_SET_ERR(rval, "Failed to create a grid vertex");
+        }
+      }
+    }
+  }
+
+  cell_elements.clear();
+  element_offsets.assign(1, 0);
+  cell_volumes.clear();
+
+  int ijk[3];
+  for (ijk[2] = 0; ijk[2] < n[2]; ++ijk[2]) {
+    for (ijk[1] = 0; ijk[1] < n[1]; ++ijk[1]) {
+      for (ijk[0] = 0; ijk[0] < n[0]; ++ijk[0]) {
+        moab::EntityHandle conn[8];
+        moab::EntityHandle hex;
+
+        if (geometry == CARTESIAN) {
+          for (int c = 0; c < 8; ++c) {
+            // hex corners go around the bottom face and then the top face
+            int i = ijk[0] + ((c & 1) ^ ((c >> 1) & 1));
+            int j = ijk[1] + ((c >> 1) & 1);
+            int k = ijk[2] + ((c >> 2) & 1);
+            conn[c] = grid_verts[i + (n[0] + 1) * (j + (n[1] + 1) * k)];
+          }
+
+          rval = mbi->create_element(moab::MBHEX, conn, 8, hex);
+          MB_CHK_SET_ERR(rval, "Failed to create a grid cell");
+          cell_elements.push_back(hex);
+        } else {
+          double r[2] = {edges[0][ijk[0]], edges[0][ijk[0] + 1]};
+          double z[2] = {edges[2][ijk[2]], edges[2][ijk[2] + 1]};
+          double theta0 = edges[1][ijk[1]];
+          double width = edges[1][ijk[1] + 1] - theta0;
+          int num_sectors = std::max(1, (int)ceil(width * SECTORS_PER_REVOLUTION - BIN_TOLERANCE));
+
+          for (int s = 0; s < num_sectors; ++s) {
+            double phi[2] = {2.0 * M_PI * (theta0 + width * s / num_sectors),
+                             2.0 * M_PI * (theta0 + width * (s + 1) / num_sectors)
+                            };
+
+            for (int c = 0; c < 8; ++c) {
+              // hex corners go around the bottom face and then the top face
+              int ir = (c & 1) ^ ((c >> 1) & 1);
+              int it = (c >> 1) & 1;
+              int iz = (c >> 2) & 1;
+              double xyz[3] = {origin[0] + r[ir]* cos(phi[it]),
+                               origin[1] + r[ir]* sin(phi[it]),
+                               origin[2] + z[iz]
+                              };
+              rval = mbi->create_vertex(xyz, conn[c]);
+              MB_CHK_SET_ERR(rval, "Failed to create a grid vertex");
+            }
+
+            rval = mbi->create_element(moab::MBHEX, conn, 8, hex);
+            MB_CHK_SET_ERR(rval, "Failed to create a grid cell");
+            cell_elements.push_back(hex);
+          }
+        }
+
+        element_offsets.push_back(cell_elements.size());
+        cell_volumes.push_back(cell_volume(ijk));
+      }
+    }
+  }
+
+  rval = mbi->add_entities(tally_mesh_set, &cell_elements[0], cell_elements.size());
+  MB_CHK_SET_ERR(rval, "Failed to add the grid cells to the output mesh set");
+
+  return moab::MB_SUCCESS;
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/StructuredMeshTally.cpp
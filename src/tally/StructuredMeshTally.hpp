@@ -0,0 +1,286 @@
+// MCNP5/dagmc/StructuredMeshTally.hpp
+
+#ifndef DAGMC_STRUCTURED_MESH_TALLY_HPP
+#define DAGMC_STRUCTURED_MESH_TALLY_HPP
+
+#include <string>
+#include <vector>
+
+#include "moab/CartVect.hpp"
+
+#include "MeshTally.hpp"
+#include "TallyEvent.hpp"
+
+// forward declarations
+namespace moab {
+class Interface;
+}
+
+//===========================================================================//
+/**
+ * \class StructuredMeshTally
+ * \brief Represents a track length mesh tally on a regular grid
+ *
+ * StructuredMeshTally is a concrete class derived from MeshTally that
+ * implements the Tally interface to tally particle tracks on a rectilinear
+ * or cylindrical grid defined entirely by its bin edges.  Two types of
+ * structured mesh tallies can be created
+ *
+ *     1) CARTESIAN mesh tally, with x, y and z bin edges
+ *     2) CYLINDRICAL mesh tally, with r, theta and z bin edges
+ *
+ * No input mesh or search tree is needed.  Each track is clipped to the
+ * grid and then walked from cell to cell with a 3D digital differential
+ * analyzer (Amanatides and Woo, "A Fast Voxel Traversal Algorithm for Ray
+ * Tracing", Eurographics 1987), generalized to non-uniform bins.  On the
+ * cylindrical grid the walk steps across the cylinders, planes and
+ * half-planes that bound the current cell, so tracks that leave through
+ * the inner radius or a partial theta range and come back are handled.
+ * If a StructuredMeshTally object receives a TallyEvent type that is not
+ * TallyEvent::TRACK, then no scores are computed.
+ *
+ * Cells are indexed with the first axis varying fastest, i.e. the index of
+ * cell (i, j, k) is i + n_i * (j + n_j * k).  The axes are (x, y, z) for
+ * CARTESIAN and (r, theta, z) for CYLINDRICAL mesh tallies.
+ *
+ * ==========
+ * TallyInput
+ * ==========
+ *
+ * The TallyInput struct needed to construct a StructuredMeshTally object is
+ * defined in Tally.hpp and is set through the TallyManager when a Tally is
+ * created.  Options that are currently available for StructuredMeshTally
+ * objects include
+ *
+ * 1) "out"="output_filename"
+ * --------------------------
+ * This option is processed through the MeshTally constructor.  Results are
+ * written as hexahedral elements in any format supported by MOAB, i.e. H5M
+ * or VTK.  The "inp" key is not used.  See MeshTally.hpp for more
+ * information.
+ *
+ * 2) "x"="x0,x1,...", "y"="y0,y1,...", "z"="z0,z1,..."
+ * ---------------------------------------------------
+ * Comma-separated, increasing bin edges along each axis.  "x", "y" and "z"
+ * are REQUIRED for CARTESIAN mesh tallies, and "z" is REQUIRED for
+ * CYLINDRICAL mesh tallies.
+ *
+ * 3) "r"="r0,r1,...", "theta"="t0,t1,...", "origin"="x,y,z"
+ * ---------------------------------------------------------
+ * Radial and azimuthal bin edges for CYLINDRICAL mesh tallies.  "r" is
+ * REQUIRED and must not be negative.  "theta" is measured in revolutions
+ * about the +z axis from the +x axis, must span at most one revolution, and
+ * defaults to a single bin from 0 to 1.  The cylinder axis is parallel to z
+ * and passes through "origin", which defaults to (0, 0, 0).  The z edges
+ * are relative to the origin.
+ */
+//===========================================================================//
+class StructuredMeshTally : public MeshTally {
+ public:
+  /**
+   * \brief Defines type of grid
+   *
+   *     0) CARTESIAN uses x, y and z bins
+   *     1) CYLINDRICAL uses r, theta and z bins about an axis parallel to z
+   */
+  enum Geometry {CARTESIAN = 0, CYLINDRICAL = 1};
+
+  /**
+   * \brief Constructor
+   * \param[in] input user-defined input parameters for this StructuredMeshTally
+   * \param[in] type the type of grid to be tallied
+   */
+  StructuredMeshTally(const TallyInput& input, Geometry type);
+
+  /**
+   * \brief Virtual destructor
+   */
+  virtual ~StructuredMeshTally();
+
+  // >>> DERIVED PUBLIC INTERFACE from Tally.hpp
+
+  /**
+   * \brief Computes scores for this StructuredMeshTally based on the given TallyEvent
+   * \param[in] event the parameters needed to compute the scores
+   */
+  virtual void compute_score(const TallyEvent& event);
+
+  /**
+   * \brief Computes scores for this StructuredMeshTally into a TallyContext
+   * \param[in] event the parameters needed to compute the scores
+   * \param[in, out] context the scoring context of the calling thread
+   */
+  virtual void compute_score(const TallyEvent& event, TallyContext& context);
+
+  /**
+   * \brief Checks if this StructuredMeshTally scores events of the given type
+   * \param[in] type the type of tally event
+   * \return true if compute_score() may score events of this type
+   */
+  virtual bool scores_event_type(TallyEvent::EventType type) const;
+
+  /**
+   * \brief Write results to the output file for this StructuredMeshTally
+   * \param[in] num_histories the number of particle histories tracked
+   *
+   * The write_data() method writes the current tally and relative standard
+   * error results for all of the grid cells to the output_filename set for
+   * this StructuredMeshTally.  These values are normalized by both the
+   * number of particle histories that were tracked and the volume of the
+   * grid cell for which the results were computed.
+   */
+  virtual void write_data(double num_histories);
+
+  /**
+   * \brief Finds the grid cell that contains a point
+   * \param[in] point the coordinates of the point
+   * \return the cell index, or -1 if the point is outside the grid
+   */
+  int get_cell_index(const moab::CartVect& point) const;
+
+ private:
+  /// Copy constructor and operator= methods are not implemented
+  StructuredMeshTally(const StructuredMeshTally& obj);
+  StructuredMeshTally& operator=(const StructuredMeshTally& obj);
+
+  // Type of grid used by this StructuredMeshTally
+  Geometry geometry;
+
+  // Bin edges along each axis, (x, y, z) or (r, theta, z)
+  std::vector<double> edges[3];
+
+  // Origin of the cylindrical grid
+  moab::CartVect origin;
+
+  // True if the theta bins cover a full revolution
+  bool full_circle;
+
+  // MOAB instance that stores the output mesh
+  moab::Interface* mbi;
+
+  // Output elements for each grid cell, stored in cell order with
+  // element_offsets[i] giving the first element of cell i
+  std::vector<moab::EntityHandle> cell_elements;
+  std::vector<unsigned int> element_offsets;
+
+  // Volume of each grid cell, stored in cell order
+  std::vector<double> cell_volumes;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Parse the TallyInput options for this StructuredMeshTally
+   */
+  void parse_tally_options();
+
+  /**
+   * \brief Parse a comma-separated list of increasing bin edges
+   * \param[in] key the option key, used for error messages
+   * \param[in] value the option value
+   * \param[out] bins the bin edges
+   */
+  void parse_bin_edges(const std::string& key, const std::string& value,
+                       std::vector<double>& bins);
+
+  /**
+   * \brief Number of bins along an axis
+   */
+  int num_bins(int axis) const {
+    return edges[axis].size() - 1;
+  }
+
+  /**
+   * \brief Index of the cell with bin indices ijk
+   */
+  unsigned int cell_index(const int ijk[3]) const {
+    return ijk[0] + num_bins(0) * (ijk[1] + num_bins(1) * ijk[2]);
+  }
+
+  /**
+   * \brief Volume of the cell with bin indices ijk
+   */
+  double cell_volume(const int ijk[3]) const;
+
+  /**
+   * \brief Copies values for each grid cell to each of its output elements
+   * \param[in, out] values the values for each grid cell, in cell order
+   */
+  void expand_to_elements(std::vector<double>& values) const;
+
+  /**
+   * \brief Finds the bin indices of the cell a track is in at a point
+   * \param[in] point the coordinates of the point on the track
+   * \param[in] direction the direction of the track
+   * \param[out] ijk the bin indices of the cell
+   * \return true if the point is inside the grid
+   *
+   * A point on a bin edge is placed in the bin the track is moving into.
+   */
+  bool locate(const moab::CartVect& point, const moab::CartVect& direction,
+              int ijk[3]) const;
+
+  /**
+   * \brief Computes scores for a track event
+   * \param[in] event the tally event, direction, position, track_length, etc
+   * \param[in, out] scores the TallyData to which the scores are added
+   */
+  void score_event(const TallyEvent& event, TallyData& scores);
+
+  /**
+   * \brief Scores a track on a CARTESIAN grid
+   * \param[in] event the tally event, direction, position, track_length, etc
+   * \param[in, out] scores the TallyData to which the scores are added
+   * \param[in] ebin the energy bin index corresponding to the energy
+   * \param[in] weight the multiplier value for the score to be tallied
+   */
+  void score_cartesian(const TallyEvent& event, TallyData& scores,
+                       unsigned int ebin, double weight);
+
+  /**
+   * \brief Scores a track on a CYLINDRICAL grid
+   * \param[in] event the tally event, direction, position, track_length, etc
+   * \param[in, out] scores the TallyData to which the scores are added
+   * \param[in] ebin the energy bin index corresponding to the energy
+   * \param[in] weight the multiplier value for the score to be tallied
+   */
+  void score_cylindrical(const TallyEvent& event, TallyData& scores,
+                         unsigned int ebin, double weight);
+
+  /**
+   * \brief Finds where a track next enters the CYLINDRICAL grid
+   * \param[in] event the tally event, direction, position, track_length, etc
+   * \param[in] start the distance along the track to search from
+   * \param[out] entry the distance along the track at which it enters
+   * \param[out] ijk the bin indices of the cell it enters
+   * \return false if the track does not enter the grid again
+   */
+  bool find_cylinder_entry(const TallyEvent& event, double start,
+                           double& entry, int ijk[3]) const;
+
+  /**
+   * \brief Walks a track through the CYLINDRICAL grid until it leaves
+   * \param[in] event the tally event, direction, position, track_length, etc
+   * \param[in, out] scores the TallyData to which the scores are added
+   * \param[in] start the distance along the track at which the walk starts
+   * \param[in, out] ijk the bin indices of the starting cell
+   * \param[in] ebin the energy bin index corresponding to the energy
+   * \param[in] weight the multiplier value for the score to be tallied
+   * \return the distance along the track at which it left the grid
+   */
+  double walk_cylinder(const TallyEvent& event, TallyData& scores,
+                       double start, int ijk[3],
+                       unsigned int ebin, double weight);
+
+  /**
+   * \brief Builds the hexahedral output mesh and its tags
+   * \return the MOAB ErrorCode value
+   *
+   * Cylindrical cells are split into sectors of at most 1/16 revolution so
+   * that they look round when plotted; all sectors carry the cell result.
+   */
+  moab::ErrorCode build_output_mesh();
+};
+
+#endif // DAGMC_STRUCTURED_MESH_TALLY_HPP
+
+// end of MCNP5/dagmc/StructuredMeshTally.hpp
@@ -3,11 +3,14 @@
 #include <cassert>
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
 
 #include "Tally.hpp"
 #include "TrackLengthMeshTally.hpp"
 #include "KDEMeshTally.hpp"
 #include "CellTally.hpp"
+#include "MultiCellTally.hpp"
+#include "StructuredMeshTally.hpp"
 
 //---------------------------------------------------------------------------//
 // CONSTRUCTOR
@@ -23,6 +26,7 @@ Tally::Tally(const TallyInput& input)
   unsigned int num_energy_bins = input_data.energy_bin_bounds.size() - 1;
 
   data = new TallyData(num_energy_bins, total_energy_bin);
+  energy_bins = EnergyBinLookup::get_lookup(input_data.energy_bin_bounds);
 }
 //---------------------------------------------------------------------------//
 // DESTRUCTOR
@@ -38,17 +42,25 @@ Tally::~Tally() {
 //                                 Mesh, Cell, Surf
 //   ------        --------------   -------------   ----------    -----------
 //  Unstructured | Track Length   | Mesh Tally   || unstr_track   implemented
+//  Cartesian    | Track Length   | Mesh Tally   || struct_track  implemented
+//  Cylindrical  | Track Length   | Mesh Tally   || cyl_track     implemented
 //  KDE          | Integral Track | Mesh Tally   || kde_track     KD's Thesis
 //  KDE          | SubTrack       | Mesh Tally   || kde_subtrack  implemented
 //  KDE          | Collision      | Mesh Tally   || kde_coll      implemented
 //               | Track Length   | Cell         || cell_track    implemented
 //               | Collision      | Cell         || cell_coll     implemented
+//  All cells    | Track Length   | Cell         || cell_track_all implemented
+//  All cells    | Collision      | Cell         || cell_coll_all  implemented
 //---------------------------------------------------------------------------//
 Tally* Tally::create_tally(const TallyInput& input) {
   Tally* newTally = NULL;
 
   if (input.tally_type == "unstr_track") {
     newTally = new moab::TrackLengthMeshTally(input);
+  } else if (input.tally_type == "struct_track") {
+    newTally = new StructuredMeshTally(input, StructuredMeshTally::CARTESIAN);
+  } else if (input.tally_type == "cyl_track") {
+    newTally = new StructuredMeshTally(input, StructuredMeshTally::CYLINDRICAL);
   } else if (input.tally_type == "kde_track") {
     KDEMeshTally::Estimator estimator = KDEMeshTally::INTEGRAL_TRACK;
     newTally = new KDEMeshTally(input, estimator);
@@ -63,6 +75,10 @@ Tally* Tally::create_tally(const TallyInput& input) {
     newTally = new CellTally(input, TallyEvent::TRACK);
   } else if (input.tally_type == "cell_coll") {
     newTally = new CellTally(input, TallyEvent::COLLISION);
+  } else if (input.tally_type == "cell_track_all") {
+    newTally = new MultiCellTally(input, TallyEvent::TRACK);
+  } else if (input.tally_type == "cell_coll_all") {
+    newTally = new MultiCellTally(input, TallyEvent::COLLISION);
   } else {
     std::cout << "Warning: " << input.tally_type
               << " is not a valid tally type." << std::endl;
@@ -73,10 +89,33 @@ Tally* Tally::create_tally(const TallyInput& input) {
 //---------------------------------------------------------------------------//
 // PUBLIC INTERFACE
 //---------------------------------------------------------------------------//
+void Tally::compute_score(const TallyEvent& event, TallyContext& context) {
+  std::cerr << "\nError: " << input_data.tally_type << " tally "
+            << input_data.tally_id << " does not support threaded scoring"
+            << std::endl;
+  exit(EXIT_FAILURE);
+}
+//---------------------------------------------------------------------------//
 void Tally::end_history() {
   data->end_history();
 }
 //---------------------------------------------------------------------------//
+bool Tally::scores_event_type(TallyEvent::EventType type) const {
+  return type != TallyEvent::NONE;
+}
+//---------------------------------------------------------------------------//
+bool Tally::uses_rand() const {
+  return false;
+}
+//---------------------------------------------------------------------------//
+void Tally::get_checkpoint_state(std::vector<double>& state) const {
+  state.clear();
+}
+//---------------------------------------------------------------------------//
+bool Tally::set_checkpoint_state(const std::vector<double>& state) {
+  return state.empty();
+}
+//---------------------------------------------------------------------------//
 const TallyData& Tally::getTallyData() {
   return *data;
 }
@@ -88,39 +127,7 @@ std::string Tally::get_tally_type() {
 // PROTECTED INTERFACE
 //---------------------------------------------------------------------------//
 bool Tally::get_energy_bin(double energy, unsigned int& ebin) {
-  bool bin_exists = false;
-
-  if (energy_in_bounds(energy)) {
-    // in bounds, energy bin index must exist
-    bin_exists = true;
-
-    if (data->get_num_energy_bins() == 1) {
-      ebin = 0;
-    } else { // in bounds and more than one energy bin
-      unsigned int max_ebound = input_data.energy_bin_bounds.size() - 1;
-
-      // Pre-load ebin with maximum bin as default
-      ebin =  max_ebound - 1;
-
-      // find ebin if not maximum bin
-      for (unsigned int i = 0; i < max_ebound; ++i) {
-        if (input_data.energy_bin_bounds.at(i) <= energy &&
-            energy < input_data.energy_bin_bounds.at(i + 1)) {
-          ebin = i;
-          break;
-        }
-      }  // end for
-    }  // end else in bounds and >1 energy bin
-  }  // end if in bounds
-
-  return bin_exists;
-}
-//---------------------------------------------------------------------------//
-bool Tally::energy_in_bounds(double energy) {
-  unsigned int max_ebound = input_data.energy_bin_bounds.size() - 1;
-
-  return !(energy < input_data.energy_bin_bounds.at(0) ||
-           energy > input_data.energy_bin_bounds.at(max_ebound));
+  return energy_bins->find_bin(energy, ebin);
 }
 //---------------------------------------------------------------------------//
 
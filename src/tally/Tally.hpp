@@ -4,13 +4,16 @@
 #define DAGMC_TALLY_HPP
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "EnergyBinLookup.hpp"
 #include "TallyData.hpp"
+#include "TallyEvent.hpp"
 
 // Forward declare because it's only referenced here
-struct TallyEvent;
+class TallyContext;
 
 //===========================================================================//
 /**
@@ -70,6 +73,11 @@ struct TallyInput {
  * sufficient for most Tally objects that use the TallyData structure for
  * storing their data.  If a different data structure is used, or alternative
  * behavior is desired, then Derived classes can override this method.
+ *
+ * Tally objects that can be scored by several threads at once also override
+ * compute_score(const TallyEvent& event, TallyContext& context), which must
+ * add its scores to context.get_scratch_data(tally_id) instead of the
+ * TallyData of this Tally, and must not modify the Tally itself.
  */
 //===========================================================================//
 class Tally {
@@ -105,11 +113,42 @@ class Tally {
    */
   virtual void compute_score(const TallyEvent& event) = 0;
 
+  /**
+   * \brief Computes scores for this Tally into the given TallyContext
+   * \param[in] event the parameters needed to compute the scores
+   * \param[in, out] context the scoring context of the calling thread
+   *
+   * Used by TallyManager for threaded scoring.  The default implementation
+   * reports that this Tally cannot be scored by several threads and exits.
+   */
+  virtual void compute_score(const TallyEvent& event, TallyContext& context);
+
   /**
    * \brief Updates Tally when a particle history ends
    */
   virtual void end_history();
 
+  /**
+   * \brief Checks if this Tally scores events of the given type
+   * \param[in] type the type of tally event
+   * \return true if compute_score() may score events of this type
+   *
+   * Used by TallyManager to only pass each event to the tallies that can
+   * score it.  The default implementation accepts COLLISION and TRACK
+   * events, so Derived classes should override it if they only score one.
+   */
+  virtual bool scores_event_type(TallyEvent::EventType type) const;
+
+  /**
+   * \brief Checks if compute_score() draws random numbers from rand()
+   * \return true if this Tally uses the random number stream of rand()
+   *
+   * TallyManager scores all tallies that share the stream of rand() on the
+   * same thread, so that they draw random numbers in the same order as when
+   * each event is scored directly.  The default implementation returns false.
+   */
+  virtual bool uses_rand() const;
+
   /**
    * \brief Write results for this Tally
    * \param[in] num_histories the number of particle histories tracked
@@ -121,6 +160,26 @@ class Tally {
    */
   virtual void write_data(double num_histories) = 0;
 
+  /**
+   * \brief Gets the state of this Tally that is not stored in its TallyData
+   * \param[out] state the values needed to restore that state
+   *
+   * Used by TallyManager::checkpoint() to save any values that a Derived
+   * class accumulates along with its scores.  The default implementation
+   * has no extra state and clears the vector.
+   */
+  virtual void get_checkpoint_state(std::vector<double>& state) const;
+
+  /**
+   * \brief Restores the state returned by get_checkpoint_state()
+   * \param[in] state the values that were saved
+   * \return true if the state is valid for this Tally; false otherwise
+   *
+   * Used by TallyManager::restore().  The default implementation only
+   * accepts an empty state.
+   */
+  virtual bool set_checkpoint_state(const std::vector<double>& state);
+
   /**
    * \brief Provide access to data for testing
    *
@@ -140,26 +199,22 @@ class Tally {
   /// All of the tally data for this tally
   TallyData* data;
 
+  /// Energy bin lookup shared by all tallies with the same energy bins
+  std::shared_ptr<const EnergyBinLookup> energy_bins;
+
   /**
    * \brief Get the bin index for the current energy
    * \param[in] energy the current particle energy
    * \param[out] ebin the energy bin index corresponding to the energy
    * \return true if energy bin is found; false otherwise
    *
-   * Calls energy_in_bounds first to check if energy is valid for this Tally.
+   * Uses the EnergyBinLookup that is shared with all other tallies that have
+   * the same energy bin boundaries.
    */
   bool get_energy_bin(double energy, unsigned int& ebin);
 
   /// The purpose of this is to allow TallyManager to use the data
   friend class TallyManager;
-
- private:
-  /**
-   * \brief Check that the energy is not outside the allowed range
-   * \param[in] energy the current particle energy
-   * \return true if energy is within the allowed range; false otherwise
-   */
-  bool energy_in_bounds(double energy);
 };
 
 #endif // DAGMC_TALLY_HPP
@@ -0,0 +1,90 @@
+// MCNP5/dagmc/TallyContext.cpp
+
+#include <cstdlib>
+#include <iostream>
+
+#include "TallyContext.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+namespace {
+// increment of the splitmix64 generator
+const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+// output function of the splitmix64 generator, which mixes all bits of x
+uint64_t mix_bits(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+} // namespace
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+TallyContext::TallyContext(uint64_t seed)
+  : seed(seed), random_state(0), history_id(0),
+    num_dispatched(0), num_rejected(0), num_histories(0) {
+  event.type = TallyEvent::NONE;
+  begin_history(0);
+}
+//---------------------------------------------------------------------------//
+// DESTRUCTOR
+//---------------------------------------------------------------------------//
+TallyContext::~TallyContext() {
+  std::map<int, TallyData*>::iterator it;
+  for (it = scratch_data.begin(); it != scratch_data.end(); ++it) {
+    delete it->second;
+  }
+}
+//---------------------------------------------------------------------------//
+// PUBLIC INTERFACE
+//---------------------------------------------------------------------------//
+TallyData& TallyContext::get_scratch_data(unsigned int tally_id) {
+  std::map<int, TallyData*>::iterator it = scratch_data.find(tally_id);
+
+  if (it == scratch_data.end()) {
+    std::cerr << "\nError: no scratch data for Tally " << tally_id
+              << " in TallyContext; call beginHistory() first" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  return *(it->second);
+}
+//---------------------------------------------------------------------------//
+double TallyContext::random_number() {
+  random_state += GOLDEN_GAMMA;
+
+  // use the top 53 bits as the mantissa of a double in [0, 1)
+  return (mix_bits(random_state) >> 11) * (1.0 / 9007199254740992.0);
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+void TallyContext::begin_history(unsigned long id) {
+  history_id = id;
+
+  // mix the history id so that streams of consecutive histories differ
+  random_state = mix_bits(seed ^ mix_bits(id + GOLDEN_GAMMA));
+}
+//---------------------------------------------------------------------------//
+void TallyContext::end_history() {
+  std::map<int, TallyData*>::iterator it;
+  ++num_histories;
+
+  for (it = scratch_data.begin(); it != scratch_data.end(); ++it) {
+    HistoryLog& log = history_logs[it->first];
+    unsigned int offset = log.indices.size();
+
+    it->second->end_history(log.indices, log.scores);
+
+    // only keep a record of histories that scored this tally
+    if (log.indices.size() > offset) {
+      log.histories.push_back(history_id);
+      log.offsets.push_back(offset);
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/TallyContext.cpp
@@ -0,0 +1,155 @@
+// MCNP5/dagmc/TallyContext.hpp
+
+#ifndef DAGMC_TALLY_CONTEXT_HPP
+#define DAGMC_TALLY_CONTEXT_HPP
+
+#include <map>
+#include <vector>
+
+#include <stdint.h>
+
+#include "TallyData.hpp"
+#include "TallyEvent.hpp"
+
+//===========================================================================//
+/**
+ * \class TallyContext
+ * \brief Stores the scoring state of one thread for all DAGMC tallies
+ *
+ * TallyContext allows several threads to score DAGMC tallies at the same
+ * time.  Each thread owns one TallyContext, which contains its own
+ * TallyEvent, a scratch TallyData for every active Tally, and a stream of
+ * random numbers.  Scores are only ever added to the scratch data of the
+ * context, so no locks are needed while particle histories are tracked.
+ *
+ * When a history ends, its sum of scores is moved out of the scratch data
+ * into a log that is kept for each Tally.  TallyManager::endBatch() then
+ * adds the logged histories to the tallies in order of their history ids,
+ * which gives results that are bitwise identical to scoring the same
+ * histories serially in that order, regardless of the number of threads
+ * or which thread tracked each history.
+ *
+ * The random number stream is reset at the start of every history from the
+ * seed of the context and the history id, so it also only depends on the
+ * history and not on the thread.  All contexts used for the same batch
+ * should therefore be created with the same seed.
+ *
+ * A TallyContext is only modified through the TallyManager methods that
+ * take it as a parameter, and by the Tally objects that are scoring into it.
+ */
+//===========================================================================//
+class TallyContext {
+ public:
+  /**
+   * \brief Constructor
+   * \param[in] seed the seed for the random number streams of all histories
+   */
+  explicit TallyContext(uint64_t seed = 0);
+
+  /**
+   * \brief Destructor
+   */
+  ~TallyContext();
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief Gets the TallyEvent that was last set for this context
+   */
+  const TallyEvent& get_event() const {
+    return event;
+  }
+
+  /**
+   * \brief Gets the id of the history currently being tracked
+   */
+  unsigned long get_history_id() const {
+    return history_id;
+  }
+
+  /**
+   * \brief Gets the scratch data in which a Tally stores its scores
+   * \param[in] tally_id the unique ID of the Tally
+   * \return the scratch TallyData for the current history
+   *
+   * Scratch data is created for all active tallies by
+   * TallyManager::beginHistory(), so the tally_id must be valid.
+   */
+  TallyData& get_scratch_data(unsigned int tally_id);
+
+  /**
+   * \brief Gets the next random number for the current history
+   * \return a random number uniformly distributed in [0, 1)
+   */
+  double random_number();
+
+  /**
+   * \brief Gets a reusable vector for storing tally point indices
+   *
+   * Allows a Tally to find the tally points that are scored for each event
+   * without allocating memory or modifying itself.
+   */
+  std::vector<unsigned int>& get_point_buffer() {
+    return point_buffer;
+  }
+
+ private:
+  /// Copy constructor and operator= methods are not implemented
+  TallyContext(const TallyContext& obj);
+  TallyContext& operator=(const TallyContext& obj);
+
+  // Sums of scores for each history that ended in this context; the scores
+  // for histories[i] start at indices[offsets[i]] and scores[offsets[i]]
+  struct HistoryLog {
+    std::vector<unsigned long> histories;
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> indices;
+    std::vector<double> scores;
+  };
+
+  // Event data read by all active DAGMC tallies in this context
+  TallyEvent event;
+
+  // Seed for the random number streams and the current stream state
+  uint64_t seed;
+  uint64_t random_state;
+
+  // Id of the history currently being tracked
+  unsigned long history_id;
+
+  // Scratch data and history log for each active Tally, keyed by tally id
+  std::map<int, TallyData*> scratch_data;
+  std::map<int, HistoryLog> history_logs;
+
+  // Workspace returned by get_point_buffer()
+  std::vector<unsigned int> point_buffer;
+
+  // Number of tally updates dispatched or rejected since the last batch
+  unsigned long num_dispatched;
+  unsigned long num_rejected;
+
+  // Number of histories ended since the last batch
+  unsigned long num_histories;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Starts a new history in this context
+   * \param[in] id the unique id of the history
+   *
+   * Resets the random number stream for the new history.
+   */
+  void begin_history(unsigned long id);
+
+  /**
+   * \brief Moves the scores for the current history into the history logs
+   */
+  void end_history();
+
+  /// The purpose of this is to allow TallyManager to set up the context
+  friend class TallyManager;
+};
+
+#endif // DAGMC_TALLY_CONTEXT_HPP
+
+// end of MCNP5/dagmc/TallyContext.hpp
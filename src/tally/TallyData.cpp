@@ -1,6 +1,8 @@
 // MCNP5/dagmc/TallyData.cpp
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iostream>
 #include <stdlib.h>
 
@@ -31,6 +33,10 @@ TallyData::TallyData(unsigned int num_energy_bins, bool total_energy_bin) {
   }
 
   this->num_tally_points = 0;
+  this->history_epoch = 1;
+  this->monitor_index = -1;
+  this->monitor_sum3 = 0.0;
+  this->monitor_sum4 = 0.0;
 }
 //---------------------------------------------------------------------------//
 // PUBLIC INTERFACE
@@ -42,8 +48,8 @@ std::pair <double, double> TallyData::get_data(unsigned int tally_point_index,
   assert(tally_point_index < num_tally_points);
 
   int index = tally_point_index * num_energy_bins + energy_bin;
-  double tally = tally_data.at(index);
-  double error = error_data.at(index);
+  double tally = tally_data[index];
+  double error = error_data[index];
 
   return std::make_pair(tally, error);
 }
@@ -70,6 +76,8 @@ void TallyData::zero_tally_data() {
   std::fill(tally_data.begin(), tally_data.end(), 0);
   std::fill(error_data.begin(), error_data.end(), 0);
   std::fill(temp_tally_data.begin(), temp_tally_data.end(), 0);
+  monitor_sum3 = 0.0;
+  monitor_sum4 = 0.0;
 }
 //---------------------------------------------------------------------------//
 void TallyData::resize_data_arrays(unsigned int tally_points) {
@@ -80,6 +88,7 @@ void TallyData::resize_data_arrays(unsigned int tally_points) {
   tally_data.resize(new_size, 0);
   error_data.resize(new_size, 0);
   temp_tally_data.resize(new_size, 0);
+  history_markers.resize(num_tally_points, 0);
 }
 //---------------------------------------------------------------------------//
 unsigned int TallyData::get_num_energy_bins() const {
@@ -90,18 +99,102 @@ bool TallyData::has_total_energy_bin() const {
   return total_energy_bin;
 }
 //---------------------------------------------------------------------------//
+void TallyData::get_results(double num_histories, const double* volumes,
+                            std::vector<double>& results,
+                            std::vector<double>& rel_errors,
+                            std::vector<double>& total_results,
+                            std::vector<double>& total_errors) const {
+  unsigned int num_bins = num_energy_bins - total_energy_bin;
+  double inv_histories = 1.0 / num_histories;
+
+  results.resize(num_tally_points * num_bins);
+  rel_errors.resize(num_tally_points * num_bins);
+  total_results.resize(total_energy_bin ? num_tally_points : 0);
+  total_errors.resize(total_energy_bin ? num_tally_points : 0);
+
+  for (unsigned int i = 0; i < num_tally_points; ++i) {
+    double norm = volumes ? inv_histories / volumes[i] : inv_histories;
+    const double* tally = &tally_data[i * num_energy_bins];
+    const double* error = &error_data[i * num_energy_bins];
+    double* result = &results[i * num_bins];
+    double* rel_error = &rel_errors[i * num_bins];
+
+    for (unsigned int j = 0; j < num_bins; ++j) {
+      result[j] = tally[j] * norm;
+
+      // use 0 as the relative error if nothing has been scored, which is
+      // MCNP's approach to avoiding a divide-by-zero
+      rel_error[j] = (error[j] != 0.0) ?
+                     sqrt(error[j] / (tally[j] * tally[j]) - inv_histories) :
+                     0.0;
+    }
+
+    if (total_energy_bin) {
+      double total = tally[num_bins];
+      double total_error = error[num_bins];
+      total_results[i] = total * norm;
+      total_errors[i] = (total_error != 0.0) ?
+                        sqrt(total_error / (total * total) - inv_histories) :
+                        0.0;
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+double TallyData::get_max_rel_error(double num_histories) const {
+  double inv_histories = 1.0 / num_histories;
+  double max_rel_error = 0.0;
+
+  for (unsigned int i = 0; i < tally_data.size(); ++i) {
+    if (error_data[i] == 0.0)
+      continue;
+
+    double r2 = error_data[i] / (tally_data[i] * tally_data[i]) - inv_histories;
+    max_rel_error = std::max(max_rel_error, r2 > 0.0 ? sqrt(r2) : 0.0);
+  }
+
+  return max_rel_error;
+}
+//---------------------------------------------------------------------------//
+void TallyData::set_monitor_bin(unsigned int tally_point_index,
+                                unsigned int energy_bin) {
+  assert(tally_point_index < num_tally_points);
+  assert(energy_bin < num_energy_bins);
+
+  monitor_index = tally_point_index * num_energy_bins + energy_bin;
+  monitor_sum3 = 0.0;
+  monitor_sum4 = 0.0;
+}
+//---------------------------------------------------------------------------//
+void TallyData::get_monitor_sums(double sums[4]) const {
+  std::fill(sums, sums + 4, 0.0);
+
+  if (monitor_index < 0)
+    return;
+
+  sums[0] = tally_data[monitor_index];
+  sums[1] = error_data[monitor_index];
+  sums[2] = monitor_sum3;
+  sums[3] = monitor_sum4;
+}
+//---------------------------------------------------------------------------//
 // TALLY ACTION METHODS
 //---------------------------------------------------------------------------//
 void TallyData::end_history() {
-  std::set<unsigned int>::iterator it;
+  std::vector<unsigned int>::const_iterator it;
+
+  // add the higher powers of the monitored bin if it was scored
+  if (monitor_index >= 0 &&
+      history_markers[monitor_index / num_energy_bins] == history_epoch) {
+    add_monitor_score(temp_tally_data[monitor_index]);
+  }
 
   // add sum of scores for this history to mesh tally for each tally point
   for (it = visited_this_history.begin(); it != visited_this_history.end(); ++it) {
     for (unsigned int j = 0; j < num_energy_bins; ++j) {
       int index = (*it) * num_energy_bins + j;
-      double& history_score = temp_tally_data.at(index);
-      double& tally         = tally_data.at(index);
-      double& error         = error_data.at(index);
+      double& history_score = temp_tally_data[index];
+      double& tally         = tally_data[index];
+      double& error         = error_data[index];
 
       tally += history_score;
       error += history_score * history_score;
@@ -111,8 +204,15 @@ void TallyData::end_history() {
     }
   }
 
-  // reset set of tally points for next particle history
+  // reset list of tally points for next particle history
   visited_this_history.clear();
+  ++history_epoch;
+
+  // reset markers if the epoch wraps around so that none match it
+  if (history_epoch == 0) {
+    std::fill(history_markers.begin(), history_markers.end(), 0);
+    history_epoch = 1;
+  }
 }
 //---------------------------------------------------------------------------//
 void TallyData::add_score_to_tally(unsigned int tally_point_index,
@@ -122,16 +222,77 @@ void TallyData::add_score_to_tally(unsigned int tally_point_index,
   assert(energy_bin < num_energy_bins);
 
   // update tally for this history with new score
-  int index = tally_point_index * num_energy_bins + energy_bin;;
-  temp_tally_data.at(index) += score;
+  int index = tally_point_index * num_energy_bins + energy_bin;
+  temp_tally_data[index] += score;
 
   // also update total energy bin tally for this history if one exists
   if (total_energy_bin) {
     index = tally_point_index * num_energy_bins + num_energy_bins - 1;
-    temp_tally_data.at(index) += score;
+    temp_tally_data[index] += score;
   }
 
-  visited_this_history.insert(tally_point_index);
+  // add tally point to the list the first time it is scored this history
+  if (history_markers[tally_point_index] != history_epoch) {
+    history_markers[tally_point_index] = history_epoch;
+    visited_this_history.push_back(tally_point_index);
+  }
+}
+//---------------------------------------------------------------------------//
+// THREADED TALLY METHODS
+//---------------------------------------------------------------------------//
+TallyData* TallyData::create_scratch_data() const {
+  TallyData* scratch = new TallyData(1, false);
+  scratch->num_energy_bins = num_energy_bins;
+  scratch->total_energy_bin = total_energy_bin;
+  scratch->num_tally_points = num_tally_points;
+
+  // only the data arrays for a single history are needed
+  scratch->temp_tally_data.resize(temp_tally_data.size(), 0);
+  scratch->history_markers.resize(num_tally_points, 0);
+
+  return scratch;
+}
+//---------------------------------------------------------------------------//
+void TallyData::end_history(std::vector<unsigned int>& indices,
+                            std::vector<double>& scores) {
+  std::vector<unsigned int>::const_iterator it;
+
+  // move sum of scores for this history out for each tally point
+  for (it = visited_this_history.begin(); it != visited_this_history.end(); ++it) {
+    for (unsigned int j = 0; j < num_energy_bins; ++j) {
+      unsigned int index = (*it) * num_energy_bins + j;
+      indices.push_back(index);
+      scores.push_back(temp_tally_data[index]);
+
+      // reset temp_tally_data array for the next particle history
+      temp_tally_data[index] = 0;
+    }
+  }
+
+  // reset list of tally points for next particle history
+  visited_this_history.clear();
+  ++history_epoch;
+
+  // reset markers if the epoch wraps around so that none match it
+  if (history_epoch == 0) {
+    std::fill(history_markers.begin(), history_markers.end(), 0);
+    history_epoch = 1;
+  }
+}
+//---------------------------------------------------------------------------//
+void TallyData::add_history_scores(const unsigned int* indices,
+                                   const double* scores,
+                                   unsigned int num_scores) {
+  for (unsigned int i = 0; i < num_scores; ++i) {
+    assert(indices[i] < tally_data.size());
+    double history_score = scores[i];
+
+    tally_data[indices[i]] += history_score;
+    error_data[indices[i]] += history_score * history_score;
+
+    if ((int)indices[i] == monitor_index)
+      add_monitor_score(history_score);
+  }
 }
 //---------------------------------------------------------------------------//
 
@@ -4,7 +4,6 @@
 #define DAGMC_TALLY_DATA_HPP
 
 #include <vector>
-#include <set>
 #include <utility>
 
 /**
@@ -102,6 +101,59 @@ class TallyData {
    */
   bool has_total_energy_bin() const;
 
+  /**
+   * \brief Computes normalized results and relative errors for all tally points
+   * \param[in] num_histories the number of particle histories tracked
+   * \param[in] volumes the volume of each tally point, or NULL if the results
+   *            are only normalized by the number of histories
+   * \param[out] results the normalized results for each energy bin
+   * \param[out] rel_errors the relative errors for each energy bin
+   * \param[out] total_results the normalized results for the total energy bin
+   * \param[out] total_errors the relative errors for the total energy bin
+   *
+   * Results for each energy bin other than the total are ordered first by
+   * tally point and then by energy bin, so they can be set directly as the
+   * values of a vector tag.  The total energy bin has one value for each
+   * tally point, and total_results and total_errors are left empty if this
+   * TallyData has no total energy bin.  The relative error is zero for any
+   * tally point and energy bin without scores.
+   */
+  void get_results(double num_histories, const double* volumes,
+                   std::vector<double>& results,
+                   std::vector<double>& rel_errors,
+                   std::vector<double>& total_results,
+                   std::vector<double>& total_errors) const;
+
+  /**
+   * \brief Finds the largest relative error over all scored bins
+   * \param[in] num_histories the number of particle histories tracked
+   * \return the largest relative error, or zero if nothing has been scored
+   *
+   * Includes every tally point and energy bin, including the total energy
+   * bin.  Bins without scores are ignored.
+   */
+  double get_max_rel_error(double num_histories) const;
+
+  /**
+   * \brief Sets the tally point and energy bin whose moments are kept
+   * \param[in] tally_point_index the index representing the tally point
+   * \param[in] energy_bin the index representing the energy bin
+   *
+   * The sums of the cubes and fourth powers of the history scores are kept
+   * for this bin, along with the sums and sums of squares that are kept for
+   * all bins.  They are used to monitor the convergence of the tally, so
+   * the bin should be set before any histories are added.
+   */
+  void set_monitor_bin(unsigned int tally_point_index, unsigned int energy_bin);
+
+  /**
+   * \brief Gets the sums of the history scores for the monitored bin
+   * \param[out] sums the sums of the history scores to the powers 1 to 4
+   *
+   * All sums are zero if no bin is monitored.
+   */
+  void get_monitor_sums(double sums[4]) const;
+
   // >>> TALLY ACTION METHODS
 
   /**
@@ -117,6 +169,45 @@ class TallyData {
    */
   void add_score_to_tally(unsigned int tally_point_index, double score, unsigned int ebin);
 
+  // >>> THREADED TALLY METHODS
+
+  /**
+   * \brief Creates an empty TallyData for scoring one history at a time
+   * \return pointer to the new TallyData
+   *
+   * The new TallyData has the same energy bins and number of tally points as
+   * this one, but only stores the sum of scores for a single history.  It is
+   * used as the scratch data of a TallyContext, and must be ended with
+   * end_history(indices, scores) rather than end_history().  The caller is
+   * responsible for deleting it.
+   */
+  TallyData* create_scratch_data() const;
+
+  /**
+   * \brief Moves the scores for a completed history out of this TallyData
+   * \param[out] indices the data array indices that were scored are appended
+   * \param[out] scores the sum of scores for each index is appended
+   *
+   * Resets the scratch data for the next history like end_history(), but
+   * the scores are appended to indices and scores instead of being added to
+   * the tally and error data.
+   */
+  void end_history(std::vector<unsigned int>& indices,
+                   std::vector<double>& scores);
+
+  /**
+   * \brief Adds the scores for a completed history to the tally and error data
+   * \param[in] indices the data array indices that were scored
+   * \param[in] scores the sum of scores for each index
+   * \param[in] num_scores the number of indices and scores
+   *
+   * Gives the same tally and error data as if the scores had been added with
+   * add_score_to_tally() and then end_history() had been called.
+   */
+  void add_history_scores(const unsigned int* indices,
+                          const double* scores,
+                          unsigned int num_scores);
+
  private:
   // Data array for storing sum of scores for all particle histories
   std::vector<double> tally_data;
@@ -127,8 +218,16 @@ class TallyData {
   // Data array for storing sum of scores for a single history
   std::vector<double> temp_tally_data;
 
-  // tally points updated in current history; cleared by end_history()
-  std::set<unsigned int> visited_this_history;
+  // tally points updated in current history, in the order they were first
+  // scored; cleared by end_history()
+  std::vector<unsigned int> visited_this_history;
+
+  // Epoch of the last history in which each tally point was scored, used to
+  // add each tally point to visited_this_history only once
+  std::vector<unsigned int> history_markers;
+
+  // Epoch of the current history; incremented by end_history()
+  unsigned int history_epoch;
 
   // Number of energy bins implemented in the data arrays
   unsigned int num_energy_bins;
@@ -138,6 +237,24 @@ class TallyData {
 
   // Number of tally points = tally_data.size()/num_energy_bins
   unsigned int num_tally_points;
+
+  // Data array index of the monitored bin, or -1 if no bin is monitored,
+  // and the sums of the cubes and fourth powers of its history scores
+  int monitor_index;
+  double monitor_sum3;
+  double monitor_sum4;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Adds the higher powers of a history score for the monitored bin
+   * \param[in] history_score the sum of scores in the bin for one history
+   */
+  void add_monitor_score(double history_score) {
+    double square = history_score * history_score;
+    monitor_sum3 += square * history_score;
+    monitor_sum4 += square * square;
+  }
 };
 
 #endif // DAGMC_TALLY_DATA_HPP
@@ -0,0 +1,120 @@
+// MCNP5/dagmc/TallyEventQueue.cpp
+
+#include <cstdlib>
+#include <iostream>
+
+#include "TallyEventQueue.hpp"
+
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+TallyEventQueue::TallyEventQueue(unsigned int capacity,
+                                 unsigned int num_multipliers)
+  : num_entries(0), num_queued_events(0), max_entries(capacity),
+    num_multipliers(num_multipliers),
+    types(capacity), particles(capacity), cells(capacity),
+    x(capacity), y(capacity), z(capacity),
+    u(capacity), v(capacity), w(capacity),
+    energies(capacity), weights(capacity),
+    track_lengths(capacity), cross_sections(capacity),
+    multipliers(capacity * num_multipliers) {
+  if (capacity == 0) {
+    std::cerr << "\nError: TallyEventQueue must have a capacity of at "
+              << "least one entry" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+//---------------------------------------------------------------------------//
+// PUBLIC INTERFACE
+//---------------------------------------------------------------------------//
+void TallyEventQueue::push_event(const TallyEvent& event) {
+  check_space();
+
+  if (event.type == TallyEvent::NONE) {
+    std::cerr << "\nError: Cannot queue a tally event of type NONE"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (event.multipliers.size() != num_multipliers) {
+    std::cerr << "\nError: TallyEventQueue expects " << num_multipliers
+              << " multipliers per event, but the event has "
+              << event.multipliers.size() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned int i = num_entries;
+  types[i]          = event.type;
+  particles[i]      = event.particle;
+  cells[i]          = event.current_cell;
+  x[i]              = event.position[0];
+  y[i]              = event.position[1];
+  z[i]              = event.position[2];
+  u[i]              = event.direction[0];
+  v[i]              = event.direction[1];
+  w[i]              = event.direction[2];
+  energies[i]       = event.particle_energy;
+  weights[i]        = event.particle_weight;
+  track_lengths[i]  = event.track_length;
+  cross_sections[i] = event.total_cross_section;
+
+  for (unsigned int j = 0; j < num_multipliers; ++j) {
+    multipliers[i * num_multipliers + j] = event.multipliers[j];
+  }
+
+  ++num_entries;
+  ++num_queued_events;
+}
+//---------------------------------------------------------------------------//
+void TallyEventQueue::push_end_history() {
+  check_space();
+
+  // only the type is read for the end of a history
+  types[num_entries] = TallyEvent::NONE;
+  ++num_entries;
+}
+//---------------------------------------------------------------------------//
+void TallyEventQueue::get_event(unsigned int index, TallyEvent& event) const {
+  event.type                = types[index];
+  event.particle            = particles[index];
+  event.current_cell        = cells[index];
+  event.position            = moab::CartVect(x[index], y[index], z[index]);
+  event.direction           = moab::CartVect(u[index], v[index], w[index]);
+  event.particle_energy     = energies[index];
+  event.particle_weight     = weights[index];
+  event.track_length        = track_lengths[index];
+  event.total_cross_section = cross_sections[index];
+
+  std::vector<double>::const_iterator first = multipliers.begin() +
+                                              index * num_multipliers;
+  event.multipliers.assign(first, first + num_multipliers);
+}
+//---------------------------------------------------------------------------//
+void TallyEventQueue::clear() {
+  num_entries = 0;
+  num_queued_events = 0;
+}
+//---------------------------------------------------------------------------//
+void TallyEventQueue::set_num_multipliers(unsigned int num_multipliers) {
+  if (!empty()) {
+    std::cerr << "\nError: Cannot change the number of multipliers in a "
+              << "TallyEventQueue that is not empty" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  this->num_multipliers = num_multipliers;
+  multipliers.resize(max_entries * num_multipliers);
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+void TallyEventQueue::check_space() const {
+  if (full()) {
+    std::cerr << "\nError: Cannot add to a full TallyEventQueue of "
+              << max_entries << " entries" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/TallyEventQueue.cpp
@@ -0,0 +1,158 @@
+// MCNP5/dagmc/TallyEventQueue.hpp
+
+#ifndef DAGMC_TALLY_EVENT_QUEUE_HPP
+#define DAGMC_TALLY_EVENT_QUEUE_HPP
+
+#include <vector>
+
+#include "TallyEvent.hpp"
+
+//===========================================================================//
+/**
+ * \class TallyEventQueue
+ * \brief Stores a fixed number of tally events for scoring at a later time
+ *
+ * TallyEventQueue stores the data for each event in a separate array for
+ * each TallyEvent member, so that tallies can check the particle, type and
+ * energy of all queued events without reading the rest of the event data.
+ * The ends of particle histories are stored in the queue along with the
+ * events, as entries with an event type of TallyEvent::NONE.  All tallies
+ * scored from a queue will therefore end their histories between the same
+ * events as they would have if each event was scored when it was set.
+ *
+ * The multiplier values at the time each event was queued are also stored.
+ * The number of multipliers can only be changed while the queue is empty.
+ *
+ * The memory for a TallyEventQueue is allocated once when it is created.
+ * It is an error to add an entry to a full queue.
+ */
+//===========================================================================//
+class TallyEventQueue {
+ public:
+  /**
+   * \brief Constructor
+   * \param[in] capacity the maximum number of entries in the queue
+   * \param[in] num_multipliers the number of multipliers stored per event
+   */
+  explicit TallyEventQueue(unsigned int capacity,
+                           unsigned int num_multipliers = 0);
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief Adds a copy of a tally event to the end of the queue
+   * \param[in] event the event to be added, which must not be of type NONE
+   */
+  void push_event(const TallyEvent& event);
+
+  /**
+   * \brief Adds the end of a particle history to the end of the queue
+   */
+  void push_end_history();
+
+  /**
+   * \brief Gets a copy of a queued event
+   * \param[in] index the index of the entry in the queue
+   * \param[out] event the event to be set
+   *
+   * Reuses the memory allocated for the multipliers of the event.
+   */
+  void get_event(unsigned int index, TallyEvent& event) const;
+
+  /**
+   * \brief Removes all entries from the queue
+   */
+  void clear();
+
+  /**
+   * \brief Sets the number of multipliers stored per event
+   * \param[in] num_multipliers the number of multipliers
+   *
+   * The queue must be empty.
+   */
+  void set_num_multipliers(unsigned int num_multipliers);
+
+  // >>> ACCESS METHODS
+
+  /**
+   * \brief get_type(), get_particle(), get_energy()
+   * \param[in] index the index of the entry in the queue
+   * \return the event data for that entry
+   *
+   * An entry of type NONE is the end of a particle history.
+   */
+  TallyEvent::EventType get_type(unsigned int index) const {
+    return types[index];
+  }
+
+  unsigned int get_particle(unsigned int index) const {
+    return particles[index];
+  }
+
+  double get_energy(unsigned int index) const {
+    return energies[index];
+  }
+
+  /**
+   * \brief size(), num_events(), capacity()
+   * \return number of entries, number of events and the maximum number of
+   *         entries in the queue
+   */
+  unsigned int size() const {
+    return num_entries;
+  }
+
+  unsigned int num_events() const {
+    return num_queued_events;
+  }
+
+  unsigned int capacity() const {
+    return max_entries;
+  }
+
+  /**
+   * \brief empty(), full()
+   * \return true if the queue has no entries or no space for more entries
+   */
+  bool empty() const {
+    return num_entries == 0;
+  }
+
+  bool full() const {
+    return num_entries == max_entries;
+  }
+
+ private:
+  // Number of entries and events in the queue and its capacity
+  unsigned int num_entries;
+  unsigned int num_queued_events;
+  unsigned int max_entries;
+
+  // Number of multipliers stored per event
+  unsigned int num_multipliers;
+
+  // Event data, with one value per entry
+  std::vector<TallyEvent::EventType> types;
+  std::vector<unsigned int> particles;
+  std::vector<int> cells;
+  std::vector<double> x, y, z;
+  std::vector<double> u, v, w;
+  std::vector<double> energies;
+  std::vector<double> weights;
+  std::vector<double> track_lengths;
+  std::vector<double> cross_sections;
+
+  // Multipliers for entry i start at multipliers[i * num_multipliers]
+  std::vector<double> multipliers;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Checks that there is space for another entry in the queue
+   */
+  void check_space() const;
+};
+
+#endif // DAGMC_TALLY_EVENT_QUEUE_HPP
+
+// end of MCNP5/dagmc/TallyEventQueue.hpp
@@ -0,0 +1,301 @@
+// MCNP5/dagmc/TallyEventReader.cpp
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+#include <stdint.h>
+
+#include "TallyEventReader.hpp"
+#include "TallyEventRecorder.hpp"
+#include "TallyManager.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+namespace {
+// number of bytes read from the file at a time
+const unsigned long BUFFER_BYTES = 1 << 16;
+
+// longest string accepted when reading an event stream
+const uint32_t MAX_STRING_LENGTH = 1 << 20;
+
+// true if a record type defines tallies or multipliers or sets a multiplier
+bool is_definition(char type) {
+  return type == TallyEventRecorder::TALLY ||
+         type == TallyEventRecorder::REMOVE_TALLY ||
+         type == TallyEventRecorder::NUM_MULTIPLIERS ||
+         type == TallyEventRecorder::TALLY_MULTIPLIER ||
+         type == TallyEventRecorder::MULTIPLIER;
+}
+} // namespace
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+TallyEventReader::TallyEventReader(const std::string& filename)
+  : file(filename.c_str(), std::ios::in | std::ios::binary),
+    position(0), valid(false), num_events(0), num_histories(0) {
+  if (!file) {
+    std::cerr << "Warning: cannot open tally event stream " << filename
+              << "." << std::endl;
+    return;
+  }
+
+  char magic[sizeof(TallyEventRecorder::MAGIC)];
+  uint32_t version = 0;
+  uint32_t byte_order = 0;
+
+  bool complete = read(magic, sizeof(magic)) && get(version) &&
+                  get(byte_order);
+
+  if (!complete ||
+      memcmp(magic, TallyEventRecorder::MAGIC, sizeof(magic)) != 0) {
+    std::cerr << "Warning: " << filename << " is not a tally event stream."
+              << std::endl;
+  } else if (byte_order != TallyEventRecorder::BYTE_ORDER_MARK) {
+    std::cerr << "Warning: tally event stream " << filename
+              << " was written with a different byte order." << std::endl;
+  } else if (version != TallyEventRecorder::VERSION) {
+    std::cerr << "Warning: format version of tally event stream " << filename
+              << " is not supported." << std::endl;
+  } else {
+    valid = true;
+  }
+}
+//---------------------------------------------------------------------------//
+// PUBLIC INTERFACE
+//---------------------------------------------------------------------------//
+bool TallyEventReader::is_valid() const {
+  return valid;
+}
+//---------------------------------------------------------------------------//
+bool TallyEventReader::replay(TallyManager& manager) {
+  return replay_records(manager, false);
+}
+//---------------------------------------------------------------------------//
+bool TallyEventReader::replay_definitions(TallyManager& manager) {
+  return replay_records(manager, true);
+}
+//---------------------------------------------------------------------------//
+bool TallyEventReader::preload() {
+  if (!valid)
+    return false;
+
+  // find the number of bytes that have not been read from the file
+  file.clear();
+  std::streampos current = file.tellg();
+  file.seekg(0, std::ios::end);
+  std::streamoff remaining = file.tellg() - current;
+  file.seekg(current);
+
+  if (!file || remaining < 0) {
+    std::cerr << "Warning: cannot read the tally event stream." << std::endl;
+    return false;
+  }
+
+  // keep the unread bytes of the buffer before the rest of the file
+  buffer.erase(buffer.begin(), buffer.begin() + position);
+  position = 0;
+
+  unsigned long unread = buffer.size();
+  buffer.resize(unread + remaining);
+  file.read(buffer.data() + unread, remaining);
+  buffer.resize(unread + file.gcount());
+
+  return file.gcount() == remaining;
+}
+//---------------------------------------------------------------------------//
+unsigned long TallyEventReader::get_num_events() const {
+  return num_events;
+}
+//---------------------------------------------------------------------------//
+unsigned long TallyEventReader::get_num_histories() const {
+  return num_histories;
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+bool TallyEventReader::fill_buffer() {
+  if (position < buffer.size())
+    return true;
+
+  buffer.resize(BUFFER_BYTES);
+  file.read(buffer.data(), BUFFER_BYTES);
+  buffer.resize(file.gcount());
+  position = 0;
+
+  return !buffer.empty();
+}
+//---------------------------------------------------------------------------//
+bool TallyEventReader::replay_records(TallyManager& manager,
+                                      bool definitions_only) {
+  if (!valid)
+    return false;
+
+  // the type of the next record is only read if it will be replayed
+  while (fill_buffer()) {
+    char type = buffer[position];
+
+    if (definitions_only && !is_definition(type))
+      return true;
+
+    ++position;
+
+    if (!replay_record(type, manager)) {
+      std::cerr << "Warning: tally event stream ends with an incomplete or "
+                << "unknown record; replayed " << num_events << " events in "
+                << num_histories << " histories." << std::endl;
+      valid = false;
+      return false;
+    }
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------//
+bool TallyEventReader::read(void* bytes, unsigned long num_bytes) {
+  char* next = static_cast<char*>(bytes);
+
+  while (num_bytes > 0) {
+    // refill the buffer once all of it has been read
+    if (!fill_buffer())
+      return false;
+
+    unsigned long count = std::min(num_bytes, buffer.size() - position);
+    memcpy(next, &buffer[position], count);
+    position += count;
+    next += count;
+    num_bytes -= count;
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------//
+bool TallyEventReader::get_string(std::string& value) {
+  uint32_t length = 0;
+
+  if (!get(length) || length > MAX_STRING_LENGTH)
+    return false;
+
+  value.resize(length);
+  return length == 0 || read(&value[0], length);
+}
+//---------------------------------------------------------------------------//
+bool TallyEventReader::replay_record(char type, TallyManager& manager) {
+  uint32_t particle = 0, id = 0, tally_id = 0;
+  int32_t cell_id = 0;
+  double values[9];
+
+  switch (type) {
+    case TallyEventRecorder::TALLY: {
+      int32_t multiplier_id = -1;
+      uint32_t num_bounds = 0, num_options = 0;
+      std::string tally_type;
+
+      if (!get(tally_id) || !get(particle) || !get(multiplier_id) ||
+          !get_string(tally_type) || !get(num_bounds) ||
+          num_bounds > MAX_STRING_LENGTH) {
+        return false;
+      }
+
+      std::vector<double> energy_bin_bounds(num_bounds);
+
+      if (num_bounds > 0 &&
+          !read(energy_bin_bounds.data(), num_bounds * sizeof(double))) {
+        return false;
+      }
+
+      if (!get(num_options))
+        return false;
+
+      std::multimap<std::string, std::string> options;
+
+      for (uint32_t i = 0; i < num_options; ++i) {
+        std::string key, value;
+
+        if (!get_string(key) || !get_string(value))
+          return false;
+
+        options.insert(std::make_pair(key, value));
+      }
+
+      manager.addNewTally(tally_id, tally_type, particle,
+                          energy_bin_bounds, options);
+
+      if (multiplier_id >= 0)
+        manager.addMultiplierToTally(multiplier_id, tally_id);
+
+      return true;
+    }
+
+    case TallyEventRecorder::REMOVE_TALLY:
+      if (!get(tally_id))
+        return false;
+
+      manager.removeTally(tally_id);
+      return true;
+
+    case TallyEventRecorder::NUM_MULTIPLIERS:
+      if (!get(id))
+        return false;
+
+      // multipliers are added up to the largest id
+      if (id > 0)
+        manager.addNewMultiplier(id - 1);
+
+      return true;
+
+    case TallyEventRecorder::TALLY_MULTIPLIER:
+      if (!get(id) || !get(tally_id))
+        return false;
+
+      manager.addMultiplierToTally(id, tally_id);
+      return true;
+
+    case TallyEventRecorder::MULTIPLIER:
+      if (!get(id) || !get(values[0]))
+        return false;
+
+      manager.updateMultiplier(id, values[0]);
+      return true;
+
+    case TallyEventRecorder::COLLISION:
+      if (!get(particle) || !read(values, 6 * sizeof(double)) ||
+          !get(cell_id)) {
+        return false;
+      }
+
+      manager.setCollisionEvent(particle, values[0], values[1], values[2],
+                                values[3], values[4], values[5], cell_id);
+      ++num_events;
+      return true;
+
+    case TallyEventRecorder::TRACK:
+      if (!get(particle) || !read(values, 9 * sizeof(double)) ||
+          !get(cell_id)) {
+        return false;
+      }
+
+      manager.setTrackEvent(particle, values[0], values[1], values[2],
+                            values[3], values[4], values[5],
+                            values[6], values[7], values[8], cell_id);
+      ++num_events;
+      return true;
+
+    case TallyEventRecorder::UPDATE:
+      manager.updateTallies();
+      return true;
+
+    case TallyEventRecorder::END_HISTORY:
+      manager.endHistory();
+      ++num_histories;
+      return true;
+
+    default:
+      return false;
+  }
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/TallyEventReader.cpp
@@ -0,0 +1,158 @@
+// MCNP5/dagmc/TallyEventReader.hpp
+
+#ifndef DAGMC_TALLY_EVENT_READER_HPP
+#define DAGMC_TALLY_EVENT_READER_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+class TallyManager;
+
+//===========================================================================//
+/**
+ * \class TallyEventReader
+ * \brief Replays a binary event stream written by a TallyEventRecorder
+ *
+ * TallyEventReader reads the records of an event stream in order and makes
+ * the same calls to a TallyManager that were recorded, which adds the same
+ * tallies and gives the same tally results as the original run.  Tallies
+ * that read an input mesh, such as mesh tallies, must be able to find it
+ * from the directory in which the stream is replayed.
+ *
+ * The stream is read in large blocks while it is being replayed, so streams
+ * that are larger than the available memory can be replayed.  To time the
+ * scoring of the events without reading the file or adding the tallies,
+ * call replay_definitions() and preload() before replay().
+ */
+//===========================================================================//
+class TallyEventReader {
+ public:
+  /**
+   * \brief Constructor
+   * \param[in] filename the name of the event stream to read
+   *
+   * Reads the header of the stream.  Use is_valid() to check if it can be
+   * replayed.
+   */
+  explicit TallyEventReader(const std::string& filename);
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief is_valid()
+   * \return true if the file is an event stream that can be replayed
+   */
+  bool is_valid() const;
+
+  /**
+   * \brief Replays all remaining records of the event stream
+   * \param[in, out] manager the TallyManager to make the recorded calls to
+   * \return true if the whole stream was replayed; false otherwise
+   *
+   * If the stream ends part way through a record, or has a record of an
+   * unknown type, then all records before it are replayed and a warning is
+   * written.
+   */
+  bool replay(TallyManager& manager);
+
+  /**
+   * \brief Replays the tally and multiplier definitions at the start
+   * \param[in, out] manager the TallyManager to make the recorded calls to
+   * \return true if the definitions were replayed; false otherwise
+   *
+   * Replays the tallies, multipliers and multiplier values that are
+   * recorded before the first event, update or end of history, which is
+   * left for replay().  Definitions made after it are replayed in order by
+   * replay().
+   */
+  bool replay_definitions(TallyManager& manager);
+
+  /**
+   * \brief Reads all remaining records of the event stream into memory
+   * \return true if the records were read; false otherwise
+   *
+   * replay() then does not read from the file.
+   */
+  bool preload();
+
+  /**
+   * \brief get_num_events(), get_num_histories()
+   * \return the number of events and histories that have been replayed
+   */
+  unsigned long get_num_events() const;
+  unsigned long get_num_histories() const;
+
+ private:
+  /// Copy constructor and operator= methods are not implemented
+  TallyEventReader(const TallyEventReader& obj);
+  TallyEventReader& operator=(const TallyEventReader& obj);
+
+  // File that the event stream is read from
+  std::ifstream file;
+
+  // Bytes read from the file and the position of the next unread byte
+  std::vector<char> buffer;
+  unsigned long position;
+
+  // True if the header of the event stream is valid
+  bool valid;
+
+  // Number of events and histories that have been replayed
+  unsigned long num_events;
+  unsigned long num_histories;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Reads the next block of the file once the buffer has been read
+   * \return true if there are unread bytes; false if the stream has ended
+   */
+  bool fill_buffer();
+
+  /**
+   * \brief Replays records until the stream ends
+   * \param[in, out] manager the TallyManager to make the recorded calls to
+   * \param[in] definitions_only if true, stops before the first event,
+   *            update or end of history
+   * \return true if all of the records were replayed; false otherwise
+   */
+  bool replay_records(TallyManager& manager, bool definitions_only);
+
+  /**
+   * \brief Reads bytes from the event stream
+   * \param[out] bytes the bytes that were read
+   * \param[in] num_bytes the number of bytes to read
+   * \return true if all bytes were read; false if the stream ended first
+   */
+  bool read(void* bytes, unsigned long num_bytes);
+
+  /**
+   * \brief Reads a value from the event stream
+   * \param[out] value the value that was read
+   * \return true if the value was read; false if the stream ended first
+   */
+  template <typename T>
+  bool get(T& value) {
+    return read(&value, sizeof(T));
+  }
+
+  /**
+   * \brief Reads a string from the event stream
+   * \param[out] value the string that was read
+   * \return true if the string was read; false otherwise
+   */
+  bool get_string(std::string& value);
+
+  /**
+   * \brief Replays the record that follows a record type
+   * \param[in] type the type of the record
+   * \param[in, out] manager the TallyManager to make the recorded call to
+   * \return true if the record was replayed; false otherwise
+   */
+  bool replay_record(char type, TallyManager& manager);
+};
+
+#endif // DAGMC_TALLY_EVENT_READER_HPP
+
+// end of MCNP5/dagmc/TallyEventReader.hpp
@@ -0,0 +1,161 @@
+// MCNP5/dagmc/TallyEventRecorder.cpp
+
+#include "TallyEventRecorder.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+namespace {
+// number of buffered bytes at which records are written to the file
+const unsigned long BUFFER_BYTES = 1 << 16;
+} // namespace
+//---------------------------------------------------------------------------//
+// STATIC MEMBERS
+//---------------------------------------------------------------------------//
+const char TallyEventRecorder::MAGIC[8] = {'D', 'A', 'G', 'E', 'V', 'E', 'N', 'T'};
+const uint32_t TallyEventRecorder::VERSION;
+const uint32_t TallyEventRecorder::BYTE_ORDER_MARK;
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+TallyEventRecorder::TallyEventRecorder(const std::string& filename)
+  : file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc) {
+  buffer.reserve(2 * BUFFER_BYTES);
+  buffer.insert(buffer.end(), MAGIC, MAGIC + sizeof(MAGIC));
+  put(VERSION);
+  put(BYTE_ORDER_MARK);
+}
+//---------------------------------------------------------------------------//
+// DESTRUCTOR
+//---------------------------------------------------------------------------//
+TallyEventRecorder::~TallyEventRecorder() {
+  close();
+}
+//---------------------------------------------------------------------------//
+// PUBLIC INTERFACE
+//---------------------------------------------------------------------------//
+bool TallyEventRecorder::is_open() const {
+  return file.is_open() && file.good();
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::record_tally(const TallyInput& input) {
+  begin_record(TALLY);
+  put<uint32_t>(input.tally_id);
+  put<uint32_t>(input.particle);
+  put<int32_t>(input.multiplier_id);
+  put_string(input.tally_type);
+
+  put<uint32_t>(input.energy_bin_bounds.size());
+  for (unsigned int i = 0; i < input.energy_bin_bounds.size(); ++i) {
+    put(input.energy_bin_bounds[i]);
+  }
+
+  put<uint32_t>(input.options.size());
+  TallyInput::TallyOptions::const_iterator it;
+  for (it = input.options.begin(); it != input.options.end(); ++it) {
+    put_string(it->first);
+    put_string(it->second);
+  }
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::record_remove_tally(unsigned int tally_id) {
+  begin_record(REMOVE_TALLY);
+  put<uint32_t>(tally_id);
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::record_num_multipliers(unsigned int num_multipliers) {
+  begin_record(NUM_MULTIPLIERS);
+  put<uint32_t>(num_multipliers);
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::record_tally_multiplier(unsigned int multiplier_id,
+                                                 unsigned int tally_id) {
+  begin_record(TALLY_MULTIPLIER);
+  put<uint32_t>(multiplier_id);
+  put<uint32_t>(tally_id);
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::record_multiplier(unsigned int multiplier_id,
+                                           double value) {
+  begin_record(MULTIPLIER);
+  put<uint32_t>(multiplier_id);
+  put(value);
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::record_collision(unsigned int particle,
+                                          double x, double y, double z,
+                                          double particle_energy,
+                                          double particle_weight,
+                                          double total_cross_section,
+                                          int cell_id) {
+  begin_record(COLLISION);
+  put<uint32_t>(particle);
+  put(x);
+  put(y);
+  put(z);
+  put(particle_energy);
+  put(particle_weight);
+  put(total_cross_section);
+  put<int32_t>(cell_id);
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::record_track(unsigned int particle,
+                                      double x, double y, double z,
+                                      double u, double v, double w,
+                                      double particle_energy,
+                                      double particle_weight,
+                                      double track_length, int cell_id) {
+  begin_record(TRACK);
+  put<uint32_t>(particle);
+  put(x);
+  put(y);
+  put(z);
+  put(u);
+  put(v);
+  put(w);
+  put(particle_energy);
+  put(particle_weight);
+  put(track_length);
+  put<int32_t>(cell_id);
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::record_update() {
+  begin_record(UPDATE);
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::record_end_history() {
+  begin_record(END_HISTORY);
+}
+//---------------------------------------------------------------------------//
+bool TallyEventRecorder::close() {
+  if (!file.is_open())
+    return false;
+
+  flush();
+  file.close();
+  return !file.fail();
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::put_string(const std::string& value) {
+  put<uint32_t>(value.size());
+  buffer.insert(buffer.end(), value.begin(), value.end());
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::begin_record(TallyEventRecorder::RecordType type) {
+  if (buffer.size() >= BUFFER_BYTES)
+    flush();
+
+  buffer.push_back(static_cast<char>(type));
+}
+//---------------------------------------------------------------------------//
+void TallyEventRecorder::flush() {
+  if (!buffer.empty() && file.is_open())
+    file.write(buffer.data(), buffer.size());
+
+  buffer.clear();
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/TallyEventRecorder.cpp
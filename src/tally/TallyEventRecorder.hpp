@@ -0,0 +1,177 @@
+// MCNP5/dagmc/TallyEventRecorder.hpp
+
+#ifndef DAGMC_TALLY_EVENT_RECORDER_HPP
+#define DAGMC_TALLY_EVENT_RECORDER_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "Tally.hpp"
+
+//===========================================================================//
+/**
+ * \class TallyEventRecorder
+ * \brief Writes the calls made to a TallyManager to a binary event stream
+ *
+ * TallyEventRecorder is used by TallyManager to record the tallies that are
+ * active and every call that scores them, so that the same scoring can be
+ * replayed later by a TallyEventReader without rerunning the transport.
+ * The stream starts with a header, followed by one record for each call
+ *
+ *     1) TALLY: a Tally that was added, with its type, particle, energy bin
+ *        boundaries, options and multiplier id
+ *     2) REMOVE_TALLY: the id of a Tally that was removed
+ *     3) NUM_MULTIPLIERS: the number of multipliers that have been added
+ *     4) TALLY_MULTIPLIER: a multiplier that was assigned to a Tally
+ *     5) MULTIPLIER: a new value of a multiplier
+ *     6) COLLISION, TRACK: the arguments of setCollisionEvent() and
+ *        setTrackEvent()
+ *     7) UPDATE: a call to updateTallies()
+ *     8) END_HISTORY: a call to endHistory()
+ *
+ * Each record is a one byte record type followed by its fields in the byte
+ * order of the machine, without padding.  Records are buffered in memory and
+ * written in large blocks, so recording only adds a copy of the arguments to
+ * each call.
+ */
+//===========================================================================//
+class TallyEventRecorder {
+ public:
+  /**
+   * \brief Defines the type of each record in an event stream
+   */
+  enum RecordType {TALLY = 1,
+                   REMOVE_TALLY = 2,
+                   NUM_MULTIPLIERS = 3,
+                   TALLY_MULTIPLIER = 4,
+                   MULTIPLIER = 5,
+                   COLLISION = 6,
+                   TRACK = 7,
+                   UPDATE = 8,
+                   END_HISTORY = 9
+                  };
+
+  /// Identifies an event stream, its format version and its byte order
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+  static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+  /**
+   * \brief Constructor
+   * \param[in] filename the name of the event stream to write
+   *
+   * Use is_open() to check if the file was created.
+   */
+  explicit TallyEventRecorder(const std::string& filename);
+
+  /**
+   * \brief Destructor
+   *
+   * Writes any buffered records and closes the file.
+   */
+  ~TallyEventRecorder();
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief is_open()
+   * \return true if the event stream can be written; false otherwise
+   */
+  bool is_open() const;
+
+  /**
+   * \brief record_tally(), record_remove_tally(), record_num_multipliers(),
+   *        record_tally_multiplier(), record_multiplier()
+   *
+   * Record changes to the active tallies and multipliers.  The options in
+   * input must be the options that were given when the Tally was added.
+   */
+  void record_tally(const TallyInput& input);
+  void record_remove_tally(unsigned int tally_id);
+  void record_num_multipliers(unsigned int num_multipliers);
+  void record_tally_multiplier(unsigned int multiplier_id,
+                               unsigned int tally_id);
+  void record_multiplier(unsigned int multiplier_id, double value);
+
+  /**
+   * \brief Records a collision event
+   *
+   * See TallyManager::setCollisionEvent() for the parameters.
+   */
+  void record_collision(unsigned int particle,
+                        double x, double y, double z,
+                        double particle_energy, double particle_weight,
+                        double total_cross_section, int cell_id);
+
+  /**
+   * \brief Records a track event
+   *
+   * See TallyManager::setTrackEvent() for the parameters.
+   */
+  void record_track(unsigned int particle,
+                    double x, double y, double z,
+                    double u, double v, double w,
+                    double particle_energy, double particle_weight,
+                    double track_length, int cell_id);
+
+  /**
+   * \brief record_update(), record_end_history()
+   *
+   * Record calls to updateTallies() and endHistory().
+   */
+  void record_update();
+  void record_end_history();
+
+  /**
+   * \brief Writes any buffered records and closes the event stream
+   * \return true if all records were written; false otherwise
+   */
+  bool close();
+
+ private:
+  /// Copy constructor and operator= methods are not implemented
+  TallyEventRecorder(const TallyEventRecorder& obj);
+  TallyEventRecorder& operator=(const TallyEventRecorder& obj);
+
+  // File that the event stream is written to
+  std::ofstream file;
+
+  // Records that have not been written yet
+  std::vector<char> buffer;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Adds the bytes of a value to the buffer
+   * \param[in] value the value to add
+   */
+  template <typename T>
+  void put(const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+  }
+
+  /**
+   * \brief Adds the length and characters of a string to the buffer
+   * \param[in] value the string to add
+   */
+  void put_string(const std::string& value);
+
+  /**
+   * \brief Starts a new record, writing the buffer first if it is full
+   * \param[in] type the type of the record
+   */
+  void begin_record(RecordType type);
+
+  /**
+   * \brief Writes the buffer to the file and clears it
+   */
+  void flush();
+};
+
+#endif // DAGMC_TALLY_EVENT_RECORDER_HPP
+
+// end of MCNP5/dagmc/TallyEventRecorder.hpp
@@ -1,18 +1,208 @@
 // MCNP5/dagmc/TallyManager.cpp
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <set>
+#include <sstream>
+
+#include <stdint.h>
 
 #include "TallyManager.hpp"
 #include "TallyEvent.hpp"
 
+//---------------------------------------------------------------------------//
+// HELPER CLASSES
+//---------------------------------------------------------------------------//
+namespace {
+// location of one history in the history logs of a set of TallyContexts
+struct HistoryRecord {
+  unsigned long history;
+  unsigned int context;
+  unsigned int entry;
+};
+
+// orders history records by their history ids
+class CompareHistories {
+ public:
+  bool operator()(const HistoryRecord& a, const HistoryRecord& b) const {
+    return a.history < b.history;
+  }
+};
+
+// identifies a checkpoint file, its format version and its byte order
+const char CHECKPOINT_MAGIC[8] = {'D', 'A', 'G', 'T', 'A', 'L', 'L', 'Y'};
+const uint32_t CHECKPOINT_VERSION = 3;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// longest tally type name accepted when reading a checkpoint
+const uint32_t MAX_TYPE_LENGTH = 1024;
+
+// running checksum of the bytes written to or read from a checkpoint, which
+// processes eight bytes at a time so that large arrays are checked quickly
+class Checksum {
+ public:
+  Checksum() : value(0x9E3779B97F4A7C15ULL) {}
+
+  void update(const void* bytes, size_t num_bytes) {
+    const char* next = static_cast<const char*>(bytes);
+    uint64_t word;
+
+    for (; num_bytes >= sizeof(word); num_bytes -= sizeof(word)) {
+      memcpy(&word, next, sizeof(word));
+      add(word);
+      next += sizeof(word);
+    }
+
+    // pad the remaining bytes with zeros
+    if (num_bytes > 0) {
+      word = 0;
+      memcpy(&word, next, num_bytes);
+      add(word);
+    }
+  }
+
+  uint64_t get() const {
+    return value;
+  }
+
+ private:
+  uint64_t value;
+
+  void add(uint64_t word) {
+    value = (value ^ word) * 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 32;
+  }
+};
+
+// writes bytes to a checkpoint and adds them to the checksum
+void write_bytes(std::ostream& out, Checksum& checksum,
+                 const void* bytes, size_t num_bytes) {
+  out.write(static_cast<const char*>(bytes), num_bytes);
+  checksum.update(bytes, num_bytes);
+}
+
+// reads bytes from a checkpoint and adds them to the checksum
+bool read_bytes(std::ifstream& in, Checksum& checksum,
+                void* bytes, size_t num_bytes) {
+  in.read(static_cast<char*>(bytes), num_bytes);
+  checksum.update(bytes, num_bytes);
+  return in.good();
+}
+
+// fixed-size part of the record for one Tally in a checkpoint
+struct CheckpointRecord {
+  uint32_t tally_id;
+  uint32_t particle;
+  uint32_t num_energy_bins;
+  uint32_t type_length;
+  uint64_t data_length;
+  uint64_t state_length;
+};
+
+// writes the fields of a record one at a time so that no padding is written
+void write_record(std::ostream& out, Checksum& checksum,
+                  const CheckpointRecord& record) {
+  write_bytes(out, checksum, &record.tally_id, sizeof(record.tally_id));
+  write_bytes(out, checksum, &record.particle, sizeof(record.particle));
+  write_bytes(out, checksum, &record.num_energy_bins,
+              sizeof(record.num_energy_bins));
+  write_bytes(out, checksum, &record.type_length, sizeof(record.type_length));
+  write_bytes(out, checksum, &record.data_length, sizeof(record.data_length));
+  write_bytes(out, checksum, &record.state_length,
+              sizeof(record.state_length));
+}
+
+bool read_record(std::ifstream& in, Checksum& checksum,
+                 CheckpointRecord& record) {
+  return read_bytes(in, checksum, &record.tally_id, sizeof(record.tally_id)) &&
+         read_bytes(in, checksum, &record.particle, sizeof(record.particle)) &&
+         read_bytes(in, checksum, &record.num_energy_bins,
+                    sizeof(record.num_energy_bins)) &&
+         read_bytes(in, checksum, &record.type_length,
+                    sizeof(record.type_length)) &&
+         read_bytes(in, checksum, &record.data_length,
+                    sizeof(record.data_length)) &&
+         read_bytes(in, checksum, &record.state_length,
+                    sizeof(record.state_length));
+}
+
+// closes a checkpoint written to temp_filename and renames it to filename
+bool finish_checkpoint(std::ofstream& out, const std::string& temp_filename,
+                       const std::string& filename) {
+  out.close();
+
+  if (out.fail()) {
+    std::cerr << "Warning: failed to write tally checkpoint "
+              << temp_filename << "." << std::endl;
+    std::remove(temp_filename.c_str());
+    return false;
+  }
+
+  // only replace the previous checkpoint once the new one is complete
+  if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+    std::cerr << "Warning: cannot rename " << temp_filename << " to "
+              << filename << "." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+// opens filename.tmp for writing a checkpoint
+bool open_checkpoint(std::ofstream& out, const std::string& temp_filename) {
+  out.open(temp_filename.c_str(),
+           std::ios::out | std::ios::binary | std::ios::trunc);
+
+  if (!out) {
+    std::cerr << "Warning: cannot open " << temp_filename
+              << " to write a tally checkpoint." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+// writes a checkpoint that was copied into memory, used by the thread that
+// writes checkpoints in the background
+void write_checkpoint_file(std::string contents, std::string filename,
+                           bool* written) {
+  std::string temp_filename = filename + ".tmp";
+  std::ofstream out;
+  *written = false;
+
+  if (!open_checkpoint(out, temp_filename))
+    return;
+
+  out.write(contents.data(), contents.size());
+  *written = finish_checkpoint(out, temp_filename, filename);
+}
+} // namespace
+
 //---------------------------------------------------------------------------//
 // CONSTRUCTOR
 //---------------------------------------------------------------------------//
-TallyManager::TallyManager() {
+TallyManager::TallyManager()
+  : num_dispatched(0), num_rejected(0),
+    event_queue(NULL), scoring_queue(NULL), worker_pool(NULL),
+    queue_task(this), num_rand_tallies(0), num_histories(0),
+    num_queued_histories(0), statistics_batch_size(0),
+    target_rel_error(0.1), next_statistics_update(0), recorder(NULL),
+    checkpoint_written(true) {
   event.type = TallyEvent::NONE;
 }
 //---------------------------------------------------------------------------//
+// DESTRUCTOR
+//---------------------------------------------------------------------------//
+TallyManager::~TallyManager() {
+  disableEventQueue();
+  stopRecording();
+  waitForCheckpoint();
+}
+//---------------------------------------------------------------------------//
 // PUBLIC INTERFACE
 //---------------------------------------------------------------------------//
 void TallyManager::addNewTally(unsigned int tally_id,
@@ -22,30 +212,57 @@ void TallyManager::addNewTally(unsigned int tally_id,
                                const std::multimap<std::string, std::string>& options) {
   Tally* newTally = createTally(tally_id, tally_type, particle,
                                 energy_bin_bounds, options);
+  flushEventQueue();
 
   if (newTally != NULL) {
     observers.insert(std::pair<int, Tally*>(tally_id, newTally));
+    buildDispatchLists();
+
+    TallyInput input = newTally->input_data;
+    input.options = options;
+    tally_inputs.insert(std::make_pair(tally_id, input));
+
+    if (recorder != NULL)
+      recorder->record_tally(input);
+
+    if (statistics_batch_size > 0)
+      addStatistics(tally_id, true);
   } else {
     std::cerr << "Warning: Tally will be ignored." << std::endl;
   }
 }
 //---------------------------------------------------------------------------//
 void TallyManager::addNewMultiplier(unsigned int multiplier_id) {
+  flushEventQueue();
+
   // pad multipliers vector up to a size one greater than the multiplier_id
   // NOTE: this would not be needed if we use an unordered map over a vector
   while (event.multipliers.size() <= multiplier_id) {
     event.multipliers.push_back(1.0);
   }
+
+  if (event_queue != NULL) {
+    event_queue->set_num_multipliers(event.multipliers.size());
+    scoring_queue->set_num_multipliers(event.multipliers.size());
+  }
+
+  if (recorder != NULL)
+    recorder->record_num_multipliers(event.multipliers.size());
 }
 //---------------------------------------------------------------------------//
 void TallyManager::addMultiplierToTally(unsigned int multiplier_id,
                                         unsigned int tally_id) {
+  flushEventQueue();
+
   std::map<int, Tally*>::iterator it;
   it = observers.find(tally_id);
 
   if (event.multipliers.size() > multiplier_id && it != observers.end()) {
     Tally* tally = it->second;
     tally->input_data.multiplier_id = multiplier_id;
+
+    if (recorder != NULL)
+      recorder->record_tally_multiplier(multiplier_id, tally_id);
   } else {
     std::cerr << "Warning: Cannot set multiplier id for Tally " << tally_id
               << ".  Tally and/or multiplier are/is invalid." << std::endl;
@@ -55,6 +272,9 @@ void TallyManager::addMultiplierToTally(unsigned int multiplier_id,
 void TallyManager::updateMultiplier(unsigned int multiplier_id, double value) {
   if (event.multipliers.size() > multiplier_id) {
     event.multipliers.at(multiplier_id) = value;
+
+    if (recorder != NULL)
+      recorder->record_multiplier(multiplier_id, value);
   }
 }
 //---------------------------------------------------------------------------//
@@ -63,6 +283,8 @@ unsigned int TallyManager::numTallies() {
 }
 //---------------------------------------------------------------------------//
 void TallyManager::removeTally(unsigned int tally_id) {
+  flushEventQueue();
+
   std::map<int, Tally*>::iterator it;
   it = observers.find(tally_id);
 
@@ -70,6 +292,12 @@ void TallyManager::removeTally(unsigned int tally_id) {
     // release memory allocated to Tally and remove it from the map
     delete it->second;
     observers.erase(it);
+    tally_inputs.erase(tally_id);
+    statistics.erase(tally_id);
+    buildDispatchLists();
+
+    if (recorder != NULL)
+      recorder->record_remove_tally(tally_id);
   } else {
     std::cerr << "Warning: Tally " << tally_id
               << " does not exist and cannot be removed. " << std::endl;
@@ -80,13 +308,18 @@ bool TallyManager::setCollisionEvent(unsigned int particle,
                                      double x, double y, double z,
                                      double particle_energy, double particle_weight,
                                      double total_cross_section, int cell_id) {
+  if (recorder != NULL) {
+    recorder->record_collision(particle, x, y, z, particle_energy,
+                               particle_weight, total_cross_section, cell_id);
+  }
+
   if (total_cross_section < 0.0) {
     std::cerr << "Warning: total_cross_section, " << total_cross_section
               << ", cannot be less than zero." << std::endl;
     return false;;
   }
 
-  return setEvent(TallyEvent::COLLISION, particle,
+  return setEvent(event, TallyEvent::COLLISION, particle,
                   x, y, z, 0.0, 0.0, 0.0,
                   particle_energy, particle_weight,
                   0.0, total_cross_section,
@@ -98,13 +331,18 @@ bool TallyManager::setTrackEvent(unsigned int particle,
                                  double u, double v, double w,
                                  double particle_energy, double particle_weight,
                                  double track_length, int cell_id) {
+  if (recorder != NULL) {
+    recorder->record_track(particle, x, y, z, u, v, w, particle_energy,
+                           particle_weight, track_length, cell_id);
+  }
+
   if (track_length < 0.0) {
     std::cerr << "Warning: track_length, " << track_length
               << ", cannot be less than zero." << std::endl;
     return false;
   }
 
-  return setEvent(TallyEvent::TRACK, particle,
+  return setEvent(event, TallyEvent::TRACK, particle,
                   x, y, z, u, v, w,
                   particle_energy, particle_weight,
                   track_length, 0.0,
@@ -112,44 +350,593 @@ bool TallyManager::setTrackEvent(unsigned int particle,
 }
 //---------------------------------------------------------------------------//
 void TallyManager::clearLastEvent() {
-  event.type = TallyEvent::NONE;
-  event.particle  = 0;
-  event.position  = moab::CartVect(0.0, 0.0, 0.0);
-  event.direction = moab::CartVect(0.0, 0.0, 0.0);
-  event.particle_energy     = 0.0;
-  event.particle_weight     = 0.0;
-  event.track_length        = 0.0;
-  event.total_cross_section = 0.0;
-  event.current_cell        = 0;
+  clearEvent(event);
 }
 //---------------------------------------------------------------------------//
 // Note: the event is set just before updateTallies is called
 void TallyManager::updateTallies() {
+  if (recorder != NULL)
+    recorder->record_update();
+
+  if (event_queue != NULL && event.type != TallyEvent::NONE) {
+    event_queue->push_event(event);
+
+    if (event_queue->full())
+      submitEventQueue();
+
+    clearLastEvent();
+    return;
+  }
+
+  unsigned int num_scored = dispatchEvent(event, NULL);
+
+  num_dispatched += num_scored;
+  num_rejected += observers.size() - num_scored;
+  clearLastEvent();
+}
+//---------------------------------------------------------------------------//
+void TallyManager::endHistory() {
+  if (recorder != NULL)
+    recorder->record_end_history();
+
+  ++num_histories;
+
+  if (event_queue != NULL) {
+    event_queue->push_end_history();
+    ++num_queued_histories;
+
+    if (event_queue->full())
+      submitEventQueue();
+  } else {
+    std::map<int, Tally*>::iterator map_it;
+    for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
+      Tally* tally = map_it->second;
+      tally->end_history();
+    }
+  }
+
+  updateStatistics();
+}
+//---------------------------------------------------------------------------//
+// THREADED SCORING METHODS
+//---------------------------------------------------------------------------//
+void TallyManager::beginHistory(TallyContext& context,
+                                unsigned long history_id) {
   std::map<int, Tally*>::iterator map_it;
   for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
-    Tally* tally = map_it->second;
+    TallyData*& scratch = context.scratch_data[map_it->first];
 
-    // skip events involving particles not expected by the tally
-    if (tally->input_data.particle == event.particle) {
-      tally->compute_score(event);
+    if (scratch == NULL) {
+      scratch = map_it->second->data->create_scratch_data();
     }
   }
-  clearLastEvent();
+
+  context.event.multipliers = event.multipliers;
+  clearEvent(context.event);
+  context.begin_history(history_id);
 }
 //---------------------------------------------------------------------------//
-void TallyManager::endHistory() {
+bool TallyManager::setCollisionEvent(TallyContext& context,
+                                     unsigned int particle,
+                                     double x, double y, double z,
+                                     double particle_energy, double particle_weight,
+                                     double total_cross_section, int cell_id) {
+  if (total_cross_section < 0.0) {
+    std::cerr << "Warning: total_cross_section, " << total_cross_section
+              << ", cannot be less than zero." << std::endl;
+    return false;
+  }
+
+  return setEvent(context.event, TallyEvent::COLLISION, particle,
+                  x, y, z, 0.0, 0.0, 0.0,
+                  particle_energy, particle_weight,
+                  0.0, total_cross_section,
+                  cell_id);
+}
+//---------------------------------------------------------------------------//
+bool TallyManager::setTrackEvent(TallyContext& context,
+                                 unsigned int particle,
+                                 double x, double y, double z,
+                                 double u, double v, double w,
+                                 double particle_energy, double particle_weight,
+                                 double track_length, int cell_id) {
+  if (track_length < 0.0) {
+    std::cerr << "Warning: track_length, " << track_length
+              << ", cannot be less than zero." << std::endl;
+    return false;
+  }
+
+  return setEvent(context.event, TallyEvent::TRACK, particle,
+                  x, y, z, u, v, w,
+                  particle_energy, particle_weight,
+                  track_length, 0.0,
+                  cell_id);
+}
+//---------------------------------------------------------------------------//
+void TallyManager::updateMultiplier(TallyContext& context,
+                                    unsigned int multiplier_id, double value) {
+  if (context.event.multipliers.size() > multiplier_id) {
+    context.event.multipliers[multiplier_id] = value;
+  }
+}
+//---------------------------------------------------------------------------//
+void TallyManager::updateTallies(TallyContext& context) {
+  unsigned int num_scored = dispatchEvent(context.event, &context);
+
+  context.num_dispatched += num_scored;
+  context.num_rejected += observers.size() - num_scored;
+  clearEvent(context.event);
+}
+//---------------------------------------------------------------------------//
+void TallyManager::endHistory(TallyContext& context) {
+  context.end_history();
+}
+//---------------------------------------------------------------------------//
+void TallyManager::endBatch(const std::vector<TallyContext*>& contexts) {
+  flushEventQueue();
+
+  std::vector<HistoryRecord> records;
+
   std::map<int, Tally*>::iterator map_it;
   for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
-    Tally* tally = map_it->second;
-    tally->end_history();
+    int tally_id = map_it->first;
+    records.clear();
+
+    // gather the histories for this tally from all of the contexts
+    for (unsigned int i = 0; i < contexts.size(); ++i) {
+      std::map<int, TallyContext::HistoryLog>::const_iterator log_it;
+      log_it = contexts[i]->history_logs.find(tally_id);
+
+      if (log_it == contexts[i]->history_logs.end())
+        continue;
+
+      const std::vector<unsigned long>& histories = log_it->second.histories;
+
+      for (unsigned int j = 0; j < histories.size(); ++j) {
+        HistoryRecord record = {histories[j], i, j};
+        records.push_back(record);
+      }
+    }
+
+    // add the histories to the tally in order of their history ids
+    std::stable_sort(records.begin(), records.end(), CompareHistories());
+
+    for (unsigned int k = 0; k < records.size(); ++k) {
+      const TallyContext::HistoryLog& log =
+        contexts[records[k].context]->history_logs[tally_id];
+
+      unsigned int entry = records[k].entry;
+      unsigned int begin = log.offsets[entry];
+      unsigned int end = (entry + 1 < log.offsets.size()) ?
+                         log.offsets[entry + 1] : log.indices.size();
+
+      map_it->second->data->add_history_scores(&log.indices[begin],
+                                               &log.scores[begin],
+                                               end - begin);
+    }
+  }
+
+  // remove the histories from the contexts, keeping the memory allocated
+  for (unsigned int i = 0; i < contexts.size(); ++i) {
+    num_dispatched += contexts[i]->num_dispatched;
+    num_rejected += contexts[i]->num_rejected;
+    num_histories += contexts[i]->num_histories;
+    contexts[i]->num_dispatched = 0;
+    contexts[i]->num_rejected = 0;
+    contexts[i]->num_histories = 0;
+
+    std::map<int, TallyContext::HistoryLog>::iterator log_it;
+    std::map<int, TallyContext::HistoryLog>& logs = contexts[i]->history_logs;
+
+    for (log_it = logs.begin(); log_it != logs.end(); ++log_it) {
+      log_it->second.histories.clear();
+      log_it->second.offsets.clear();
+      log_it->second.indices.clear();
+      log_it->second.scores.clear();
+    }
+  }
+
+  updateStatistics();
+}
+//---------------------------------------------------------------------------//
+// EVENT QUEUE METHODS
+//---------------------------------------------------------------------------//
+void TallyManager::enableEventQueue(unsigned int capacity,
+                                    unsigned int num_threads) {
+  disableEventQueue();
+
+  if (capacity == 0) {
+    std::cerr << "Warning: event queue must have a capacity of at least one "
+              << "entry and will not be enabled." << std::endl;
+    return;
+  }
+
+  event_queue = new TallyEventQueue(capacity, event.multipliers.size());
+  scoring_queue = new TallyEventQueue(capacity, event.multipliers.size());
+  worker_pool = new TallyWorkerPool(num_threads);
+  buildDispatchLists();
+}
+//---------------------------------------------------------------------------//
+void TallyManager::disableEventQueue() {
+  if (event_queue == NULL)
+    return;
+
+  flushEventQueue();
+
+  delete worker_pool;
+  delete scoring_queue;
+  delete event_queue;
+
+  worker_pool = NULL;
+  scoring_queue = NULL;
+  event_queue = NULL;
+}
+//---------------------------------------------------------------------------//
+void TallyManager::flushEventQueue() {
+  if (event_queue == NULL)
+    return;
+
+  submitEventQueue();
+  worker_pool->wait();
+  collectScoredQueue();
+}
+//---------------------------------------------------------------------------//
+// STATISTICS METHODS
+//---------------------------------------------------------------------------//
+void TallyManager::enableStatistics(unsigned long batch_size,
+                                    double target_rel_error) {
+  disableStatistics();
+
+  if (batch_size == 0) {
+    std::cerr << "Warning: statistics must be updated after at least one "
+              << "history; statistics will not be enabled." << std::endl;
+    return;
+  }
+
+  statistics_batch_size = batch_size;
+  this->target_rel_error = target_rel_error;
+  statistics_start = std::chrono::steady_clock::now();
+
+  std::map<int, Tally*>::iterator map_it;
+  for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
+    addStatistics(map_it->first, true);
+  }
+
+  next_statistics_update = numScoredHistories() + batch_size;
+}
+//---------------------------------------------------------------------------//
+void TallyManager::disableStatistics() {
+  statistics.clear();
+  statistics_batch_size = 0;
+}
+//---------------------------------------------------------------------------//
+bool TallyManager::setStatisticsBin(unsigned int tally_id,
+                                    unsigned int tally_point,
+                                    unsigned int energy_bin) {
+  flushEventQueue();
+
+  std::map<int, Tally*>::iterator it;
+  it = observers.find(tally_id);
+
+  if (statistics_batch_size == 0 || it == observers.end()) {
+    std::cerr << "Warning: Tally " << tally_id << " does not exist or "
+              << "statistics are not enabled." << std::endl;
+    return false;
+  }
+
+  TallyData* data = it->second->data;
+  int length = 0;
+  data->get_tally_data(length);
+
+  if (energy_bin >= data->get_num_energy_bins() ||
+      (tally_point + 1) * data->get_num_energy_bins() > (unsigned int)length) {
+    std::cerr << "Warning: bin (" << tally_point << ", " << energy_bin
+              << ") does not exist in Tally " << tally_id << "." << std::endl;
+    return false;
+  }
+
+  data->set_monitor_bin(tally_point, energy_bin);
+  addStatistics(tally_id, false);
+
+  return true;
+}
+//---------------------------------------------------------------------------//
+const TallyStatistics* TallyManager::getStatistics(unsigned int tally_id) const {
+  std::map<int, TallyStatistics>::const_iterator it;
+  it = statistics.find(tally_id);
+
+  return it != statistics.end() ? &(it->second) : NULL;
+}
+//---------------------------------------------------------------------------//
+bool TallyManager::isConverged() const {
+  if (statistics.empty())
+    return false;
+
+  std::map<int, TallyStatistics>::const_iterator it;
+  for (it = statistics.begin(); it != statistics.end(); ++it) {
+    if (!it->second.converged())
+      return false;
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------//
+unsigned long TallyManager::getNumHistories() const {
+  return num_histories;
+}
+//---------------------------------------------------------------------------//
+// RECORDING METHODS
+//---------------------------------------------------------------------------//
+bool TallyManager::startRecording(const std::string& filename) {
+  stopRecording();
+
+  recorder = new TallyEventRecorder(filename);
+
+  if (!recorder->is_open()) {
+    std::cerr << "Warning: cannot open " << filename
+              << " to record tally events." << std::endl;
+    delete recorder;
+    recorder = NULL;
+    return false;
+  }
+
+  // record the current state so that the stream can be replayed on its own
+  unsigned int num_multipliers = event.multipliers.size();
+
+  if (num_multipliers > 0)
+    recorder->record_num_multipliers(num_multipliers);
+
+  for (unsigned int i = 0; i < num_multipliers; ++i) {
+    recorder->record_multiplier(i, event.multipliers[i]);
+  }
+
+  std::map<int, TallyInput>::iterator it;
+  for (it = tally_inputs.begin(); it != tally_inputs.end(); ++it) {
+    TallyInput input = it->second;
+    input.multiplier_id = observers[it->first]->input_data.multiplier_id;
+    recorder->record_tally(input);
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------//
+bool TallyManager::stopRecording() {
+  if (recorder == NULL)
+    return false;
+
+  bool written = recorder->close();
+  delete recorder;
+  recorder = NULL;
+
+  if (!written)
+    std::cerr << "Warning: failed to write all recorded tally events."
+              << std::endl;
+
+  return written;
+}
+//---------------------------------------------------------------------------//
+bool TallyManager::isRecording() const {
+  return recorder != NULL;
+}
+//---------------------------------------------------------------------------//
+// CHECKPOINT METHODS
+//---------------------------------------------------------------------------//
+bool TallyManager::checkpoint(const std::string& filename,
+                              bool in_background) {
+  flushEventQueue();
+  waitForCheckpoint();
+
+  // copy the checkpoint into memory and write it while transport continues
+  if (in_background) {
+    std::ostringstream buffer(std::ios::out | std::ios::binary);
+    writeCheckpoint(buffer);
+    checkpoint_thread = std::thread(write_checkpoint_file, buffer.str(),
+                                    filename, &checkpoint_written);
+    return true;
+  }
+
+  std::string temp_filename = filename + ".tmp";
+  std::ofstream out;
+
+  if (!open_checkpoint(out, temp_filename))
+    return false;
+
+  writeCheckpoint(out);
+  return finish_checkpoint(out, temp_filename, filename);
+}
+//---------------------------------------------------------------------------//
+bool TallyManager::waitForCheckpoint() {
+  if (checkpoint_thread.joinable())
+    checkpoint_thread.join();
+
+  return checkpoint_written;
+}
+//---------------------------------------------------------------------------//
+bool TallyManager::restore(const std::string& filename) {
+  flushEventQueue();
+  waitForCheckpoint();
+
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+
+  if (!in) {
+    std::cerr << "Warning: cannot open tally checkpoint " << filename
+              << "." << std::endl;
+    return false;
+  }
+
+  // check that the header is valid for this TallyManager
+  Checksum checksum;
+  char magic[sizeof(CHECKPOINT_MAGIC)];
+  uint32_t version = 0;
+  uint32_t byte_order = 0;
+  uint32_t num_tallies = 0;
+  uint64_t counts[3] = {0, 0, 0};
+  uint64_t sum = 0;
+
+  bool valid = read_bytes(in, checksum, magic, sizeof(magic)) &&
+               read_bytes(in, checksum, &version, sizeof(version)) &&
+               read_bytes(in, checksum, &byte_order, sizeof(byte_order)) &&
+               read_bytes(in, checksum, &num_tallies, sizeof(num_tallies)) &&
+               read_bytes(in, checksum, counts, sizeof(counts));
+
+  in.read(reinterpret_cast<char*>(&sum), sizeof(sum));
+
+  std::string problem;
+
+  if (!valid || !in.good() ||
+      memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0) {
+    problem = "it is not a tally checkpoint";
+  } else if (byte_order != BYTE_ORDER_MARK) {
+    problem = "it was written with a different byte order";
+  } else if (version != CHECKPOINT_VERSION) {
+    problem = "its format version is not supported";
+  } else if (sum != checksum.get()) {
+    problem = "its header is corrupt";
+  } else if (num_tallies != observers.size()) {
+    problem = "it does not have the same number of tallies";
+  } else if (counts[0] != static_cast<unsigned long>(counts[0])) {
+    problem = "its number of histories is too large";
+  }
+
+  // check that every record matches an active Tally before changing any
+  std::vector<std::streampos> record_positions;
+  std::set<unsigned int> restored_ids;
+
+  for (uint32_t i = 0; i < num_tallies && problem.empty(); ++i) {
+    record_positions.push_back(in.tellg());
+
+    Checksum record_checksum;
+    CheckpointRecord record = {0, 0, 0, 0, 0, 0};
+    std::string type;
+
+    if (read_record(in, record_checksum, record) &&
+        record.type_length <= MAX_TYPE_LENGTH) {
+      type.resize(record.type_length);
+      read_bytes(in, record_checksum, &type[0], record.type_length);
+    }
+
+    std::map<int, Tally*>::iterator it = observers.find(record.tally_id);
+
+    if (!in.good() || record.type_length > MAX_TYPE_LENGTH) {
+      problem = "it is truncated or corrupt";
+    } else if (it == observers.end() ||
+               !restored_ids.insert(record.tally_id).second) {
+      problem = "it does not have the same tally ids";
+    } else {
+      Tally* tally = it->second;
+      int length = 0;
+      tally->data->get_tally_data(length);
+
+      std::vector<double> state;
+      tally->get_checkpoint_state(state);
+
+      if (type != tally->input_data.tally_type ||
+          record.particle != tally->input_data.particle ||
+          record.num_energy_bins != tally->data->get_num_energy_bins() ||
+          record.data_length != static_cast<uint64_t>(length) ||
+          record.state_length != state.size()) {
+        problem = "its tallies do not match the active tallies";
+      }
+    }
+
+    // skip the data arrays, the extra state and the checksum
+    uint64_t num_values = 2 * record.data_length + record.state_length;
+    in.seekg(num_values * sizeof(double) + sizeof(sum), std::ios::cur);
+  }
+
+  // the data arrays of the last record must also be complete
+  if (problem.empty()) {
+    std::streampos end_of_records = in.tellg();
+    in.seekg(0, std::ios::end);
+
+    if (!in.good() || in.tellg() < end_of_records)
+      problem = "it is truncated or corrupt";
+  }
+
+  if (!problem.empty()) {
+    std::cerr << "Warning: cannot restore tallies from " << filename
+              << " because " << problem << "." << std::endl;
+    return false;
+  }
+
+  // read the data arrays directly into each Tally, but only restore the
+  // extra state of the tallies once all of the records are valid
+  zeroAllTallyData();
+  std::vector<Tally*> restored_tallies(num_tallies);
+  std::vector<std::vector<double> > states(num_tallies);
+
+  for (uint32_t i = 0; i < num_tallies; ++i) {
+    in.seekg(record_positions[i]);
+
+    Checksum record_checksum;
+    CheckpointRecord record;
+    read_record(in, record_checksum, record);
+
+    std::string type(record.type_length, ' ');
+    read_bytes(in, record_checksum, &type[0], record.type_length);
+
+    Tally* tally = observers[record.tally_id];
+    restored_tallies[i] = tally;
+
+    int length = 0;
+    double* tally_data = tally->data->get_tally_data(length);
+    double* error_data = tally->data->get_error_data(length);
+
+    read_bytes(in, record_checksum, tally_data, length * sizeof(double));
+    read_bytes(in, record_checksum, error_data, length * sizeof(double));
+
+    states[i].resize(record.state_length);
+
+    if (record.state_length > 0) {
+      read_bytes(in, record_checksum, &states[i][0],
+                 record.state_length * sizeof(double));
+    }
+
+    in.read(reinterpret_cast<char*>(&sum), sizeof(sum));
+
+    if (!in.good() || sum != record_checksum.get()) {
+      std::cerr << "Warning: data for Tally " << record.tally_id
+                << " in checkpoint " << filename << " is corrupt; all"
+                << " tally data has been reset." << std::endl;
+      zeroAllTallyData();
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < num_tallies; ++i) {
+    if (!restored_tallies[i]->set_checkpoint_state(states[i])) {
+      std::cerr << "Warning: extra state of Tally "
+                << restored_tallies[i]->input_data.tally_id
+                << " in checkpoint " << filename << " is not valid."
+                << std::endl;
+    }
   }
+
+  num_histories = counts[0];
+  num_dispatched = counts[1];
+  num_rejected = counts[2];
+  resetStatistics();
+
+  return true;
 }
 //---------------------------------------------------------------------------//
 void TallyManager::writeData(double num_histories) {
+  flushEventQueue();
+
+  std::cout << "Tally updates dispatched: " << num_dispatched
+            << ", rejected: " << num_rejected << std::endl;
+
   std::map<int, Tally*>::iterator map_it;
   for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
     Tally* tally = map_it->second;
     tally->write_data(num_histories);
+
+    const TallyStatistics* tally_statistics = getStatistics(map_it->first);
+
+    if (tally_statistics != NULL) {
+      std::cout << "Statistics for Tally " << map_it->first << ":" << std::endl;
+      tally_statistics->write_summary(std::cout);
+    }
   }
 }
 //---------------------------------------------------------------------------//
@@ -159,6 +946,8 @@ void TallyManager::writeData(double num_histories) {
 // Future addition could add similar functions to the Tally interface so that
 // each implementation can choose how to store its data.
 double* TallyManager::getTallyData(int tally_id, int& length) {
+  flushEventQueue();
+
   std::map<int, Tally*>::iterator it;
   it = observers.find(tally_id);
 
@@ -173,6 +962,8 @@ double* TallyManager::getTallyData(int tally_id, int& length) {
 }
 //---------------------------------------------------------------------------//
 double* TallyManager::getErrorData(int tally_id, int& length) {
+  flushEventQueue();
+
   std::map<int, Tally*>::iterator it;
   it = observers.find(tally_id);
 
@@ -187,6 +978,8 @@ double* TallyManager::getErrorData(int tally_id, int& length) {
 }
 //---------------------------------------------------------------------------//
 double* TallyManager::getScratchData(int tally_id, int& length) {
+  flushEventQueue();
+
   std::map<int, Tally*>::iterator it;
   it = observers.find(tally_id);
 
@@ -201,12 +994,26 @@ double* TallyManager::getScratchData(int tally_id, int& length) {
 }
 //---------------------------------------------------------------------------//
 void TallyManager::zeroAllTallyData() {
+  flushEventQueue();
+
   std::map<int, Tally*>::iterator map_it;
   for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
     Tally* tally = map_it->second;
     tally->data->zero_tally_data();
   }
   clearLastEvent();
+  num_dispatched = 0;
+  num_rejected = 0;
+  num_histories = 0;
+  resetStatistics();
+}
+//---------------------------------------------------------------------------//
+unsigned long TallyManager::getNumDispatched() const {
+  return num_dispatched;
+}
+//---------------------------------------------------------------------------//
+unsigned long TallyManager::getNumRejected() const {
+  return num_rejected;
 }
 //---------------------------------------------------------------------------//
 // PRIVATE METHODS
@@ -236,7 +1043,8 @@ Tally* TallyManager::createTally(unsigned int tally_id,
   return Tally::create_tally(input);
 }
 //---------------------------------------------------------------------------//
-bool TallyManager::setEvent(TallyEvent::EventType type, unsigned int particle,
+bool TallyManager::setEvent(TallyEvent& tally_event,
+                            TallyEvent::EventType type, unsigned int particle,
                             double x, double y, double z,
                             double u, double v, double w,
                             double particle_energy, double particle_weight,
@@ -246,18 +1054,18 @@ bool TallyManager::setEvent(TallyEvent::EventType type, unsigned int particle,
   bool errflag = false;
 
   // Set the particle state object
-  event.particle = particle;
-  event.position  = moab::CartVect(x, y, z);
-  event.direction = moab::CartVect(u, v, w);
+  tally_event.particle = particle;
+  tally_event.position  = moab::CartVect(x, y, z);
+  tally_event.direction = moab::CartVect(u, v, w);
   // This should already be normalized
-  event.direction.normalize();
+  tally_event.direction.normalize();
 
   if (particle_energy < 0.0) {
     std::cerr << "Warning: particle_energy, " << particle_energy
               << ", cannot be less than zero." << std::endl;
     errflag = true;
   } else {
-    event.particle_energy = particle_energy;
+    tally_event.particle_energy = particle_energy;
   }
 
   if (particle_weight < 0.0) {
@@ -265,25 +1073,305 @@ bool TallyManager::setEvent(TallyEvent::EventType type, unsigned int particle,
               << ", cannot be less than zero." << std::endl;
     errflag = true;
   } else {
-    event.particle_weight = particle_weight;
+    tally_event.particle_weight = particle_weight;
   }
 
-  event.track_length        = track_length;
-  event.total_cross_section = total_cross_section;
-  event.current_cell        = cell_id;
+  tally_event.track_length        = track_length;
+  tally_event.total_cross_section = total_cross_section;
+  tally_event.current_cell        = cell_id;
 
   if (type != TallyEvent::NONE) {
-    event.type = type;
+    tally_event.type = type;
   } else {
     errflag = true;
     std::cerr << "Warning: Cannot set a tally event of type NONE." << std::endl;
   }
   if (errflag) {
-    clearLastEvent();
+    clearEvent(tally_event);
   }
   bool event_is_set = !errflag;
   return event_is_set;
 }
 //---------------------------------------------------------------------------//
+void TallyManager::clearEvent(TallyEvent& tally_event) {
+  tally_event.type = TallyEvent::NONE;
+  tally_event.particle  = 0;
+  tally_event.position  = moab::CartVect(0.0, 0.0, 0.0);
+  tally_event.direction = moab::CartVect(0.0, 0.0, 0.0);
+  tally_event.particle_energy     = 0.0;
+  tally_event.particle_weight     = 0.0;
+  tally_event.track_length        = 0.0;
+  tally_event.total_cross_section = 0.0;
+  tally_event.current_cell        = 0;
+}
+//---------------------------------------------------------------------------//
+void TallyManager::buildDispatchLists() {
+  const TallyEvent::EventType types[] = {TallyEvent::COLLISION,
+                                         TallyEvent::TRACK
+                                        };
+  dispatch_lists.clear();
+
+  std::map<int, Tally*>::iterator map_it;
+  for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
+    Tally* tally = map_it->second;
+    const std::vector<double>& bounds = tally->input_data.energy_bin_bounds;
+
+    DispatchEntry entry = {tally, bounds.front(), bounds.back()};
+
+    for (int i = 0; i < 2; ++i) {
+      if (tally->scores_event_type(types[i])) {
+        DispatchKey key(types[i], tally->input_data.particle);
+        dispatch_lists[key].push_back(entry);
+      }
+    }
+  }
+
+  // the queue is always empty when tallies are added or removed
+  if (event_queue != NULL) {
+    queued_tallies.clear();
+
+    for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
+      if (map_it->second->uses_rand())
+        queued_tallies.push_back(map_it->second);
+    }
+
+    num_rand_tallies = queued_tallies.size();
+
+    for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
+      if (!map_it->second->uses_rand())
+        queued_tallies.push_back(map_it->second);
+    }
+
+    queued_events.resize(queued_tallies.size());
+    queued_dispatched.assign(queued_tallies.size(), 0);
+  }
+}
+//---------------------------------------------------------------------------//
+unsigned int TallyManager::dispatchEvent(const TallyEvent& tally_event,
+                                         TallyContext* context) {
+  DispatchKey key(tally_event.type, tally_event.particle);
+  std::map<DispatchKey, std::vector<DispatchEntry> >::const_iterator list_it;
+  list_it = dispatch_lists.find(key);
+
+  if (list_it == dispatch_lists.end())
+    return 0;
+
+  const std::vector<DispatchEntry>& entries = list_it->second;
+  double energy = tally_event.particle_energy;
+  unsigned int num_scored = 0;
+
+  for (unsigned int i = 0; i < entries.size(); ++i) {
+    // skip tallies whose energy bins do not include this event
+    if (energy < entries[i].min_energy || energy > entries[i].max_energy)
+      continue;
+
+    if (context == NULL)
+      entries[i].tally->compute_score(tally_event);
+    else
+      entries[i].tally->compute_score(tally_event, *context);
+
+    ++num_scored;
+  }
+
+  return num_scored;
+}
+//---------------------------------------------------------------------------//
+void TallyManager::addStatistics(unsigned int tally_id, bool summary) {
+  unsigned long num_scored = numScoredHistories();
+  double sums[4] = {0.0, 0.0, 0.0, 0.0};
+
+  if (!summary)
+    observers[tally_id]->data->get_monitor_sums(sums);
+
+  std::chrono::duration<double> elapsed;
+  elapsed = std::chrono::steady_clock::now() - statistics_start;
+
+  TallyStatistics tally_statistics(target_rel_error, summary);
+  tally_statistics.reset(num_scored, sums, elapsed.count());
+  statistics.erase(tally_id);
+  statistics.insert(std::make_pair(tally_id, tally_statistics));
+}
+//---------------------------------------------------------------------------//
+void TallyManager::resetStatistics() {
+  if (statistics_batch_size == 0)
+    return;
+
+  unsigned long num_scored = numScoredHistories();
+
+  std::chrono::duration<double> elapsed;
+  elapsed = std::chrono::steady_clock::now() - statistics_start;
+
+  std::map<int, TallyStatistics>::iterator it;
+  for (it = statistics.begin(); it != statistics.end(); ++it) {
+    double sums[4];
+    observers[it->first]->data->get_monitor_sums(sums);
+    it->second.reset(num_scored, sums, elapsed.count());
+  }
+
+  next_statistics_update = num_scored + statistics_batch_size;
+}
+//---------------------------------------------------------------------------//
+void TallyManager::updateStatistics() {
+  // only histories whose scores have been added to the tally data are
+  // included, so queued histories are left for a later update
+  unsigned long num_scored = numScoredHistories();
+
+  if (statistics_batch_size == 0 || num_scored < next_statistics_update)
+    return;
+
+  std::chrono::duration<double> elapsed;
+  elapsed = std::chrono::steady_clock::now() - statistics_start;
+
+  std::map<int, TallyStatistics>::iterator it;
+  for (it = statistics.begin(); it != statistics.end(); ++it) {
+    TallyData* data = observers[it->first]->data;
+
+    if (it->second.is_summary()) {
+      double max_rel_error = data->get_max_rel_error(num_scored);
+      it->second.update_summary(num_scored, max_rel_error, elapsed.count());
+    } else {
+      double sums[4];
+      data->get_monitor_sums(sums);
+      it->second.update(num_scored, sums, elapsed.count());
+    }
+  }
+
+  next_statistics_update = num_scored + statistics_batch_size;
+}
+//---------------------------------------------------------------------------//
+void TallyManager::writeCheckpoint(std::ostream& out) {
+  // header, followed by its checksum
+  Checksum checksum;
+  uint32_t num_tallies = observers.size();
+  uint64_t counts[3] = {num_histories, num_dispatched, num_rejected};
+
+  write_bytes(out, checksum, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  write_bytes(out, checksum, &CHECKPOINT_VERSION, sizeof(CHECKPOINT_VERSION));
+  write_bytes(out, checksum, &BYTE_ORDER_MARK, sizeof(BYTE_ORDER_MARK));
+  write_bytes(out, checksum, &num_tallies, sizeof(num_tallies));
+  write_bytes(out, checksum, counts, sizeof(counts));
+
+  uint64_t sum = checksum.get();
+  out.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
+
+  // one record for each Tally, each followed by its own checksum
+  std::vector<double> state;
+  std::map<int, Tally*>::iterator map_it;
+
+  for (map_it = observers.begin(); map_it != observers.end(); ++map_it) {
+    Tally* tally = map_it->second;
+    const std::string& type = tally->input_data.tally_type;
+
+    int length = 0;
+    double* tally_data = tally->data->get_tally_data(length);
+    double* error_data = tally->data->get_error_data(length);
+    tally->get_checkpoint_state(state);
+
+    CheckpointRecord record;
+    record.tally_id = map_it->first;
+    record.particle = tally->input_data.particle;
+    record.num_energy_bins = tally->data->get_num_energy_bins();
+    record.type_length = type.size();
+    record.data_length = length;
+    record.state_length = state.size();
+
+    Checksum record_checksum;
+    write_record(out, record_checksum, record);
+    write_bytes(out, record_checksum, type.data(), type.size());
+    write_bytes(out, record_checksum, tally_data, length * sizeof(double));
+    write_bytes(out, record_checksum, error_data, length * sizeof(double));
+
+    if (!state.empty()) {
+      write_bytes(out, record_checksum, &state[0],
+                  state.size() * sizeof(double));
+    }
+
+    sum = record_checksum.get();
+    out.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
+  }
+}
+//---------------------------------------------------------------------------//
+void TallyManager::submitEventQueue() {
+  worker_pool->wait();
+  collectScoredQueue();
+
+  if (event_queue->empty())
+    return;
+
+  // keep adding events while the full queue is scored
+  std::swap(event_queue, scoring_queue);
+  worker_pool->start(queue_task, numQueueItems());
+}
+//---------------------------------------------------------------------------//
+void TallyManager::collectScoredQueue() {
+  unsigned long num_updates = scoring_queue->num_events();
+  num_updates *= queued_tallies.size();
+
+  for (unsigned int i = 0; i < queued_dispatched.size(); ++i) {
+    num_dispatched += queued_dispatched[i];
+    num_updates -= queued_dispatched[i];
+    queued_dispatched[i] = 0;
+  }
+
+  num_rejected += num_updates;
+  num_queued_histories -= scoring_queue->size() - scoring_queue->num_events();
+  scoring_queue->clear();
+
+  // no worker is scoring, so the statistics can be updated
+  updateStatistics();
+}
+//---------------------------------------------------------------------------//
+unsigned long TallyManager::numScoredHistories() const {
+  return num_histories - num_queued_histories;
+}
+//---------------------------------------------------------------------------//
+unsigned int TallyManager::numQueueItems() const {
+  if (num_rand_tallies == 0)
+    return queued_tallies.size();
+
+  return queued_tallies.size() - num_rand_tallies + 1;
+}
+//---------------------------------------------------------------------------//
+void TallyManager::scoreQueuedEvents(unsigned int index) {
+  unsigned int first = index;
+  unsigned int last = index + 1;
+
+  // the tallies that use rand() are all scored by the first item
+  if (num_rand_tallies > 0) {
+    first = (index == 0) ? 0 : index + num_rand_tallies - 1;
+    last = (index == 0) ? num_rand_tallies : first + 1;
+  }
+
+  for (unsigned int i = 0; i < scoring_queue->size(); ++i) {
+    for (unsigned int j = first; j < last; ++j) {
+      scoreQueuedEntry(j, i);
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+void TallyManager::scoreQueuedEntry(unsigned int index, unsigned int entry) {
+  Tally* tally = queued_tallies[index];
+  TallyEvent::EventType type = scoring_queue->get_type(entry);
+
+  if (type == TallyEvent::NONE) {
+    tally->end_history();
+    return;
+  }
+
+  // use the same criteria as the dispatch lists
+  const TallyInput& input = tally->input_data;
+  double energy = scoring_queue->get_energy(entry);
+
+  if (scoring_queue->get_particle(entry) != input.particle ||
+      !tally->scores_event_type(type) ||
+      energy < input.energy_bin_bounds.front() ||
+      energy > input.energy_bin_bounds.back())
+    return;
+
+  scoring_queue->get_event(entry, queued_events[index]);
+  tally->compute_score(queued_events[index]);
+  ++queued_dispatched[index];
+}
+//---------------------------------------------------------------------------//
 
 // end of MCNP5/dagmc/TallyManager.cpp
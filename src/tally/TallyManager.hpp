@@ -3,8 +3,17 @@
 #ifndef DAGMC_TALLY_MANAGER_HPP
 #define DAGMC_TALLY_MANAGER_HPP
 
+#include <chrono>
+#include <ostream>
+#include <thread>
+
 #include "Tally.hpp"
+#include "TallyContext.hpp"
 #include "TallyEvent.hpp"
+#include "TallyEventQueue.hpp"
+#include "TallyEventRecorder.hpp"
+#include "TallyStatistics.hpp"
+#include "TallyWorkerPool.hpp"
 
 //===========================================================================//
 /**
@@ -20,11 +29,15 @@
  * DAGMC tally types that are currently available include
  *
  *     "unstr_track": Unstructured tracklength mesh tally (TrackLengthMeshTally)
+ *     "struct_track": Cartesian tracklength mesh tally (StructuredMeshTally)
+ *     "cyl_track": Cylindrical tracklength mesh tally (StructuredMeshTally)
  *     "kde_coll": KDE collision mesh tally (KDEMeshTally)
  *     "kde_subtrack": KDE sub-track mesh tally (KDEMeshTally)
  *     "kde_track": KDE integral-track mesh tally (KDEMeshTally)
  *     "cell_coll": Simple collision-based cell tally (CellTally)
  *     "cell_track": Simple track-based cell tally (CellTally)
+ *     "cell_coll_all": Collision-based tally of all cells (MultiCellTally)
+ *     "cell_track_all": Track-based tally of all cells (MultiCellTally)
  *
  * See the individual implementations for a more detailed description and a
  * list of all available tally options for that particular tally type.  The
@@ -48,11 +61,13 @@
  *
  * After an event type has been set, the TallyManager can then be used to
  * updateTallies().  This will compute the scores for all currently active
- * tallies, based on the tally event data that was set.  If a particular event
- * type is not compatible with a specific DAGMC tally type, then nothing will
- * happen and the code will move on to the next tally in the list.  Note that
- * when updateTallies() has updated all of the tallies it will then reset the
- * event data using clearLastEvent().
+ * tallies, based on the tally event data that was set.  Each event is only
+ * passed to the tallies that score its event type and particle and whose
+ * energy bins include the particle energy.  These are found from dispatch
+ * lists that are rebuilt whenever a tally is added or removed, and the
+ * number of tally updates that were dispatched or skipped is reported by
+ * writeData().  Note that when updateTallies() has updated all of the
+ * tallies it will then reset the event data using clearLastEvent().
  *
  * As each particle history is completed, the endHistory() method should be
  * called through the TallyManager.  This adds the current sum of scores to
@@ -79,6 +94,88 @@
  * multiplier ID in the Tally so that it has access to that multiplier during
  * the transport process for computing its scores.  As the multiplier values
  * change, use updateMultiplier() to update their values in the TallyManager.
+ *
+ * ================
+ * Threaded Scoring
+ * ================
+ *
+ * Particle histories can also be scored by several threads at once.  Each
+ * thread creates its own TallyContext, and then uses the versions of the
+ * event, multiplier and update methods that take a TallyContext in place of
+ * the methods described above.  Each history must be started with
+ * beginHistory(), which is given a unique history id that is independent of
+ * the thread, and ended with endHistory().  Scores are stored in the
+ * TallyContext until endBatch() is called with all of the contexts once the
+ * threads have finished, which adds them to the tallies in order of their
+ * history ids.  The results are then bitwise identical for any number of
+ * threads, and match a serial run of the same histories in that order.
+ *
+ * TallyManager itself must not be modified while the threads are scoring,
+ * and only tallies that override Tally::compute_score() for a TallyContext
+ * can be used.  KDE collision tallies do not update their optimal bandwidth
+ * when scored in this way.
+ *
+ * ============
+ * Event Queues
+ * ============
+ *
+ * Scoring can also be moved off the thread that is tracking particles by
+ * calling enableEventQueue().  updateTallies() and endHistory() then add the
+ * event or the end of the history to a TallyEventQueue instead of updating
+ * the tallies.  Once the queue is full it is handed to a TallyWorkerPool,
+ * which scores all queued entries for each Tally on one of its threads while
+ * further events are added to a second queue.  Each Tally is only scored by
+ * one thread at a time and processes the entries in order, so the results
+ * are the same as when each event is scored as it occurs.  Tallies that use
+ * rand(), such as KDE sub-track tallies, are all scored by the same thread
+ * one entry at a time in tally id order, so that they also draw the same
+ * random numbers as when each event is scored as it occurs.
+ *
+ * Queued events are always scored before tallies are added or removed,
+ * multipliers are assigned, or any tally data is accessed, so the methods of
+ * TallyManager can be called in the same way as without a queue.
+ * flushEventQueue() can also be used to score the queued events directly.
+ *
+ * =================
+ * Tally Convergence
+ * =================
+ *
+ * The convergence of each Tally can be monitored while histories are being
+ * tracked by calling enableStatistics().  A TallyStatistics is then kept for
+ * each Tally, which by default monitors the largest relative error over all
+ * of its scored bins, so that a mesh tally only converges once every scored
+ * mesh cell has.  setStatisticsBin() monitors one bin of a Tally instead,
+ * which adds its mean, VOV and batch-means relative error.  The statistics
+ * are updated after each batch of histories has been ended with endHistory()
+ * or added with endBatch(), and include the relative error, figure of merit
+ * and the results of a set of statistical checks.  Host codes can use
+ * isConverged() to stop once all of the monitored tallies have reached the
+ * target relative error and passed all of the checks, instead of tracking a
+ * fixed number of histories.
+ *
+ * Statistics only include the histories since they were enabled, or since
+ * the tally data was last reset or restored.  With an event queue, the
+ * statistics are not updated when a history ends, as its events may not have
+ * been scored yet.  They are instead updated whenever the worker threads have
+ * finished scoring a queue, from the histories that have been scored by then,
+ * so monitoring never stops the tracking thread to wait for the workers.
+ * Each update may then include more histories than the batch size.
+ *
+ * ===============
+ * Event Recording
+ * ===============
+ *
+ * The active tallies and all events that are scored can be written to a
+ * binary event stream by calling startRecording().  Each later call that
+ * changes the tallies or multipliers, sets an event, updates the tallies or
+ * ends a history is then recorded by a TallyEventRecorder until
+ * stopRecording() is called.  A TallyEventReader can replay the stream into
+ * another TallyManager, which adds the same tallies and gives the same
+ * results without rerunning the transport.  The tally_replay tool uses this
+ * to benchmark tallies with the events of a production run.
+ *
+ * Only the serial methods are recorded, so histories scored in a
+ * TallyContext are not included.
  */
 //===========================================================================//
 class TallyManager {
@@ -88,6 +185,13 @@ class TallyManager {
    */
   TallyManager();
 
+  /**
+   * \brief Destructor
+   *
+   * Scores any queued events, stops the worker threads and stops recording.
+   */
+  ~TallyManager();
+
   // >>> PUBLIC INTERFACE
 
   /**
@@ -194,15 +298,241 @@ class TallyManager {
   /**
    * \brief Call compute_score() for all active DAGMC tallies
    *
-   * Resets the tally event once all scores are computed.
+   * Resets the tally event once all scores are computed.  If the event queue
+   * is enabled, then the event is queued to be scored later instead.
    */
   void updateTallies();
 
   /**
    * \brief Call end_history() for all active DAGMC tallies
+   *
+   * If the event queue is enabled, then the end of the history is queued.
    */
   void endHistory();
 
+  // >>> THREADED SCORING METHODS
+
+  /**
+   * \brief Start a new particle history in a TallyContext
+   * \param[in, out] context the scoring context of the calling thread
+   * \param[in] history_id the unique id of the history
+   *
+   * Creates the scratch data for any active tallies that do not have it
+   * yet, copies the current multiplier values and resets the random number
+   * stream of the context for this history.
+   */
+  void beginHistory(TallyContext& context, unsigned long history_id);
+
+  /**
+   * \brief Set a collision event in a TallyContext
+   * \param[in, out] context the scoring context of the calling thread
+   *
+   * See setCollisionEvent() for the other parameters.
+   */
+  bool setCollisionEvent(TallyContext& context, unsigned int particle,
+                         double x, double y, double z,
+                         double particle_energy, double particle_weight,
+                         double total_cross_section, int cell_id);
+
+  /**
+   * \brief Set a track event in a TallyContext
+   * \param[in, out] context the scoring context of the calling thread
+   *
+   * See setTrackEvent() for the other parameters.
+   */
+  bool setTrackEvent(TallyContext& context, unsigned int particle,
+                     double x, double y, double z,
+                     double u, double v, double w,
+                     double particle_energy, double particle_weight,
+                     double track_length, int cell_id);
+
+  /**
+   * \brief Update the value associated with the multiplier ID in a TallyContext
+   * \param[in, out] context the scoring context of the calling thread
+   * \param[in] multiplier_id the unique ID for the multiplier
+   * \param[in] value the value of the multiplier
+   */
+  void updateMultiplier(TallyContext& context, unsigned int multiplier_id,
+                        double value);
+
+  /**
+   * \brief Call compute_score() for all active DAGMC tallies in a TallyContext
+   * \param[in, out] context the scoring context of the calling thread
+   *
+   * Resets the tally event of the context once all scores are computed.
+   */
+  void updateTallies(TallyContext& context);
+
+  /**
+   * \brief End the current particle history in a TallyContext
+   * \param[in, out] context the scoring context of the calling thread
+   */
+  void endHistory(TallyContext& context);
+
+  /**
+   * \brief Add all histories that ended in the given contexts to the tallies
+   * \param[in] contexts the scoring contexts of all threads
+   *
+   * Histories are added in order of their history ids, so the results do not
+   * depend on the order of the contexts or how histories were distributed
+   * between them.  The histories are then removed from the contexts.  This
+   * must not be called while any of the contexts are in use.
+   */
+  void endBatch(const std::vector<TallyContext*>& contexts);
+
+  // >>> EVENT QUEUE METHODS
+
+  /**
+   * \brief Queue events so that they are scored in bulk on worker threads
+   * \param[in] capacity the number of entries in each event queue
+   * \param[in] num_threads the number of worker threads used for scoring
+   *
+   * Each event and the end of each history takes one entry.  If num_threads
+   * is zero, then full queues are scored by the calling thread instead.  Any
+   * existing queue is flushed and replaced.
+   */
+  void enableEventQueue(unsigned int capacity, unsigned int num_threads);
+
+  /**
+   * \brief Flush the event queue and return to scoring each event directly
+   */
+  void disableEventQueue();
+
+  /**
+   * \brief Score all queued events and wait for the scores to be computed
+   *
+   * Does nothing if the event queue is not enabled.
+   */
+  void flushEventQueue();
+
+  // >>> STATISTICS METHODS
+
+  /**
+   * \brief Starts monitoring the convergence of all active tallies
+   * \param[in] batch_size the number of histories between updates
+   * \param[in] target_rel_error the relative error needed to converge
+   *
+   * Each Tally is monitored by the largest relative error over all of its
+   * scored bins.  Tallies that are added later are also monitored.  Replaces
+   * any previous statistics.
+   */
+  void enableStatistics(unsigned long batch_size,
+                        double target_rel_error = 0.1);
+
+  /**
+   * \brief Stops monitoring the convergence of all tallies
+   */
+  void disableStatistics();
+
+  /**
+   * \brief Monitors the convergence of one bin of a Tally
+   * \param[in] tally_id the unique ID of the Tally
+   * \param[in] tally_point the index of the tally point
+   * \param[in] energy_bin the index of the energy bin
+   * \return true if the bin was set; false otherwise
+   *
+   * Replaces the summary over all bins of the Tally.  The statistics of the
+   * Tally are restarted from the current histories, so the bin should be
+   * set before any histories are added.
+   */
+  bool setStatisticsBin(unsigned int tally_id, unsigned int tally_point,
+                        unsigned int energy_bin);
+
+  /**
+   * \brief Gets the statistics of a Tally
+   * \param[in] tally_id the unique ID of the Tally
+   * \return the statistics, or NULL if the Tally is not monitored
+   */
+  const TallyStatistics* getStatistics(unsigned int tally_id) const;
+
+  /**
+   * \brief Checks if all monitored tallies have converged
+   * \return true if statistics are enabled and all of the monitored tallies
+   *         passed all of their statistical checks at the last update
+   */
+  bool isConverged() const;
+
+  /**
+   * \brief getNumHistories()
+   * \return the number of histories ended since the tally data was reset
+   */
+  unsigned long getNumHistories() const;
+
+  // >>> RECORDING METHODS
+
+  /**
+   * \brief Starts recording all calls to this TallyManager
+   * \param[in] filename the name of the event stream to write
+   * \return true if recording started; false otherwise
+   *
+   * The active tallies, multipliers and multiplier values are recorded first
+   * so that the stream can be replayed on its own.  Stops any previous
+   * recording.  This should be called between histories.
+   */
+  bool startRecording(const std::string& filename);
+
+  /**
+   * \brief Stops recording and closes the event stream
+   * \return true if the whole event stream was written; false otherwise
+   */
+  bool stopRecording();
+
+  /**
+   * \brief isRecording()
+   * \return true if calls are being recorded
+   */
+  bool isRecording() const;
+
+  // >>> CHECKPOINT METHODS
+
+  /**
+   * \brief Write the data of all active tallies to a binary checkpoint file
+   * \param[in] filename the name of the checkpoint file
+   * \param[in] in_background if true, write the file on a separate thread
+   * \return true if the checkpoint was written or started; false otherwise
+   *
+   * The raw tally and error data arrays are written with the id, type,
+   * particle and number of energy bins of each Tally, along with the number
+   * of histories, the number of tally updates dispatched and rejected and
+   * any extra state returned by Tally::get_checkpoint_state().  The file starts with a format version and
+   * a byte order mark, and each record has a checksum.  It is first written
+   * to filename.tmp and then renamed, so an existing checkpoint is only
+   * replaced once the new one is complete.
+   *
+   * If in_background is true, the checkpoint is copied into memory and this
+   * method returns while a separate thread writes the file, so transport is
+   * only stopped for the copy.  waitForCheckpoint() gives the result.  Only
+   * one checkpoint is written at a time, so this first waits for the
+   * previous one to finish.
+   *
+   * Any queued events are scored first.  Scores from the current history and
+   * from a TallyContext that has not been added with endBatch() are not
+   * included, so this should be called between histories.
+   */
+  bool checkpoint(const std::string& filename, bool in_background = false);
+
+  /**
+   * \brief Wait for a checkpoint that is written in the background
+   * \return true if the last checkpoint written in the background is
+   *         complete, or if none were written; false otherwise
+   */
+  bool waitForCheckpoint();
+
+  /**
+   * \brief Restore the data of all active tallies from a checkpoint file
+   * \param[in] filename the name of the checkpoint file
+   * \return true if the tally data was restored; false otherwise
+   *
+   * The same tallies must have been added as when the checkpoint was written.
+   * If the file does not match the active tallies then nothing is changed,
+   * but if the data fails its checksum then all tally data is set to zero.
+   * The extra state of each Tally is only restored if all data is valid.
+   * The number of histories is restored with the data, so getNumHistories()
+   * continues from the count at the checkpoint.  Any statistics are
+   * restarted, and only include later histories.
+   */
+  bool restore(const std::string& filename);
+
   /**
    * \brief Call write_data() for all active DAGMC tallies
    * \param[in] num_histories the number of particle histories tracked
@@ -228,16 +558,106 @@ class TallyManager {
 
   /**
    * \brief Resets all data arrays for all active Tally Observers
+   *
+   * Also resets the dispatch counts.
    */
   void zeroAllTallyData();
 
+  /**
+   * \brief getNumDispatched(), getNumRejected()
+   * \return number of tally updates that were dispatched to a Tally or
+   *         rejected without calling it
+   *
+   * Each event counts once for every active Tally.  Counts from a
+   * TallyContext are included once endBatch() has been called.
+   */
+  unsigned long getNumDispatched() const;
+  unsigned long getNumRejected() const;
+
  private:
+  /// Copy constructor and operator= methods are not implemented
+  TallyManager(const TallyManager& obj);
+  TallyManager& operator=(const TallyManager& obj);
+
   // Keep a record of the currently active Tally Observers
   std::map<int, Tally*> observers;
 
+  // Input of each active Tally with the options it was added with, which are
+  // needed to record the Tally
+  std::map<int, TallyInput> tally_inputs;
+
   // Store event data read by all active DAGMC tallies
   TallyEvent event;
 
+  // Tally that may score events of one type and particle, along with the
+  // range of energies that it accepts
+  struct DispatchEntry {
+    Tally* tally;
+    double min_energy;
+    double max_energy;
+  };
+
+  // Tallies that may score each (event type, particle), in tally id order
+  typedef std::pair<int, unsigned int> DispatchKey;
+  std::map<DispatchKey, std::vector<DispatchEntry> > dispatch_lists;
+
+  // Number of tally updates dispatched to a Tally or rejected
+  unsigned long num_dispatched;
+  unsigned long num_rejected;
+
+  // Scores the events in scoring_queue for one of the queued_tallies
+  class QueueTask : public TallyWorkerPool::Task {
+   public:
+    explicit QueueTask(TallyManager* manager) : manager(manager) {}
+
+    void run(unsigned int index) {
+      manager->scoreQueuedEvents(index);
+    }
+
+   private:
+    TallyManager* manager;
+  };
+
+  // Queue that events are added to and queue that is being scored, which
+  // are both NULL if the event queue is not enabled
+  TallyEventQueue* event_queue;
+  TallyEventQueue* scoring_queue;
+  TallyWorkerPool* worker_pool;
+  QueueTask queue_task;
+
+  // Tallies scored from the event queue, along with an event and the number
+  // of tally updates dispatched for each one.  The first num_rand_tallies
+  // use rand() and are scored together, followed by all other tallies, and
+  // both groups are in tally id order
+  std::vector<Tally*> queued_tallies;
+  unsigned int num_rand_tallies;
+  std::vector<TallyEvent> queued_events;
+  std::vector<unsigned long> queued_dispatched;
+
+  // Number of histories ended since the tally data was reset, and the
+  // number of those whose end is still waiting in the event queues
+  unsigned long num_histories;
+  unsigned long num_queued_histories;
+
+  // Statistics of each monitored Tally, keyed by tally id, along with the
+  // number of histories between updates, which is zero if statistics are
+  // not enabled
+  std::map<int, TallyStatistics> statistics;
+  unsigned long statistics_batch_size;
+  double target_rel_error;
+
+  // Number of histories at the next update, and time of the last reset
+  unsigned long next_statistics_update;
+  std::chrono::steady_clock::time_point statistics_start;
+
+  // Recorder that calls are written to, or NULL if they are not recorded
+  TallyEventRecorder* recorder;
+
+  // Thread that writes a checkpoint in the background, and whether the last
+  // one it wrote is complete
+  std::thread checkpoint_thread;
+  bool checkpoint_written;
+
   // >>> PRIVATE METHODS
 
   /**
@@ -258,6 +678,7 @@ class TallyManager {
 
   /**
    * \brief Sets up TallyEvent
+   * \param[out] tally_event the TallyEvent to set
    * \param[in] type the type of event to be tallied
    * \param[in] particle the type of particle to be tallied
    * \param[in] x, y, z the position of the particle
@@ -269,12 +690,108 @@ class TallyManager {
    * \param[in] cell_id the unique ID for the current geometric cell
    * \return true if an event was set; false otherwise
    */
-  bool setEvent(TallyEvent::EventType type, unsigned int particle,
+  bool setEvent(TallyEvent& tally_event,
+                TallyEvent::EventType type, unsigned int particle,
                 double x, double y, double z,
                 double u, double v, double w,
                 double particle_energy, double particle_weight,
                 double track_length, double total_cross_section,
                 int cell_id);
+
+  /**
+   * \brief Resets a TallyEvent
+   * \param[out] tally_event the TallyEvent to reset
+   *
+   * Sets event type to NONE and clears all event data except multipliers.
+   */
+  static void clearEvent(TallyEvent& tally_event);
+
+  /**
+   * \brief Rebuilds the dispatch lists from the active Tally Observers
+   */
+  void buildDispatchLists();
+
+  /**
+   * \brief Calls compute_score() for the tallies that may score an event
+   * \param[in] tally_event the event to be scored
+   * \param[in, out] context if not NULL, the TallyContext to score into
+   * \return the number of tallies to which the event was dispatched
+   */
+  unsigned int dispatchEvent(const TallyEvent& tally_event,
+                             TallyContext* context);
+
+  /**
+   * \brief Starts monitoring the convergence of a Tally
+   * \param[in] tally_id the unique ID of the Tally
+   * \param[in] summary true to monitor all bins; false to monitor the bin
+   *            set in its TallyData
+   *
+   * Replaces any previous statistics of the Tally.
+   */
+  void addStatistics(unsigned int tally_id, bool summary);
+
+  /**
+   * \brief Restarts the statistics of all monitored tallies
+   *
+   * Later updates only include the histories that are ended after this.
+   */
+  void resetStatistics();
+
+  /**
+   * \brief Updates the statistics if a batch of histories has been scored
+   */
+  void updateStatistics();
+
+  /**
+   * \brief Writes the checkpoint of all active tallies to a stream
+   * \param[in] out the stream that the checkpoint is written to
+   */
+  void writeCheckpoint(std::ostream& out);
+
+  /**
+   * \brief Hands the event queue to the worker threads for scoring
+   *
+   * Waits for the previous queue to be scored first, and then continues
+   * adding events to that queue.
+   */
+  void submitEventQueue();
+
+  /**
+   * \brief Adds the tally update counts of the scored queue and clears it
+   *
+   * Must only be called once the worker threads have finished.  Updates the
+   * statistics if a batch of histories has now been scored.
+   */
+  void collectScoredQueue();
+
+  /**
+   * \brief Gets the number of ended histories that have been scored
+   * \return the number of histories whose end is not waiting in a queue
+   */
+  unsigned long numScoredHistories() const;
+
+  /**
+   * \brief Gets the number of items scored by the worker threads per queue
+   * \return one item for each Tally, with all tallies using rand() as one
+   */
+  unsigned int numQueueItems() const;
+
+  /**
+   * \brief Calls compute_score() and end_history() for one item of the queue
+   * \param[in] index the index of the item, from 0 to numQueueItems()
+   *
+   * Item 0 scores all tallies that use rand() if there are any, and each
+   * other item scores one Tally in queued_tallies.  Processes all entries in
+   * scoring_queue in order, and is called by the worker threads.
+   */
+  void scoreQueuedEvents(unsigned int index);
+
+  /**
+   * \brief Calls compute_score() or end_history() for one queued Tally
+   * \param[in] index the index of the Tally in queued_tallies
+   * \param[in] entry the index of the entry in scoring_queue
+   */
+  void scoreQueuedEntry(unsigned int index, unsigned int entry);
 };
 
 #endif // DAGMC_TALLY_MANAGER_HPP
@@ -0,0 +1,335 @@
+// MCNP5/dagmc/TallyStatistics.cpp
+
+#include <algorithm>
+#include <cmath>
+
+#include "TallyStatistics.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+namespace {
+// names of the statistical checks, in the order of TallyStatistics::Check
+const char* const CHECK_NAMES[] = {"mean random",
+                                   "relative error target",
+                                   "relative error decreasing",
+                                   "relative error 1/sqrt(N)",
+                                   "VOV target",
+                                   "VOV decreasing",
+                                   "VOV 1/N",
+                                   "FOM constant",
+                                   "FOM random"
+                                  };
+
+// largest VOV that passes VOV_TARGET
+const double VOV_LIMIT = 0.1;
+
+// largest fractional difference of FOM from its average for FOM_CONSTANT
+const double FOM_TOLERANCE = 0.1;
+
+// largest difference of the R and VOV slopes from their expected values
+const double SLOPE_TOLERANCE = 0.2;
+
+// true if values never increase
+bool non_increasing(const std::vector<double>& values) {
+  for (unsigned int i = 1; i < values.size(); ++i) {
+    if (values[i] > values[i - 1])
+      return false;
+  }
+
+  return true;
+}
+
+// true if values never increase or never decrease
+bool monotonic(const std::vector<double>& values) {
+  std::vector<double> negated(values.size());
+
+  for (unsigned int i = 0; i < values.size(); ++i) {
+    negated[i] = -values[i];
+  }
+
+  return non_increasing(values) || non_increasing(negated);
+}
+
+// least squares slope of log(y) against log(x), which must all be positive
+double log_slope(const std::vector<double>& x, const std::vector<double>& y) {
+  double n = x.size();
+  double sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_xy = 0.0;
+
+  for (unsigned int i = 0; i < x.size(); ++i) {
+    double log_x = log(x[i]);
+    double log_y = log(y[i]);
+    sum_x += log_x;
+    sum_y += log_y;
+    sum_xx += log_x * log_x;
+    sum_xy += log_x * log_y;
+  }
+
+  double denominator = n * sum_xx - sum_x * sum_x;
+  return denominator > 0.0 ? (n * sum_xy - sum_x * sum_y) / denominator : 0.0;
+}
+} // namespace
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+TallyStatistics::TallyStatistics(double target_rel_error, bool summary)
+  : target_rel_error(target_rel_error), summary(summary) {
+  const double sums[4] = {0.0, 0.0, 0.0, 0.0};
+  reset(0, sums, 0.0);
+}
+//---------------------------------------------------------------------------//
+// PUBLIC INTERFACE
+//---------------------------------------------------------------------------//
+void TallyStatistics::update(unsigned long num_histories,
+                             const double total_sums[4],
+                             double elapsed_seconds) {
+  if (num_histories <= base_histories + last_histories)
+    return;
+
+  // only include the histories since the last reset
+  num_histories -= base_histories;
+  elapsed_seconds -= base_seconds;
+  double sums[4];
+
+  for (unsigned int i = 0; i < 4; ++i) {
+    sums[i] = total_sums[i] - base_sums[i];
+  }
+
+  // add the mean history score of this batch to the batch means
+  double batch_score = (sums[0] - last_sum) / (num_histories - last_histories);
+  ++num_batches;
+  double delta = batch_score - batch_mean;
+  batch_mean += delta / num_batches;
+  batch_m2 += delta * (batch_score - batch_mean);
+
+  last_histories = num_histories;
+  last_sum = sums[0];
+
+  // compute the statistics of the tally bin from the sums of the scores
+  double n = num_histories;
+  Sample sample = {num_histories, sums[0] / n, 0.0, 0.0, 0.0};
+
+  if (sums[0] != 0.0) {
+    double r2 = sums[1] / (sums[0] * sums[0]) - 1.0 / n;
+    sample.rel_error = r2 > 0.0 ? sqrt(r2) : 0.0;
+
+    double variance = sums[1] - sums[0] * sums[0] / n;
+
+    if (variance > 0.0) {
+      double m4 = sums[3] - 4.0 * sums[0] * sums[2] / n
+                  + 6.0 * sums[0] * sums[0] * sums[1] / (n * n)
+                  - 3.0 * pow(sums[0], 4) / (n * n * n);
+      sample.vov = m4 / (variance * variance) - 1.0 / n;
+    }
+
+    if (r2 > 0.0 && elapsed_seconds > 0.0)
+      sample.fom = 60.0 / (r2 * elapsed_seconds);
+  }
+
+  add_sample(sample);
+}
+//---------------------------------------------------------------------------//
+void TallyStatistics::update_summary(unsigned long num_histories,
+                                     double max_rel_error,
+                                     double elapsed_seconds) {
+  if (num_histories <= base_histories + last_histories)
+    return;
+
+  // only include the histories since the last reset
+  num_histories -= base_histories;
+  elapsed_seconds -= base_seconds;
+  ++num_batches;
+  last_histories = num_histories;
+
+  Sample sample = {num_histories, 0.0, max_rel_error, 0.0, 0.0};
+
+  if (max_rel_error > 0.0 && elapsed_seconds > 0.0)
+    sample.fom = 60.0 / (max_rel_error * max_rel_error * elapsed_seconds);
+
+  add_sample(sample);
+}
+//---------------------------------------------------------------------------//
+void TallyStatistics::reset(unsigned long num_histories, const double sums[4],
+                            double elapsed_seconds) {
+  base_histories = num_histories;
+  base_seconds = elapsed_seconds;
+  std::copy(sums, sums + 4, base_sums);
+
+  samples.clear();
+  last_histories = 0;
+  last_sum = 0.0;
+  num_batches = 0;
+  batch_mean = 0.0;
+  batch_m2 = 0.0;
+  std::fill(checks, checks + NUM_CHECKS, false);
+}
+//---------------------------------------------------------------------------//
+double TallyStatistics::get_mean() const {
+  return samples.empty() ? 0.0 : samples.back().mean;
+}
+//---------------------------------------------------------------------------//
+double TallyStatistics::get_rel_error() const {
+  return samples.empty() ? 0.0 : samples.back().rel_error;
+}
+//---------------------------------------------------------------------------//
+double TallyStatistics::get_vov() const {
+  return samples.empty() ? 0.0 : samples.back().vov;
+}
+//---------------------------------------------------------------------------//
+double TallyStatistics::get_fom() const {
+  return samples.empty() ? 0.0 : samples.back().fom;
+}
+//---------------------------------------------------------------------------//
+double TallyStatistics::get_batch_rel_error() const {
+  if (num_batches < 2 || batch_mean == 0.0)
+    return 0.0;
+
+  double variance = batch_m2 / (num_batches - 1);
+  return sqrt(variance / num_batches) / fabs(batch_mean);
+}
+//---------------------------------------------------------------------------//
+unsigned long TallyStatistics::get_num_histories() const {
+  return last_histories;
+}
+//---------------------------------------------------------------------------//
+unsigned long TallyStatistics::get_num_batches() const {
+  return num_batches;
+}
+//---------------------------------------------------------------------------//
+bool TallyStatistics::is_summary() const {
+  return summary;
+}
+//---------------------------------------------------------------------------//
+bool TallyStatistics::applies(TallyStatistics::Check check) const {
+  if (check >= NUM_CHECKS)
+    return false;
+
+  // the mean and VOV of a summary are not known
+  return !summary || (check != MEAN_RANDOM && check != VOV_TARGET &&
+                      check != VOV_DECREASING && check != VOV_RATE);
+}
+//---------------------------------------------------------------------------//
+bool TallyStatistics::passed(TallyStatistics::Check check) const {
+  return applies(check) && checks[check];
+}
+//---------------------------------------------------------------------------//
+bool TallyStatistics::converged() const {
+  return count_checks(true) == count_checks(false);
+}
+//---------------------------------------------------------------------------//
+void TallyStatistics::write_summary(std::ostream& out) const {
+  out << "    histories = " << last_histories
+      << ", batches = " << num_batches << std::endl;
+  if (summary) {
+    out << "    largest relative error of all scored bins = "
+        << get_rel_error() << ", FOM = " << get_fom() << std::endl;
+  } else {
+    out << "    mean = " << get_mean()
+        << ", relative error = " << get_rel_error()
+        << ", batch relative error = " << get_batch_rel_error() << std::endl;
+    out << "    VOV = " << get_vov()
+        << ", FOM = " << get_fom() << std::endl;
+  }
+
+  unsigned int num_applicable = count_checks(false);
+  out << "    statistical checks passed: " << count_checks(true)
+      << " of " << num_applicable;
+
+  if (num_applicable < NUM_CHECKS)
+    out << " (" << NUM_CHECKS - num_applicable << " not applicable)";
+
+  out << std::endl;
+
+  for (unsigned int i = 0; i < NUM_CHECKS; ++i) {
+    Check check = static_cast<Check>(i);
+
+    if (!applies(check))
+      out << "        not applicable: " << CHECK_NAMES[i] << std::endl;
+    else if (!checks[i])
+      out << "        failed: " << CHECK_NAMES[i] << std::endl;
+  }
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+unsigned int TallyStatistics::count_checks(bool passed_only) const {
+  unsigned int count = 0;
+
+  for (unsigned int i = 0; i < NUM_CHECKS; ++i) {
+    Check check = static_cast<Check>(i);
+
+    if (applies(check) && (!passed_only || checks[i]))
+      ++count;
+  }
+
+  return count;
+}
+//---------------------------------------------------------------------------//
+void TallyStatistics::add_sample(const Sample& sample) {
+  samples.push_back(sample);
+  make_checks();
+}
+//---------------------------------------------------------------------------//
+void TallyStatistics::make_checks() {
+  std::fill(checks, checks + NUM_CHECKS, false);
+
+  // find the updates in the last half of the histories
+  unsigned int first = samples.size();
+
+  while (first > 0 && 2 * samples[first - 1].num_histories >= last_histories) {
+    --first;
+  }
+
+  if (samples.size() - first < MIN_UPDATES)
+    return;
+
+  std::vector<double> histories, means, rel_errors, vovs, foms;
+
+  for (unsigned int i = first; i < samples.size(); ++i) {
+    const Sample& sample = samples[i];
+
+    // the bin must have been scored with a variance in all of the updates
+    if (sample.rel_error <= 0.0 || (!summary && sample.vov <= 0.0))
+      return;
+
+    histories.push_back(sample.num_histories);
+    means.push_back(sample.mean);
+    rel_errors.push_back(sample.rel_error);
+    vovs.push_back(sample.vov);
+    foms.push_back(sample.fom);
+  }
+
+  checks[REL_ERROR_TARGET] = rel_errors.back() <= target_rel_error;
+  checks[REL_ERROR_DECREASING] = non_increasing(rel_errors);
+  checks[REL_ERROR_RATE] =
+    fabs(log_slope(histories, rel_errors) + 0.5) <= SLOPE_TOLERANCE;
+
+  // the mean and VOV of a summary are not known, so those checks only
+  // apply to a single bin
+  if (!summary) {
+    checks[MEAN_RANDOM] = !monotonic(means);
+    checks[VOV_TARGET] = vovs.back() < VOV_LIMIT;
+    checks[VOV_DECREASING] = non_increasing(vovs);
+    checks[VOV_RATE] =
+      fabs(log_slope(histories, vovs) + 1.0) <= SLOPE_TOLERANCE;
+  }
+
+  // FOM is only known if the time taken was given
+  double average_fom = 0.0;
+
+  for (unsigned int i = 0; i < foms.size(); ++i) {
+    average_fom += foms[i] / foms.size();
+  }
+
+  checks[FOM_CONSTANT] = average_fom > 0.0;
+
+  for (unsigned int i = 0; i < foms.size(); ++i) {
+    if (fabs(foms[i] - average_fom) > FOM_TOLERANCE * average_fom)
+      checks[FOM_CONSTANT] = false;
+  }
+
+  checks[FOM_RANDOM] = average_fom > 0.0 && !monotonic(foms);
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/TallyStatistics.cpp
@@ -0,0 +1,232 @@
+// MCNP5/dagmc/TallyStatistics.hpp
+
+#ifndef DAGMC_TALLY_STATISTICS_HPP
+#define DAGMC_TALLY_STATISTICS_HPP
+
+#include <iostream>
+#include <vector>
+
+//===========================================================================//
+/**
+ * \class TallyStatistics
+ * \brief Monitors the convergence of a tally as histories are added
+ *
+ * TallyStatistics is updated after each batch of particle histories with the
+ * total number of histories and the sums of the first four powers of the
+ * history scores for one tally bin.  Each update records the mean, relative
+ * error (R), relative variance of the variance (VOV) and figure of merit
+ * (FOM = 1 / (R^2 T), with T in minutes) of the bin, and the mean history
+ * score of the batch, which is used to find the batch-means relative error.
+ *
+ * The following checks are then made over the updates in the last half of
+ * the histories, based on the statistical checks of MCNP
+ *
+ *     0) MEAN_RANDOM: the mean does not change monotonically
+ *     1) REL_ERROR_TARGET: R is not greater than the target relative error
+ *     2) REL_ERROR_DECREASING: R does not increase
+ *     3) REL_ERROR_RATE: R decreases as 1/sqrt(N)
+ *     4) VOV_TARGET: VOV is less than 0.1
+ *     5) VOV_DECREASING: VOV does not increase
+ *     6) VOV_RATE: VOV decreases as 1/N
+ *     7) FOM_CONSTANT: FOM stays within 10% of its average
+ *     8) FOM_RANDOM: FOM does not change monotonically
+ *
+ * The rates are found from the slope of log(R) or log(VOV) against log(N),
+ * which must be within 0.2 of -0.5 and -1.0 respectively.  All checks fail
+ * until the last half contains at least MIN_UPDATES updates.  The slope of
+ * the tail of the history score distribution, the tenth MCNP check, is not
+ * made as the individual history scores are not kept.
+ *
+ * A summary TallyStatistics monitors a whole tally instead of one bin.  It
+ * is updated with the largest relative error over all scored bins, which is
+ * used as R for the REL_ERROR and FOM checks.  The mean and VOV are not
+ * known for a summary, so they are zero and MEAN_RANDOM and the VOV checks
+ * do not apply.  These checks never pass, and a summary converges once the
+ * other five checks pass.
+ */
+//===========================================================================//
+class TallyStatistics {
+ public:
+  /**
+   * \brief Defines the statistical checks that are made
+   */
+  enum Check {MEAN_RANDOM = 0,
+              REL_ERROR_TARGET = 1,
+              REL_ERROR_DECREASING = 2,
+              REL_ERROR_RATE = 3,
+              VOV_TARGET = 4,
+              VOV_DECREASING = 5,
+              VOV_RATE = 6,
+              FOM_CONSTANT = 7,
+              FOM_RANDOM = 8,
+              NUM_CHECKS = 9
+             };
+
+  /// Minimum number of updates in the last half before checks can pass
+  static const unsigned int MIN_UPDATES = 4;
+
+  /**
+   * \brief Constructor
+   * \param[in] target_rel_error the relative error needed to converge
+   * \param[in] summary true if update_summary() is used instead of update()
+   */
+  explicit TallyStatistics(double target_rel_error, bool summary = false);
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief Adds the results of the histories since the last update
+   * \param[in] num_histories the total number of histories
+   * \param[in] sums the sums of the history scores to the powers 1 to 4
+   * \param[in] elapsed_seconds the total time taken by the histories
+   *
+   * Updates with no new histories are ignored.  The statistics only include
+   * the histories since the last reset().
+   */
+  void update(unsigned long num_histories, const double sums[4],
+              double elapsed_seconds);
+
+  /**
+   * \brief Adds the largest relative error of a summary after more histories
+   * \param[in] num_histories the total number of histories
+   * \param[in] max_rel_error the largest relative error over all scored bins
+   * \param[in] elapsed_seconds the total time taken by the histories
+   *
+   * Updates with no new histories are ignored.
+   */
+  void update_summary(unsigned long num_histories, double max_rel_error,
+                      double elapsed_seconds);
+
+  /**
+   * \brief Restarts the statistics from the given totals
+   * \param[in] num_histories the total number of histories
+   * \param[in] sums the sums of the history scores to the powers 1 to 4
+   * \param[in] elapsed_seconds the total time taken by the histories
+   *
+   * Later updates only include the histories that are added after this.
+   */
+  void reset(unsigned long num_histories, const double sums[4],
+             double elapsed_seconds);
+
+  /**
+   * \brief get_mean(), get_rel_error(), get_vov(), get_fom()
+   * \return the mean, relative error, VOV and FOM of the last update
+   *
+   * All values are zero until an update in which the bin has been scored.
+   * For a summary, get_rel_error() is the largest relative error over all
+   * scored bins, and the mean and VOV are always zero.
+   */
+  double get_mean() const;
+  double get_rel_error() const;
+  double get_vov() const;
+  double get_fom() const;
+
+  /**
+   * \brief Gets the relative error estimated from the batch means
+   * \return the batch-means relative error, or zero if there are fewer than
+   *         two batches or the mean is zero
+   */
+  double get_batch_rel_error() const;
+
+  /**
+   * \brief get_num_histories(), get_num_batches()
+   * \return the number of histories and updates since the last reset()
+   */
+  unsigned long get_num_histories() const;
+  unsigned long get_num_batches() const;
+
+  /**
+   * \brief Checks if these statistics are a summary over all bins
+   * \return true if update_summary() is used; false otherwise
+   */
+  bool is_summary() const;
+
+  /**
+   * \brief Checks if a statistical check is made for these statistics
+   * \param[in] check the statistical check
+   * \return true if the check is made; false if it is not applicable
+   *
+   * MEAN_RANDOM and the VOV checks do not apply to a summary.
+   */
+  bool applies(Check check) const;
+
+  /**
+   * \brief Checks if one statistical check passed at the last update
+   * \param[in] check the statistical check
+   * \return true if the check applies and passed; false otherwise
+   */
+  bool passed(Check check) const;
+
+  /**
+   * \brief Checks if all applicable statistical checks passed at the last
+   *        update
+   * \return true if the tally bin has converged; false otherwise
+   */
+  bool converged() const;
+
+  /**
+   * \brief Writes a summary of the statistics and checks
+   * \param[in] out the stream to write to
+   */
+  void write_summary(std::ostream& out) const;
+
+ private:
+  // Statistics of the tally bin at one update
+  struct Sample {
+    unsigned long num_histories;
+    double mean;
+    double rel_error;
+    double vov;
+    double fom;
+  };
+
+  // Relative error needed to pass REL_ERROR_TARGET
+  double target_rel_error;
+
+  // True if the largest relative error over all bins is monitored
+  bool summary;
+
+  // Statistics at each update, in order
+  std::vector<Sample> samples;
+
+  // Number of histories, sums of scores and time at the last reset
+  unsigned long base_histories;
+  double base_sums[4];
+  double base_seconds;
+
+  // Number of histories and sum of scores since the reset at the last update
+  unsigned long last_histories;
+  double last_sum;
+
+  // Running mean and sum of squared deviations of the batch means
+  unsigned long num_batches;
+  double batch_mean;
+  double batch_m2;
+
+  // Results of the statistical checks at the last update
+  bool checks[NUM_CHECKS];
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Counts the statistical checks that apply
+   * \param[in] passed_only if true, only count the checks that passed
+   * \return the number of checks
+   */
+  unsigned int count_checks(bool passed_only) const;
+
+  /**
+   * \brief Adds a sample and makes all statistical checks
+   * \param[in] sample the statistics since the last reset
+   */
+  void add_sample(const Sample& sample);
+
+  /**
+   * \brief Makes all statistical checks for the current samples
+   */
+  void make_checks();
+};
+
+#endif // DAGMC_TALLY_STATISTICS_HPP
+
+// end of MCNP5/dagmc/TallyStatistics.hpp
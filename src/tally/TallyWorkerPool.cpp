@@ -0,0 +1,97 @@
+// MCNP5/dagmc/TallyWorkerPool.cpp
+
+#include "TallyWorkerPool.hpp"
+
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+TallyWorkerPool::TallyWorkerPool(unsigned int num_threads)
+  : task(NULL), num_items(0), next_item(0), num_running(0), stopping(false) {
+  for (unsigned int i = 0; i < num_threads; ++i) {
+    threads.push_back(std::thread(&TallyWorkerPool::run_worker, this));
+  }
+}
+//---------------------------------------------------------------------------//
+// DESTRUCTOR
+//---------------------------------------------------------------------------//
+TallyWorkerPool::~TallyWorkerPool() {
+  wait();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  task_started.notify_all();
+
+  for (unsigned int i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+  }
+}
+//---------------------------------------------------------------------------//
+// PUBLIC INTERFACE
+//---------------------------------------------------------------------------//
+void TallyWorkerPool::start(Task& new_task, unsigned int new_num_items) {
+  wait();
+
+  if (new_num_items == 0)
+    return;
+
+  // without worker threads the task is run before returning
+  if (threads.empty()) {
+    for (unsigned int i = 0; i < new_num_items; ++i) {
+      new_task.run(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    task = &new_task;
+    num_items = new_num_items;
+    next_item = 0;
+    num_running = 0;
+  }
+  task_started.notify_all();
+}
+//---------------------------------------------------------------------------//
+void TallyWorkerPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (task != NULL) {
+    task_finished.wait(lock);
+  }
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+void TallyWorkerPool::run_worker() {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    while (!stopping && (task == NULL || next_item == num_items)) {
+      task_started.wait(lock);
+    }
+
+    if (stopping)
+      return;
+
+    // process the next item without holding the lock
+    Task* current_task = task;
+    unsigned int item = next_item++;
+    ++num_running;
+
+    lock.unlock();
+    current_task->run(item);
+    lock.lock();
+
+    --num_running;
+
+    if (next_item == num_items && num_running == 0) {
+      task = NULL;
+      task_finished.notify_all();
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/TallyWorkerPool.cpp
@@ -0,0 +1,113 @@
+// MCNP5/dagmc/TallyWorkerPool.hpp
+
+#ifndef DAGMC_TALLY_WORKER_POOL_HPP
+#define DAGMC_TALLY_WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//===========================================================================//
+/**
+ * \class TallyWorkerPool
+ * \brief Runs tally scoring tasks on a fixed set of worker threads
+ *
+ * A task is given to the pool with start(), along with the number of items
+ * that it has to process.  Each worker thread takes the next unprocessed
+ * item and calls Task::run() for it until all items have been processed.
+ * Items are independent of each other and may be run in any order, but
+ * each item is only ever run by one thread.
+ *
+ * start() returns as soon as the task has been given to the workers, so the
+ * calling thread can continue with other work.  wait() blocks until all items
+ * of the current task have been processed.  Only one task is run at a time,
+ * so start() also waits for the previous task to finish.
+ *
+ * A TallyWorkerPool with no threads runs all items on the calling thread
+ * before start() returns.
+ */
+//===========================================================================//
+class TallyWorkerPool {
+ public:
+  /**
+   * \class Task
+   * \brief Defines the interface for work that is run by a TallyWorkerPool
+   */
+  class Task {
+   public:
+    virtual ~Task() {}
+
+    /**
+     * \brief Processes one item of the task
+     * \param[in] index the index of the item, from 0 to the number of items
+     */
+    virtual void run(unsigned int index) = 0;
+  };
+
+  /**
+   * \brief Constructor
+   * \param[in] num_threads the number of worker threads to create
+   */
+  explicit TallyWorkerPool(unsigned int num_threads);
+
+  /**
+   * \brief Destructor
+   *
+   * Waits for the current task to finish and stops all worker threads.
+   */
+  ~TallyWorkerPool();
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief Starts running a task on the worker threads
+   * \param[in] task the task to run, which must exist until it has finished
+   * \param[in] num_items the number of items to be processed
+   */
+  void start(Task& task, unsigned int num_items);
+
+  /**
+   * \brief Waits for all items of the current task to be processed
+   */
+  void wait();
+
+  /**
+   * \brief get_num_threads()
+   * \return number of worker threads in the pool
+   */
+  unsigned int get_num_threads() const {
+    return threads.size();
+  }
+
+ private:
+  /// Copy constructor and operator= methods are not implemented
+  TallyWorkerPool(const TallyWorkerPool& obj);
+  TallyWorkerPool& operator=(const TallyWorkerPool& obj);
+
+  // Worker threads and the synchronization of the current task
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable task_started;
+  std::condition_variable task_finished;
+
+  // Current task, which is NULL once all of its items have been processed
+  Task* task;
+  unsigned int num_items;
+  unsigned int next_item;
+  unsigned int num_running;
+
+  // Set when the worker threads should exit
+  bool stopping;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Processes items of each task until the pool is stopped
+   */
+  void run_worker();
+};
+
+#endif // DAGMC_TALLY_WORKER_POOL_HPP
+
+// end of MCNP5/dagmc/TallyWorkerPool.hpp
@@ -4,6 +4,8 @@
 #include <sstream>
 #include <cmath>
 #include <set>
+#include <map>
+#include <algorithm>
 
 #include "moab/Core.hpp"
 #include "moab/Range.hpp"
@@ -34,6 +36,8 @@
 
 // the header file has at least one assert, so keep this include below the macro checks
 #include "TrackLengthMeshTally.hpp"
+#include "TallyContext.hpp"
+#include "VTKMeshWriter.hpp"
 
 // tolerance for ray-triangle intersection tests
 // (note: this paramater is ignored by GeomUtil, so don't bother trying to tune it)
@@ -122,7 +126,8 @@ TrackLengthMeshTally::TrackLengthMeshTally(const TallyInput& input)
     last_visited_tet(0),
     last_cell(-1),
     convex(false),
-    conformal_surface_source(false) {
+    conformal_surface_source(false),
+    walk(false) {
   std::cout << "Creating dagmc mesh tally" << input.tally_id
             << ", input: " << input_filename
             << ", output: " << output_filename << std::endl;
@@ -141,9 +146,9 @@ TrackLengthMeshTally::TrackLengthMeshTally(const TallyInput& input)
 
   // initialize MeshTally::tally_points to include all mesh cells
   set_tally_points(all_tets);
-  // build the kdtree
+  // copy the tets out of MOAB into the flat mesh store
   // Does not change all_tets
-  rval = compute_barycentric_data(all_tets);
+  rval = build_mesh_store(all_tets);
   assert(rval == MB_SUCCESS);
 
   // Perform tasks
@@ -165,55 +170,18 @@ TrackLengthMeshTally::~TrackLengthMeshTally() {
 // DERIVED PUBLIC INTERFACE from Tally.hpp
 //---------------------------------------------------------------------------//
 void TrackLengthMeshTally::compute_score(const TallyEvent& event) {
-  // If it's not the type we want leave immediately
-  if (event.type != TallyEvent::TRACK)
-    return;
-
-  unsigned int ebin;
-  if (!get_energy_bin(event.particle_energy, ebin)) {
-    return;
-  }
-
-  double weight = event.get_score_multiplier(input_data.multiplier_id);
-
-  std::vector<double> intersections;     // vector of distance to triangular facet intersections
-  std::vector< EntityHandle > triangles; // vector of entityhandles that belong to the triangles hit
-  //  std::vector<ray_data> hit_information; // vector of reformated ray triangle intersections
-
-  // get all ray-triangle intersections along the ray
-  ErrorCode rval = get_all_intersections(event.position, event.direction, event.track_length, triangles, intersections);
-  if (rval != MB_SUCCESS) {
-    std::cout << "we have a problem finding intersections" << std::endl;
-    exit(1);
-  }
-
-  EntityHandle tet; // tet
-  if (intersections.size() == 0)
-    // ray is so short it either does not intersect a triangular face, or it inside the mesh
-    // but can't reach
-  {
-    // tet = point_in_which_tet(event.position);
-    tet = point_in_which_tet(event.position);
-    // if tet value is greater than 0 then in a tet, otherwise not
-    if (tet == 0) {
-      return;
-    } else {
-      // determine tracklength to return
-      add_score_to_mesh_tally(tet, weight, event.track_length, ebin);
-      //    found_crossing = true;
-      return;
-    }
-  }
-
-  // sort the intersection data
-  sort_intersection_data(intersections, triangles);
-
-  // compute the tracklengths
-  compute_tracklengths(event, ebin, weight, intersections);
-
-  return;
+  score_event(event, *data);
+}
+//---------------------------------------------------------------------------//
+void TrackLengthMeshTally::compute_score(const TallyEvent& event,
+                                         TallyContext& context) {
+  score_event(event, context.get_scratch_data(input_data.tally_id));
 }
 
+//---------------------------------------------------------------------------//
+bool TrackLengthMeshTally::scores_event_type(TallyEvent::EventType type) const {
+  return type == TallyEvent::TRACK;
+}
 
 //---------------------------------------------------------------------------//
 // This may not need to be overridden, depending on whether conformality
@@ -228,87 +196,31 @@ void TrackLengthMeshTally::end_history() {
 void TrackLengthMeshTally::write_data(double num_histories) {
   ErrorCode rval;
 
-  Range all_tets;
-  rval = mb->get_entities_by_dimension(tally_mesh_set, 3, all_tets);
-  if (rval != MB_SUCCESS) {
-    std::cout << "Failed to get 3d entities" << std::endl;
-    exit(1);
-  }
-  assert(rval == MB_SUCCESS);
-
-
-  for (Range::const_iterator i = all_tets.begin(); i != all_tets.end(); ++i) {
-    EntityHandle t = *i;
-
-    CartVect v[4];
-
-    std::vector<EntityHandle> vtx;
-    mb->get_connectivity(&t, 1, vtx);
-    assert(vtx.size() == 4);
-
-    int k = 0;
-    for (std::vector<EntityHandle>::iterator j = vtx.begin(); j != vtx.end(); ++j) {
-      EntityHandle vertex = *j;
-      mb->get_coords(&vertex, 1, v[k++].array());
-    }
-
-    double volume = tet_volume(v[0], v[1], v[2], v[3]);
-    unsigned int tet_index = get_entity_index(t);
-
-    unsigned int num_ebins = data->get_num_energy_bins();
-
-    // if there is a total, dont do anything with it
-    if (data->has_total_energy_bin())
-      num_ebins--;
-
-    std::vector<double> tally_vect(num_ebins);
-    std::vector<double> error_vect(num_ebins);
-
-    for (unsigned j = 0; j < num_ebins ; ++j) {
-      std::pair <double, double> tally_data = data->get_data(tet_index, j);
-      double tally = tally_data.first;
-      double error = tally_data.second;
-
-      double score = (tally / (volume * num_histories));
-
-      // Use 0 as the error output value if nothing has been computed for this mesh cell;
-      // this reflects MCNP's approach to avoiding a divide-by-zero situation.
-      double rel_err = 0;
-      if (error != 0) {
-        rel_err = sqrt((error / (tally * tally)) - (1. / num_histories));
-      }
-
-      tally_vect[j] = score;
-      error_vect[j] = rel_err;
-    }
-
-    rval = mb->tag_set_data(tally_tag, &t, 1, tally_vect.data());
-    MB_CHK_SET_ERR_RET(rval, "Failed to set tally_tag " + std::to_string(rval) + " " + std::to_string(t));
-    rval = mb->tag_set_data(error_tag, &t, 1, error_vect.data());
-    MB_CHK_SET_ERR_RET(rval, "Failed to set error_tag " + std::to_string(rval) + " " + std::to_string(t));
+  // compute results for all tets in one pass over the tally data
+  std::vector<double> tally_vect, error_vect, total_tally, total_error;
+  data->get_results(num_histories, tet_volumes.data(),
+                    tally_vect, error_vect, total_tally, total_error);
 
+  std::vector<double> ww_lower;
+  rval = set_weight_windows(mb, tally_vect, error_vect, ww_lower);
+  MB_CHK_SET_ERR_RET(rval, "Failed to set weight windows " + std::to_string(rval));
 
-    // if we have a total bin, write it out
-    if (data->has_total_energy_bin()) {
-      int j = num_ebins++;
-      std::pair <double, double> tally_data = data->get_data(tet_index, j);
-      double tally = tally_data.first;
-      double error = tally_data.second;
+  if (is_vtk_output()) {
+    write_vtk(tally_vect, error_vect, total_tally, total_error, ww_lower);
+    return;
+  }
 
-      double score = (tally / (volume * num_histories));
+  rval = mb->tag_set_data(tally_tag, tally_points, tally_vect.data());
+  MB_CHK_SET_ERR_RET(rval, "Failed to set tally_tag " + std::to_string(rval));
+  rval = mb->tag_set_data(error_tag, tally_points, error_vect.data());
+  MB_CHK_SET_ERR_RET(rval, "Failed to set error_tag " + std::to_string(rval));
 
-      // Use 0 as the error output value if nothing has been computed for this mesh cell;
-      // this reflects MCNP's approach to avoiding a divide-by-zero situation.
-      double rel_err = 0;
-      if (error != 0) {
-        rel_err = sqrt((error / (tally * tally)) - (1. / num_histories));
-      }
-
-      rval = mb->tag_set_data(total_tally_tag, &t, 1, &score);
-      MB_CHK_SET_ERR_RET(rval, "Failed to set tally_tag " + std::to_string(rval) + " " + std::to_string(t));
-      rval = mb->tag_set_data(total_error_tag, &t, 1, &rel_err);
-      MB_CHK_SET_ERR_RET(rval, "Failed to set error_tag " + std::to_string(rval) + " " + std::to_string(t));
-    }
+  // if we have a total bin, write it out
+  if (data->has_total_energy_bin()) {
+    rval = mb->tag_set_data(total_tally_tag, tally_points, total_tally.data());
+    MB_CHK_SET_ERR_RET(rval, "Failed to set tally_tag " + std::to_string(rval));
+    rval = mb->tag_set_data(total_error_tag, tally_points, total_error.data());
+    MB_CHK_SET_ERR_RET(rval, "Failed to set error_tag " + std::to_string(rval));
   }
 
   std::vector<Tag> output_tags;
@@ -318,14 +230,59 @@ void TrackLengthMeshTally::write_data(double num_histories) {
     output_tags.push_back(total_tally_tag);
     output_tags.push_back(total_error_tag);
   }
+  if (!ww_lower.empty())
+    output_tags.push_back(ww_tag);
 
   rval = mb->write_file(output_filename.c_str(), NULL, NULL, &tally_mesh_set, 1, &(output_tags[0]), output_tags.size());
   assert(rval == MB_SUCCESS);
 
 }
 //---------------------------------------------------------------------------//
+unsigned long TrackLengthMeshTally::mesh_store_bytes() const {
+  return vertex_coords.size() * sizeof(double) +
+         tet_connectivity.size() * sizeof(uint32_t) +
+         tet_volumes.size() * sizeof(double) +
+         tet_neighbors.size() * sizeof(int32_t) +
+         tet_baryc_data.size() * sizeof(Matrix3);
+}
+//---------------------------------------------------------------------------//
 // PROTECTED METHODS
 //---------------------------------------------------------------------------//
+void TrackLengthMeshTally::write_vtk(const std::vector<double>& tally_vect,
+                                     const std::vector<double>& error_vect,
+                                     const std::vector<double>& total_tally,
+                                     const std::vector<double>& total_error,
+                                     const std::vector<double>& ww_lower) {
+  unsigned long num_tets = tet_volumes.size();
+  unsigned int num_ebins = tally_vect.size() / num_tets;
+
+  // stream the mesh store and results straight to the file
+  VTKMeshWriter writer(output_filename);
+  writer.write_points(vertex_coords.data(), vertex_coords.size() / 3);
+  writer.write_cells(tet_connectivity.data(), 4, num_tets,
+                     VTKMeshWriter::TETRA);
+
+  unsigned int num_fields = (total_tally.empty() ? 2 : 4) +
+                            (ww_lower.empty() ? 0 : 1);
+
+  writer.begin_cell_data(num_tets, num_fields);
+  writer.write_field("TALLY_TAG", tally_vect.data(), num_ebins);
+  writer.write_field("ERROR_TAG", error_vect.data(), num_ebins);
+
+  if (!total_tally.empty()) {
+    writer.write_field("TALLY_TAG_TOTAL", total_tally.data(), 1);
+    writer.write_field("ERROR_TAG_TOTAL", total_error.data(), 1);
+  }
+
+  if (!ww_lower.empty())
+    writer.write_field("WW_LOWER", ww_lower.data(), num_ebins);
+
+  if (!writer.close()) {
+    std::cerr << "Error: failed to write track length mesh tally "
+              << input_data.tally_id << " to " << output_filename << std::endl;
+  }
+}
+//---------------------------------------------------------------------------//
 void TrackLengthMeshTally::parse_tally_options() {
   const TallyInput::TallyOptions& options = input_data.options;
   TallyInput::TallyOptions::const_iterator it;
@@ -340,6 +297,8 @@ void TrackLengthMeshTally::parse_tally_options() {
       convex = true;
     else if (key == "conf_surf_src" && (val == "t" || val == "true"))
       conformal_surface_source = true;
+    else if (key == "walk" && (val == "t" || val == "true"))
+      walk = true;
     else if (key == "conformal") {
       // Since the options are a multimap, the conformal tag could (illogically) occur more than once
       if (conformality.empty()) {
@@ -428,19 +387,40 @@ void TrackLengthMeshTally::set_tally_meshset() {
   }
 }
 //---------------------------------------------------------------------------//
-ErrorCode TrackLengthMeshTally::compute_barycentric_data(const Range& all_tets) {
+ErrorCode TrackLengthMeshTally::build_mesh_store(const Range& all_tets) {
   ErrorCode rval;
 
-  // Iterate over all tets and compute barycentric matrices
   int num_tets = all_tets.size();
   std::cerr << "  There are " << num_tets << " tetrahedrons in this tally mesh." << std::endl;
 
-  if (num_tets != 0) {
-    tet_baryc_data.resize(num_tets);
+  Range all_verts;
+  rval = mb->get_connectivity(all_tets, all_verts);
+  if (rval != MB_SUCCESS) {
+    std::cout << "Failed to get connectivity information" << std::endl;
+    exit(1);
+  }
+
+  vertex_coords.resize(3 * all_verts.size());
+  if (!all_verts.empty()) {
+    rval = mb->get_coords(all_verts, &vertex_coords[0]);
+    if (rval != MB_SUCCESS) {
+      std::cout << "Failed to get coordinate data" << std::endl;
+      exit(1);
+    }
   }
 
+  tet_connectivity.resize(4 * num_tets);
+  tet_volumes.resize(num_tets);
+  tet_neighbors.assign(4 * num_tets, -1);
+  tet_baryc_data.resize(num_tets);
+
+  // faces keyed by their sorted vertices, waiting for the tet on the other side
+  typedef std::pair<uint32_t, std::pair<uint32_t, uint32_t> > FaceKey;
+  std::map<FaceKey, std::pair<int32_t, int> > open_faces;
+
   for (Range::const_iterator i = all_tets.begin(); i != all_tets.end(); ++i) {
     EntityHandle tet = *i;
+    unsigned int index = get_entity_index(tet);
 
     const EntityHandle* verts;
     int num_verts;
@@ -457,13 +437,12 @@ ErrorCode TrackLengthMeshTally::compute_barycentric_data(const Range& all_tets)
       return MB_NOT_IMPLEMENTED;
     }
 
+    uint32_t* conn = &tet_connectivity[4 * index];
     CartVect p[4];
-    rval = mb->get_coords(verts, 4, p[0].array());
-    if (rval != MB_SUCCESS) {
-      std::cout << "Failed to get coordinate data" << std::endl;
-      exit(1);
+    for (int k = 0; k < 4; ++k) {
+      conn[k] = all_verts.index(verts[k]);
+      p[k] = CartVect(&vertex_coords[3 * conn[k]]);
     }
-    assert(rval == MB_SUCCESS);
 
     CartVect row0 = p[1] - p[0];
     CartVect row1 = p[2] - p[0];
@@ -471,8 +450,32 @@ ErrorCode TrackLengthMeshTally::compute_barycentric_data(const Range& all_tets)
     Matrix3 a(row0[0], row0[1], row0[2],
               row1[0], row1[1], row1[2],
               row2[0], row2[1], row2[2]);
-    a = a.transpose().inverse();
-    tet_baryc_data.at(get_entity_index(tet)) = a;
+    tet_baryc_data[index] = a.transpose().inverse();
+    tet_volumes[index] = tet_volume(p[0], p[1], p[2], p[3]);
+
+    for (int k = 0; k < 4; ++k) {
+      uint32_t face[3];
+      for (int j = 0, n = 0; j < 4; ++j)
+        if (j != k)
+          face[n++] = conn[j];
+      std::sort(face, face + 3);
+      FaceKey key(face[0], std::make_pair(face[1], face[2]));
+
+      std::map<FaceKey, std::pair<int32_t, int> >::iterator it = open_faces.find(key);
+      if (it == open_faces.end()) {
+        open_faces[key] = std::make_pair((int32_t)index, k);
+      } else {
+        tet_neighbors[4 * index + k] = it->second.first;
+        tet_neighbors[4 * it->second.first + it->second.second] = index;
+        open_faces.erase(it);
+      }
+    }
+  }
+
+  std::cout << "  " << open_faces.size() << " tet faces lie on the mesh skin." << std::endl;
+  if (num_tets != 0) {
+    std::cout << "  Mesh store uses " << mesh_store_bytes() << " bytes ("
+              << mesh_store_bytes() / num_tets << " bytes per tet)." << std::endl;
   }
   return MB_SUCCESS;
 }
@@ -503,28 +506,132 @@ void TrackLengthMeshTally::build_trees(Range& all_tets) {
   std::cout << "done." << std::endl << std::endl;;
 }
 //---------------------------------------------------------------------------//
-bool TrackLengthMeshTally::point_in_tet(const CartVect& point,
-                                        const EntityHandle* tet) {
-  ErrorCode rval;
+void TrackLengthMeshTally::score_event(const TallyEvent& event,
+                                       TallyData& scores) {
+  // If it's not the type we want leave immediately
+  if (event.type != TallyEvent::TRACK)
+    return;
 
-  const EntityHandle* verts;
-  int num_verts;
-  rval = mb->get_connectivity(*tet, verts, num_verts);
-  if (rval != MB_SUCCESS) {
-    std::cout << "Failed to get connectivity information" << std::endl;
-    exit(1);
+  unsigned int ebin;
+  if (!get_energy_bin(event.particle_energy, ebin)) {
+    return;
   }
-  assert(rval == MB_SUCCESS);
 
-  CartVect p0;
-  rval = mb->get_coords(verts, 1, p0.array());
+  double weight = event.get_score_multiplier(input_data.multiplier_id);
+
+  if (walk)
+    score_by_walk(event, scores, ebin, weight);
+  else
+    score_by_intersections(event, scores, ebin, weight);
+}
+//---------------------------------------------------------------------------//
+void TrackLengthMeshTally::score_by_intersections(const TallyEvent& event,
+                                                  TallyData& scores,
+                                                  unsigned int ebin, double weight) {
+  std::vector<double> intersections;     // vector of distance to triangular facet intersections
+  std::vector< EntityHandle > triangles; // vector of entityhandles that belong to the triangles hit
+  //  std::vector<ray_data> hit_information; // vector of reformated ray triangle intersections
+
+  // get all ray-triangle intersections along the ray
+  ErrorCode rval = get_all_intersections(event.position, event.direction, event.track_length, triangles, intersections);
   if (rval != MB_SUCCESS) {
-    std::cout << "Failed to get coordinate information" << std::endl;
+    std::cout << "we have a problem finding intersections" << std::endl;
     exit(1);
   }
-  assert(rval == MB_SUCCESS);
 
-  Matrix3& Ainverse = tet_baryc_data[ get_entity_index(*tet) ];
+  int tet; // tet
+  if (intersections.size() == 0)
+    // ray is so short it either does not intersect a triangular face, or it inside the mesh
+    // but can't reach
+  {
+    // tet = point_in_which_tet(event.position);
+    tet = point_in_which_tet(event.position);
+    // if tet value is not negative then in a tet, otherwise not
+    if (tet < 0) {
+      return;
+    } else {
+      // determine tracklength to return
+      scores.add_score_to_tally(tet, weight * event.track_length, ebin);
+      //    found_crossing = true;
+      return;
+    }
+  }
+
+  // sort the intersection data
+  sort_intersection_data(intersections, triangles);
+
+  // compute the tracklengths
+  compute_tracklengths(event, scores, ebin, weight, intersections);
+
+  return;
+}
+//---------------------------------------------------------------------------//
+void TrackLengthMeshTally::score_by_walk(const TallyEvent& event,
+                                         TallyData& scores,
+                                         unsigned int ebin, double weight) {
+  int tet = point_in_which_tet(event.position);
+  if (tet < 0) {
+    // starts outside the mesh, it may still enter it further on
+    score_by_intersections(event, scores, ebin, weight);
+    return;
+  }
+
+  double dist = 0.0;
+  unsigned int steps = 0;
+  while (tet >= 0) {
+    const Matrix3& Ainverse = tet_baryc_data[tet];
+    CartVect p0(&vertex_coords[3 * tet_connectivity[4 * tet]]);
+
+    // barycentric coordinates along the track are linear in the distance,
+    // the track leaves through the face opposite the first one to reach 0
+    CartVect b = Ainverse * (event.position - p0);
+    CartVect db = Ainverse * event.direction;
+    double bary[4] = {1.0 - b[0] - b[1] - b[2], b[0], b[1], b[2]};
+    double dbary[4] = {-db[0] - db[1] - db[2], db[0], db[1], db[2]};
+
+    double exit_dist = HUGE_VAL;
+    int exit_face = -1;
+    for (int k = 0; k < 4; ++k) {
+      if (dbary[k] < 0.0) {
+        double d = -bary[k] / dbary[k];
+        if (d < exit_dist) {
+          exit_dist = d;
+          exit_face = k;
+        }
+      }
+    }
+    exit_dist = std::max(exit_dist, dist);
+
+    if (exit_dist >= event.track_length) {
+      scores.add_score_to_tally(tet, weight * (event.track_length - dist), ebin);
+      return;
+    }
+
+    // a track starting on a face may leave its first tet immediately
+    if (exit_dist > dist)
+      scores.add_score_to_tally(tet, weight * (exit_dist - dist), ebin);
+    dist = exit_dist;
+
+    // guard against cycling on degenerate tets
+    if (++steps > tally_points.size())
+      break;
+
+    tet = tet_neighbors[4 * tet + exit_face];
+  }
+
+  // left the mesh before the end of the track
+  if (!convex && dist < event.track_length) {
+    TallyEvent rest = event;
+    rest.position = event.position + event.direction * dist;
+    rest.track_length = event.track_length - dist;
+    score_by_intersections(rest, scores, ebin, weight);
+  }
+}
+//---------------------------------------------------------------------------//
+bool TrackLengthMeshTally::point_in_tet(const CartVect& point,
+                                        unsigned int tet) {
+  CartVect p0(&vertex_coords[3 * tet_connectivity[4 * tet]]);
+  const Matrix3& Ainverse = tet_baryc_data[tet];
 
   CartVect bary = (Ainverse) * (point - p0);
 
@@ -540,6 +647,7 @@ bool TrackLengthMeshTally::point_in_tet(const CartVect& point,
 ErrorCode TrackLengthMeshTally::get_all_intersections(const CartVect& position, const CartVect& direction, double track_length,
                                                       std::vector<EntityHandle>& triangles, std::vector<double>& intersections) {
 
+  std::lock_guard<std::mutex> lock(moab_mutex);
   ErrorCode result = kdtree->ray_intersect_triangles(kdtree_root, TRIANGLE_INTERSECTION_TOL,
                                                      direction.array(), position.array(), triangles,
                                                      intersections, 0, track_length);
@@ -554,29 +662,38 @@ ErrorCode TrackLengthMeshTally::get_all_intersections(const CartVect& position,
 /*
  * loop through all tets to find which one we are in
  */
-EntityHandle TrackLengthMeshTally::point_in_which_tet(const CartVect& point) {
+int TrackLengthMeshTally::point_in_which_tet(const CartVect& point) {
   ErrorCode rval;
   AdaptiveKDTreeIter tree_iter;
+  Range candidate_tets;
+
+  // only the kd-tree and MOAB queries need the lock
+  {
+    std::lock_guard<std::mutex> lock(moab_mutex);
 
-  // Check to see if starting point begins inside a tet
+    // Check to see if starting point begins inside a tet
 #if MB_VERSION_MAJOR == 4 && MB_VERSION_MINOR < 7
-  rval = kdtree->leaf_containing_point(kdtree_root, point.array(), tree_iter);
+    rval = kdtree->leaf_containing_point(kdtree_root, point.array(), tree_iter);
 #else
-  rval = kdtree->point_search(point.array(), tree_iter);
+    rval = kdtree->point_search(point.array(), tree_iter);
 #endif
 
+    if (rval == MB_SUCCESS) {
+      EntityHandle leaf = tree_iter.handle();
+      rval = mb->get_entities_by_dimension(leaf, 3, candidate_tets, false);
+      assert(rval == MB_SUCCESS);
+    }
+  }
+
   if (rval == MB_SUCCESS) {
-    EntityHandle leaf = tree_iter.handle();
-    Range candidate_tets;
-    rval = mb->get_entities_by_dimension(leaf, 3, candidate_tets, false);
-    assert(rval == MB_SUCCESS);
     for (Range::const_iterator i = candidate_tets.begin(); i != candidate_tets.end(); ++i) {
-      if (point_in_tet(point, &(*i))) {
-        return *i;
+      unsigned int tet = get_entity_index(*i);
+      if (point_in_tet(point, tet)) {
+        return tet;
       }
     }
   }
-  return 0;
+  return -1;
 }
 
 /*
@@ -629,16 +746,17 @@ void TrackLengthMeshTally::sort_intersection_data(std::vector<double>& intersect
 
 // function to compute the track lengths
 void TrackLengthMeshTally::compute_tracklengths(const TallyEvent& event,
+                                                TallyData& scores,
                                                 unsigned int ebin, double weight,
                                                 const std::vector<double>& intersections) {
   double track_length; // track_length to add to the tet
   CartVect hit_p; //position on the triangular face of the hit
   std::vector<CartVect> hit_point; // array of all hit points
   CartVect tet_centroid; // centroid position between intersect point
-  EntityHandle tet;
+  int tet;
   hit_point.push_back(event.position); // add the origin of the ray to the point to the list
 
-  EntityHandle next_tet = 0;
+  int next_tet = -1;
   // loop over all intersections
   for (unsigned int i = 0 ; i < intersections.size() ; i++) {
     // make the hit point, this is absolute 3d coordinate of the hit
@@ -652,8 +770,8 @@ void TrackLengthMeshTally::compute_tracklengths(const TallyEvent& event,
     // determine the tet that the point belongs to
     tet = point_in_which_tet(tet_centroid);
 
-    // if point in tet returns a valid entity handle
-    if (tet > 0) {
+    // if point in tet returns a valid tet index
+    if (tet >= 0) {
       if (i != 0)   // determine the track_length, the general case
         track_length = intersections[i] - intersections[i - 1];
       else
@@ -667,7 +785,7 @@ void TrackLengthMeshTally::compute_tracklengths(const TallyEvent& event,
         std::cout << tet << " " << next_tet << std::endl;
       }
       // Note: track_length is for the current tet; it is not the event tracklength
-      add_score_to_mesh_tally(tet, weight, track_length, ebin);
+      scores.add_score_to_tally(tet, weight * track_length, ebin);
     }
   }
 
@@ -694,8 +812,8 @@ void TrackLengthMeshTally::compute_tracklengths(const TallyEvent& event,
     // re-entrant mesh
     hit_p = (event.direction * average_distance) + event.position;
 
-    // determine the entity handle of the tet we are inside of, we cannot
-    // assert that the tet is != 0 since we rely on the tet being 0 for points
+    // determine the index of the tet we are inside of, we cannot
+    // assert that the tet is >= 0 since we rely on the tet being -1 for points
     // outside of a re-entrant mesh.
     tet = point_in_which_tet(hit_p);
 
@@ -707,8 +825,8 @@ void TrackLengthMeshTally::compute_tracklengths(const TallyEvent& event,
     }
 
     // if the point belongs to a tet, then we need to add the score
-    if (tet > 0) {
-      add_score_to_mesh_tally(tet, weight, track_length, ebin);
+    if (tet >= 0) {
+      scores.add_score_to_tally(tet, weight * track_length, ebin);
     }
   }
 }
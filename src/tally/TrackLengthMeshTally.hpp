@@ -5,7 +5,9 @@
 
 #include <string>
 #include <cassert>
+#include <mutex>
 #include <set>
+#include <stdint.h>
 
 #include "moab/Interface.hpp"
 #include "moab/CartVect.hpp"
@@ -55,6 +57,21 @@ class OrientedBoxTreeTool;
  * on the input mesh itself using the MOAB tagging feature.  Note that "tag"
  * name can only be set once, whereas multiple "tagval" values can be added.
  * This option is only used during setup to define the set of tally points.
+ *
+ * 3) "walk"="true"
+ * ----------------
+ * Score tracks by walking from tet to tet instead of intersecting the whole
+ * track with the mesh skin.  The starting tet is located once, then the
+ * track steps through shared faces using precomputed neighbour arrays, so
+ * the cost is proportional to the number of tets crossed.  Tracks that start
+ * outside the mesh, or leave it before they end, fall back to the default
+ * method for the part outside.
+ *
+ * 4) "ww"="method", "ww_norm"="value", "ww_max_error"="value"
+ * -----------------------------------------------------------
+ * Writes a weight-window map with one lower bound for each tet and energy
+ * group.  These options are processed through the MeshTally constructor.
+ * See MeshTally.hpp for more information.
  */
 //===========================================================================//
 class TrackLengthMeshTally : public MeshTally {
@@ -78,6 +95,24 @@ class TrackLengthMeshTally : public MeshTally {
    */
   virtual void compute_score(const TallyEvent& event);
 
+  /**
+   * \brief Computes scores for this TrackLengthMeshTally into a TallyContext
+   * \param[in] event the parameters needed to compute the scores
+   * \param[in, out] context the scoring context of the calling thread
+   *
+   * Several threads may score at once.  Their kd-tree and MOAB queries are
+   * made one at a time, as MOAB changes its traversal state and lookup
+   * caches while answering them.
+   */
+  virtual void compute_score(const TallyEvent& event, TallyContext& context);
+
+  /**
+   * \brief Checks if this TrackLengthMeshTally scores events of the given type
+   * \param[in] type the type of tally event
+   * \return true if compute_score() may score events of this type
+   */
+  virtual bool scores_event_type(TallyEvent::EventType type) const;
+
   /**
    * \brief Updates TrackLengthMeshTally when a particle history ends
    *
@@ -95,9 +130,23 @@ class TrackLengthMeshTally : public MeshTally {
    * output_filename set for this TrackLengthMeshTally.  These values are
    * normalized by both the number of particle histories that were tracked
    * and the volume of the mesh cell for which the results were computed.
+   *
+   * Results for all mesh cells are computed in a single pass over the tally
+   * data and set as tags on the whole range of tets at once.  VTK output
+   * files are streamed directly from the flat mesh store instead.
    */
   virtual void write_data(double num_histories);
 
+  /**
+   * \brief Memory used by the flat mesh store
+   * \return the number of bytes held for vertices, tets and neighbours
+   *
+   * All scoring reads mesh data from this store; MOAB is only used for
+   * locating points and intersecting tracks with the mesh faces, which is
+   * serialized by moab_mutex.
+   */
+  unsigned long mesh_store_bytes() const;
+
  protected:
   /// Copy constructor and operator= methods are not implemented
   TrackLengthMeshTally(const TrackLengthMeshTally& obj);
@@ -111,6 +160,10 @@ class TrackLengthMeshTally : public MeshTally {
   moab::AdaptiveKDTree* kdtree;
   moab::EntityHandle kdtree_root;
 
+  // Held during every kd-tree and MOAB query made while scoring, as MOAB
+  // queries on the same instance are not thread safe
+  std::mutex moab_mutex;
+
   // Oriented Box Tree variables
   OrientedBoxTreeTool* obb_tool;
   EntityHandle obbtree_root;
@@ -123,10 +176,22 @@ class TrackLengthMeshTally : public MeshTally {
   bool convex;
   bool conformal_surface_source;
 
+  // Optional tet-walk scoring flag
+  bool walk;
+
   // If not empty, user has asserted mesh tally geometry
   // conforms to the cells identified in this set
   std::set<int> conformality;
 
+  // Flat mesh store built once at setup and indexed like the tally points,
+  // so that scoring never calls back into MOAB: vertex coordinates (x,y,z
+  // per vertex), four vertex indices per tet, tet volumes and the four
+  // neighbours across the faces opposite each vertex (-1 on the mesh skin)
+  std::vector<double> vertex_coords;
+  std::vector<uint32_t> tet_connectivity;
+  std::vector<double> tet_volumes;
+  std::vector<int32_t> tet_neighbors;
+
   // Stores barycentric data for tetrahedrons
   std::vector<Matrix3> tet_baryc_data;
 
@@ -136,6 +201,24 @@ class TrackLengthMeshTally : public MeshTally {
 
   // >>> PROTECTED METHODS
 
+  /**
+   * \brief Writes results and the mesh store directly to a VTK output file
+   * \param[in] tally_vect the normalized results for each tet and energy bin
+   * \param[in] error_vect the relative errors for each tet and energy bin
+   * \param[in] total_tally the normalized results for the total energy bin
+   * \param[in] total_error the relative errors for the total energy bin
+   * \param[in] ww_lower the lower weight bounds, or empty if weight windows
+   *            were not requested
+   *
+   * Used instead of MOAB when the output file has a ".vtk" extension.  The
+   * fields have the same names as the tags written to H5M output files.
+   */
+  void write_vtk(const std::vector<double>& tally_vect,
+                 const std::vector<double>& error_vect,
+                 const std::vector<double>& total_tally,
+                 const std::vector<double>& total_error,
+                 const std::vector<double>& ww_lower);
+
   /**
    * \brief Parse the TallyInput options for this TrackLengthMeshTally
    */
@@ -153,11 +236,14 @@ class TrackLengthMeshTally : public MeshTally {
   void set_tally_meshset();
 
   /**
-   * \brief Computes the barycentric matrices for all tetrahedrons
+   * \brief Fills the flat mesh store for all tetrahedrons
    * \param[in] all_tets the set of tets extracted from the input mesh
    * \return the MOAB ErrorCode value
+   *
+   * Copies vertex coordinates and connectivity out of MOAB and computes the
+   * barycentric matrix, volume and face neighbours of every tet.
    */
-  ErrorCode compute_barycentric_data(const Range& all_tets);
+  ErrorCode build_mesh_store(const Range& all_tets);
 
   /**
    * \brief Constructs the KD and OBB trees from the mesh data
@@ -186,22 +272,50 @@ class TrackLengthMeshTally : public MeshTally {
   ErrorCode get_all_intersections(const CartVect& position, const CartVect& direction, double track_length,
                                   std::vector<EntityHandle>& triangles, std::vector<double>& intersections);
 
+  /**
+   * \brief Computes scores for a track event
+   * \param[in] event the tally event, direction, position, track_length, etc
+   * \param[in, out] scores the TallyData to which the scores are added
+   */
+  void score_event(const TallyEvent& event, TallyData& scores);
+
+  /**
+   * \brief Scores a track by intersecting it with all mesh faces at once
+   * \param[in] event the tally event, direction, position, track_length, etc
+   * \param[in, out] scores the TallyData to which the scores are added
+   * \param[in] ebin the energy bin index corresponding to the energy
+   * \param[in] weight the multiplier value for the score to be tallied
+   */
+  void score_by_intersections(const TallyEvent& event, TallyData& scores,
+                              unsigned int ebin, double weight);
+
+  /**
+   * \brief Scores a track by walking through neighbouring tets
+   * \param[in] event the tally event, direction, position, track_length, etc
+   * \param[in, out] scores the TallyData to which the scores are added
+   * \param[in] ebin the energy bin index corresponding to the energy
+   * \param[in] weight the multiplier value for the score to be tallied
+   *
+   * Falls back to score_by_intersections for any part of the track that is
+   * outside the mesh.
+   */
+  void score_by_walk(const TallyEvent& event, TallyData& scores,
+                     unsigned int ebin, double weight);
+
   /**
    * \brief Checks if the given point is inside the given tet
    * \param[in] point the coordinates of the point to test
-   * \param[in] tet the EntityHandle of the tet
+   * \param[in] tet the index of the tet in the tally points
    * \return true if the point falls inside tet; false otherwise
-   *
-   * Assumes that tet is part of this TrackLengthMeshTally.
    */
-  bool point_in_tet(const CartVect& point, const EntityHandle* tet);
+  bool point_in_tet(const CartVect& point, unsigned int tet);
 
   /**
    * \brief loop through all tets to find which tet, the point belong to
    * \param [in] point point to test
-   * \return entity handle to the tet which the point belongs to
+   * \return index of the tet which the point belongs to, -1 if none found
    */
-  EntityHandle point_in_which_tet(const CartVect& point);
+  int point_in_which_tet(const CartVect& point);
 
   /**
    * \brief return the tet_element in which the ray ends
@@ -231,12 +345,13 @@ class TrackLengthMeshTally : public MeshTally {
   /**
    * \brief return the tracklengths of the ray in each tet
    * \param[in] event the tally event, direction, position, track_length, etc
+   * \param[in, out] scores the TallyData to which the scores are added
    * \param[in] ebin the energy bin index corresponding to the energy
    * \param[in] weight the multiplier value for the score to be tallied
    * \param[in] vector<double> intersections list of all the intersections
    * \return void
    */
-  void compute_tracklengths(const TallyEvent& event,
+  void compute_tracklengths(const TallyEvent& event, TallyData& scores,
                             unsigned int ebin, double weight,
                             const std::vector<double>& intersections);
 
@@ -0,0 +1,134 @@
+// MCNP5/dagmc/VTKMeshWriter.cpp
+
+#include <algorithm>
+#include <cstring>
+
+#include "VTKMeshWriter.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+namespace {
+// size of the buffer used to convert values to big-endian
+const unsigned long BUFFER_BYTES = 1 << 16;
+
+// number of cells converted at a time by write_cells()
+const unsigned long CELL_CHUNK = 4096;
+
+// true if this machine stores values as little-endian
+bool is_little_endian() {
+  const uint32_t value = 1;
+  return *reinterpret_cast<const unsigned char*>(&value) == 1;
+}
+} // namespace
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+VTKMeshWriter::VTKMeshWriter(const std::string& filename,
+                             const std::string& title)
+  : file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc),
+    buffer(BUFFER_BYTES), num_tuples(0) {
+  file << "# vtk DataFile Version 3.0\n"
+       << title << "\n"
+       << "BINARY\n"
+       << "DATASET UNSTRUCTURED_GRID\n";
+}
+//---------------------------------------------------------------------------//
+// PUBLIC INTERFACE
+//---------------------------------------------------------------------------//
+void VTKMeshWriter::write_points(const double* coords,
+                                 unsigned long num_points) {
+  file << "POINTS " << num_points << " double\n";
+  write_binary(coords, 3 * num_points);
+  file << "\n";
+}
+//---------------------------------------------------------------------------//
+void VTKMeshWriter::write_cells(const uint32_t* connectivity,
+                                unsigned int verts_per_cell,
+                                unsigned long num_cells,
+                                VTKMeshWriter::CellType type) {
+  file << "CELLS " << num_cells << " "
+       << num_cells * (verts_per_cell + 1) << "\n";
+
+  // each cell is written as its number of vertices followed by the vertices
+  std::vector<int32_t> cells;
+  cells.reserve(CELL_CHUNK * (verts_per_cell + 1));
+
+  for (unsigned long i = 0; i < num_cells; i += CELL_CHUNK) {
+    unsigned long end = std::min(i + CELL_CHUNK, num_cells);
+    cells.clear();
+
+    for (unsigned long j = i; j < end; ++j) {
+      cells.push_back(verts_per_cell);
+      const uint32_t* conn = &connectivity[j * verts_per_cell];
+      cells.insert(cells.end(), conn, conn + verts_per_cell);
+    }
+
+    write_binary(cells.data(), cells.size());
+  }
+
+  file << "\nCELL_TYPES " << num_cells << "\n";
+  std::vector<int32_t> types(std::min(CELL_CHUNK, num_cells), type);
+
+  for (unsigned long i = 0; i < num_cells; i += CELL_CHUNK) {
+    write_binary(types.data(), std::min(CELL_CHUNK, num_cells - i));
+  }
+
+  file << "\n";
+}
+//---------------------------------------------------------------------------//
+void VTKMeshWriter::begin_cell_data(unsigned long num_tuples,
+                                    unsigned int num_fields) {
+  begin_data("CELL_DATA", num_tuples, num_fields);
+}
+//---------------------------------------------------------------------------//
+void VTKMeshWriter::begin_point_data(unsigned long num_tuples,
+                                     unsigned int num_fields) {
+  begin_data("POINT_DATA", num_tuples, num_fields);
+}
+//---------------------------------------------------------------------------//
+void VTKMeshWriter::write_field(const std::string& name, const double* values,
+                                unsigned int num_components) {
+  file << name << " " << num_components << " " << num_tuples << " double\n";
+  write_binary(values, num_components * num_tuples);
+  file << "\n";
+}
+//---------------------------------------------------------------------------//
+bool VTKMeshWriter::close() {
+  file.close();
+  return !file.fail();
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+void VTKMeshWriter::begin_data(const char* section, unsigned long num_tuples,
+                               unsigned int num_fields) {
+  this->num_tuples = num_tuples;
+  file << section << " " << num_tuples << "\n"
+       << "FIELD FieldData " << num_fields << "\n";
+}
+//---------------------------------------------------------------------------//
+template <typename T>
+void VTKMeshWriter::write_binary(const T* values, unsigned long count) {
+  if (!is_little_endian()) {
+    file.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+    return;
+  }
+
+  unsigned long chunk = BUFFER_BYTES / sizeof(T);
+
+  for (unsigned long i = 0; i < count; i += chunk) {
+    unsigned long n = std::min(chunk, count - i);
+    std::memcpy(buffer.data(), &values[i], n * sizeof(T));
+
+    // reverse the bytes of each value
+    for (unsigned long j = 0; j < n * sizeof(T); j += sizeof(T)) {
+      std::reverse(&buffer[j], &buffer[j] + sizeof(T));
+    }
+
+    file.write(buffer.data(), n * sizeof(T));
+  }
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/VTKMeshWriter.cpp
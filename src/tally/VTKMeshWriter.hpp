@@ -0,0 +1,125 @@
+// MCNP5/dagmc/VTKMeshWriter.hpp
+
+#ifndef DAGMC_VTK_MESH_WRITER_HPP
+#define DAGMC_VTK_MESH_WRITER_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//===========================================================================//
+/**
+ * \class VTKMeshWriter
+ * \brief Writes mesh tally results directly to a legacy binary VTK file
+ *
+ * VTKMeshWriter streams a mesh and its results from flat arrays to an
+ * UNSTRUCTURED_GRID dataset in the legacy VTK file format, without storing
+ * the results as tag data in MOAB.  Values are converted to big-endian in a
+ * fixed size buffer as they are written, so the memory used does not depend
+ * on the size of the mesh.
+ *
+ * The file must be written in the following order
+ *
+ *     1) write_points()
+ *     2) write_cells()
+ *     3) begin_cell_data() or begin_point_data()
+ *     4) write_field() once for each field declared in step 3
+ *     5) close()
+ *
+ * The fields are stored as FIELD arrays, so each field can have any number
+ * of components.  Any error when writing the file is reported by close().
+ */
+//===========================================================================//
+class VTKMeshWriter {
+ public:
+  /**
+   * \brief Defines the VTK cell types that can be written
+   */
+  enum CellType {VERTEX = 1, TETRA = 10, HEXAHEDRON = 12};
+
+  /**
+   * \brief Constructor
+   * \param[in] filename the name of the file to write
+   * \param[in] title the title written in the file header
+   */
+  explicit VTKMeshWriter(const std::string& filename,
+                         const std::string& title = "DAGMC mesh tally");
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief Writes the coordinates of the mesh vertices
+   * \param[in] coords the x, y and z coordinates of each vertex
+   * \param[in] num_points the number of vertices
+   */
+  void write_points(const double* coords, unsigned long num_points);
+
+  /**
+   * \brief Writes the mesh cells, which must all have the same type
+   * \param[in] connectivity the vertex indices of each cell
+   * \param[in] verts_per_cell the number of vertices of each cell
+   * \param[in] num_cells the number of cells
+   * \param[in] type the VTK cell type
+   */
+  void write_cells(const uint32_t* connectivity, unsigned int verts_per_cell,
+                   unsigned long num_cells, CellType type);
+
+  /**
+   * \brief begin_cell_data(), begin_point_data()
+   * \param[in] num_tuples the number of cells or vertices
+   * \param[in] num_fields the number of fields that will be written
+   *
+   * Starts the fields that are defined on the cells or vertices.
+   */
+  void begin_cell_data(unsigned long num_tuples, unsigned int num_fields);
+  void begin_point_data(unsigned long num_tuples, unsigned int num_fields);
+
+  /**
+   * \brief Writes one field of values
+   * \param[in] name the name of the field, which cannot contain spaces
+   * \param[in] values the values, ordered first by tuple then by component
+   * \param[in] num_components the number of values for each tuple
+   */
+  void write_field(const std::string& name, const double* values,
+                   unsigned int num_components);
+
+  /**
+   * \brief Closes the file
+   * \return true if the whole file was written; false otherwise
+   */
+  bool close();
+
+ private:
+  // Output file
+  std::ofstream file;
+
+  // Buffer used to convert values to big-endian before they are written
+  std::vector<char> buffer;
+
+  // Number of tuples in each field of the current data section
+  unsigned long num_tuples;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Writes the header of a data section
+   * \param[in] section "CELL_DATA" or "POINT_DATA"
+   * \param[in] num_tuples the number of cells or vertices
+   * \param[in] num_fields the number of fields that will be written
+   */
+  void begin_data(const char* section, unsigned long num_tuples,
+                  unsigned int num_fields);
+
+  /**
+   * \brief Writes values as big-endian binary data
+   * \param[in] values the values to write
+   * \param[in] count the number of values
+   */
+  template <typename T>
+  void write_binary(const T* values, unsigned long count);
+};
+
+#endif // DAGMC_VTK_MESH_WRITER_HPP
+
+// end of MCNP5/dagmc/VTKMeshWriter.hpp
@@ -0,0 +1,108 @@
+// MCNP5/dagmc/WeightWindowGenerator.cpp
+
+#include <cassert>
+
+#include "WeightWindowGenerator.hpp"
+
+//---------------------------------------------------------------------------//
+// CONSTRUCTOR
+//---------------------------------------------------------------------------//
+WeightWindowGenerator::WeightWindowGenerator(Method method,
+                                             double normalization,
+                                             double max_rel_error)
+  : method(method), normalization(normalization),
+    max_rel_error(max_rel_error) {}
+//---------------------------------------------------------------------------//
+bool WeightWindowGenerator::parse_method(const std::string& name,
+                                         Method& method) {
+  if (name == "magic") {
+    method = MAGIC;
+  } else if (name == "adjoint") {
+    method = ADJOINT;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------//
+double WeightWindowGenerator::default_normalization(Method method) {
+  return method == MAGIC ? 0.5 : 1.0;
+}
+//---------------------------------------------------------------------------//
+// PUBLIC INTERFACE
+//---------------------------------------------------------------------------//
+unsigned long
+WeightWindowGenerator::generate(unsigned int num_groups,
+                                const std::vector<double>& results,
+                                const std::vector<double>& rel_errors,
+                                const std::vector<double>& previous,
+                                std::vector<double>& lower_bounds) const {
+  assert(num_groups > 0);
+  assert(results.size() == rel_errors.size());
+  assert(previous.empty() || previous.size() == results.size());
+
+  unsigned long num_values = results.size();
+
+  if (previous.empty())
+    lower_bounds.assign(num_values, 0.0);
+  else
+    lower_bounds = previous;
+
+  // the magic method is normalized by the largest result in each group
+  std::vector<double> scale(num_groups, normalization);
+
+  if (method == MAGIC) {
+    std::vector<double> max_results(num_groups, 0.0);
+
+    for (unsigned long i = 0; i < num_values; ++i) {
+      unsigned int group = i % num_groups;
+
+      if (is_reliable(results[i], rel_errors[i]) &&
+          results[i] > max_results[group]) {
+        max_results[group] = results[i];
+      }
+    }
+
+    for (unsigned int j = 0; j < num_groups; ++j) {
+      if (max_results[j] > 0.0)
+        scale[j] = normalization / max_results[j];
+    }
+  }
+
+  unsigned long num_generated = 0;
+
+  for (unsigned long i = 0; i < num_values; ++i) {
+    if (!is_reliable(results[i], rel_errors[i]))
+      continue;
+
+    double scale_i = scale[i % num_groups];
+    lower_bounds[i] = (method == MAGIC) ? scale_i * results[i] :
+                      scale_i / results[i];
+    ++num_generated;
+  }
+
+  return num_generated;
+}
+//---------------------------------------------------------------------------//
+WeightWindowGenerator::Method WeightWindowGenerator::get_method() const {
+  return method;
+}
+//---------------------------------------------------------------------------//
+double WeightWindowGenerator::get_normalization() const {
+  return normalization;
+}
+//---------------------------------------------------------------------------//
+double WeightWindowGenerator::get_max_rel_error() const {
+  return max_rel_error;
+}
+//---------------------------------------------------------------------------//
+// PRIVATE METHODS
+//---------------------------------------------------------------------------//
+bool WeightWindowGenerator::is_reliable(double result,
+                                        double rel_error) const {
+  return result > 0.0 && rel_error <= max_rel_error;
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/WeightWindowGenerator.cpp
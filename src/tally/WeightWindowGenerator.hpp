@@ -0,0 +1,118 @@
+// MCNP5/dagmc/WeightWindowGenerator.hpp
+
+#ifndef DAGMC_WEIGHT_WINDOW_GENERATOR_HPP
+#define DAGMC_WEIGHT_WINDOW_GENERATOR_HPP
+
+#include <string>
+#include <vector>
+
+//===========================================================================//
+/**
+ * \class WeightWindowGenerator
+ * \brief Builds weight window lower bounds from mesh tally results
+ *
+ * WeightWindowGenerator converts the results of a mesh tally into the lower
+ * weight bounds of a weight-window map on the same mesh, with one bound for
+ * each tally point and energy group.  Two methods are supported
+ *
+ *     1) MAGIC: the bound is proportional to the forward flux, normalized so
+ *        that the largest bound in each energy group is the normalization
+ *     2) ADJOINT: the bound is the normalization divided by the adjoint flux
+ *        (importance), as in CADIS; the normalization is usually the
+ *        estimated detector response divided by the center of the window in
+ *        the source region
+ *
+ * A bound is only found from a tally point with a non-zero result and a
+ * relative error that is not greater than the maximum relative error.  Other
+ * tally points keep their bound from the previous weight-window map, or are
+ * set to zero to turn the windows off if there is no previous map.  Running
+ * a series of problems that each use the weight windows generated by the one
+ * before therefore fills in and converges the map as more of the mesh is
+ * reliably sampled.
+ */
+//===========================================================================//
+class WeightWindowGenerator {
+ public:
+  /**
+   * \brief Defines the method used to find the lower weight bounds
+   */
+  enum Method {MAGIC = 0, ADJOINT = 1};
+
+  /**
+   * \brief Constructor
+   * \param[in] method the method used to find the lower weight bounds
+   * \param[in] normalization the normalization constant of the method
+   * \param[in] max_rel_error the largest relative error of a tally result
+   *            that is used to find a bound
+   */
+  WeightWindowGenerator(Method method, double normalization,
+                        double max_rel_error);
+
+  /**
+   * \brief Parses the name of a weight window method
+   * \param[in] name the name of the method, "magic" or "adjoint"
+   * \param[out] method the method with the given name
+   * \return true if the name is valid; false otherwise
+   */
+  static bool parse_method(const std::string& name, Method& method);
+
+  /**
+   * \brief Gets the default normalization constant of a method
+   * \param[in] method the weight window method
+   * \return 0.5 for MAGIC and 1.0 for ADJOINT
+   */
+  static double default_normalization(Method method);
+
+  // >>> PUBLIC INTERFACE
+
+  /**
+   * \brief Generates the lower weight bounds for all tally points
+   * \param[in] num_groups the number of energy groups
+   * \param[in] results the tally results for each energy group
+   * \param[in] rel_errors the relative errors for each energy group
+   * \param[in] previous the lower bounds of the previous weight-window map,
+   *            or an empty vector if there is no previous map
+   * \param[out] lower_bounds the lower bounds for each energy group
+   * \return the number of lower bounds that were found from the results
+   *
+   * All vectors are ordered first by tally point and then by energy group,
+   * as returned by TallyData::get_results().
+   */
+  unsigned long generate(unsigned int num_groups,
+                         const std::vector<double>& results,
+                         const std::vector<double>& rel_errors,
+                         const std::vector<double>& previous,
+                         std::vector<double>& lower_bounds) const;
+
+  /**
+   * \brief get_method(), get_normalization(), get_max_rel_error()
+   * \return the parameters of this WeightWindowGenerator
+   */
+  Method get_method() const;
+  double get_normalization() const;
+  double get_max_rel_error() const;
+
+ private:
+  // Method used to find the lower weight bounds
+  Method method;
+
+  // Normalization constant of the method
+  double normalization;
+
+  // Largest relative error of a tally result that is used to find a bound
+  double max_rel_error;
+
+  // >>> PRIVATE METHODS
+
+  /**
+   * \brief Checks if a tally result can be used to find a lower bound
+   * \param[in] result the tally result
+   * \param[in] rel_error the relative error of the result
+   * \return true if the result is reliable; false otherwise
+   */
+  bool is_reliable(double result, double rel_error) const;
+};
+
+#endif // DAGMC_WEIGHT_WINDOW_GENERATOR_HPP
+
+// end of MCNP5/dagmc/WeightWindowGenerator.hpp
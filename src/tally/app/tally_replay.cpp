@@ -0,0 +1,81 @@
+// tally_replay: replays a recorded tally event stream to benchmark tallies
+//
+// input:  event stream written by TallyManager::startRecording()
+// output: the results of the recorded tallies, the time taken to add the
+//         tallies and read the stream, and the time taken to score the
+//         recorded events
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "moab/ProgOptions.hpp"
+
+#include "TallyEventReader.hpp"
+#include "TallyManager.hpp"
+
+int main(int argc, char* argv[]) {
+  ProgOptions po("tally_replay: a tool that rebuilds the tallies recorded in "
+                 "a tally event stream and replays its events to time them");
+
+  std::string filename;
+  int capacity = 0;
+  int num_threads = 0;
+  bool no_output = false;
+  bool no_preload = false;
+
+  po.addRequiredArg<std::string>("event_stream", "Path to the recorded event stream", &filename);
+  po.addOpt<int>("queue,q", "Score events from an event queue with this capacity", &capacity);
+  po.addOpt<int>("threads,t", "Number of threads that score the event queue", &num_threads);
+  po.addOpt<void>("no-output,n", "Do not write the tally results", &no_output);
+  po.addOpt<void>("no-preload,s", "Read the event stream while scoring instead of loading it first", &no_preload);
+
+  po.parseCommandLine(argc, argv);
+
+  std::cout << "Replaying tally events from " << filename << "..." << std::endl;
+
+  // add the tallies and read the stream before the events are timed
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  TallyEventReader reader(filename);
+
+  if (!reader.is_valid())
+    return 1;
+
+  TallyManager manager;
+
+  if (capacity > 0)
+    manager.enableEventQueue(capacity, num_threads < 0 ? 0 : num_threads);
+
+  bool complete = reader.replay_definitions(manager) &&
+                  (no_preload || reader.preload());
+  std::chrono::duration<double> setup = std::chrono::steady_clock::now() - start;
+
+  // only the events, updates and ends of histories are timed
+  start = std::chrono::steady_clock::now();
+  complete = complete && reader.replay(manager);
+  manager.flushEventQueue();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  double seconds = elapsed.count();
+  unsigned long num_events = reader.get_num_events();
+  unsigned long num_histories = reader.get_num_histories();
+
+  std::cout << "Replayed " << num_events << " events in " << num_histories
+            << " histories for " << manager.numTallies() << " tallies" << std::endl;
+  std::cout << "    setup time = " << setup.count() << " s" << std::endl;
+  std::cout << "    scoring time = " << seconds << " s";
+
+  if (seconds > 0.0) {
+    std::cout << ", " << num_events / seconds << " events/s, "
+              << num_histories / seconds << " histories/s";
+  }
+
+  std::cout << std::endl;
+  std::cout << "    tally updates dispatched = " << manager.getNumDispatched()
+            << ", rejected = " << manager.getNumRejected() << std::endl;
+
+  if (!no_output && num_histories > 0)
+    manager.writeData(num_histories);
+
+  return complete ? 0 : 1;
+}
@@ -94,6 +94,18 @@ TEST(CellTallyInputTest, InvalidCellVolume) {
 //---------------------------------------------------------------------------//
 // FIXTURE-BASED TESTS: CellTallyTest
 //---------------------------------------------------------------------------//
+// Test that each CellTally only scores its expected event type
+TEST_F(CellTallyTest, ScoresEventType) {
+  EXPECT_FALSE(cell_tally1->scores_event_type(TallyEvent::COLLISION));
+  EXPECT_FALSE(cell_tally1->scores_event_type(TallyEvent::TRACK));
+
+  EXPECT_TRUE(cell_tally2->scores_event_type(TallyEvent::COLLISION));
+  EXPECT_FALSE(cell_tally2->scores_event_type(TallyEvent::TRACK));
+
+  EXPECT_FALSE(cell_tally3->scores_event_type(TallyEvent::COLLISION));
+  EXPECT_TRUE(cell_tally3->scores_event_type(TallyEvent::TRACK));
+}
+//---------------------------------------------------------------------------//
 // Test that cell_id mismatch results in no score being computed
 TEST_F(CellTallyTest, NotInCell) {
   TallyEvent event;
@@ -0,0 +1,192 @@
+// MCNP5/dagmc/test/test_EnergyBinLookup.cpp
+
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../EnergyBinLookup.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+// finds the energy bin with the linear search previously used by Tally
+bool linear_search(const std::vector<double>& bounds, double energy,
+                   unsigned int& ebin) {
+  unsigned int max_ebound = bounds.size() - 1;
+
+  if (energy < bounds.at(0) || energy > bounds.at(max_ebound))
+    return false;
+
+  ebin = max_ebound - 1;
+
+  for (unsigned int i = 0; i < max_ebound; ++i) {
+    if (bounds.at(i) <= energy && energy < bounds.at(i + 1)) {
+      ebin = i;
+      break;
+    }
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------//
+// creates num_bins energy bins from 1e-5 eV to 20 MeV that are uniform in
+// lethargy, with the bounds perturbed by the given fraction of a bin
+std::vector<double> group_structure(unsigned int num_bins, double perturbation) {
+  std::vector<double> bounds;
+  double min_log = log(1.0e-11);
+  double width = (log(20.0) - min_log) / num_bins;
+
+  for (unsigned int i = 0; i <= num_bins; ++i) {
+    double shift = (i == 0 || i == num_bins) ? 0.0 :
+                   perturbation * width * sin(7.3 * i);
+    bounds.push_back(exp(min_log + i * width + shift));
+  }
+
+  return bounds;
+}
+//---------------------------------------------------------------------------//
+// energies spread through and just outside the range of the bounds
+std::vector<double> test_energies(const std::vector<double>& bounds,
+                                  unsigned int num_energies) {
+  std::vector<double> energies(bounds);
+  double min_log = log(bounds.front()) - 0.1;
+  double max_log = log(bounds.back()) + 0.1;
+  unsigned long state = 42;
+
+  for (unsigned int i = 0; i < num_energies; ++i) {
+    state = (1103515245 * state + 12345) % 2147483648UL;
+    double u = state / 2147483648.0;
+    energies.push_back(exp(min_log + u * (max_log - min_log)));
+  }
+
+  return energies;
+}
+//---------------------------------------------------------------------------//
+// tests that EnergyBinLookup finds the same bins as the linear search
+void compare_bins(const std::vector<double>& bounds) {
+  EnergyBinLookup lookup(bounds);
+  std::vector<double> energies = test_energies(bounds, 20000);
+
+  for (unsigned int i = 0; i < energies.size(); ++i) {
+    unsigned int expected_bin = 0;
+    unsigned int bin = 0;
+    bool expected = linear_search(bounds, energies[i], expected_bin);
+
+    ASSERT_EQ(expected, lookup.find_bin(energies[i], bin)) << energies[i];
+
+    if (expected) {
+      ASSERT_EQ(expected_bin, bin) << energies[i];
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+// SIMPLE TESTS
+//---------------------------------------------------------------------------//
+TEST(EnergyBinLookupTest, FewBins) {
+  std::vector<double> bounds;
+  bounds.push_back(0.0);
+  bounds.push_back(10.0);
+  bounds.push_back(20.3);
+  bounds.push_back(20.3);
+  bounds.push_back(67.9);
+
+  EnergyBinLookup lookup(bounds);
+  EXPECT_FALSE(lookup.uses_table());
+
+  unsigned int ebin = 99;
+  EXPECT_FALSE(lookup.find_bin(-1.0, ebin));
+  EXPECT_FALSE(lookup.find_bin(68.0, ebin));
+  EXPECT_EQ(99u, ebin);
+
+  EXPECT_TRUE(lookup.find_bin(0.0, ebin));
+  EXPECT_EQ(0u, ebin);
+  EXPECT_TRUE(lookup.find_bin(20.3, ebin));
+  EXPECT_EQ(3u, ebin);
+  EXPECT_TRUE(lookup.find_bin(67.9, ebin));
+  EXPECT_EQ(3u, ebin);
+
+  compare_bins(bounds);
+}
+//---------------------------------------------------------------------------//
+TEST(EnergyBinLookupTest, GroupStructures) {
+  const unsigned int num_bins[] = {33, 175, 709};
+
+  for (unsigned int i = 0; i < 3; ++i) {
+    std::vector<double> bounds = group_structure(num_bins[i], 0.0);
+    EXPECT_TRUE(EnergyBinLookup(bounds).uses_table());
+    compare_bins(bounds);
+
+    // bins that are far from uniform in lethargy
+    compare_bins(group_structure(num_bins[i], 0.45));
+  }
+
+  // a minimum energy of zero cannot use the lethargy grid
+  std::vector<double> bounds = group_structure(175, 0.2);
+  bounds[0] = 0.0;
+  EXPECT_FALSE(EnergyBinLookup(bounds).uses_table());
+  compare_bins(bounds);
+}
+//---------------------------------------------------------------------------//
+TEST(EnergyBinLookupTest, SharedLookup) {
+  std::vector<double> bounds = group_structure(175, 0.0);
+
+  std::shared_ptr<const EnergyBinLookup> lookup1;
+  lookup1 = EnergyBinLookup::get_lookup(bounds);
+  std::shared_ptr<const EnergyBinLookup> lookup2;
+  lookup2 = EnergyBinLookup::get_lookup(bounds);
+  EXPECT_EQ(lookup1.get(), lookup2.get());
+
+  bounds.back() = 21.0;
+  lookup2 = EnergyBinLookup::get_lookup(bounds);
+  EXPECT_NE(lookup1.get(), lookup2.get());
+}
+//---------------------------------------------------------------------------//
+// Reports the time to find the energy bins of many events; this is a
+// benchmark, so it only runs with --gtest_also_run_disabled_tests
+TEST(EnergyBinLookupTest, DISABLED_LookupThroughput) {
+  const unsigned int num_bins[] = {10, 175, 709};
+  const unsigned int num_repeats = 50;
+
+  for (unsigned int i = 0; i < 3; ++i) {
+    std::vector<double> bounds = group_structure(num_bins[i], 0.2);
+    std::vector<double> energies = test_energies(bounds, 20000);
+    EnergyBinLookup lookup(bounds);
+
+    unsigned long linear_sum = 0;
+    unsigned long lookup_sum = 0;
+    unsigned int ebin = 0;
+
+    std::clock_t start = std::clock();
+
+    for (unsigned int n = 0; n < num_repeats; ++n) {
+      for (unsigned int j = 0; j < energies.size(); ++j) {
+        if (linear_search(bounds, energies[j], ebin))
+          linear_sum += ebin;
+      }
+    }
+
+    double linear_seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+    start = std::clock();
+
+    for (unsigned int n = 0; n < num_repeats; ++n) {
+      for (unsigned int j = 0; j < energies.size(); ++j) {
+        if (lookup.find_bin(energies[j], ebin))
+          lookup_sum += ebin;
+      }
+    }
+
+    double lookup_seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+    EXPECT_EQ(linear_sum, lookup_sum);
+
+    std::cout << "Energy bin lookup: " << num_repeats * energies.size()
+              << " energies x " << num_bins[i] << " bins, linear search "
+              << linear_seconds << " s, EnergyBinLookup "
+              << lookup_seconds << " s" << std::endl;
+  }
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_EnergyBinLookup.cpp
@@ -0,0 +1,113 @@
+// MCNP5/dagmc/test/test_FixedPolynomialKernel.cpp
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "../FixedPolynomialKernel.hpp"
+#include "../PolynomialKernel.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+// compares a FixedPolynomialKernel with the equivalent PolynomialKernel
+template <unsigned int S, unsigned int R>
+void compare_with_generic_kernel() {
+  FixedPolynomialKernel<S, R> fixed_kernel;
+  PolynomialKernel kernel(S, R);
+
+  EXPECT_EQ(kernel.get_kernel_name(), fixed_kernel.get_kernel_name());
+  EXPECT_EQ(kernel.get_order(), fixed_kernel.get_order());
+
+  // compile-time table matches the polynomial of the generic kernel
+  std::vector<double> polynomial;
+  ASSERT_TRUE(kernel.get_polynomial(polynomial));
+  ASSERT_EQ(2 * (S + R) - 1, polynomial.size());
+
+  for (unsigned int k = 0; k < S + R; ++k) {
+    EXPECT_EQ(polynomial[2 * k],
+              (FixedPolynomialKernelTable<S, R>::TERMS[k]));
+  }
+
+  // values across and outside the domain, including both end points
+  const unsigned int n = 51;
+  double u[n];
+  double values[n];
+
+  for (unsigned int i = 0; i < n; ++i) {
+    u[i] = -1.25 + 0.05 * i;
+  }
+
+  u[5] = -1.0;
+  u[45] = 1.0;
+
+  fixed_kernel.evaluate_batch(u, n, values);
+
+  for (unsigned int i = 0; i < n; ++i) {
+    EXPECT_DOUBLE_EQ(kernel.evaluate(u[i]), fixed_kernel.evaluate(u[i]));
+    EXPECT_DOUBLE_EQ(kernel.evaluate(u[i]), values[i]);
+    EXPECT_EQ(fixed_kernel.evaluate(u[i]),
+              (FixedPolynomialKernel<S, R>::evaluate_fixed(u[i])));
+  }
+
+  // moments over full, partial and invalid integration limits
+  const double limits[][2] = {{-1.0, 1.0}, {-2.0, 0.3}, {-0.7, 0.4},
+    {0.2, 3.0}, {1.0, 2.0}, {-4.0, -1.5}
+  };
+
+  for (unsigned int j = 0; j < 6; ++j) {
+    for (unsigned int i = 0; i < 3; ++i) {
+      double a = limits[j][0];
+      double b = limits[j][1];
+      EXPECT_NEAR(kernel.integrate_moment(a, b, i),
+                  fixed_kernel.integrate_moment(a, b, i), 1e-13);
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+// SIMPLE TESTS
+//---------------------------------------------------------------------------//
+TEST(FixedPolynomialKernelTest, EpanechnikovKernels) {
+  compare_with_generic_kernel<1, 1>();
+  compare_with_generic_kernel<1, 2>();
+  compare_with_generic_kernel<1, 3>();
+}
+//---------------------------------------------------------------------------//
+TEST(FixedPolynomialKernelTest, BiweightKernels) {
+  compare_with_generic_kernel<2, 1>();
+  compare_with_generic_kernel<2, 2>();
+  compare_with_generic_kernel<2, 3>();
+}
+//---------------------------------------------------------------------------//
+TEST(FixedPolynomialKernelTest, TriweightKernels) {
+  compare_with_generic_kernel<3, 1>();
+  compare_with_generic_kernel<3, 2>();
+  compare_with_generic_kernel<3, 3>();
+}
+//---------------------------------------------------------------------------//
+TEST(FixedPolynomialKernelTest, CreateKernel) {
+  typedef FixedPolynomialKernel<2, 2> BiweightKernel4;
+  typedef FixedPolynomialKernel<3, 3> TriweightKernel6;
+
+  // commonly used kernels are created with a fixed s and r
+  KDEKernel* kernel = KDEKernel::createKernel("biweight", 4);
+  EXPECT_TRUE(dynamic_cast<BiweightKernel4*>(kernel) != NULL);
+  delete kernel;
+
+  kernel = KDEKernel::createKernel("triweight", 6);
+  EXPECT_TRUE(dynamic_cast<TriweightKernel6*>(kernel) != NULL);
+  delete kernel;
+
+  // others use the generic polynomial kernel
+  kernel = KDEKernel::createKernel("uniform", 2);
+  EXPECT_TRUE(dynamic_cast<PolynomialKernel*>(kernel) != NULL);
+  EXPECT_EQ("2nd-order uniform", kernel->get_kernel_name());
+  delete kernel;
+
+  kernel = KDEKernel::createKernel("epanechnikov", 8);
+  EXPECT_TRUE(dynamic_cast<PolynomialKernel*>(kernel) != NULL);
+  EXPECT_EQ(8, kernel->get_order());
+  delete kernel;
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_FixedPolynomialKernel.cpp
@@ -1,6 +1,9 @@
 // MCNP5/dagmc/test/test_KDEMeshTally.cpp
 
 #include <cmath>
+#include <ctime>
+#include <iostream>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -51,6 +54,23 @@ class KDEMeshTallyTest : public ::testing::Test {
     return kde_tally->integral_track_score(X, event);
   }
 
+  // integral_track_score computed with the KDEMeshTally::quadrature
+  double test_quadrature_track_score(const moab::CartVect& coords,
+                                     const TallyEvent& event) {
+    KDEMeshTally::CalculationPoint X;
+    X.coords[0] = coords[0];
+    X.coords[1] = coords[1];
+    X.coords[2] = coords[2];
+
+    std::pair<double, double> limits;
+    if (!kde_tally->set_integral_limits(event, coords, limits))
+      return 0.0;
+
+    KDEMeshTally::PathKernel path_kernel(*kde_tally, event, X);
+    return kde_tally->quadrature->integrate(limits.first, limits.second,
+                                            path_kernel);
+  }
+
   // wrapper for the KDEMeshTally::subtrack_score method
   double test_subtrack_score(const moab::CartVect& coords,
                              const std::vector<moab::CartVect>& points) {
@@ -81,6 +101,35 @@ class KDEMeshTallyTest : public ::testing::Test {
     return kde_tally->evaluate_kernel(X, observation);
   }
 
+  // wrapper for KDEMeshTally::evaluate_kernel with a precomputed correction
+  double test_precomputed_kernel(const moab::CartVect& coords,
+                                 const moab::CartVect& observation,
+                                 int* boundary_data,
+                                 double* distance_data) {
+    KDEMeshTally::CalculationPoint X;
+    double pi[3];
+    unsigned int si[3];
+    unsigned int num_corrections = 0;
+
+    for (int i = 0; i < 3; ++i) {
+      X.coords[i] = coords[i];
+      X.boundary_data[i] = boundary_data[i];
+      X.distance_data[i] = distance_data[i];
+
+      if (boundary_data[i] != -1) {
+        pi[num_corrections] = distance_data[i] / kde_tally->bandwidth[i];
+        si[num_corrections] = boundary_data[i];
+        ++num_corrections;
+      }
+    }
+
+    KDEKernel::BoundaryCorrection correction;
+    kde_tally->kernel->get_boundary_correction(pi, si, num_corrections,
+                                               correction);
+    X.correction = &correction;
+    return kde_tally->evaluate_kernel(X, observation);
+  }
+
   // accessor method to change the KDEMeshTally::bandwidth value
   void change_bandwidth(const moab::CartVect& new_bandwidth) {
     kde_tally->bandwidth = new_bandwidth;
@@ -90,6 +139,16 @@ class KDEMeshTallyTest : public ::testing::Test {
   void force_boundary_correction() {
     kde_tally->use_boundary_correction = true;
   }
+
+  // number of calculation points in the KDEMeshTally::region
+  unsigned int get_num_points() {
+    return kde_tally->region->get_points().size();
+  }
+
+  // coordinates of a calculation point in the KDEMeshTally::region
+  moab::CartVect get_point_coords(unsigned int point) {
+    return moab::CartVect(kde_tally->region->get_coords(point));
+  }
 };
 //---------------------------------------------------------------------------//
 // Tests the private integral_track_score method in KDEMeshTally
@@ -219,6 +278,106 @@ TEST_F(KDEMeshTallyTest, InvalidBandwidth) {
   EXPECT_NO_THROW(kde_tally = new KDEMeshTally(input, type));
 }
 //---------------------------------------------------------------------------//
+// Tests collision scores computed in blocks match evaluate_kernel
+TEST_F(KDEMeshTallyTest, CollisionScoresMatchKernel) {
+  // use all calculation points and a bandwidth spanning many of them
+  input.multiplier_id = -1;
+  input.options.insert(std::make_pair("neighborhood", "off"));
+  kde_tally = new KDEMeshTally(input, KDEMeshTally::COLLISION);
+  change_bandwidth(moab::CartVect(0.6, 0.3, 0.3));
+
+  TallyEvent event;
+  event.type = TallyEvent::COLLISION;
+  event.position = moab::CartVect(2.1, 0.05, -0.1);
+  event.total_cross_section = 1.0;
+  event.particle_energy = 5.0;
+  event.particle_weight = 1.0;
+
+  kde_tally->compute_score(event);
+  kde_tally->end_history();
+
+  // verify every calculation point has the same score as evaluate_kernel
+  unsigned int num_points = get_num_points();
+  EXPECT_EQ(2025, num_points);
+
+  for (unsigned int i = 0; i < num_points; ++i) {
+    double expected = test_evaluate_kernel(get_point_coords(i), event.position);
+    double score = kde_tally->getTallyData().get_data(i, 0).first;
+    EXPECT_DOUBLE_EQ(expected, score);
+  }
+}
+//---------------------------------------------------------------------------//
+// Reports the collision-estimator throughput on all calculation points; this
+// is a benchmark, so it only runs with --gtest_also_run_disabled_tests
+TEST_F(KDEMeshTallyTest, DISABLED_CollisionScoreThroughput) {
+  input.multiplier_id = -1;
+  input.options.insert(std::make_pair("neighborhood", "off"));
+  kde_tally = new KDEMeshTally(input, KDEMeshTally::COLLISION);
+  change_bandwidth(moab::CartVect(0.6, 0.3, 0.3));
+
+  TallyEvent event;
+  event.type = TallyEvent::COLLISION;
+  event.total_cross_section = 1.0;
+  event.particle_energy = 5.0;
+  event.particle_weight = 1.0;
+
+  // time a number of collisions spread through the mesh
+  const int num_collisions = 2000;
+  std::clock_t start = std::clock();
+
+  for (int n = 0; n < num_collisions; ++n) {
+    event.position = moab::CartVect(5.0 * n / num_collisions,
+                                    0.4 * sin(0.1 * n),
+                                    0.4 * cos(0.1 * n));
+    kde_tally->compute_score(event);
+    kde_tally->end_history();
+  }
+
+  double seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+  std::cout << "KDE collision estimator: " << num_collisions
+            << " collisions x " << get_num_points() << " points in "
+            << seconds << " s" << std::endl;
+}
+//---------------------------------------------------------------------------//
+// Tests that the collision data for the optimal bandwidth can be restored
+TEST_F(KDEMeshTallyTest, RestoreCheckpointState) {
+  kde_tally = new KDEMeshTally(input, KDEMeshTally::COLLISION);
+  KDEMeshTally restored(input, KDEMeshTally::COLLISION);
+
+  TallyEvent event;
+  event.type = TallyEvent::COLLISION;
+  event.total_cross_section = 1.0;
+  event.particle_energy = 5.0;
+  event.particle_weight = 1.0;
+
+  for (int i = 0; i < 5; ++i) {
+    event.position = moab::CartVect(0.3 * i, 0.1 - 0.05 * i, 0.02 * i * i);
+    kde_tally->compute_score(event);
+  }
+
+  std::vector<double> state;
+  kde_tally->get_checkpoint_state(state);
+  ASSERT_EQ(8u, state.size());
+  EXPECT_EQ(5.0, state[0]);
+
+  EXPECT_FALSE(restored.set_checkpoint_state(std::vector<double>(3, 0.0)));
+  EXPECT_TRUE(restored.set_checkpoint_state(state));
+
+  // both tallies continue with the same collision data
+  event.position = moab::CartVect(1.1, -0.2, 0.4);
+  kde_tally->compute_score(event);
+  restored.compute_score(event);
+
+  std::vector<double> restored_state;
+  kde_tally->get_checkpoint_state(state);
+  restored.get_checkpoint_state(restored_state);
+  ASSERT_EQ(state.size(), restored_state.size());
+
+  for (unsigned int i = 0; i < state.size(); ++i) {
+    EXPECT_EQ(state[i], restored_state[i]);
+  }
+}
+//---------------------------------------------------------------------------//
 // FIXTURE-BASED TESTS: KDEIntegralTrackTest
 //---------------------------------------------------------------------------//
 // Tests cases that have a valid [Smin, Smax] interval with Smin != Smax
@@ -349,6 +508,33 @@ TEST_F(KDEIntegralTrackTest, InvalidLimits) {
   EXPECT_DOUBLE_EQ(0.0, test_integral_track_score(coords5, event));
 }
 //---------------------------------------------------------------------------//
+// Tests the exact integral against quadrature for a higher-order kernel
+TEST_F(KDEMeshTallyTest, PolynomialMatchesQuadrature) {
+  // 10-pt quadrature is exact for the 4th-order biweight kernel
+  input.options.insert(std::make_pair("kernel", "biweight"));
+  input.options.insert(std::make_pair("order", "4"));
+  kde_tally = new KDEMeshTally(input, KDEMeshTally::INTEGRAL_TRACK);
+  change_bandwidth(moab::CartVect(0.1, 0.2, 0.3));
+
+  TallyEvent event;
+  event.type = TallyEvent::TRACK;
+  event.position = moab::CartVect(-0.2, -0.4, -0.1);
+  event.direction = moab::CartVect(0.7, 0.2, sqrt(0.47));
+  event.track_length = 1.0;
+
+  for (int i = 0; i < 20; ++i) {
+    moab::CartVect coords(-0.2 + 0.05 * i, -0.3 + 0.02 * i, 0.1 * i - 0.5);
+    double expected = test_quadrature_track_score(coords, event);
+    double score = test_integral_track_score(coords, event);
+    EXPECT_NEAR(expected, score, 1e-10 * (1.0 + fabs(expected)));
+  }
+
+  // track parallel to the x-axis, outside the kernel in y
+  event.direction = moab::CartVect(1.0, 0.0, 0.0);
+  moab::CartVect coords(0.0, -0.1, -0.1);
+  EXPECT_DOUBLE_EQ(0.0, test_integral_track_score(coords, event));
+}
+//---------------------------------------------------------------------------//
 // FIXTURE-BASED TESTS: KDESubtrackTest
 //---------------------------------------------------------------------------//
 TEST_F(KDESubtrackTest, NoSubtracks) {
@@ -541,5 +727,40 @@ TEST_F(KDECollisionTest, EvaluateBoundaryPointOnXYZ) {
   EXPECT_NEAR(-72.732558, score2, 1e-6);
 }
 //---------------------------------------------------------------------------//
+TEST_F(KDECollisionTest, EvaluatePrecomputedCorrection) {
+  force_boundary_correction();
+
+  // boundary points near one, two and three boundaries
+  int boundary_data[3][3] = {{-1, -1, 1}, {0, 0, -1}, {0, 0, 1}};
+  double distance_data[3] = {0.0, 0.1, 0.05};
+
+  // collision points inside, on the edge of and outside the boundary kernel
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 5; ++j) {
+      moab::CartVect observation = collision;
+      observation[i] += 0.04 * (j - 2);
+
+      for (int k = 0; k < 3; ++k) {
+        double expected = test_evaluate_kernel(calculation_point,
+                                               observation,
+                                               boundary_data[k],
+                                               distance_data);
+
+        double score = test_precomputed_kernel(calculation_point,
+                                               observation,
+                                               boundary_data[k],
+                                               distance_data);
+
+        EXPECT_NEAR(expected, score, 1e-10 * (1.0 + fabs(expected)));
+      }
+    }
+  }
+
+  EXPECT_NEAR(-72.732558, test_precomputed_kernel(calculation_point,
+                                                  collision,
+                                                  boundary_data[2],
+                                                  distance_data), 1e-6);
+}
+//---------------------------------------------------------------------------//
 
 // end of MCNP5/dagmc/test/test_KDEMeshTally.cpp
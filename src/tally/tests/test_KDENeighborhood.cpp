@@ -1,8 +1,10 @@
 // MCNP5/dagmc/test/test_KDENeighborhood.cpp
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <set>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -29,11 +31,27 @@ void load_default_mesh(moab::Interface* mbi, moab::Range& mesh_nodes) {
 //---------------------------------------------------------------------------//
 // check all points are valid for given neighborhood region
 bool check_all_points(const KDENeighborhood& region,
+                      const std::vector<unsigned int>& points) {
+  std::vector<unsigned int>::const_iterator it;
+
+  for (it = points.begin(); it != points.end(); ++it) {
+    if (!region.is_calculation_point(*it))
+      return false;
+  }
+
+  return true;
+}
+//---------------------------------------------------------------------------//
+// check all mesh nodes in points are valid for given neighborhood region
+bool check_all_points(const KDENeighborhood& region,
+                      const moab::Range& mesh_nodes,
                       const std::set<moab::EntityHandle>& points) {
   std::set<moab::EntityHandle>::iterator it;
 
   for (it = points.begin(); it != points.end(); ++it) {
-    if (!region.is_calculation_point(*it))
+    int index = mesh_nodes.index(*it);
+
+    if (index < 0 || !region.is_calculation_point(index))
       return false;
   }
 
@@ -169,12 +187,12 @@ TEST(KDENeighborhoodTest, NoMeshNodes) {
 
   // check default number of points in region1
   KDENeighborhood region1(mbi, mesh_nodes, false);
-  std::set<moab::EntityHandle> points1 = region1.get_points();
+  std::vector<unsigned int> points1 = region1.get_points();
   EXPECT_EQ(0, points1.size());
 
   // check default number of points in region2
   KDENeighborhood region2(mbi, mesh_nodes, true);
-  std::set<moab::EntityHandle> points2 = region2.get_points();
+  std::vector<unsigned int> points2 = region2.get_points();
   EXPECT_EQ(0, points2.size());
 }
 //---------------------------------------------------------------------------//
@@ -277,8 +295,9 @@ TEST_F(GetPointsTest, GetPointsInBox) {
   EXPECT_EQ(2025, region1->get_points().size());
 
   // test number of points returned by region2 and check all are valid
-  std::set<moab::EntityHandle> points1 = region2->get_points();
-  EXPECT_EQ(320, points1.size());
+  // (the box bounding the whole track would contain 320 points)
+  std::vector<unsigned int> points1 = region2->get_points();
+  EXPECT_EQ(120, points1.size());
   EXPECT_TRUE(check_all_points(*region2, points1));
 
   // change to neighborhood based on collision event (region inside mesh)
@@ -290,11 +309,131 @@ TEST_F(GetPointsTest, GetPointsInBox) {
   EXPECT_EQ(2025, region1->get_points().size());
 
   // test number of points returned by region2 and check all are valid
-  std::set<moab::EntityHandle> points2 = region2->get_points();
+  std::vector<unsigned int> points2 = region2->get_points();
   EXPECT_EQ(32, points2.size());
   EXPECT_TRUE(check_all_points(*region2, points2));
 }
 //---------------------------------------------------------------------------//
+// Tests a long diagonal track only returns points near the track
+TEST_F(GetPointsTest, GetPointsAlongDiagonalTrack) {
+  // track from one corner of the mesh to the opposite corner
+  TallyEvent event;
+  event.type = TallyEvent::TRACK;
+  event.position = moab::CartVect(0.0, -0.5, -0.5);
+  event.direction = moab::CartVect(5.0, 1.0, 1.0);
+  event.track_length = event.direction.length();
+  event.direction.normalize();
+  moab::CartVect bandwidth(0.25, 0.125, 0.125);
+  region2->update_neighborhood(event, bandwidth);
+
+  // box bounding the track contains all points, swept box only some
+  std::vector<unsigned int> points = region2->get_points();
+  EXPECT_EQ(205, points.size());
+
+  // check every point is no further than |h| from the track
+  for (unsigned int i = 0; i < points.size(); ++i) {
+    moab::CartVect X(region2->get_coords(points[i]));
+    double distance_to_track = ((X - event.position) * event.direction).length();
+    EXPECT_LE(distance_to_track, bandwidth.length());
+  }
+}
+//---------------------------------------------------------------------------//
+// Tests kd-tree search matches a search over all points for many boxes
+TEST_F(GetPointsTest, MatchesBruteForceSearch) {
+  TallyEvent event;
+  event.type = TallyEvent::COLLISION;
+  moab::CartVect bandwidth(0.15, 0.1, 0.25);
+
+  for (int n = 0; n < 50; ++n) {
+    // sweep the collision point diagonally through and past the mesh
+    event.position = moab::CartVect(-0.5 + 0.12 * n,
+                                    -0.6 + 0.025 * n,
+                                     0.7 - 0.03 * n);
+    region2->update_neighborhood(event, bandwidth);
+
+    // find the expected points using the coordinates of all mesh nodes
+    std::vector<unsigned int> expected;
+    const std::vector<unsigned int>& all_points = region1->get_points();
+
+    for (unsigned int i = 0; i < all_points.size(); ++i) {
+      const double* coords = region1->get_coords(all_points[i]);
+      bool inside = true;
+
+      for (int j = 0; j < 3; ++j) {
+        if (coords[j] < event.position[j] - bandwidth[j] - 1e-12 ||
+            coords[j] > event.position[j] + bandwidth[j] + 1e-12)
+          inside = false;
+      }
+
+      if (inside)
+        expected.push_back(all_points[i]);
+    }
+
+    std::vector<unsigned int> points = region2->get_points();
+    std::sort(points.begin(), points.end());
+    EXPECT_EQ(expected, points);
+  }
+}
+//---------------------------------------------------------------------------//
+// Tests points for an event match updating the neighborhood, which is unchanged
+TEST_F(GetPointsTest, GetPointsForEvent) {
+  TallyEvent collision;
+  collision.type = TallyEvent::COLLISION;
+  collision.position = moab::CartVect(0.1, -0.05, 0.2);
+
+  TallyEvent track;
+  track.type = TallyEvent::TRACK;
+  track.position = moab::CartVect(0.0, -0.5, -0.5);
+  track.direction = moab::CartVect(5.0, 1.0, 1.0);
+  track.track_length = track.direction.length();
+  track.direction.normalize();
+
+  moab::CartVect bandwidth(0.25, 0.125, 0.125);
+  region2->update_neighborhood(collision, bandwidth);
+  std::vector<unsigned int> collision_points = region2->get_points();
+
+  // get points for the track without updating the neighborhood
+  std::vector<unsigned int> points;
+  region2->get_points(track, bandwidth, points);
+  EXPECT_EQ(205, points.size());
+  EXPECT_EQ(collision_points, region2->get_points());
+
+  region2->update_neighborhood(track, bandwidth);
+  EXPECT_EQ(region2->get_points(), points);
+
+  // get points for the collision, reusing the same vector
+  region2->get_points(collision, bandwidth, points);
+  EXPECT_EQ(collision_points, points);
+
+  // all points are returned if there is no kd-tree
+  region1->get_points(track, bandwidth, points);
+  EXPECT_EQ(region1->get_points(), points);
+}
+//---------------------------------------------------------------------------//
+// Tests coordinates are returned in the same order as the mesh nodes
+TEST(KDENeighborhoodTest, GetCoords) {
+  moab::Core mb_core;
+  moab::Interface* mbi = &mb_core;
+
+  // load the default mesh and get all mesh nodes
+  moab::Range mesh_nodes;
+  load_default_mesh(mbi, mesh_nodes);
+
+  KDENeighborhood region(mbi, mesh_nodes, true);
+
+  for (unsigned int i = 0; i < mesh_nodes.size(); i += 97) {
+    moab::EntityHandle point = mesh_nodes[i];
+    double coords[3];
+    moab::ErrorCode rval = mbi->get_coords(&point, 1, coords);
+    assert(rval == moab::MB_SUCCESS);
+
+    const double* region_coords = region.get_coords(i);
+    EXPECT_DOUBLE_EQ(coords[0], region_coords[0]);
+    EXPECT_DOUBLE_EQ(coords[1], region_coords[1]);
+    EXPECT_DOUBLE_EQ(coords[2], region_coords[2]);
+  }
+}
+//---------------------------------------------------------------------------//
 // FIXTURE-BASED TESTS: IsCalculationPointTest
 //---------------------------------------------------------------------------//
 // Tests all points are calculation points when no kd-tree is used
@@ -312,13 +451,13 @@ TEST_F(IsCalculationPointTest, NoKDTree) {
   KDENeighborhood region(mbi, mesh_nodes, false);
 
   EXPECT_EQ(2025, region.get_points().size());
-  EXPECT_TRUE(check_all_points(region, mesh_set));
+  EXPECT_TRUE(check_all_points(region, mesh_nodes, mesh_set));
 
   // update neighborhood region and check it still includes all points
   region.update_neighborhood(event, bandwidth);
 
   EXPECT_EQ(2025, region.get_points().size());
-  EXPECT_TRUE(check_all_points(region, mesh_set));
+  EXPECT_TRUE(check_all_points(region, mesh_nodes, mesh_set));
 }
 //---------------------------------------------------------------------------//
 // Tests corners of neighborhood are valid calculation points
@@ -361,7 +500,7 @@ TEST_F(IsCalculationPointTest, ValidCornerPoints) {
   region.update_neighborhood(event, bandwidth);
 
   EXPECT_TRUE(region.get_points().size() > 0);
-  EXPECT_TRUE(check_all_points(region, corner_set));
+  EXPECT_TRUE(check_all_points(region, mesh_nodes, corner_set));
 }
 //---------------------------------------------------------------------------//
 // Tests points along edges of neighborhood are valid calculation points
@@ -404,7 +543,7 @@ TEST_F(IsCalculationPointTest, ValidEdgePoints) {
   region.update_neighborhood(event, bandwidth);
 
   EXPECT_TRUE(region.get_points().size() > 0);
-  EXPECT_TRUE(check_all_points(region, edge_set));
+  EXPECT_TRUE(check_all_points(region, mesh_nodes, edge_set));
 }
 //---------------------------------------------------------------------------//
 // Tests points inside neighborhood are valid calculation points
@@ -443,7 +582,7 @@ TEST_F(IsCalculationPointTest, ValidInteriorPoints) {
   region.update_neighborhood(event, bandwidth);
 
   EXPECT_TRUE(region.get_points().size() > 0);
-  EXPECT_TRUE(check_all_points(region, interior_set));
+  EXPECT_TRUE(check_all_points(region, mesh_nodes, interior_set));
 }
 //---------------------------------------------------------------------------//
 // Tests points that are NOT in neighborhood are NOT valid calculation points
@@ -490,7 +629,7 @@ TEST_F(IsCalculationPointTest, InvalidPoints) {
 
   std::set<moab::EntityHandle>::iterator it;
   for (it = invalid_set.begin(); it != invalid_set.end(); ++it) {
-    EXPECT_FALSE(region.is_calculation_point(*it));
+    EXPECT_FALSE(region.is_calculation_point(mesh_nodes.index(*it)));
   }
 }
 //---------------------------------------------------------------------------//
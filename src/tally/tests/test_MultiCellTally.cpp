@@ -0,0 +1,182 @@
+// MCNP5/dagmc/test/test_MultiCellTally.cpp
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "moab/CartVect.hpp"
+
+#include "../MultiCellTally.hpp"
+#include "../TallyEvent.hpp"
+#include "../TallyManager.hpp"
+
+//---------------------------------------------------------------------------//
+// TEST FIXTURES
+//---------------------------------------------------------------------------//
+class MultiCellTallyTest : public ::testing::Test {
+ protected:
+  // initialize variables for each test
+  virtual void SetUp() {
+    input.tally_id = 1;
+    input.tally_type = "cell_coll_all";
+    input.energy_bin_bounds.push_back(0.0);
+    input.energy_bin_bounds.push_back(5.0);
+    input.energy_bin_bounds.push_back(10.0);
+    input.multiplier_id = -1;  // indicates not using multipliers
+    input.options.insert(std::make_pair("num_cells", "4"));
+    coll_tally = new MultiCellTally(input, TallyEvent::COLLISION);
+
+    input.tally_id = 2;
+    input.tally_type = "cell_track_all";
+    track_tally = new MultiCellTally(input, TallyEvent::TRACK);
+  }
+
+  // deallocate memory resources
+  virtual void TearDown() {
+    delete coll_tally;
+    delete track_tally;
+  }
+
+ protected:
+  // data needed for each test
+  TallyInput input;
+  MultiCellTally* coll_tally;
+  MultiCellTally* track_tally;
+};
+//---------------------------------------------------------------------------//
+// SIMPLE TESTS
+//---------------------------------------------------------------------------//
+// Test parsing of an invalid number of cells
+TEST(MultiCellTallyInputTest, InvalidNumCells) {
+  TallyInput input;
+  input.tally_id = 1;
+  input.energy_bin_bounds.push_back(0.0);
+  input.energy_bin_bounds.push_back(10.0);
+  input.options.insert(std::make_pair("num_cells", "many"));
+
+  EXPECT_EXIT(MultiCellTally(input, TallyEvent::TRACK),
+              ::testing::ExitedWithCode(EXIT_FAILURE), "no cells");
+}
+//---------------------------------------------------------------------------//
+// FIXTURE-BASED TESTS: MultiCellTallyTest
+//---------------------------------------------------------------------------//
+TEST_F(MultiCellTallyTest, NumCells) {
+  EXPECT_EQ(4u, coll_tally->get_num_cells());
+  EXPECT_DOUBLE_EQ(1.0, coll_tally->get_cell_volume(4));
+
+  EXPECT_TRUE(coll_tally->scores_event_type(TallyEvent::COLLISION));
+  EXPECT_FALSE(coll_tally->scores_event_type(TallyEvent::TRACK));
+  EXPECT_TRUE(track_tally->scores_event_type(TallyEvent::TRACK));
+}
+//---------------------------------------------------------------------------//
+// Test that each event only scores the tally point of its cell
+TEST_F(MultiCellTallyTest, ScoresCellIndex) {
+  TallyEvent event;
+  event.type = TallyEvent::TRACK;
+  event.particle_energy = 7.0;
+  event.particle_weight = 0.5;
+  event.track_length = 3.0;
+  event.direction = moab::CartVect(0.0, 0.0, 1.0);
+
+  event.current_cell = 3;
+  track_tally->compute_score(event);
+
+  // cells outside the tally are ignored
+  event.current_cell = 0;
+  track_tally->compute_score(event);
+  event.current_cell = 5;
+  track_tally->compute_score(event);
+  track_tally->end_history();
+
+  const TallyData& data = track_tally->getTallyData();
+
+  for (unsigned int i = 0; i < 4; ++i) {
+    std::pair<double, double> result = data.get_data(i, 1);
+    EXPECT_DOUBLE_EQ(i == 2 ? 1.5 : 0.0, result.first);
+    EXPECT_DOUBLE_EQ(i == 2 ? 2.25 : 0.0, result.second);
+
+    result = data.get_data(i, 0);
+    EXPECT_DOUBLE_EQ(0.0, result.first);
+  }
+
+  // collision events are not scored by a track tally
+  event.type = TallyEvent::COLLISION;
+  event.current_cell = 1;
+  event.total_cross_section = 0.25;
+  track_tally->compute_score(event);
+  coll_tally->compute_score(event);
+  coll_tally->end_history();
+
+  EXPECT_DOUBLE_EQ(0.0, data.get_data(0, 1).first);
+  EXPECT_DOUBLE_EQ(2.0, coll_tally->getTallyData().get_data(0, 1).first);
+}
+//---------------------------------------------------------------------------//
+// Test that a MultiCellTally gives the same results as one CellTally per cell
+TEST(MultiCellTallyManagerTest, MatchesCellTallies) {
+  std::vector<double> energy_bin_bounds;
+  energy_bin_bounds.push_back(0.0);
+  energy_bin_bounds.push_back(2.5);
+  energy_bin_bounds.push_back(10.0);
+
+  TallyManager cells;
+  TallyManager all_cells;
+  std::multimap<std::string, std::string> options;
+
+  for (int i = 1; i <= 6; ++i) {
+    std::stringstream cell;
+    cell << i;
+
+    options.clear();
+    options.insert(std::make_pair("cell", cell.str()));
+    cells.addNewTally(i, "cell_track", 1, energy_bin_bounds, options);
+  }
+
+  options.clear();
+  options.insert(std::make_pair("num_cells", "6"));
+  all_cells.addNewTally(1, "cell_track_all", 1, energy_bin_bounds, options);
+
+  unsigned long state = 2718;
+
+  for (unsigned int history = 0; history < 50; ++history) {
+    for (unsigned int i = 0; i < 1 + history % 3; ++i) {
+      state = (1103515245 * state + 12345) % 2147483648UL;
+      int cell = 1 + state % 6;
+      double energy = (state % 1000) * 0.01;
+      double length = (state % 317) * 0.0311;
+
+      cells.setTrackEvent(1, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0,
+                          energy, 1.0, length, cell);
+      cells.updateTallies();
+      all_cells.setTrackEvent(1, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0,
+                              energy, 1.0, length, cell);
+      all_cells.updateTallies();
+    }
+
+    cells.endHistory();
+    all_cells.endHistory();
+  }
+
+  int length;
+  int cell_length;
+  double* data = all_cells.getTallyData(1, length);
+  double* error = all_cells.getErrorData(1, length);
+  ASSERT_EQ(6 * 3, length);
+
+  // tally point i - 1 of all_cells holds the data for cell i
+  for (int i = 1; i <= 6; ++i) {
+    double* cell_data = cells.getTallyData(i, cell_length);
+    double* cell_error = cells.getErrorData(i, cell_length);
+    ASSERT_EQ(3, cell_length);
+
+    for (int j = 0; j < 3; ++j) {
+      EXPECT_EQ(cell_data[j], data[(i - 1) * 3 + j]);
+      EXPECT_EQ(cell_error[j], error[(i - 1) * 3 + j]);
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_MultiCellTally.cpp
@@ -364,6 +364,61 @@ TEST_F(PolynomialKernelTest, Evaluate6thOrderTriweight) {
   EXPECT_DOUBLE_EQ(0.0, kernel->evaluate(2.0));
 }
 //---------------------------------------------------------------------------//
+// Tests evaluate_batch gives the same values as evaluate for all kernels
+TEST_F(PolynomialKernelTest, EvaluateBatch) {
+  // values across and outside the domain, including both end points
+  const unsigned int n = 51;
+  double u[n];
+  double values[n];
+
+  for (unsigned int i = 0; i < n; ++i) {
+    u[i] = -1.25 + 0.05 * i;
+  }
+
+  u[5] = -1.0;
+  u[45] = 1.0;
+
+  for (unsigned int s = 0; s < 4; ++s) {
+    for (unsigned int r = 1; r < 4; ++r) {
+      kernel = new PolynomialKernel(s, r);
+      kernel->evaluate_batch(u, n, values);
+
+      for (unsigned int i = 0; i < n; ++i) {
+        EXPECT_DOUBLE_EQ(kernel->evaluate(u[i]), values[i]);
+      }
+
+      delete kernel;
+      kernel = NULL;
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+TEST_F(PolynomialKernelTest, GetPolynomial) {
+  std::vector<double> polynomial;
+
+  for (unsigned int s = 0; s < 4; ++s) {
+    for (unsigned int r = 1; r < 4; ++r) {
+      kernel = new PolynomialKernel(s, r);
+      EXPECT_TRUE(kernel->get_polynomial(polynomial));
+      EXPECT_EQ(2 * (s + r) - 1, polynomial.size());
+
+      // coefficients reproduce the kernel inside its domain
+      for (double u = -1.0; u <= 1.0; u += 0.125) {
+        double value = 0.0;
+
+        for (int k = polynomial.size() - 1; k >= 0; --k) {
+          value = value * u + polynomial[k];
+        }
+
+        EXPECT_NEAR(kernel->evaluate(u), value, 1e-12);
+      }
+
+      delete kernel;
+      kernel = NULL;
+    }
+  }
+}
+//---------------------------------------------------------------------------//
 // FIXTURE-BASED TESTS: IntegrateMomentTest
 //---------------------------------------------------------------------------//
 TEST_F(IntegrateMomentTest, Integrate0thMoment) {
@@ -0,0 +1,259 @@
+// MCNP5/dagmc/test/test_StructuredMeshTally.cpp
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+#include "moab/CartVect.hpp"
+
+#include "../StructuredMeshTally.hpp"
+#include "../TallyEvent.hpp"
+
+//---------------------------------------------------------------------------//
+// TEST FIXTURES
+//---------------------------------------------------------------------------//
+class StructuredMeshTallyTest : public ::testing::Test {
+ protected:
+  // initialize variables for each test
+  virtual void SetUp() {
+    input.tally_id = 1;
+    input.energy_bin_bounds.push_back(0.0);
+    input.energy_bin_bounds.push_back(10.0);
+    input.multiplier_id = -1;
+    mesh_tally = NULL;
+  }
+
+  // deallocate memory resources
+  virtual void TearDown() {
+    delete mesh_tally;
+  }
+
+  // scores one track and ends the history
+  void score_track(double x, double y, double z,
+                   double u, double v, double w, double track_length) {
+    TallyEvent event;
+    event.type = TallyEvent::TRACK;
+    event.particle = 1;
+    event.current_cell = 1;
+    event.position = moab::CartVect(x, y, z);
+    event.direction = moab::CartVect(u, v, w);
+    event.direction.normalize();
+    event.track_length = track_length;
+    event.particle_energy = 5.0;
+    event.particle_weight = 1.0;
+
+    mesh_tally->compute_score(event);
+    mesh_tally->end_history();
+  }
+
+  // tally result for one grid cell
+  double get_score(unsigned int cell) {
+    return mesh_tally->getTallyData().get_data(cell, 0).first;
+  }
+
+  // sum of the tally results over the whole grid
+  double get_total() {
+    int length;
+    TallyData data = mesh_tally->getTallyData();
+    double* tally_data = data.TallyData::get_tally_data(length);
+
+    double total = 0.0;
+    for (int i = 0; i < length; ++i)
+      total += tally_data[i];
+
+    return total;
+  }
+
+ protected:
+  TallyInput input;
+  StructuredMeshTally* mesh_tally;
+};
+//---------------------------------------------------------------------------//
+class CartesianMeshTallyTest : public StructuredMeshTallyTest {
+ protected:
+  virtual void SetUp() {
+    StructuredMeshTallyTest::SetUp();
+    input.tally_type = "struct_track";
+    input.options.insert(std::make_pair("x", "0,1,3,6"));
+    input.options.insert(std::make_pair("y", "0,2"));
+    input.options.insert(std::make_pair("z", "-1,0,1"));
+    mesh_tally = new StructuredMeshTally(input, StructuredMeshTally::CARTESIAN);
+  }
+};
+//---------------------------------------------------------------------------//
+class CylindricalMeshTallyTest : public StructuredMeshTallyTest {
+ protected:
+  virtual void SetUp() {
+    StructuredMeshTallyTest::SetUp();
+    input.tally_type = "cyl_track";
+    input.options.insert(std::make_pair("r", "0,1,2,3"));
+    input.options.insert(std::make_pair("theta", "0,0.25,0.5,0.75,1"));
+    input.options.insert(std::make_pair("z", "0,1"));
+    mesh_tally = new StructuredMeshTally(input, StructuredMeshTally::CYLINDRICAL);
+  }
+};
+//---------------------------------------------------------------------------//
+// SIMPLE TESTS
+//---------------------------------------------------------------------------//
+TEST_F(CartesianMeshTallyTest, GetCellIndex) {
+  EXPECT_EQ(0, mesh_tally->get_cell_index(moab::CartVect(0.5, 1.0, -0.5)));
+  EXPECT_EQ(2, mesh_tally->get_cell_index(moab::CartVect(5.0, 1.0, -0.5)));
+  EXPECT_EQ(4, mesh_tally->get_cell_index(moab::CartVect(2.0, 1.0, 0.5)));
+  EXPECT_EQ(-1, mesh_tally->get_cell_index(moab::CartVect(7.0, 1.0, 0.5)));
+  EXPECT_EQ(-1, mesh_tally->get_cell_index(moab::CartVect(2.0, -1.0, 0.5)));
+}
+//---------------------------------------------------------------------------//
+TEST_F(CylindricalMeshTallyTest, GetCellIndex) {
+  // cell index is ir + 3 * itheta
+  EXPECT_EQ(0, mesh_tally->get_cell_index(moab::CartVect(0.5, 0.1, 0.5)));
+  EXPECT_EQ(4, mesh_tally->get_cell_index(moab::CartVect(-0.1, 1.5, 0.5)));
+  EXPECT_EQ(11, mesh_tally->get_cell_index(moab::CartVect(0.1, -2.5, 0.5)));
+  EXPECT_EQ(-1, mesh_tally->get_cell_index(moab::CartVect(3.5, 0.0, 0.5)));
+  EXPECT_EQ(-1, mesh_tally->get_cell_index(moab::CartVect(0.5, 0.5, 1.5)));
+}
+//---------------------------------------------------------------------------//
+// COMPUTE SCORE TESTS
+//---------------------------------------------------------------------------//
+TEST_F(CartesianMeshTallyTest, ComputeScoreIgnoresCollision) {
+  TallyEvent event;
+  event.type = TallyEvent::COLLISION;
+  event.position = moab::CartVect(0.5, 1.0, -0.5);
+  event.total_cross_section = 1.0;
+  event.particle_energy = 5.0;
+  event.particle_weight = 1.0;
+  mesh_tally->compute_score(event);
+  mesh_tally->end_history();
+
+  EXPECT_DOUBLE_EQ(0.0, get_total());
+}
+//---------------------------------------------------------------------------//
+TEST_F(CartesianMeshTallyTest, ComputeScoreAlongX) {
+  // starts outside the grid and ends inside the last cell
+  score_track(-2.0, 1.0, -0.5, 1.0, 0.0, 0.0, 6.0);
+
+  EXPECT_DOUBLE_EQ(1.0, get_score(0));
+  EXPECT_DOUBLE_EQ(2.0, get_score(1));
+  EXPECT_DOUBLE_EQ(1.0, get_score(2));
+  EXPECT_DOUBLE_EQ(4.0, get_total());
+}
+//---------------------------------------------------------------------------//
+TEST_F(CartesianMeshTallyTest, ComputeScoreBackwards) {
+  // passes through the whole grid in -x
+  score_track(10.0, 1.0, 0.5, -1.0, 0.0, 0.0, 20.0);
+
+  EXPECT_DOUBLE_EQ(1.0, get_score(3));
+  EXPECT_DOUBLE_EQ(2.0, get_score(4));
+  EXPECT_DOUBLE_EQ(3.0, get_score(5));
+  EXPECT_DOUBLE_EQ(6.0, get_total());
+}
+//---------------------------------------------------------------------------//
+TEST_F(CartesianMeshTallyTest, ComputeScoreDiagonal) {
+  // crosses the corner shared by four cells at (1, 1, 0)
+  score_track(0.0, 0.0, -1.0, 1.0, 1.0, 1.0, 10.0);
+
+  double half = sqrt(3.0);
+  EXPECT_NEAR(half, get_score(0), 1e-12);
+  EXPECT_NEAR(half, get_score(4), 1e-12);
+  EXPECT_NEAR(2.0 * half, get_total(), 1e-12);
+}
+//---------------------------------------------------------------------------//
+TEST_F(CartesianMeshTallyTest, ComputeScoreMissesGrid) {
+  score_track(-1.0, 3.0, 0.0, 1.0, 0.0, 0.0, 10.0);
+
+  EXPECT_DOUBLE_EQ(0.0, get_total());
+}
+//---------------------------------------------------------------------------//
+TEST_F(CylindricalMeshTallyTest, ComputeScoreRadial) {
+  // from the axis out through all radial bins in the first quadrant
+  score_track(0.0, 0.0, 0.5, 1.0, 1.0, 0.0, 5.0);
+
+  EXPECT_NEAR(1.0, get_score(0), 1e-12);
+  EXPECT_NEAR(1.0, get_score(1), 1e-12);
+  EXPECT_NEAR(1.0, get_score(2), 1e-12);
+  EXPECT_NEAR(3.0, get_total(), 1e-12);
+}
+//---------------------------------------------------------------------------//
+TEST_F(CylindricalMeshTallyTest, ComputeScoreThroughAxis) {
+  // from the third quadrant through the axis into the first
+  score_track(-1.0, -1.0, 0.5, 1.0, 1.0, 0.0, 2.0 * sqrt(2.0));
+
+  EXPECT_NEAR(sqrt(2.0) - 1.0, get_score(7), 1e-12);
+  EXPECT_NEAR(1.0, get_score(6), 1e-12);
+  EXPECT_NEAR(1.0, get_score(0), 1e-12);
+  EXPECT_NEAR(sqrt(2.0) - 1.0, get_score(1), 1e-12);
+  EXPECT_NEAR(2.0 * sqrt(2.0), get_total(), 1e-12);
+}
+//---------------------------------------------------------------------------//
+TEST_F(CylindricalMeshTallyTest, ComputeScoreChord) {
+  // along y = 0.5 from x = -5 to x = 5, crossing theta = 0.25 at x = 0
+  score_track(-5.0, 0.5, 0.5, 1.0, 0.0, 0.0, 10.0);
+
+  double x1 = sqrt(1.0 - 0.25);
+  double x2 = sqrt(4.0 - 0.25);
+  double x3 = sqrt(9.0 - 0.25);
+
+  // second quadrant
+  EXPECT_NEAR(x3 - x2, get_score(5), 1e-12);
+  EXPECT_NEAR(x2 - x1, get_score(4), 1e-12);
+  EXPECT_NEAR(x1, get_score(3), 1e-12);
+  // first quadrant
+  EXPECT_NEAR(x1, get_score(0), 1e-12);
+  EXPECT_NEAR(x2 - x1, get_score(1), 1e-12);
+  EXPECT_NEAR(x3 - x2, get_score(2), 1e-12);
+  EXPECT_NEAR(2.0 * x3, get_total(), 1e-12);
+}
+//---------------------------------------------------------------------------//
+TEST_F(CylindricalMeshTallyTest, ComputeScoreAlongAxis) {
+  // parallel to the axis, only the z range of the grid is scored
+  score_track(1.5, 0.1, -2.0, 0.0, 0.0, 1.0, 5.0);
+
+  EXPECT_DOUBLE_EQ(1.0, get_score(1));
+  EXPECT_DOUBLE_EQ(1.0, get_total());
+}
+//---------------------------------------------------------------------------//
+TEST_F(StructuredMeshTallyTest, ComputeScoreReentrantCylinder) {
+  // annulus with a hole and a quarter of a revolution
+  input.tally_type = "cyl_track";
+  input.options.insert(std::make_pair("r", "1,2"));
+  input.options.insert(std::make_pair("theta", "0,0.25"));
+  input.options.insert(std::make_pair("z", "0,1"));
+  input.options.insert(std::make_pair("origin", "10,0,0"));
+  mesh_tally = new StructuredMeshTally(input, StructuredMeshTally::CYLINDRICAL);
+
+  // along y = 0.5, entering and leaving the hole and the quadrant
+  score_track(5.0, 0.5, 0.5, 1.0, 0.0, 0.0, 10.0);
+
+  double x1 = sqrt(1.0 - 0.25);
+  double x2 = sqrt(4.0 - 0.25);
+  EXPECT_NEAR(x2 - x1, get_total(), 1e-12);
+
+  // along x = 10.5 in +y, through the inner hole
+  delete mesh_tally;
+  mesh_tally = new StructuredMeshTally(input, StructuredMeshTally::CYLINDRICAL);
+  score_track(10.5, -5.0, 0.5, 0.0, 1.0, 0.0, 10.0);
+  EXPECT_NEAR(x2 - x1, get_total(), 1e-12);
+}
+//---------------------------------------------------------------------------//
+TEST_F(CylindricalMeshTallyTest, ComputeScoreMatchesCellLookup) {
+  // split an oblique track into short pieces and score each piece in the
+  // cell containing its midpoint, then compare with the walk
+  moab::CartVect start(-3.2, -1.1, -0.3);
+  moab::CartVect dir(1.0, 0.37, 0.09);
+  dir.normalize();
+  double length = 8.0;
+
+  score_track(start[0], start[1], start[2], dir[0], dir[1], dir[2], length);
+
+  const int num_pieces = 100000;
+  std::vector<double> expected(12, 0.0);
+  for (int i = 0; i < num_pieces; ++i) {
+    moab::CartVect mid = start + dir * (length * (i + 0.5) / num_pieces);
+    int cell = mesh_tally->get_cell_index(mid);
+    if (cell >= 0)
+      expected[cell] += length / num_pieces;
+  }
+
+  for (unsigned int cell = 0; cell < 12; ++cell)
+    EXPECT_NEAR(expected[cell], get_score(cell), 1e-3);
+}
+//---------------------------------------------------------------------------//
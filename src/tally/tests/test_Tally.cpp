@@ -97,6 +97,25 @@ TEST_F(TallyFactoryTest, CreateTrackLengthMeshTally) {
   EXPECT_EQ("unstr_track", tally->get_tally_type());
 }
 //---------------------------------------------------------------------------//
+TEST_F(TallyFactoryTest, CreateCartesianMeshTally) {
+  input.tally_type = "struct_track";
+  input.options.insert(std::make_pair("x", "0,1,2"));
+  input.options.insert(std::make_pair("y", "0,1"));
+  input.options.insert(std::make_pair("z", "0,1"));
+  tally = Tally::create_tally(input);
+  EXPECT_TRUE(tally != NULL);
+  EXPECT_EQ("struct_track", tally->get_tally_type());
+}
+//---------------------------------------------------------------------------//
+TEST_F(TallyFactoryTest, CreateCylindricalMeshTally) {
+  input.tally_type = "cyl_track";
+  input.options.insert(std::make_pair("r", "0,1,2"));
+  input.options.insert(std::make_pair("z", "0,1"));
+  tally = Tally::create_tally(input);
+  EXPECT_TRUE(tally != NULL);
+  EXPECT_EQ("cyl_track", tally->get_tally_type());
+}
+//---------------------------------------------------------------------------//
 
 TEST_F(TallyFactoryTest, CreateKDETrackMeshTally) {
   input.tally_type = "kde_track";
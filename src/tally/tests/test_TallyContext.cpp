@@ -0,0 +1,439 @@
+// MCNP5/dagmc/test/test_TallyContext.cpp
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../TallyContext.hpp"
+#include "../TallyManager.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+// adds the cell tallies used by all tests to the TallyManager
+void add_cell_tallies(TallyManager& manager) {
+  std::vector<double> energy_bin_bounds;
+  energy_bin_bounds.push_back(0.0);
+  energy_bin_bounds.push_back(2.5);
+  energy_bin_bounds.push_back(6.0);
+  energy_bin_bounds.push_back(10.0);
+
+  std::multimap<std::string, std::string> options;
+  options.insert(std::make_pair("cell", "1"));
+  manager.addNewTally(1, "cell_track", 1, energy_bin_bounds, options);
+
+  options.clear();
+  options.insert(std::make_pair("cell", "2"));
+  manager.addNewTally(2, "cell_coll", 1, energy_bin_bounds, options);
+
+  options.clear();
+  options.insert(std::make_pair("cell", "3"));
+  manager.addNewTally(3, "cell_track", 1, energy_bin_bounds, options);
+
+  manager.addNewMultiplier(0);
+  manager.addMultiplierToTally(0, 3);
+}
+//---------------------------------------------------------------------------//
+// tracks a particle history with events that only depend on its history id,
+// either serially if context is NULL or in the given TallyContext
+void track_history(TallyManager& manager, TallyContext* context,
+                   unsigned long history) {
+  unsigned long state = 12345 + 7919 * history;
+
+  if (context != NULL)
+    manager.beginHistory(*context, history);
+
+  for (unsigned int i = 0; i < 1 + history % 5; ++i) {
+    state = (1103515245 * state + 12345) % 2147483648UL;
+    int cell = 1 + state % 3;
+    double energy = (state % 1000) * 0.01 + 0.003;
+    double weight = 1.0 / (1 + state % 7);
+    double length = (state % 317) * 0.0311;
+    double multiplier = 1.0 + (state % 13) * 0.1;
+
+    if (context == NULL) {
+      manager.updateMultiplier(0, multiplier);
+
+      if (cell == 2) {
+        manager.setCollisionEvent(1, 0.0, 0.0, 0.0, energy, weight, 0.7, cell);
+      } else {
+        manager.setTrackEvent(1, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0,
+                              energy, weight, length, cell);
+      }
+
+      manager.updateTallies();
+    } else {
+      manager.updateMultiplier(*context, 0, multiplier);
+
+      if (cell == 2) {
+        manager.setCollisionEvent(*context, 1, 0.0, 0.0, 0.0,
+                                  energy, weight, 0.7, cell);
+      } else {
+        manager.setTrackEvent(*context, 1, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0,
+                              energy, weight, length, cell);
+      }
+
+      manager.updateTallies(*context);
+    }
+  }
+
+  if (context == NULL)
+    manager.endHistory();
+  else
+    manager.endHistory(*context);
+}
+//---------------------------------------------------------------------------//
+// tracks histories [first, last) in batches of batch_size, with each history
+// assigned to one of the contexts out of order
+void track_batches(TallyManager& manager,
+                   const std::vector<TallyContext*>& contexts,
+                   unsigned long first, unsigned long last,
+                   unsigned long batch_size) {
+  unsigned int num_contexts = contexts.size();
+
+  for (unsigned long begin = first; begin < last; begin += batch_size) {
+    unsigned long end = std::min(begin + batch_size, last);
+
+    // each context tracks its histories in reverse order
+    for (unsigned int i = 0; i < num_contexts; ++i) {
+      for (unsigned long history = end; history > begin; --history) {
+        if ((7 * (history - 1)) % num_contexts == i)
+          track_history(manager, contexts[i], history - 1);
+      }
+    }
+
+    manager.endBatch(contexts);
+  }
+}
+//---------------------------------------------------------------------------//
+// tests that the tally and error data of a Tally in two TallyManagers are
+// identical
+void compare_tally_data(TallyManager& expected, TallyManager& actual,
+                        int tally_id) {
+  int expected_length = 0;
+  int length = 0;
+
+  double* expected_data = expected.getTallyData(tally_id, expected_length);
+  double* data = actual.getTallyData(tally_id, length);
+  ASSERT_EQ(expected_length, length);
+
+  for (int i = 0; i < length; ++i) {
+    EXPECT_EQ(expected_data[i], data[i]);
+  }
+
+  expected_data = expected.getErrorData(tally_id, expected_length);
+  data = actual.getErrorData(tally_id, length);
+  ASSERT_EQ(expected_length, length);
+
+  for (int i = 0; i < length; ++i) {
+    EXPECT_EQ(expected_data[i], data[i]);
+  }
+}
+//---------------------------------------------------------------------------//
+// SIMPLE TESTS
+//---------------------------------------------------------------------------//
+TEST(TallyContextTest, RandomNumberStreams) {
+  TallyManager manager;
+  TallyContext context1(5);
+  TallyContext context2(5);
+  TallyContext context3(6);
+
+  manager.beginHistory(context1, 3);
+  manager.beginHistory(context2, 3);
+  manager.beginHistory(context3, 3);
+  EXPECT_EQ(3u, context1.get_history_id());
+
+  std::vector<double> values;
+
+  // same seed and history give the same stream in any context
+  for (int i = 0; i < 100; ++i) {
+    double value = context1.random_number();
+    EXPECT_LE(0.0, value);
+    EXPECT_GT(1.0, value);
+    EXPECT_EQ(value, context2.random_number());
+    EXPECT_NE(value, context3.random_number());
+    values.push_back(value);
+  }
+
+  // starting the history again restarts its stream
+  manager.beginHistory(context2, 3);
+  EXPECT_EQ(values[0], context2.random_number());
+
+  // a different history gives a different stream
+  manager.beginHistory(context2, 4);
+  EXPECT_NE(values[0], context2.random_number());
+}
+//---------------------------------------------------------------------------//
+TEST(TallyContextTest, SeparateEvents) {
+  TallyManager manager;
+  add_cell_tallies(manager);
+
+  TallyContext context1;
+  TallyContext context2;
+  manager.beginHistory(context1, 0);
+  manager.beginHistory(context2, 1);
+
+  EXPECT_TRUE(manager.setCollisionEvent(context1, 1, 0.0, 0.0, 0.0,
+                                        1.0, 1.0, 0.5, 2));
+  EXPECT_FALSE(manager.setTrackEvent(context2, 1, 0.0, 0.0, 0.0,
+                                     1.0, 0.0, 0.0, 1.0, 1.0, -1.0, 1));
+  manager.updateMultiplier(context1, 0, 4.0);
+
+  EXPECT_EQ(TallyEvent::COLLISION, context1.get_event().type);
+  EXPECT_EQ(TallyEvent::NONE, context2.get_event().type);
+  EXPECT_DOUBLE_EQ(4.0, context1.get_event().multipliers[0]);
+  EXPECT_DOUBLE_EQ(1.0, context2.get_event().multipliers[0]);
+
+  // scores are only added to the tallies at the end of the batch
+  manager.updateTallies(context1);
+  EXPECT_EQ(TallyEvent::NONE, context1.get_event().type);
+  manager.endHistory(context1);
+
+  int length;
+  double* data = manager.getTallyData(2, length);
+  EXPECT_DOUBLE_EQ(0.0, data[0]);
+
+  std::vector<TallyContext*> contexts;
+  contexts.push_back(&context1);
+  contexts.push_back(&context2);
+  manager.endBatch(contexts);
+
+  EXPECT_DOUBLE_EQ(2.0, data[0]);
+  EXPECT_DOUBLE_EQ(2.0, data[3]);
+
+  // histories are removed from the contexts once they have been added
+  manager.endBatch(contexts);
+  EXPECT_DOUBLE_EQ(2.0, data[0]);
+}
+//---------------------------------------------------------------------------//
+TEST(TallyContextTest, DispatchCounts) {
+  TallyManager manager;
+  add_cell_tallies(manager);
+
+  // collisions only reach the collision tally
+  manager.setCollisionEvent(1, 0.0, 0.0, 0.0, 5.0, 1.0, 0.5, 2);
+  manager.updateTallies();
+  EXPECT_EQ(1u, manager.getNumDispatched());
+  EXPECT_EQ(2u, manager.getNumRejected());
+
+  // tracks only reach the two track tallies
+  manager.setTrackEvent(1, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 5.0, 1.0, 2.0, 1);
+  manager.updateTallies();
+  EXPECT_EQ(3u, manager.getNumDispatched());
+  EXPECT_EQ(3u, manager.getNumRejected());
+
+  // events outside the energy bins or for other particles reach no tallies
+  manager.setTrackEvent(1, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 10.5, 1.0, 2.0, 1);
+  manager.updateTallies();
+  manager.setCollisionEvent(2, 0.0, 0.0, 0.0, 5.0, 1.0, 0.5, 2);
+  manager.updateTallies();
+  EXPECT_EQ(3u, manager.getNumDispatched());
+  EXPECT_EQ(9u, manager.getNumRejected());
+
+  int length;
+  double* data = manager.getScratchData(1, length);
+  EXPECT_DOUBLE_EQ(2.0, data[1]);
+
+  // removing a tally removes it from the dispatch lists
+  manager.removeTally(3);
+  manager.setTrackEvent(1, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 5.0, 1.0, 2.0, 1);
+  manager.updateTallies();
+  EXPECT_EQ(4u, manager.getNumDispatched());
+  EXPECT_EQ(10u, manager.getNumRejected());
+
+  // counts from a context are added at the end of the batch
+  TallyContext context;
+  manager.beginHistory(context, 0);
+  manager.setCollisionEvent(context, 1, 0.0, 0.0, 0.0, 5.0, 1.0, 0.5, 2);
+  manager.updateTallies(context);
+  manager.endHistory(context);
+  EXPECT_EQ(4u, manager.getNumDispatched());
+
+  std::vector<TallyContext*> contexts(1, &context);
+  manager.endBatch(contexts);
+  EXPECT_EQ(5u, manager.getNumDispatched());
+  EXPECT_EQ(11u, manager.getNumRejected());
+
+  manager.zeroAllTallyData();
+  EXPECT_EQ(0u, manager.getNumDispatched());
+  EXPECT_EQ(0u, manager.getNumRejected());
+}
+//---------------------------------------------------------------------------//
+TEST(TallyContextTest, MatchesSerialScores) {
+  const unsigned long num_histories = 200;
+
+  TallyManager serial_manager;
+  add_cell_tallies(serial_manager);
+
+  for (unsigned long history = 0; history < num_histories; ++history) {
+    track_history(serial_manager, NULL, history);
+  }
+
+  // results are identical for any number of contexts and batch size
+  const unsigned int num_contexts[] = {1, 2, 3, 8};
+  const unsigned long batch_sizes[] = {num_histories, 64, 17, 1};
+
+  for (unsigned int i = 0; i < 4; ++i) {
+    TallyManager manager;
+    add_cell_tallies(manager);
+
+    std::vector<TallyContext*> contexts;
+    for (unsigned int j = 0; j < num_contexts[i]; ++j) {
+      contexts.push_back(new TallyContext(42));
+    }
+
+    track_batches(manager, contexts, 0, num_histories, batch_sizes[i]);
+
+    for (int tally_id = 1; tally_id <= 3; ++tally_id) {
+      compare_tally_data(serial_manager, manager, tally_id);
+    }
+
+    for (unsigned int j = 0; j < num_contexts[i]; ++j) {
+      delete contexts[j];
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+TEST(TallyContextTest, MatchesSerialStatistics) {
+  const unsigned long num_histories = 400;
+
+  TallyManager serial_manager;
+  add_cell_tallies(serial_manager);
+  serial_manager.enableStatistics(50, 0.5);
+  EXPECT_TRUE(serial_manager.setStatisticsBin(2, 0, 1));
+  EXPECT_FALSE(serial_manager.setStatisticsBin(2, 1, 0));
+  EXPECT_FALSE(serial_manager.setStatisticsBin(4, 0, 0));
+  EXPECT_TRUE(serial_manager.getStatistics(4) == NULL);
+
+  for (unsigned long history = 0; history < num_histories; ++history) {
+    track_history(serial_manager, NULL, history);
+  }
+
+  TallyManager manager;
+  add_cell_tallies(manager);
+  manager.enableStatistics(50, 0.5);
+  manager.setStatisticsBin(2, 0, 1);
+
+  std::vector<TallyContext*> contexts;
+  for (int i = 0; i < 3; ++i) {
+    contexts.push_back(new TallyContext());
+  }
+
+  track_batches(manager, contexts, 0, num_histories, 50);
+  EXPECT_EQ(num_histories, manager.getNumHistories());
+
+  // statistics are updated after the same histories in both managers
+  for (int tally_id = 1; tally_id <= 3; ++tally_id) {
+    const TallyStatistics* expected = serial_manager.getStatistics(tally_id);
+    const TallyStatistics* actual = manager.getStatistics(tally_id);
+    ASSERT_TRUE(expected != NULL);
+    ASSERT_TRUE(actual != NULL);
+
+    EXPECT_EQ(num_histories, actual->get_num_histories());
+    EXPECT_EQ(8u, actual->get_num_batches());
+    EXPECT_EQ(tally_id != 2, actual->is_summary());
+    EXPECT_NE(0.0, actual->get_rel_error());
+    EXPECT_DOUBLE_EQ(expected->get_mean(), actual->get_mean());
+    EXPECT_DOUBLE_EQ(expected->get_rel_error(), actual->get_rel_error());
+    EXPECT_DOUBLE_EQ(expected->get_vov(), actual->get_vov());
+    EXPECT_DOUBLE_EQ(expected->get_batch_rel_error(),
+                     actual->get_batch_rel_error());
+  }
+
+  // the mean is the tally result of the monitored bin per history
+  int length = 0;
+  double* data = manager.getTallyData(2, length);
+  EXPECT_DOUBLE_EQ(data[1] / num_histories,
+                   manager.getStatistics(2)->get_mean());
+  EXPECT_NE(0.0, manager.getStatistics(2)->get_vov());
+
+  // other tallies monitor the largest relative error of all scored bins
+  data = manager.getTallyData(1, length);
+  double* error = manager.getErrorData(1, length);
+  double max_rel_error = 0.0;
+
+  for (int i = 0; i < length; ++i) {
+    if (data[i] != 0.0) {
+      double r2 = error[i] / (data[i] * data[i]) - 1.0 / num_histories;
+      max_rel_error = std::max(max_rel_error, sqrt(r2));
+    }
+  }
+
+  EXPECT_DOUBLE_EQ(max_rel_error, manager.getStatistics(1)->get_rel_error());
+  EXPECT_EQ(0.0, manager.getStatistics(1)->get_mean());
+
+  manager.zeroAllTallyData();
+  EXPECT_EQ(0u, manager.getNumHistories());
+  EXPECT_EQ(0u, manager.getStatistics(1)->get_num_histories());
+  EXPECT_FALSE(manager.isConverged());
+
+  manager.disableStatistics();
+  EXPECT_TRUE(manager.getStatistics(1) == NULL);
+
+  for (unsigned int i = 0; i < contexts.size(); ++i) {
+    delete contexts[i];
+  }
+}
+//---------------------------------------------------------------------------//
+TEST(TallyContextTest, KDEMatchesSerialScores) {
+  std::vector<double> energy_bin_bounds;
+  energy_bin_bounds.push_back(0.0);
+  energy_bin_bounds.push_back(10.0);
+
+  std::multimap<std::string, std::string> options;
+  options.insert(std::make_pair("hx", "0.3"));
+  options.insert(std::make_pair("hy", "0.3"));
+  options.insert(std::make_pair("hz", "0.3"));
+  options.insert(std::make_pair("inp", "structured_mesh.h5m"));
+
+  TallyManager serial_manager;
+  serial_manager.addNewTally(1, "kde_coll", 1, energy_bin_bounds, options);
+  serial_manager.addNewTally(2, "kde_track", 1, energy_bin_bounds, options);
+
+  TallyManager manager;
+  manager.addNewTally(1, "kde_coll", 1, energy_bin_bounds, options);
+  manager.addNewTally(2, "kde_track", 1, energy_bin_bounds, options);
+
+  std::vector<TallyContext*> contexts;
+  for (int i = 0; i < 3; ++i) {
+    contexts.push_back(new TallyContext());
+  }
+
+  // each history has a collision followed by a track through the mesh
+  for (unsigned long history = 0; history < 30; ++history) {
+    double x = 0.15 * history;
+    double y = 0.3 * sin(0.7 * history);
+    double z = 0.3 * cos(0.7 * history);
+
+    serial_manager.setCollisionEvent(1, x, y, z, 5.0, 1.0, 0.8, 1);
+    serial_manager.updateTallies();
+    serial_manager.setTrackEvent(1, x, y, z, 1.0, 0.2, -0.1,
+                                 5.0, 1.0, 0.5, 1);
+    serial_manager.updateTallies();
+    serial_manager.endHistory();
+
+    TallyContext& context = *contexts[history % 3];
+    manager.beginHistory(context, history);
+    manager.setCollisionEvent(context, 1, x, y, z, 5.0, 1.0, 0.8, 1);
+    manager.updateTallies(context);
+    manager.setTrackEvent(context, 1, x, y, z, 1.0, 0.2, -0.1,
+                          5.0, 1.0, 0.5, 1);
+    manager.updateTallies(context);
+    manager.endHistory(context);
+  }
+
+  manager.endBatch(contexts);
+  compare_tally_data(serial_manager, manager, 1);
+  compare_tally_data(serial_manager, manager, 2);
+
+  for (int i = 0; i < 3; ++i) {
+    delete contexts[i];
+  }
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_TallyContext.cpp
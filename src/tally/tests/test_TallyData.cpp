@@ -1,5 +1,8 @@
 // MCNP5/dagmc/test/test_TallyData.cpp
 
+#include <cmath>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "../TallyData.hpp"
@@ -279,6 +282,102 @@ TEST_F(TallyDataTest, EndHistory) {
   }
 }
 //---------------------------------------------------------------------------//
+TEST_F(TallyDataTest, EndMultipleHistories) {
+  int length;
+
+  // Three tally points, 9 energy bins, no total
+  tallyData3->resize_data_arrays(3);
+  double* tally_data = tallyData3->get_tally_data(length);
+  double* error_data = tallyData3->get_error_data(length);
+  double* scratch_data = tallyData3->get_scratch_data(length);
+
+  // First history scores points 2 and 0, point 2 more than once
+  tallyData3->add_score_to_tally(2, 1.5, 4);
+  tallyData3->add_score_to_tally(0, 2.0, 1);
+  tallyData3->add_score_to_tally(2, 0.5, 4);
+  tallyData3->end_history();
+
+  // Second history scores point 2 again, then point 1
+  tallyData3->add_score_to_tally(2, 3.0, 4);
+  tallyData3->add_score_to_tally(1, -1.0, 8);
+  tallyData3->end_history();
+
+  // Third history scores nothing
+  tallyData3->end_history();
+
+  EXPECT_DOUBLE_EQ(2.0, tally_data[1]);
+  EXPECT_DOUBLE_EQ(4.0, error_data[1]);
+  EXPECT_DOUBLE_EQ(-1.0, tally_data[17]);
+  EXPECT_DOUBLE_EQ(1.0, error_data[17]);
+  EXPECT_DOUBLE_EQ(5.0, tally_data[22]);
+  EXPECT_DOUBLE_EQ(13.0, error_data[22]);
+
+  double total_tally = 0.0;
+  for (int i = 0; i < length; i++) {
+    total_tally += tally_data[i];
+    EXPECT_DOUBLE_EQ(0.0, scratch_data[i]);
+  }
+
+  EXPECT_DOUBLE_EQ(6.0, total_tally);
+}
+//---------------------------------------------------------------------------//
+TEST_F(TallyDataTest, ScratchDataHistories) {
+  int length;
+
+  // Two tally points, 5 energy bins, total
+  tallyData2->resize_data_arrays(2);
+  TallyData* scratch = tallyData2->create_scratch_data();
+  double* scratch_data = scratch->get_scratch_data(length);
+  EXPECT_EQ(12, length);
+
+  // First history scores point 1 twice and point 0 once
+  std::vector<unsigned int> indices;
+  std::vector<double> scores;
+  scratch->add_score_to_tally(1, 5.6, 0);
+  scratch->add_score_to_tally(0, 1.1, 3);
+  scratch->add_score_to_tally(1, 7.8, 2);
+  scratch->end_history(indices, scores);
+
+  // all energy bins of the points that were scored are moved, point 1 first
+  ASSERT_EQ(12u, indices.size());
+  ASSERT_EQ(12u, scores.size());
+  EXPECT_EQ(6u, indices[0]);
+  EXPECT_DOUBLE_EQ(5.6, scores[0]);
+  EXPECT_DOUBLE_EQ(13.4, scores[5]);
+  EXPECT_EQ(0u, indices[6]);
+  EXPECT_DOUBLE_EQ(1.1, scores[9]);
+
+  for (int i = 0; i < length; i++) {
+    EXPECT_DOUBLE_EQ(0.0, scratch_data[i]);
+  }
+
+  // Second history scores point 0 again
+  scratch->add_score_to_tally(0, -2.1, 0);
+  scratch->end_history(indices, scores);
+  ASSERT_EQ(18u, indices.size());
+
+  // adding both histories matches scoring them directly
+  TallyData expected(5, true);
+  expected.resize_data_arrays(2);
+  expected.add_score_to_tally(1, 5.6, 0);
+  expected.add_score_to_tally(0, 1.1, 3);
+  expected.add_score_to_tally(1, 7.8, 2);
+  expected.end_history();
+  expected.add_score_to_tally(0, -2.1, 0);
+  expected.end_history();
+
+  tallyData2->add_history_scores(&indices[0], &scores[0], 12);
+  tallyData2->add_history_scores(&indices[12], &scores[12], 6);
+
+  for (unsigned int i = 0; i < 2; i++) {
+    for (unsigned int j = 0; j < 6; j++) {
+      EXPECT_EQ(expected.get_data(i, j), tallyData2->get_data(i, j));
+    }
+  }
+
+  delete scratch;
+}
+//---------------------------------------------------------------------------//
 TEST_F(TallyDataTest, AddScoreToTally) {
   int length;
 
@@ -327,5 +426,60 @@ TEST_F(TallyDataTest, AddScoreToTally) {
   EXPECT_DOUBLE_EQ(0.0, scratch_data[10]);
 }
 //---------------------------------------------------------------------------//
+TEST_F(TallyDataTest, GetResults) {
+  // Two tally points, 5 energy bins, total
+  tallyData2->resize_data_arrays(2);
+  tallyData2->add_score_to_tally(0, 2.0, 1);
+  tallyData2->add_score_to_tally(1, 3.0, 4);
+  tallyData2->end_history();
+  tallyData2->add_score_to_tally(0, 6.0, 1);
+  tallyData2->add_score_to_tally(0, 1.0, 3);
+  tallyData2->end_history();
+
+  std::vector<double> results, rel_errors, total_results, total_errors;
+  double volumes[] = {0.5, 4.0};
+  tallyData2->get_results(2.0, volumes, results, rel_errors,
+                          total_results, total_errors);
+
+  ASSERT_EQ(10u, results.size());
+  ASSERT_EQ(10u, rel_errors.size());
+  ASSERT_EQ(2u, total_results.size());
+  ASSERT_EQ(2u, total_errors.size());
+
+  // each result matches the values from get_data
+  for (unsigned int i = 0; i < 2; ++i) {
+    for (unsigned int j = 0; j < 6; ++j) {
+      std::pair<double, double> data = tallyData2->get_data(i, j);
+      double rel_error = 0.0;
+
+      if (data.second != 0.0)
+        rel_error = sqrt(data.second / (data.first * data.first) - 0.5);
+
+      double result = j < 5 ? results[i * 5 + j] : total_results[i];
+      double error = j < 5 ? rel_errors[i * 5 + j] : total_errors[i];
+      EXPECT_DOUBLE_EQ(data.first / (2.0 * volumes[i]), result);
+      EXPECT_DOUBLE_EQ(rel_error, error);
+    }
+  }
+
+  EXPECT_DOUBLE_EQ(8.0, results[1]);
+  EXPECT_DOUBLE_EQ(0.0, rel_errors[0]);
+  EXPECT_DOUBLE_EQ(9.0, total_results[0]);
+
+  // without volumes or a total energy bin
+  tallyData1->resize_data_arrays(3);
+  tallyData1->add_score_to_tally(2, 4.0, 0);
+  tallyData1->end_history();
+  tallyData1->get_results(4.0, NULL, results, rel_errors,
+                          total_results, total_errors);
+
+  ASSERT_EQ(3u, results.size());
+  EXPECT_TRUE(total_results.empty());
+  EXPECT_TRUE(total_errors.empty());
+  EXPECT_DOUBLE_EQ(1.0, results[2]);
+  EXPECT_DOUBLE_EQ(sqrt(0.75), rel_errors[2]);
+  EXPECT_DOUBLE_EQ(0.0, results[0]);
+}
+//---------------------------------------------------------------------------//
 
 // end of MCNP5/dagmc/test/test_TallyData.cpp
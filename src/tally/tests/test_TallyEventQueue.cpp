@@ -0,0 +1,262 @@
+// MCNP5/dagmc/test/test_TallyEventQueue.cpp
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../TallyEventQueue.hpp"
+#include "../TallyManager.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+// adds cell tallies for two particles, with a multiplier on one of them
+void add_queue_tallies(TallyManager& manager) {
+  std::vector<double> energy_bin_bounds;
+  energy_bin_bounds.push_back(0.0);
+  energy_bin_bounds.push_back(2.5);
+  energy_bin_bounds.push_back(6.0);
+
+  std::multimap<std::string, std::string> options;
+  options.insert(std::make_pair("cell", "1"));
+  manager.addNewTally(1, "cell_track", 1, energy_bin_bounds, options);
+  manager.addNewTally(4, "cell_track", 2, energy_bin_bounds, options);
+
+  options.clear();
+  options.insert(std::make_pair("cell", "2"));
+  manager.addNewTally(2, "cell_coll", 1, energy_bin_bounds, options);
+
+  options.clear();
+  options.insert(std::make_pair("cell", "3"));
+  manager.addNewTally(3, "cell_track", 1, energy_bin_bounds, options);
+
+  manager.addNewMultiplier(0);
+  manager.addMultiplierToTally(0, 3);
+}
+//---------------------------------------------------------------------------//
+// adds two KDE sub-track tallies that share the random numbers of rand()
+void add_sub_track_tallies(TallyManager& manager) {
+  std::vector<double> energy_bin_bounds;
+  energy_bin_bounds.push_back(0.0);
+  energy_bin_bounds.push_back(6.0);
+
+  std::multimap<std::string, std::string> options;
+  options.insert(std::make_pair("inp", "structured_mesh.h5m"));
+  options.insert(std::make_pair("hx", "0.5"));
+  options.insert(std::make_pair("hy", "0.5"));
+  options.insert(std::make_pair("hz", "0.5"));
+  options.insert(std::make_pair("seed", "2014"));
+  manager.addNewTally(5, "kde_subtrack", 1, energy_bin_bounds, options);
+  manager.addNewTally(6, "kde_subtrack", 1, energy_bin_bounds, options);
+}
+//---------------------------------------------------------------------------//
+// tracks histories [0, num_histories) with events that only depend on the
+// history id, some of which are outside the energy range of the tallies
+void track_queue_histories(TallyManager& manager,
+                           unsigned long num_histories) {
+  for (unsigned long history = 0; history < num_histories; ++history) {
+    unsigned long state = 54321 + 7919 * history;
+
+    for (unsigned int i = 0; i < 1 + history % 4; ++i) {
+      state = (1103515245 * state + 12345) % 2147483648UL;
+      unsigned int particle = 1 + state % 2;
+      int cell = 1 + state % 3;
+      double energy = (state % 1000) * 0.007 + 0.003;
+      double weight = 1.0 / (1 + state % 7);
+      double length = (state % 317) * 0.0311;
+
+      manager.updateMultiplier(0, 1.0 + (state % 13) * 0.1);
+
+      if (cell == 2) {
+        manager.setCollisionEvent(particle, 0.0, 0.0, 0.0,
+                                  energy, weight, 0.7, cell);
+      } else {
+        manager.setTrackEvent(particle, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0,
+                              energy, weight, length, cell);
+      }
+
+      manager.updateTallies();
+    }
+
+    manager.endHistory();
+  }
+}
+//---------------------------------------------------------------------------//
+// SIMPLE TESTS
+//---------------------------------------------------------------------------//
+TEST(TallyEventQueueTest, StoresEvents) {
+  TallyEventQueue queue(3, 2);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(3u, queue.capacity());
+
+  TallyEvent event;
+  event.type = TallyEvent::TRACK;
+  event.particle = 2;
+  event.current_cell = 7;
+  event.position = moab::CartVect(1.0, 2.0, 3.0);
+  event.direction = moab::CartVect(0.0, 0.6, 0.8);
+  event.particle_energy = 4.5;
+  event.particle_weight = 0.25;
+  event.track_length = 1.5;
+  event.total_cross_section = 0.0;
+  event.multipliers.push_back(2.0);
+  event.multipliers.push_back(3.0);
+
+  queue.push_event(event);
+  queue.push_end_history();
+  EXPECT_EQ(2u, queue.size());
+  EXPECT_EQ(1u, queue.num_events());
+  EXPECT_FALSE(queue.full());
+
+  EXPECT_EQ(TallyEvent::TRACK, queue.get_type(0));
+  EXPECT_EQ(2u, queue.get_particle(0));
+  EXPECT_DOUBLE_EQ(4.5, queue.get_energy(0));
+  EXPECT_EQ(TallyEvent::NONE, queue.get_type(1));
+
+  TallyEvent queued_event;
+  queue.get_event(0, queued_event);
+  EXPECT_EQ(TallyEvent::TRACK, queued_event.type);
+  EXPECT_EQ(7, queued_event.current_cell);
+  EXPECT_DOUBLE_EQ(3.0, queued_event.position[2]);
+  EXPECT_DOUBLE_EQ(0.8, queued_event.direction[2]);
+  EXPECT_DOUBLE_EQ(0.25, queued_event.particle_weight);
+  EXPECT_DOUBLE_EQ(1.5, queued_event.track_length);
+  ASSERT_EQ(2u, queued_event.multipliers.size());
+  EXPECT_DOUBLE_EQ(3.0, queued_event.multipliers[1]);
+
+  queue.push_end_history();
+  EXPECT_TRUE(queue.full());
+
+  queue.clear();
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(0u, queue.num_events());
+
+  queue.set_num_multipliers(0);
+  event.multipliers.clear();
+  queue.push_event(event);
+  queue.get_event(0, queued_event);
+  EXPECT_TRUE(queued_event.multipliers.empty());
+}
+//---------------------------------------------------------------------------//
+TEST(TallyEventQueueTest, FlushOnDataAccess) {
+  TallyManager manager;
+  add_queue_tallies(manager);
+  manager.enableEventQueue(16, 2);
+
+  manager.setCollisionEvent(1, 0.0, 0.0, 0.0, 1.0, 0.5, 0.25, 2);
+  manager.updateTallies();
+  manager.endHistory();
+
+  // the queue is scored before the data is returned
+  int length;
+  double* data = manager.getTallyData(2, length);
+  EXPECT_DOUBLE_EQ(2.0, data[0]);
+  EXPECT_EQ(1u, manager.getNumDispatched());
+  EXPECT_EQ(3u, manager.getNumRejected());
+
+  // events are scored directly once the queue is disabled
+  manager.disableEventQueue();
+  manager.setCollisionEvent(1, 0.0, 0.0, 0.0, 1.0, 0.5, 0.25, 2);
+  manager.updateTallies();
+  manager.endHistory();
+
+  data = manager.getTallyData(2, length);
+  EXPECT_DOUBLE_EQ(4.0, data[0]);
+}
+//---------------------------------------------------------------------------//
+// ADVANCED TESTS
+//---------------------------------------------------------------------------//
+TEST(TallyEventQueueTest, MatchesDirectScores) {
+  TallyManager expected;
+  add_queue_tallies(expected);
+  add_sub_track_tallies(expected);
+  track_queue_histories(expected, 200);
+
+  const unsigned int capacities[] = {1, 7, 64, 4096};
+  const unsigned int num_threads[] = {0, 1, 3};
+
+  for (unsigned int i = 0; i < 4; ++i) {
+    for (unsigned int j = 0; j < 3; ++j) {
+      // the seed of the sub-track tallies is reset when they are added
+      TallyManager manager;
+      add_queue_tallies(manager);
+      add_sub_track_tallies(manager);
+      manager.enableEventQueue(capacities[i], num_threads[j]);
+      track_queue_histories(manager, 200);
+      manager.flushEventQueue();
+
+      EXPECT_EQ(expected.getNumDispatched(), manager.getNumDispatched());
+      EXPECT_EQ(expected.getNumRejected(), manager.getNumRejected());
+
+      for (int tally_id = 1; tally_id <= 6; ++tally_id) {
+        int expected_length = 0;
+        int length = 0;
+
+        double* expected_data = expected.getTallyData(tally_id,
+                                                      expected_length);
+        double* data = manager.getTallyData(tally_id, length);
+        ASSERT_EQ(expected_length, length);
+
+        for (int k = 0; k < length; ++k) {
+          EXPECT_EQ(expected_data[k], data[k]);
+        }
+
+        // errors are only equal if the histories ended at the same events
+        expected_data = expected.getErrorData(tally_id, expected_length);
+        data = manager.getErrorData(tally_id, length);
+
+        for (int k = 0; k < length; ++k) {
+          EXPECT_EQ(expected_data[k], data[k]);
+        }
+      }
+    }
+  }
+}
+//---------------------------------------------------------------------------//
+// Tests that statistics are only updated from histories that have been
+// scored by the workers, without waiting for the queue to be scored
+TEST(TallyEventQueueTest, StatisticsFromScoredHistories) {
+  TallyManager expected;
+  add_queue_tallies(expected);
+  expected.enableStatistics(10, 0.1);
+  track_queue_histories(expected, 200);
+
+  // a queue of one entry is scored before the next entry is added, so the
+  // updates are made after the same histories as when scoring directly
+  TallyManager manager;
+  add_queue_tallies(manager);
+  manager.enableEventQueue(1, 0);
+  manager.enableStatistics(10, 0.1);
+  track_queue_histories(manager, 200);
+  manager.flushEventQueue();
+
+  for (int tally_id = 1; tally_id <= 4; ++tally_id) {
+    const TallyStatistics* expected_statistics =
+      expected.getStatistics(tally_id);
+    const TallyStatistics* statistics = manager.getStatistics(tally_id);
+    ASSERT_TRUE(statistics != NULL);
+
+    EXPECT_EQ(20u, statistics->get_num_batches());
+    EXPECT_EQ(expected_statistics->get_num_histories(),
+              statistics->get_num_histories());
+    EXPECT_DOUBLE_EQ(expected_statistics->get_rel_error(),
+                     statistics->get_rel_error());
+  }
+
+  // larger queues are only included once the workers have scored them
+  TallyManager queued;
+  add_queue_tallies(queued);
+  queued.enableEventQueue(64, 2);
+  queued.enableStatistics(10, 0.1);
+  track_queue_histories(queued, 200);
+
+  const TallyStatistics* statistics = queued.getStatistics(1);
+  EXPECT_LT(0u, statistics->get_num_batches());
+  EXPECT_GT(20u, statistics->get_num_batches());
+  EXPECT_GT(200u, statistics->get_num_histories());
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_TallyEventQueue.cpp
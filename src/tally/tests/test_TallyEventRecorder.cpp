@@ -0,0 +1,246 @@
+// MCNP5/dagmc/test/test_TallyEventRecorder.cpp
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../TallyEventReader.hpp"
+#include "../TallyEventRecorder.hpp"
+#include "../TallyManager.hpp"
+
+//---------------------------------------------------------------------------//
+// TEST FIXTURES
+//---------------------------------------------------------------------------//
+class TallyEventRecorderTest : public ::testing::Test {
+ protected:
+  // initialize variables for each test
+  virtual void SetUp() {
+    filename = "test_tally_events.bin";
+
+    std::vector<double> energy_bin_bounds;
+    energy_bin_bounds.push_back(0.0);
+    energy_bin_bounds.push_back(5.0);
+    energy_bin_bounds.push_back(10.0);
+
+    std::multimap<std::string, std::string> options;
+    options.insert(std::make_pair("cell", "1"));
+    manager.addNewTally(4, "cell_track", 1, energy_bin_bounds, options);
+
+    options.clear();
+    options.insert(std::make_pair("cell", "2"));
+    options.insert(std::make_pair("volume", "2.5"));
+    manager.addNewTally(7, "cell_coll", 1, energy_bin_bounds, options);
+
+    manager.addNewMultiplier(1);
+    manager.addMultiplierToTally(1, 4);
+    manager.updateMultiplier(1, 3.0);
+  }
+
+  // remove the event stream
+  virtual void TearDown() {
+    std::remove(filename.c_str());
+  }
+
+  // scores a number of histories with events in both cells
+  void score_histories(TallyManager& tally_manager, int first, int last) {
+    for (int i = first; i < last; ++i) {
+      double energy = 0.7 * (i % 15);
+      tally_manager.updateMultiplier(1, 1.0 + 0.1 * i);
+      tally_manager.setTrackEvent(1, 0.0, 0.0, 0.0, 1.0, 2.0, 0.5,
+                                  energy, 1.0, 0.1 * i, 1);
+      tally_manager.updateTallies();
+      tally_manager.setCollisionEvent(1, 0.0, 0.0, 0.0,
+                                      energy, 0.5, 0.3 + i, 2);
+      tally_manager.updateTallies();
+      tally_manager.endHistory();
+    }
+  }
+
+  // tests that the data for a Tally is the same in both TallyManagers
+  void compare_data(TallyManager& expected, TallyManager& actual,
+                    int tally_id) {
+    int expected_length = 0;
+    int length = 0;
+    double* expected_data = expected.getTallyData(tally_id, expected_length);
+    double* data = actual.getTallyData(tally_id, length);
+    ASSERT_EQ(expected_length, length);
+
+    for (int i = 0; i < length; ++i) {
+      EXPECT_EQ(expected_data[i], data[i]);
+    }
+
+    expected_data = expected.getErrorData(tally_id, expected_length);
+    data = actual.getErrorData(tally_id, length);
+
+    for (int i = 0; i < length; ++i) {
+      EXPECT_EQ(expected_data[i], data[i]);
+    }
+  }
+
+ protected:
+  // data needed for each test
+  std::string filename;
+  TallyManager manager;
+};
+//---------------------------------------------------------------------------//
+// FIXTURE-BASED TESTS: TallyEventRecorderTest
+//---------------------------------------------------------------------------//
+// Tests that a replayed stream rebuilds the tallies and gives the same data
+TEST_F(TallyEventRecorderTest, ReplayEvents) {
+  // histories before recording starts are not included
+  score_histories(manager, 0, 5);
+  manager.zeroAllTallyData();
+
+  ASSERT_TRUE(manager.startRecording(filename));
+  EXPECT_TRUE(manager.isRecording());
+  score_histories(manager, 5, 25);
+
+  // tallies added and removed while recording
+  std::vector<double> energy_bin_bounds;
+  energy_bin_bounds.push_back(0.0);
+  energy_bin_bounds.push_back(10.0);
+
+  std::multimap<std::string, std::string> options;
+  options.insert(std::make_pair("cell", "2"));
+  manager.addNewTally(9, "cell_track", 1, energy_bin_bounds, options);
+  manager.addMultiplierToTally(1, 9);
+  manager.removeTally(4);
+  score_histories(manager, 25, 40);
+
+  EXPECT_TRUE(manager.stopRecording());
+  EXPECT_FALSE(manager.isRecording());
+
+  // later histories are not recorded
+  score_histories(manager, 40, 45);
+
+  TallyEventReader reader(filename);
+  ASSERT_TRUE(reader.is_valid());
+
+  TallyManager replayed;
+  EXPECT_TRUE(reader.replay(replayed));
+  EXPECT_EQ(70u, reader.get_num_events());
+  EXPECT_EQ(35u, reader.get_num_histories());
+  EXPECT_EQ(35u, replayed.getNumHistories());
+
+  ASSERT_EQ(2u, replayed.numTallies());
+  int length = 0;
+  EXPECT_TRUE(replayed.getTallyData(4, length) == NULL);
+
+  // replaying through the event queue gives the same data
+  TallyEventReader queued_reader(filename);
+  TallyManager queued;
+  queued.enableEventQueue(16, 2);
+  EXPECT_TRUE(queued_reader.replay(queued));
+  queued.flushEventQueue();
+
+  compare_data(replayed, queued, 7);
+  compare_data(replayed, queued, 9);
+  EXPECT_EQ(replayed.getNumDispatched(), queued.getNumDispatched());
+  EXPECT_EQ(replayed.getNumRejected(), queued.getNumRejected());
+}
+//---------------------------------------------------------------------------//
+// Tests that the replayed data matches the data of the recorded run
+TEST_F(TallyEventRecorderTest, MatchesRecordedRun) {
+  score_histories(manager, 0, 3);
+  manager.zeroAllTallyData();
+
+  ASSERT_TRUE(manager.startRecording(filename));
+  score_histories(manager, 3, 30);
+
+  // invalid events are replayed in the same way
+  EXPECT_FALSE(manager.setTrackEvent(1, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0,
+                                     1.0, 1.0, -1.0, 1));
+  manager.updateTallies();
+  manager.endHistory();
+  EXPECT_TRUE(manager.stopRecording());
+
+  TallyEventReader reader(filename);
+  TallyManager replayed;
+  ASSERT_TRUE(reader.replay(replayed));
+
+  EXPECT_EQ(2u, replayed.numTallies());
+  compare_data(manager, replayed, 4);
+  compare_data(manager, replayed, 7);
+  EXPECT_EQ(manager.getNumDispatched(), replayed.getNumDispatched());
+  EXPECT_EQ(manager.getNumRejected(), replayed.getNumRejected());
+}
+//---------------------------------------------------------------------------//
+// Tests that definitions can be replayed and the events loaded before replay
+TEST_F(TallyEventRecorderTest, PreloadEvents) {
+  ASSERT_TRUE(manager.startRecording(filename));
+  score_histories(manager, 0, 20);
+  EXPECT_TRUE(manager.stopRecording());
+
+  TallyEventReader reader(filename);
+  TallyManager replayed;
+  ASSERT_TRUE(reader.replay_definitions(replayed));
+  EXPECT_EQ(2u, replayed.numTallies());
+  EXPECT_EQ(0u, reader.get_num_events());
+  EXPECT_EQ(0u, replayed.getNumDispatched());
+
+  // the file is no longer needed once it has been loaded
+  ASSERT_TRUE(reader.preload());
+  std::remove(filename.c_str());
+
+  ASSERT_TRUE(reader.replay(replayed));
+  EXPECT_EQ(40u, reader.get_num_events());
+  EXPECT_EQ(20u, reader.get_num_histories());
+  compare_data(manager, replayed, 4);
+  compare_data(manager, replayed, 7);
+
+  // nothing is left to replay
+  EXPECT_TRUE(reader.replay_definitions(replayed));
+  EXPECT_TRUE(reader.preload());
+  EXPECT_TRUE(reader.replay(replayed));
+  EXPECT_EQ(20u, reader.get_num_histories());
+}
+//---------------------------------------------------------------------------//
+// Tests that incomplete streams and other files are detected
+TEST_F(TallyEventRecorderTest, InvalidStream) {
+  ASSERT_TRUE(manager.startRecording(filename));
+  score_histories(manager, 0, 10);
+  EXPECT_TRUE(manager.stopRecording());
+
+  // remove the end of the last record
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  std::string contents((std::istreambuf_iterator<char>(in)),
+                       std::istreambuf_iterator<char>());
+  in.close();
+
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  out.write(contents.data(), contents.size() - 10);
+  out.close();
+
+  TallyEventReader reader(filename);
+  ASSERT_TRUE(reader.is_valid());
+
+  TallyManager replayed;
+  EXPECT_FALSE(reader.replay(replayed));
+  EXPECT_EQ(19u, reader.get_num_events());
+  EXPECT_EQ(9u, reader.get_num_histories());
+  EXPECT_EQ(2u, replayed.numTallies());
+
+  // files that are missing or are not event streams
+  TallyEventReader missing("missing_events.bin");
+  EXPECT_FALSE(missing.is_valid());
+  EXPECT_FALSE(missing.replay(replayed));
+
+  out.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+  out << "not an event stream" << std::endl;
+  out.close();
+
+  TallyEventReader invalid(filename);
+  EXPECT_FALSE(invalid.is_valid());
+
+  EXPECT_FALSE(manager.startRecording("missing_directory/events.bin"));
+  EXPECT_FALSE(manager.isRecording());
+  EXPECT_FALSE(manager.stopRecording());
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_TallyEventRecorder.cpp
@@ -0,0 +1,224 @@
+// MCNP5/dagmc/test/test_TallyManager.cpp
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../TallyManager.hpp"
+
+//---------------------------------------------------------------------------//
+// TEST FIXTURES
+//---------------------------------------------------------------------------//
+class TallyCheckpointTest : public ::testing::Test {
+ protected:
+  // initialize variables for each test
+  virtual void SetUp() {
+    filename = "test_tally_checkpoint.bin";
+    add_tallies(manager);
+    add_tallies(restored);
+    score_histories(manager, 30);
+  }
+
+  // remove the checkpoint files
+  virtual void TearDown() {
+    std::remove(filename.c_str());
+    std::remove((filename + ".tmp").c_str());
+  }
+
+  // adds two cell tallies with different energy bins to the TallyManager
+  void add_tallies(TallyManager& tally_manager) {
+    std::vector<double> energy_bin_bounds;
+    energy_bin_bounds.push_back(0.0);
+    energy_bin_bounds.push_back(5.0);
+    energy_bin_bounds.push_back(10.0);
+
+    std::multimap<std::string, std::string> options;
+    options.insert(std::make_pair("cell", "1"));
+    tally_manager.addNewTally(4, "cell_track", 1, energy_bin_bounds, options);
+
+    energy_bin_bounds.push_back(20.0);
+    options.clear();
+    options.insert(std::make_pair("cell", "2"));
+    tally_manager.addNewTally(7, "cell_coll", 1, energy_bin_bounds, options);
+  }
+
+  // scores a number of histories with events in both cells
+  void score_histories(TallyManager& tally_manager, int num_histories) {
+    for (int i = 0; i < num_histories; ++i) {
+      double energy = 0.7 * (i % 25);
+      tally_manager.setTrackEvent(1, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0,
+                                  energy, 1.0, 0.1 * i, 1);
+      tally_manager.updateTallies();
+      tally_manager.setCollisionEvent(1, 0.0, 0.0, 0.0,
+                                      energy, 0.5, 0.3 + i, 2);
+      tally_manager.updateTallies();
+      tally_manager.endHistory();
+    }
+  }
+
+  // tests that the data for a Tally is the same in both TallyManagers
+  void compare_data(TallyManager& expected, TallyManager& actual,
+                    int tally_id) {
+    int expected_length = 0;
+    int length = 0;
+    double* expected_data = expected.getTallyData(tally_id, expected_length);
+    double* data = actual.getTallyData(tally_id, length);
+    ASSERT_EQ(expected_length, length);
+
+    for (int i = 0; i < length; ++i) {
+      EXPECT_EQ(expected_data[i], data[i]);
+    }
+
+    expected_data = expected.getErrorData(tally_id, expected_length);
+    data = actual.getErrorData(tally_id, length);
+
+    for (int i = 0; i < length; ++i) {
+      EXPECT_EQ(expected_data[i], data[i]);
+    }
+  }
+
+  // changes one byte at the given offset from the end of the checkpoint
+  void corrupt_checkpoint(long offset) {
+    std::fstream file(filename.c_str(),
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(-offset, std::ios::end);
+    char byte = file.peek();
+    file.seekp(-offset, std::ios::end);
+    file.put(byte ^ 0x10);
+  }
+
+ protected:
+  // data needed for each test
+  std::string filename;
+  TallyManager manager;
+  TallyManager restored;
+};
+//---------------------------------------------------------------------------//
+// FIXTURE-BASED TESTS: TallyCheckpointTest
+//---------------------------------------------------------------------------//
+// Tests that restored data is identical and can be scored further
+TEST_F(TallyCheckpointTest, RestoreCheckpoint) {
+  ASSERT_TRUE(manager.checkpoint(filename));
+  ASSERT_TRUE(restored.restore(filename));
+
+  compare_data(manager, restored, 4);
+  compare_data(manager, restored, 7);
+  EXPECT_EQ(manager.getNumDispatched(), restored.getNumDispatched());
+  EXPECT_EQ(manager.getNumRejected(), restored.getNumRejected());
+  EXPECT_EQ(30u, restored.getNumHistories());
+
+  // continuing from the checkpoint gives the same results
+  score_histories(manager, 10);
+  score_histories(restored, 10);
+  compare_data(manager, restored, 4);
+  compare_data(manager, restored, 7);
+  EXPECT_EQ(40u, restored.getNumHistories());
+
+  // a new checkpoint replaces the old one
+  ASSERT_TRUE(manager.checkpoint(filename));
+  ASSERT_TRUE(restored.restore(filename));
+  compare_data(manager, restored, 7);
+}
+//---------------------------------------------------------------------------//
+// Tests that a checkpoint written in the background has the data from when
+// it was started
+TEST_F(TallyCheckpointTest, BackgroundCheckpoint) {
+  EXPECT_TRUE(manager.waitForCheckpoint());
+  ASSERT_TRUE(manager.checkpoint(filename, true));
+
+  // scoring continues while the checkpoint is written
+  score_histories(manager, 10);
+  ASSERT_TRUE(manager.waitForCheckpoint());
+
+  ASSERT_TRUE(restored.restore(filename));
+  score_histories(restored, 10);
+  compare_data(manager, restored, 4);
+  compare_data(manager, restored, 7);
+
+  // a checkpoint that cannot be written is reported by waitForCheckpoint()
+  ASSERT_TRUE(manager.checkpoint("missing_directory/checkpoint.bin", true));
+  EXPECT_FALSE(manager.waitForCheckpoint());
+}
+//---------------------------------------------------------------------------//
+// Tests that checkpoints for different tallies are not restored
+TEST_F(TallyCheckpointTest, MismatchedTallies) {
+  ASSERT_TRUE(manager.checkpoint(filename));
+  score_histories(restored, 5);
+
+  TallyManager original;
+  add_tallies(original);
+  score_histories(original, 5);
+
+  std::vector<double> energy_bin_bounds;
+  energy_bin_bounds.push_back(0.0);
+  energy_bin_bounds.push_back(10.0);
+  std::multimap<std::string, std::string> options;
+
+  // different energy bins for the same tally id
+  restored.removeTally(4);
+  restored.addNewTally(4, "cell_track", 1, energy_bin_bounds, options);
+  EXPECT_FALSE(restored.restore(filename));
+
+  // different number of tallies
+  restored.removeTally(4);
+  EXPECT_FALSE(restored.restore(filename));
+
+  // different tally type
+  restored.addNewTally(4, "cell_coll", 1, energy_bin_bounds, options);
+  EXPECT_FALSE(restored.restore(filename));
+
+  // the data and the number of histories were not changed
+  compare_data(original, restored, 7);
+  EXPECT_EQ(5u, restored.getNumHistories());
+
+  // files that are missing or are not checkpoints
+  EXPECT_FALSE(restored.restore("missing_checkpoint.bin"));
+
+  std::ofstream file(filename.c_str());
+  file << "not a checkpoint" << std::endl;
+  file.close();
+  EXPECT_FALSE(restored.restore(filename));
+  compare_data(original, restored, 7);
+}
+//---------------------------------------------------------------------------//
+// Tests that corrupt data is detected by the checksums
+TEST_F(TallyCheckpointTest, CorruptCheckpoint) {
+  ASSERT_TRUE(manager.checkpoint(filename));
+
+  // the last error value of the last tally
+  corrupt_checkpoint(12);
+  EXPECT_FALSE(restored.restore(filename));
+
+  int length = 0;
+  double* data = restored.getTallyData(7, length);
+
+  for (int i = 0; i < length; ++i) {
+    EXPECT_EQ(0.0, data[i]);
+  }
+
+  // a truncated checkpoint does not change the data
+  ASSERT_TRUE(manager.checkpoint(filename));
+  score_histories(restored, 5);
+  data = restored.getTallyData(7, length);
+  double expected = data[0];
+
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  std::string contents((std::istreambuf_iterator<char>(in)),
+                       std::istreambuf_iterator<char>());
+  in.close();
+
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  out.write(contents.data(), contents.size() - 20);
+  out.close();
+
+  EXPECT_FALSE(restored.restore(filename));
+  EXPECT_EQ(expected, restored.getTallyData(7, length)[0]);
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_TallyManager.cpp
@@ -0,0 +1,222 @@
+// MCNP5/dagmc/test/test_TallyStatistics.cpp
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "../TallyStatistics.hpp"
+
+//---------------------------------------------------------------------------//
+// HELPER FUNCTIONS
+//---------------------------------------------------------------------------//
+// adds the powers 1 to 4 of a history score to the sums
+void add_score(double score, double sums[4]) {
+  sums[0] += score;
+  sums[1] += score * score;
+  sums[2] += score * score * score;
+  sums[3] += score * score * score * score;
+}
+//---------------------------------------------------------------------------//
+// adds a batch of histories with scores uniformly distributed in [0, 1),
+// taking one second for every 1000 histories
+void add_batch(TallyStatistics& statistics, unsigned long& num_histories,
+               double sums[4], unsigned long& state) {
+  for (unsigned int i = 0; i < 1000; ++i) {
+    state = (1103515245 * state + 12345) % 2147483648UL;
+    add_score(state / 2147483648.0, sums);
+  }
+
+  num_histories += 1000;
+  statistics.update(num_histories, sums, num_histories / 1000.0);
+}
+//---------------------------------------------------------------------------//
+// SIMPLE TESTS
+//---------------------------------------------------------------------------//
+TEST(TallyStatisticsTest, ComputeStatistics) {
+  TallyStatistics statistics(0.1);
+  double sums[4] = {0.0, 0.0, 0.0, 0.0};
+
+  EXPECT_EQ(0.0, statistics.get_mean());
+  EXPECT_EQ(0.0, statistics.get_rel_error());
+  EXPECT_FALSE(statistics.converged());
+
+  for (unsigned int i = 1; i <= 4; ++i) {
+    add_score(i, sums);
+  }
+
+  statistics.update(4, sums, 60.0);
+
+  EXPECT_EQ(4u, statistics.get_num_histories());
+  EXPECT_EQ(1u, statistics.get_num_batches());
+  EXPECT_DOUBLE_EQ(2.5, statistics.get_mean());
+  EXPECT_DOUBLE_EQ(sqrt(0.05), statistics.get_rel_error());
+  EXPECT_DOUBLE_EQ(0.16, statistics.get_vov());
+  EXPECT_DOUBLE_EQ(20.0, statistics.get_fom());
+
+  // batch means are 2.5 and 0.0
+  statistics.update(4, sums, 120.0);
+  EXPECT_EQ(1u, statistics.get_num_batches());
+  EXPECT_EQ(0.0, statistics.get_batch_rel_error());
+
+  statistics.update(8, sums, 120.0);
+  EXPECT_EQ(2u, statistics.get_num_batches());
+  EXPECT_DOUBLE_EQ(1.0, statistics.get_batch_rel_error());
+  EXPECT_DOUBLE_EQ(1.25, statistics.get_mean());
+}
+//---------------------------------------------------------------------------//
+TEST(TallyStatisticsTest, ResetStatistics) {
+  TallyStatistics statistics(0.1);
+  double sums[4] = {0.0, 0.0, 0.0, 0.0};
+
+  add_score(100.0, sums);
+  add_score(100.0, sums);
+  statistics.update(2, sums, 10.0);
+  statistics.reset(2, sums, 10.0);
+
+  EXPECT_EQ(0u, statistics.get_num_histories());
+  EXPECT_EQ(0u, statistics.get_num_batches());
+  EXPECT_EQ(0.0, statistics.get_mean());
+
+  // only the histories after the reset are included
+  for (unsigned int i = 1; i <= 4; ++i) {
+    add_score(i, sums);
+  }
+
+  statistics.update(6, sums, 70.0);
+
+  EXPECT_EQ(4u, statistics.get_num_histories());
+  EXPECT_DOUBLE_EQ(2.5, statistics.get_mean());
+  EXPECT_DOUBLE_EQ(sqrt(0.05), statistics.get_rel_error());
+  EXPECT_DOUBLE_EQ(0.16, statistics.get_vov());
+  EXPECT_DOUBLE_EQ(20.0, statistics.get_fom());
+}
+//---------------------------------------------------------------------------//
+// Tests that a well behaved tally passes all of the statistical checks
+TEST(TallyStatisticsTest, ConvergedTally) {
+  TallyStatistics statistics(0.01);
+  double sums[4] = {0.0, 0.0, 0.0, 0.0};
+  unsigned long num_histories = 0;
+  unsigned long state = 17;
+
+  // too few updates in the last half
+  for (unsigned int i = 0; i < 3; ++i) {
+    add_batch(statistics, num_histories, sums, state);
+  }
+
+  EXPECT_FALSE(statistics.passed(TallyStatistics::VOV_TARGET));
+  EXPECT_FALSE(statistics.converged());
+
+  for (unsigned int i = 0; i < 97; ++i) {
+    add_batch(statistics, num_histories, sums, state);
+  }
+
+  std::stringstream summary;
+  statistics.write_summary(summary);
+
+  EXPECT_NEAR(0.5, statistics.get_mean(), 0.01);
+  EXPECT_NEAR(sqrt(1.0 / 3.0 / num_histories), statistics.get_rel_error(),
+              1.0e-4);
+  EXPECT_NEAR(statistics.get_rel_error(), statistics.get_batch_rel_error(),
+              0.2 * statistics.get_rel_error());
+  EXPECT_TRUE(statistics.converged()) << summary.str();
+  EXPECT_NE(std::string::npos, summary.str().find("passed: 9 of 9"));
+  EXPECT_EQ(std::string::npos, summary.str().find("not applicable"));
+}
+//---------------------------------------------------------------------------//
+// Tests that a large score late in the run fails the statistical checks
+TEST(TallyStatisticsTest, UnconvergedTally) {
+  TallyStatistics statistics(0.01);
+  double sums[4] = {0.0, 0.0, 0.0, 0.0};
+  unsigned long num_histories = 0;
+  unsigned long state = 17;
+
+  for (unsigned int i = 0; i < 80; ++i) {
+    add_batch(statistics, num_histories, sums, state);
+  }
+
+  EXPECT_TRUE(statistics.converged());
+
+  add_score(1000.0, sums);
+  num_histories += 1;
+  statistics.update(num_histories, sums, num_histories / 1000.0);
+
+  for (unsigned int i = 0; i < 20; ++i) {
+    add_batch(statistics, num_histories, sums, state);
+  }
+
+  EXPECT_FALSE(statistics.passed(TallyStatistics::REL_ERROR_DECREASING));
+  EXPECT_FALSE(statistics.passed(TallyStatistics::VOV_TARGET));
+  EXPECT_FALSE(statistics.passed(TallyStatistics::FOM_CONSTANT));
+  EXPECT_FALSE(statistics.converged());
+
+  // a tally that is not scored never converges
+  TallyStatistics empty(0.01);
+  double zero_sums[4] = {0.0, 0.0, 0.0, 0.0};
+
+  for (unsigned long i = 1; i <= 20; ++i) {
+    empty.update(1000 * i, zero_sums, i);
+  }
+
+  EXPECT_FALSE(empty.passed(TallyStatistics::REL_ERROR_TARGET));
+  EXPECT_FALSE(empty.converged());
+}
+//---------------------------------------------------------------------------//
+// Tests the checks made on the largest relative error over all bins
+TEST(TallyStatisticsTest, SummaryStatistics) {
+  TallyStatistics statistics(0.01, true);
+  EXPECT_TRUE(statistics.is_summary());
+
+  // the relative error decreases as 1/sqrt(N) with a constant FOM
+  for (unsigned long i = 1; i <= 3; ++i) {
+    statistics.update_summary(1000 * i, 0.2 / sqrt(i), i);
+  }
+
+  EXPECT_FALSE(statistics.passed(TallyStatistics::VOV_TARGET));
+  EXPECT_FALSE(statistics.converged());
+
+  for (unsigned long i = 4; i <= 1000; ++i) {
+    statistics.update_summary(1000 * i, 0.2 / sqrt(i), i);
+  }
+
+  std::stringstream summary;
+  statistics.write_summary(summary);
+
+  EXPECT_EQ(1000u, statistics.get_num_batches());
+  EXPECT_DOUBLE_EQ(0.2 / sqrt(1000.0), statistics.get_rel_error());
+  EXPECT_NEAR(60.0 / 0.04, statistics.get_fom(), 1.0e-9);
+  EXPECT_EQ(0.0, statistics.get_mean());
+  EXPECT_EQ(0.0, statistics.get_vov());
+  EXPECT_TRUE(statistics.converged()) << summary.str();
+  EXPECT_NE(std::string::npos, summary.str().find("largest relative error"));
+
+  // the mean and VOV checks are not made, so they are not counted
+  EXPECT_FALSE(statistics.applies(TallyStatistics::MEAN_RANDOM));
+  EXPECT_FALSE(statistics.applies(TallyStatistics::VOV_RATE));
+  EXPECT_TRUE(statistics.applies(TallyStatistics::FOM_RANDOM));
+  EXPECT_FALSE(statistics.passed(TallyStatistics::VOV_TARGET));
+  EXPECT_NE(std::string::npos,
+            summary.str().find("passed: 5 of 5 (4 not applicable)"));
+  EXPECT_NE(std::string::npos,
+            summary.str().find("not applicable: VOV 1/N"));
+
+  // a relative error that stops decreasing fails the checks
+  statistics.update_summary(1001000, 0.1, 1001.0);
+  EXPECT_FALSE(statistics.passed(TallyStatistics::REL_ERROR_TARGET));
+  EXPECT_FALSE(statistics.passed(TallyStatistics::REL_ERROR_DECREASING));
+  EXPECT_FALSE(statistics.converged());
+
+  // a summary without scored bins never converges
+  TallyStatistics empty(0.01, true);
+
+  for (unsigned long i = 1; i <= 20; ++i) {
+    empty.update_summary(1000 * i, 0.0, i);
+  }
+
+  EXPECT_FALSE(empty.passed(TallyStatistics::REL_ERROR_TARGET));
+  EXPECT_FALSE(empty.converged());
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_TallyStatistics.cpp
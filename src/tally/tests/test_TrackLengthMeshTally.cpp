@@ -68,13 +68,68 @@ class TrackLengthMeshTallyTest : public ::testing::Test {
     event.track_length = track_length;
   }
 
+  // scores tracks along +x, each in its own history, with both the
+  // intersection and walk modes, and checks that both give the expected
+  // total and the same score in each tet
+  void compare_walk(const std::string& mesh_file, double y, double z,
+                    const double* starts, const double* lengths,
+                    int num_tracks, double expected_total) {
+    input.tally_type = "unstr_track";
+    input.options.insert(std::make_pair("inp", mesh_file));
+    mesh_tally = Tally::create_tally(input);
+    ASSERT_TRUE(mesh_tally != NULL);
+
+    TallyInput walk_input = input;
+    walk_input.options.insert(std::make_pair("walk", "true"));
+    Tally* walk_tally = Tally::create_tally(walk_input);
+    ASSERT_TRUE(walk_tally != NULL);
+
+    TallyEvent event;
+    make_event(event);
+    double direction[3] = {1.0, 0.0, 0.0};
+    double position[3] = {0.0, y, z};
+
+    for (int i = 0; i < num_tracks; ++i) {
+      position[0] = starts[i];
+      mod_event_3d(event, position, direction, lengths[i]);
+      mesh_tally->compute_score(event);
+      mesh_tally->end_history();
+      walk_tally->compute_score(event);
+      walk_tally->end_history();
+    }
+
+    TallyData data = mesh_tally->getTallyData();
+    TallyData walk_data = walk_tally->getTallyData();
+    int length, walk_length;
+    double* track_data = data.TallyData::get_tally_data(length);
+    double* walk_track_data = walk_data.TallyData::get_tally_data(walk_length);
+    ASSERT_EQ(length, walk_length);
+
+    double total = 0.0;
+    double walk_total = 0.0;
+    for (int i = 0 ; i < length ; i++) {
+      total += track_data[i];
+      walk_total += walk_track_data[i];
+      EXPECT_NEAR(track_data[i], walk_track_data[i], WALK_TOLERANCE);
+    }
+
+    EXPECT_DOUBLE_EQ(expected_total, total);
+    EXPECT_DOUBLE_EQ(expected_total, walk_total);
+
+    delete walk_tally;
+  }
 
  protected:
   // data needed for each test
   Tally* mesh_tally;
   TallyInput input;
+
+  // largest difference between the scores of one tet in the two modes
+  static const double WALK_TOLERANCE;
 };
 
+const double TrackLengthMeshTallyTest::WALK_TOLERANCE = 1e-12;
+
 // Tests Tally constructor for default number of energy bins
 TEST_F(TrackLengthMeshTallyTest, DefaultNumEnergyBins) {
   input.tally_type = "unstr_track";
@@ -1270,3 +1325,232 @@ TEST_F(TrackLengthMeshTallyTest, EnsureVectorTags) {
 
   // all done :)
 }
+
+//---------------------------------------------------------------------------//
+// The following tests repeat every track case from above with "walk" enabled,
+// which must give the same total as intersecting the whole track with the
+// mesh and the same score in each tet.  The two modes find the distance to
+// each tet face with different arithmetic (ray-triangle tests on the kd-tree
+// against barycentric coordinates in the mesh store), so the scores of each
+// tet can differ by rounding and are compared to WALK_TOLERANCE instead.
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkComputeScore1Ray) {
+  double starts[1] = {1.0};
+  double lengths[1] = {1.0};
+  compare_walk("unstructured_mesh.h5m", 0.0, 0.0, starts, lengths, 1, 1.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkComputeScore2Ray) {
+  double starts[2] = {0.0, 2.5};
+  double lengths[2] = {2.5, 2.5};
+  compare_walk("unstructured_mesh.h5m", 0.0, 0.0, starts, lengths, 2, 5.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkComputeScore1RaySplit) {
+  double starts[1] = {0.0};
+  double lengths[1] = {5.0};
+  compare_walk("unstr_mesh_split.h5m", 0.0, 0.0, starts, lengths, 1, 3.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkComputeScore4RaySplit) {
+  double starts[4] = {1.0, 2.0, 3.0, 4.0};
+  double lengths[4] = {1.0, 1.0, 1.0, 1.0};
+  compare_walk("unstr_mesh_split.h5m", 0.0, 0.0, starts, lengths, 4, 2.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkComputeScore5RaySplit) {
+  double starts[5] = {0.0, 1.0, 2.0, 3.0, 4.0};
+  double lengths[5] = {1.0, 1.0, 1.0, 1.0, 1.0};
+  compare_walk("unstr_mesh_split.h5m", 0.0, 0.0, starts, lengths, 5, 3.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkComputeScorePointOnBoundary) {
+  double starts[4] = {1.0, 2.0, 3.0, 4.0};
+  double lengths[4] = {1.0, 1.0, 1.0, 1.0};
+  compare_walk("unstr_mesh_split.h5m", 0.0, 0.0, starts, lengths, 4, 2.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkComputeScorePointOnAdjacentBoundary) {
+  double starts[3] = {2.0, 3.0, 4.0};
+  double lengths[3] = {1.0, 1.0, 1.0};
+  compare_walk("unstr_mesh_split.h5m", 0.0, 0.0, starts, lengths, 3, 2.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkPointOutside5of5RayReEntrantMeshRayOffCenter) {
+  double starts[5] = {-1.0, 1.0, 5.0, 6.0, 10.0};
+  double lengths[5] = {2.0, 4.0, 1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 4.0, 0.5, starts, lengths, 5, 3.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk5of5RayReEntrantMeshRayOffCenter) {
+  double starts[5] = {0.0, 1.0, 5.0, 6.0, 10.0};
+  double lengths[5] = {1.0, 4.0, 1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 4.0, 0.5, starts, lengths, 5, 3.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk4of5RayReEntrantMeshRayOffCenter) {
+  double starts[4] = {1.0, 5.0, 6.0, 10.0};
+  double lengths[4] = {4.0, 1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 4.0, 0.5, starts, lengths, 4, 2.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk3of5RayReEntrantMeshRayOffCenter) {
+  double starts[3] = {5.0, 6.0, 10.0};
+  double lengths[3] = {1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 4.0, 0.5, starts, lengths, 3, 2.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk2of5RayReEntrantMeshRayOffCenter) {
+  double starts[2] = {6.0, 10.0};
+  double lengths[2] = {4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 4.0, 0.5, starts, lengths, 2, 1.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkReEntrantMeshRayOffCenter) {
+  double starts[1] = {0.0};
+  double lengths[1] = {11.0};
+  compare_walk("rune_mesh.h5m", 4.0, 0.5, starts, lengths, 1, 3.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk5of5RayReEntrantMeshRayOnCenter) {
+  double starts[5] = {0.0, 1.0, 5.0, 6.0, 10.0};
+  double lengths[5] = {1.0, 4.0, 1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 0.0, 0.0, starts, lengths, 5, 11.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk5of5RayReEntrantMeshRayOffCenterY) {
+  double starts[5] = {0.0, 1.0, 5.0, 6.0, 10.0};
+  double lengths[5] = {1.0, 4.0, 1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 0.5, 0.0, starts, lengths, 5, 11.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk5of5RayReEntrantMeshRayOffCenterY2) {
+  double starts[5] = {0.0, 1.0, 5.0, 6.0, 10.0};
+  double lengths[5] = {1.0, 4.0, 1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 0.51, 0.0, starts, lengths, 5, 3.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk5of5RayReEntrantMeshRayOffCenterY2Z) {
+  double starts[5] = {0.0, 1.0, 5.0, 6.0, 10.0};
+  double lengths[5] = {1.0, 4.0, 1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 0.51, 2.0, starts, lengths, 5, 3.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk5of5RayReEntrantMeshRayOffCenterY2Z2) {
+  double starts[5] = {0.0, 1.0, 5.0, 6.0, 10.0};
+  double lengths[5] = {1.0, 4.0, 1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 5.0, 5.0, starts, lengths, 5, 3.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, Walk5of5RayReEntrantMeshRayOffCenterY3Z3) {
+  double starts[5] = {0.0, 1.0, 5.0, 6.0, 10.0};
+  double lengths[5] = {1.0, 4.0, 1.0, 4.0, 1.0};
+  compare_walk("rune_mesh.h5m", 5.01, 5.01, starts, lengths, 5, 0.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkHashtagMeshReentrantSeparateTracks_1) {
+  double starts[5] = {-50.0, -30.0, -20.0, 20.0, 30.0};
+  double lengths[5] = {20.0, 10.0, 40.0, 10.0, 20.0};
+  compare_walk("hashtag_mesh.h5m", 18.0, 2.0, starts, lengths, 5, 20.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkHashtagMeshReentrantSeparateTracks_2) {
+  double starts[5] = {-50.0, -30.0, -20.0, 20.0, 30.0};
+  double lengths[5] = {20.0, 10.0, 40.0, 10.0, 20.0};
+  compare_walk("hashtag_mesh.h5m", -7.0, 0.0, starts, lengths, 5, 20.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkHashtagMeshReentrantSeparateTracks_3) {
+  double starts[5] = {-50.0, -30.0, -20.0, 20.0, 30.0};
+  double lengths[5] = {20.0, 10.0, 40.0, 10.0, 20.0};
+  compare_walk("hashtag_mesh.h5m", 11.0, 3.0, starts, lengths, 5, 20.0);
+}
+
+//---------------------------------------------------------------------------//
+TEST_F(TrackLengthMeshTallyTest, WalkComputeScoreTallyManager1Ray) {
+  input.tally_type = "unstr_track";
+  input.options.insert(std::make_pair("inp", "unstructured_mesh.h5m"));
+  input.options.insert(std::make_pair("walk", "true"));
+
+  // dummy variable to prevent segfault during teardown
+  mesh_tally = Tally::create_tally(input);
+
+  // neutron and proton
+  unsigned int particles[2] = {1, 9};
+
+  for (int p = 0; p < 2; ++p) {
+    TallyEvent event;
+    make_event(event);
+    event.particle = particles[p];
+
+    TallyManager tallyManager;
+    tallyManager.addNewTally(input.tally_id, input.tally_type, event.particle,
+                             input.energy_bin_bounds, input.options);
+
+    mod_event(event, 1.0, 1.0, 1.0);
+    tallyManager.setTrackEvent(event.particle,
+                               event.position[0], event.position[1], event.position[2],
+                               event.direction[0], event.direction[1], event.direction[2],
+                               event.particle_energy, event.particle_weight, event.track_length,
+                               event.current_cell);
+    tallyManager.updateTallies();
+    tallyManager.endHistory();
+
+    int length;
+    double* track_data = tallyManager.getTallyData(input.tally_id, length);
+
+    double total = 0.0;
+    for (int i = 0; i < length; i++)
+      total += track_data[i];
+
+    EXPECT_EQ(total, event.track_length);
+  }
+}
+
+//---------------------------------------------------------------------------//
+// Tests the flat mesh store holds vertices, connectivity, volumes,
+// neighbours and barycentric matrices for every tet
+TEST_F(TrackLengthMeshTallyTest, MeshStoreFootprint) {
+  input.tally_type = "unstr_track";
+  input.options.insert(std::make_pair("inp", "unstructured_mesh.h5m"));
+  mesh_tally = Tally::create_tally(input);
+  EXPECT_TRUE(mesh_tally != NULL);
+
+  moab::TrackLengthMeshTally* tl_tally =
+      dynamic_cast<moab::TrackLengthMeshTally*>(mesh_tally);
+  ASSERT_TRUE(tl_tally != NULL);
+
+  TallyData data = mesh_tally->getTallyData();
+  int length;
+  data.TallyData::get_tally_data(length);
+  unsigned long num_tets = length / data.get_num_energy_bins();
+  ASSERT_GT(num_tets, 0u);
+
+  // per tet: 4 vertex indices, volume, 4 neighbours and a 3x3 matrix,
+  // plus at least 4 vertices worth of coordinates shared across the mesh
+  unsigned long per_tet = 4 * sizeof(uint32_t) + sizeof(double) +
+                          4 * sizeof(int32_t) + sizeof(moab::Matrix3);
+  EXPECT_GE(tl_tally->mesh_store_bytes(),
+            num_tets * per_tet + 4 * 3 * sizeof(double));
+}
@@ -0,0 +1,185 @@
+// MCNP5/dagmc/test/test_VTKMeshWriter.cpp
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../VTKMeshWriter.hpp"
+
+//---------------------------------------------------------------------------//
+// TEST FIXTURES
+//---------------------------------------------------------------------------//
+class VTKMeshWriterTest : public ::testing::Test {
+ protected:
+  // initialize variables for each test
+  virtual void SetUp() {
+    filename = "test_vtk_mesh_writer.vtk";
+  }
+
+  // remove the output file
+  virtual void TearDown() {
+    std::remove(filename.c_str());
+  }
+
+  // reads the next line of text from the output file
+  std::string read_line() {
+    std::string line;
+    std::getline(file, line);
+    return line;
+  }
+
+  // reads count big-endian values from the output file
+  template <typename T>
+  std::vector<T> read_values(unsigned long count) {
+    std::vector<T> values(count);
+
+    for (unsigned long i = 0; i < count; ++i) {
+      char bytes[sizeof(T)];
+      file.read(bytes, sizeof(T));
+      std::reverse(bytes, bytes + sizeof(T));
+      std::memcpy(&values[i], bytes, sizeof(T));
+    }
+
+    // skip the end of line after the values
+    file.get();
+    return values;
+  }
+
+ protected:
+  // data needed for each test
+  std::string filename;
+  std::ifstream file;
+};
+//---------------------------------------------------------------------------//
+// FIXTURE-BASED TESTS: VTKMeshWriterTest
+//---------------------------------------------------------------------------//
+// Tests that a tet mesh and its cell data are written in the legacy format
+TEST_F(VTKMeshWriterTest, WriteTetMesh) {
+  double coords[] = {0.0, 0.0, 0.0,
+                     1.0, 0.0, 0.0,
+                     0.0, 1.0, 0.0,
+                     0.0, 0.0, 1.0,
+                     1.0, 1.0, 1.0
+                    };
+
+  uint32_t connectivity[] = {0, 1, 2, 3, 1, 2, 3, 4};
+  double results[] = {1.5, 2.5, 3.5, -4.5, 5.5, 6.5};
+  double totals[] = {7.5, 8.25};
+
+  VTKMeshWriter writer(filename, "test mesh");
+  writer.write_points(coords, 5);
+  writer.write_cells(connectivity, 4, 2, VTKMeshWriter::TETRA);
+  writer.begin_cell_data(2, 2);
+  writer.write_field("TALLY_TAG", results, 3);
+  writer.write_field("TALLY_TAG_TOTAL", totals, 1);
+  ASSERT_TRUE(writer.close());
+
+  file.open(filename.c_str(), std::ios::binary);
+  ASSERT_TRUE(file.is_open());
+
+  EXPECT_EQ("# vtk DataFile Version 3.0", read_line());
+  EXPECT_EQ("test mesh", read_line());
+  EXPECT_EQ("BINARY", read_line());
+  EXPECT_EQ("DATASET UNSTRUCTURED_GRID", read_line());
+
+  EXPECT_EQ("POINTS 5 double", read_line());
+  std::vector<double> points = read_values<double>(15);
+
+  for (unsigned int i = 0; i < 15; ++i) {
+    EXPECT_EQ(coords[i], points[i]);
+  }
+
+  EXPECT_EQ("CELLS 2 10", read_line());
+  std::vector<int32_t> cells = read_values<int32_t>(10);
+  EXPECT_EQ(4, cells[0]);
+  EXPECT_EQ(3, cells[4]);
+  EXPECT_EQ(4, cells[5]);
+  EXPECT_EQ(4, cells[9]);
+
+  EXPECT_EQ("CELL_TYPES 2", read_line());
+  std::vector<int32_t> types = read_values<int32_t>(2);
+  EXPECT_EQ(10, types[0]);
+  EXPECT_EQ(10, types[1]);
+
+  EXPECT_EQ("CELL_DATA 2", read_line());
+  EXPECT_EQ("FIELD FieldData 2", read_line());
+  EXPECT_EQ("TALLY_TAG 3 2 double", read_line());
+  std::vector<double> values = read_values<double>(6);
+
+  for (unsigned int i = 0; i < 6; ++i) {
+    EXPECT_EQ(results[i], values[i]);
+  }
+
+  EXPECT_EQ("TALLY_TAG_TOTAL 1 2 double", read_line());
+  values = read_values<double>(2);
+  EXPECT_EQ(7.5, values[0]);
+  EXPECT_EQ(8.25, values[1]);
+
+  // nothing else was written
+  EXPECT_EQ(EOF, file.peek());
+}
+//---------------------------------------------------------------------------//
+// Tests that meshes larger than the conversion buffer are written in full
+TEST_F(VTKMeshWriterTest, WriteLargeMesh) {
+  const unsigned long num_points = 20000;
+  std::vector<double> coords(3 * num_points);
+  std::vector<uint32_t> connectivity(num_points);
+
+  for (unsigned long i = 0; i < num_points; ++i) {
+    coords[3 * i] = 0.5 * i;
+    coords[3 * i + 1] = -1.0 * i;
+    coords[3 * i + 2] = 2.0;
+    connectivity[i] = num_points - 1 - i;
+  }
+
+  VTKMeshWriter writer(filename);
+  writer.write_points(coords.data(), num_points);
+  writer.write_cells(connectivity.data(), 1, num_points, VTKMeshWriter::VERTEX);
+  writer.begin_point_data(num_points, 1);
+  writer.write_field("ERROR_TAG", coords.data(), 3);
+  ASSERT_TRUE(writer.close());
+
+  file.open(filename.c_str(), std::ios::binary);
+
+  for (unsigned int i = 0; i < 4; ++i) {
+    read_line();
+  }
+
+  EXPECT_EQ("POINTS 20000 double", read_line());
+  EXPECT_TRUE(coords == read_values<double>(3 * num_points));
+
+  EXPECT_EQ("CELLS 20000 40000", read_line());
+  std::vector<int32_t> cells = read_values<int32_t>(2 * num_points);
+
+  for (unsigned long i = 0; i < num_points; ++i) {
+    ASSERT_EQ(1, cells[2 * i]);
+    ASSERT_EQ((int32_t)connectivity[i], cells[2 * i + 1]);
+  }
+
+  EXPECT_EQ("CELL_TYPES 20000", read_line());
+  std::vector<int32_t> types = read_values<int32_t>(num_points);
+  EXPECT_EQ(num_points, (unsigned long)std::count(types.begin(), types.end(), 1));
+
+  EXPECT_EQ("POINT_DATA 20000", read_line());
+  EXPECT_EQ("FIELD FieldData 1", read_line());
+  EXPECT_EQ("ERROR_TAG 3 20000 double", read_line());
+  EXPECT_TRUE(coords == read_values<double>(3 * num_points));
+  EXPECT_EQ(EOF, file.peek());
+}
+//---------------------------------------------------------------------------//
+// Tests that an error is returned if the file cannot be written
+TEST_F(VTKMeshWriterTest, InvalidFile) {
+  double coords[] = {0.0, 0.0, 0.0};
+
+  VTKMeshWriter writer("missing_directory/test.vtk");
+  writer.write_points(coords, 1);
+  EXPECT_FALSE(writer.close());
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_VTKMeshWriter.cpp
@@ -0,0 +1,132 @@
+// MCNP5/dagmc/test/test_WeightWindowGenerator.cpp
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../WeightWindowGenerator.hpp"
+
+//---------------------------------------------------------------------------//
+// TEST FIXTURES
+//---------------------------------------------------------------------------//
+class WeightWindowGeneratorTest : public ::testing::Test {
+ protected:
+  // initialize variables for each test
+  virtual void SetUp() {
+    // four tally points with two energy groups
+    const double result_values[] = {2.0, 8.0,
+                                    4.0, 0.0,
+                                    1.0, 2.0,
+                                    0.5, 16.0
+                                   };
+
+    const double error_values[] = {0.1, 0.05,
+                                   0.2, 0.0,
+                                   0.3, 0.7,
+                                   0.4, 0.6
+                                  };
+
+    results.assign(result_values, result_values + 8);
+    rel_errors.assign(error_values, error_values + 8);
+  }
+
+ protected:
+  // data needed for each test
+  std::vector<double> results;
+  std::vector<double> rel_errors;
+  std::vector<double> lower_bounds;
+};
+//---------------------------------------------------------------------------//
+// SIMPLE TESTS
+//---------------------------------------------------------------------------//
+TEST(WeightWindowMethodTest, ParseMethod) {
+  WeightWindowGenerator::Method method = WeightWindowGenerator::MAGIC;
+
+  EXPECT_TRUE(WeightWindowGenerator::parse_method("adjoint", method));
+  EXPECT_EQ(WeightWindowGenerator::ADJOINT, method);
+  EXPECT_TRUE(WeightWindowGenerator::parse_method("magic", method));
+  EXPECT_EQ(WeightWindowGenerator::MAGIC, method);
+
+  EXPECT_FALSE(WeightWindowGenerator::parse_method("cadis", method));
+  EXPECT_EQ(WeightWindowGenerator::MAGIC, method);
+
+  EXPECT_DOUBLE_EQ(0.5, WeightWindowGenerator::default_normalization(
+                     WeightWindowGenerator::MAGIC));
+  EXPECT_DOUBLE_EQ(1.0, WeightWindowGenerator::default_normalization(
+                     WeightWindowGenerator::ADJOINT));
+}
+//---------------------------------------------------------------------------//
+// FIXTURE-BASED TESTS: WeightWindowGeneratorTest
+//---------------------------------------------------------------------------//
+// Tests that the magic method is normalized by the largest reliable result
+TEST_F(WeightWindowGeneratorTest, MagicMethod) {
+  WeightWindowGenerator generator(WeightWindowGenerator::MAGIC, 0.5, 0.5);
+  std::vector<double> previous;
+
+  EXPECT_EQ(5u, generator.generate(2, results, rel_errors, previous,
+                                   lower_bounds));
+  ASSERT_EQ(8u, lower_bounds.size());
+
+  // group 0 has a largest result of 4.0 and group 1 of 8.0
+  EXPECT_DOUBLE_EQ(0.25, lower_bounds[0]);
+  EXPECT_DOUBLE_EQ(0.5, lower_bounds[1]);
+  EXPECT_DOUBLE_EQ(0.5, lower_bounds[2]);
+  EXPECT_EQ(0.0, lower_bounds[3]);
+  EXPECT_DOUBLE_EQ(0.125, lower_bounds[4]);
+  EXPECT_EQ(0.0, lower_bounds[5]);
+  EXPECT_DOUBLE_EQ(0.0625, lower_bounds[6]);
+  EXPECT_EQ(0.0, lower_bounds[7]);
+}
+//---------------------------------------------------------------------------//
+// Tests that the adjoint method uses the inverse of the importance
+TEST_F(WeightWindowGeneratorTest, AdjointMethod) {
+  WeightWindowGenerator generator(WeightWindowGenerator::ADJOINT, 2.0, 0.65);
+  std::vector<double> previous;
+
+  EXPECT_EQ(6u, generator.generate(2, results, rel_errors, previous,
+                                   lower_bounds));
+  ASSERT_EQ(8u, lower_bounds.size());
+
+  EXPECT_DOUBLE_EQ(1.0, lower_bounds[0]);
+  EXPECT_DOUBLE_EQ(0.25, lower_bounds[1]);
+  EXPECT_DOUBLE_EQ(0.5, lower_bounds[2]);
+  EXPECT_EQ(0.0, lower_bounds[3]);
+  EXPECT_DOUBLE_EQ(2.0, lower_bounds[4]);
+  EXPECT_EQ(0.0, lower_bounds[5]);
+  EXPECT_DOUBLE_EQ(4.0, lower_bounds[6]);
+  EXPECT_DOUBLE_EQ(0.125, lower_bounds[7]);
+}
+//---------------------------------------------------------------------------//
+// Tests that unreliable results keep the previous lower bounds
+TEST_F(WeightWindowGeneratorTest, PreviousWeightWindows) {
+  WeightWindowGenerator generator(WeightWindowGenerator::MAGIC, 1.0, 0.25);
+  std::vector<double> previous(8, 0.75);
+  previous[5] = 0.0;
+
+  EXPECT_EQ(3u, generator.generate(2, results, rel_errors, previous,
+                                   lower_bounds));
+  ASSERT_EQ(8u, lower_bounds.size());
+
+  EXPECT_DOUBLE_EQ(0.5, lower_bounds[0]);
+  EXPECT_DOUBLE_EQ(1.0, lower_bounds[1]);
+  EXPECT_DOUBLE_EQ(1.0, lower_bounds[2]);
+  EXPECT_DOUBLE_EQ(0.75, lower_bounds[3]);
+  EXPECT_DOUBLE_EQ(0.75, lower_bounds[4]);
+  EXPECT_EQ(0.0, lower_bounds[5]);
+  EXPECT_DOUBLE_EQ(0.75, lower_bounds[6]);
+  EXPECT_DOUBLE_EQ(0.75, lower_bounds[7]);
+
+  // the next iteration only replaces the reliable results
+  results[7] = 32.0;
+  rel_errors[7] = 0.1;
+  previous = lower_bounds;
+
+  EXPECT_EQ(4u, generator.generate(2, results, rel_errors, previous,
+                                   lower_bounds));
+  EXPECT_DOUBLE_EQ(0.25, lower_bounds[1]);
+  EXPECT_DOUBLE_EQ(0.75, lower_bounds[4]);
+  EXPECT_DOUBLE_EQ(1.0, lower_bounds[7]);
+}
+//---------------------------------------------------------------------------//
+
+// end of MCNP5/dagmc/test/test_WeightWindowGenerator.cpp